@@ -191,6 +191,8 @@ macro (oiio_add_all_tests)
     oiio_add_tests (${all_texture_tests}
                     SUFFIX ".batch"
                     ENVIRONMENT TESTTEX_BATCH=1)
+    # Lookup order must match the pixel order, so no batch variant
+    oiio_add_tests (texture-trace)
 
     # Tests that require oiio-images:
     oiio_add_tests (gpsread
@@ -667,6 +667,11 @@ bool OIIO_API rotate (ImageBuf &dst, const ImageBuf &src,
 /// lanczos3 when downsizing).  The filter is used to weight the `src`
 /// pixels falling underneath it for each `dst` pixel; the filter's size is
 /// expressed in pixel units of the `dst` image.
+///
+/// Separable filters (all of the named ones except "disk", "radial-lanczos3"
+/// and "nuke-lanczos6") are applied in two passes, horizontally and then
+/// vertically, so the cost per `dst` pixel grows with the filter width
+/// rather than with its area.
 
 ImageBuf OIIO_API resize(const ImageBuf &src, KWArgs options = {},
                          ROI roi = {}, int nthreads = 0);
@@ -1564,6 +1569,47 @@ std::vector<imagesize_t> histogram (const ImageBuf &src, int channel=0,
                                     ROI roi={}, int nthreads=0);
 
 
+/// Bit flags for `analyze()`, selecting which results to compute.
+enum AnalyzeFlags {
+    AnalyzeStats      = 1,   ///< Pixel statistics, as computePixelStats()
+    AnalyzeConstant   = 2,   ///< Constant color test, as isConstantColor()
+    AnalyzeMonochrome = 4,   ///< Monochrome test, as isMonochrome()
+    AnalyzeOpaque     = 8,   ///< Is alpha 1 everywhere?
+    AnalyzeHistogram  = 16,  ///< 256 bin histogram of each channel
+    AnalyzeHash       = 32,  ///< SHA-1 hash of the pixels
+    AnalyzeAll        = 63
+};
+
+/// The results of `analyze()`. Members whose flag was not requested keep
+/// their default values.
+struct ImageAnalysis {
+    /// Same as `computePixelStats(src, roi)`.
+    PixelStats stats;
+    /// Same as `isConstantColor(src, 0.0f, constant_color, roi)`.
+    bool constant = false;
+    std::vector<float> constant_color;
+    /// Same as `isMonochrome(src, 0.0f, roi)`.
+    bool monochrome = false;
+    /// True if the alpha channel is exactly 1 in every pixel, or if the
+    /// ROI doesn't include an alpha channel.
+    bool opaque = false;
+    /// For each channel in the ROI, `histogram(src, c, 256, 0.0f, 1.0f,
+    /// false, roi)`. Channels outside the ROI have empty vectors.
+    std::vector<std::vector<imagesize_t>> histogram;
+    /// Same as `computePixelHashSHA1(src, "", roi, 256)`.
+    std::string sha1;
+};
+
+/// Compute any combination of the results selected by `flags` (a bitwise
+/// OR of `AnalyzeFlags`) for the ROI of `src`, all in a single pass over
+/// the pixels. This is much cheaper for big images than calling the
+/// individual functions one after another. Deep images are not supported.
+/// If there is a failure, `stats` will have vectors of size 0 and an error
+/// will be set in src.
+ImageAnalysis OIIO_API analyze (const ImageBuf &src, int flags = AnalyzeAll,
+                                ROI roi={}, int nthreads=0);
+
+
 /// Make a 1-channel `float` image of the named kernel. The size of the
 /// image will be big enough to contain the kernel given its size (`width` x
 /// `height`) and rounded up to odd resolution so that the center of the
@@ -1593,6 +1639,11 @@ ImageBuf OIIO_API make_kernel (string_view name, float width, float height,
 /// it defaults to the full size `src`. If `normalized` is true, the kernel will
 /// be normalized for the  convolution, otherwise the original values will
 /// be used.
+///
+/// Separable 2D kernels (such as the gaussian and box kernels made by
+/// `make_kernel()`) are applied as a horizontal pass followed by a vertical
+/// one, and other 2D kernels of 16x16 or more taps are applied with FFTs.
+/// Both match the direct sum to within floating point roundoff.
 ImageBuf OIIO_API convolve (const ImageBuf &src, const ImageBuf &kernel,
                             bool normalize = true, ROI roi={}, int nthreads=0);
 /// Write to an existing image `dst` (allocating if it is uninitialized).
@@ -1752,6 +1803,10 @@ bool OIIO_API fillholes_pushpull (ImageBuf &dst, const ImageBuf &src,
 /// Median filters are good for removing high-frequency detail smaller than
 /// the window size (including noise), without blurring edges that are
 /// larger than the window size.
+///
+/// For 8 and 16 bit (including half) images, larger windows are filtered
+/// with a sliding histogram, whose cost grows with the window's width
+/// rather than its area.
 ImageBuf OIIO_API median_filter (const ImageBuf &src,
                                  int width = 3, int height = -1,
                                  ROI roi={}, int nthreads=0);
@@ -1798,6 +1853,9 @@ bool OIIO_API unsharp_mask (ImageBuf &dst, const ImageBuf &src,
 /// If height is not set, it will default to be the same as width. Dilation
 /// makes bright features wider and more prominent, dark features thinner,
 /// and removes small isolated dark spots.
+///
+/// Both dilate and erode are computed separably, with a cost per pixel that
+/// doesn't depend on the size of the structuring element.
 ImageBuf OIIO_API dilate (const ImageBuf &src, int width=3, int height=-1,
                           ROI roi={}, int nthreads=0);
 /// Write to an existing image `dst` (allocating if it is uninitialized).
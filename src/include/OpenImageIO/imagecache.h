@@ -219,6 +219,161 @@ public:
     ///           enabled, this reduces the number of file opens, at the
     ///           expense of not being able to open files if their format do
     ///           not actually match their filename extension). Default: 0
+    /// - `int prefetch_threads` :
+    ///           The number of background threads used to service
+    ///           `prefetch()` requests and read-ahead. The threads are only
+    ///           created the first time a prefetch is requested. Setting it
+    ///           to 0 turns prefetching off entirely. (Default: 2)
+    /// - `int readahead` :
+    ///           When nonzero, every tile that misses the cache also queues
+    ///           an asynchronous read of its right and lower neighbors and of
+    ///           the tile covering the same region on the next coarser MIP
+    ///           level, overlapping that I/O with the caller's work.
+    ///           (Default: 0)
+    /// - `int get_pixels_threads` :
+    ///           The most threads that one `get_pixels()` call (or
+    ///           TextureSystem `get_texels()` call) uses to fetch a region
+    ///           that spans several tiles. The region is split on tile
+    ///           boundaries, and the pieces are fetched by the threads of
+    ///           the shared thread pool, so that reads of the tiles not in
+    ///           the cache proceed concurrently. 0 means as many threads as
+    ///           the pool has, 1 fetches everything on the calling thread.
+    ///           Calls made from within a pool thread never fan out.
+    ///           (Default: 0)
+    /// - `int microcache_size` :
+    ///           Besides the last two tiles it used, each thread keeps this
+    ///           many recently used tiles in a small private
+    ///           set-associative cache that is consulted before the shared
+    ///           tile cache. The value is rounded up to a power of two (at
+    ///           least 4, at most 256); 0 disables it. Note that tiles held
+    ///           this way stay in memory even if they are evicted from the
+    ///           shared cache, until the thread replaces them or the cache
+    ///           is invalidated, so with many threads the cache may use up
+    ///           to (threads x `microcache_size`) tiles more memory than
+    ///           `max_memory_MB`. (Default: 0)
+    /// - `string eviction_policy` :
+    ///           How tiles are chosen for removal when the cache exceeds
+    ///           `max_memory_MB`. `"clock"` uses a single clock hand that
+    ///           sweeps the whole cache. `"sharded_clock"` runs an
+    ///           independent clock in each of many shards, so threads
+    ///           freeing memory at the same time don't serialize on one
+    ///           sweep. `"slru"` (segmented LRU) is also sharded, and also
+    ///           protects tiles that are used repeatedly (such as the
+    ///           coarse MIP levels) from being displaced by tiles that are
+    ///           used only once. (Default: "clock")
+    /// - `int compress_tiles` :
+    ///           When nonzero, tiles evicted from memory are kept in a
+    ///           losslessly compressed form (byte planes, then deflate),
+    ///           taking up to half of `max_memory_MB`, and are unpacked
+    ///           again when next needed instead of being re-read from the
+    ///           file. Tiles that don't compress well are simply dropped.
+    ///           This trades some CPU for effectively holding more tiles
+    ///           in the same memory, most of all for half and 8 bit
+    ///           textures. (Default: 0)
+    /// - `string diskcache_dir` :
+    ///           If not empty, the directory (created if necessary) of a
+    ///           second-level tile cache on local disk. Tiles evicted from
+    ///           memory are written there uncompressed, and tile misses
+    ///           look there before going back to the original file, which
+    ///           saves repeated decompression and network I/O when the
+    ///           memory limit forces textures to be re-read. Tiles are
+    ///           keyed by the file's fingerprint (or its name, modification
+    ///           time and size), the color spaces and OCIO config of any
+    ///           color transform, and the cache options that change the
+    ///           decoded pixels, so several processes may share the
+    ///           directory, and its contents stay valid across runs. See
+    ///           `diskcache_max_MB` for how it is kept from growing without
+    ///           bound. (Default: "")
+    /// - `int diskcache_mmap` :
+    ///           When nonzero (and `diskcache_dir` is set), the disk cache
+    ///           files are memory-mapped, and tiles found there are used in
+    ///           place rather than copied into the cache's own memory. The
+    ///           pages are shared by every process mapping the same files,
+    ///           and do not count toward `max_memory_MB` (see
+    ///           `stat:mapped_memory_used`). Only tiles that have been
+    ///           spilled to the disk cache are mapped: tiles of the
+    ///           original image files, even uncompressed ones, are always
+    ///           read into the cache's memory, since their layout on disk
+    ///           is private to the format reader. Not available on Windows.
+    ///           (Default: 0)
+    /// - `int diskcache_max_MB` :
+    ///           The most disk space the files in `diskcache_dir` may take
+    ///           up. Whenever a new cache file takes the directory over the
+    ///           limit, the least recently used files are removed until it
+    ///           is within it again. 0 means no limit. (Default: 10240)
+    /// - `string header_catalog` :
+    ///           If not empty, the path of a persistent catalog of image
+    ///           headers. The spec of every subimage and MIP level of each
+    ///           file the cache opens is appended to it, and when a later
+    ///           process first needs the header of a file whose name,
+    ///           modification time and size match a catalog entry, the
+    ///           cache's record of the file is built from the catalog
+    ///           without opening the file (which is then only opened once
+    ///           its pixels are needed). Any mismatch falls back to opening
+    ///           the file, and if the file has changed by the time its
+    ///           pixels are needed, its headers are read again. The catalog
+    ///           may be shared by several processes, and is rewritten
+    ///           without superseded entries when it is loaded and they make
+    ///           up half of it. Default: "" (no catalog).
+    /// - `string shared_pool` :
+    ///           If not empty, the name of a POSIX shared memory segment
+    ///           (such as "/oiio_tiles") holding a tile pool shared by
+    ///           every process on the host that names the same segment.
+    ///           Tiles are read from their files straight into the pool,
+    ///           and a tile another process has already read is used in
+    ///           place, so concurrent renders of the same textures keep a
+    ///           single copy of each tile. The segment is created (only
+    ///           accessible to the user) by the first process to use it,
+    ///           and removed when the last one detaches; the tiles held or
+    ///           being read by processes that die are taken back by the
+    ///           others. At most 64 caches may be attached at once, and
+    ///           they must share a process id namespace. The pool's size
+    ///           bounds the memory of the shared tiles, but there is no
+    ///           host-wide budget beyond it: shared tiles still count
+    ///           toward each process's own `max_memory_MB`, which bounds
+    ///           how many of them it holds on to; since those pages are
+    ///           not duplicated, the limit can be raised accordingly. Not
+    ///           available on Windows. (Default: "")
+    /// - `int shared_pool_MB` :
+    ///           Size of the tile pool when this process creates the
+    ///           `shared_pool` segment, which is the memory budget of all
+    ///           the processes sharing it. Set it before `shared_pool`; an
+    ///           existing segment keeps the size it was created with.
+    ///           (Default: 4096)
+    /// - `int shared_pool_tile_KB` :
+    ///           Size of each slot of a newly created `shared_pool`. Tiles
+    ///           bigger than this (not counting a small amount of padding)
+    ///           are kept in the process's own memory instead; smaller
+    ///           ones still take a whole slot. The default fits a 64x64
+    ///           tile of four float channels. (Default: 64)
+    /// - `int access_stats` :
+    ///           When nonzero, keep per-file, per-MIP-level counts of the
+    ///           tiles found in the cache and read from the file (and how
+    ///           many of those reads were redundant), and of the time
+    ///           spent reading, waiting for other threads' reads, and
+    ///           decompressing. They appear in `getstats()` at level 2 and
+    ///           above and in `getstats_json()`, and are retrieved for one
+    ///           file with `get_image_info()` as sized arrays (one entry
+    ///           per MIP level) named `stat:mip_hits`, `stat:mip_misses`,
+    ///           `stat:mip_redundant_tiles` (int64), and
+    ///           `stat:mip_io_time`, `stat:mip_wait_time`,
+    ///           `stat:mip_decompress_time` (float). Tiles found among a
+    ///           thread's few most recently used ones are not counted as
+    ///           hits. (Default: 0)
+    /// - `int deduplicate_tiles` :
+    ///           When nonzero, each tile read from a file is compared
+    ///           (by a hash of its pixels, then byte for byte) with the
+    ///           tiles already in memory, and tiles whose pixels are
+    ///           identical share one copy. This saves memory for texture
+    ///           sets with many repeated tiles, such as constant or
+    ///           tiling regions, or the same image saved under several
+    ///           names, at the cost of hashing every tile as it is read.
+    ///           Tiles in the `shared_pool` or used in place from a mapped
+    ///           disk cache are not deduplicated. Pixels shared by several
+    ///           tiles don't count toward `max_memory_MB` (evicting one
+    ///           of the tiles wouldn't free them), and deduplicated tiles
+    ///           aren't written to the disk cache or compressed when they
+    ///           are evicted. (Default: 0)
     /// - `string colorspace` :
     ///           The working colorspace of the texture system. Default: none.
     /// - `string colorconfig` :
@@ -311,6 +466,120 @@ public:
     ///           Total time (across all threads) that threads spent looking
     ///           up individual tiles.
     ///
+    /// - `int64 stat:find_tile_microcache_assoc_hits` :
+    ///           Number of tile lookups satisfied by the per-thread
+    ///           set-associative microcache (see `microcache_size`).
+    ///
+    /// - `float stat:tile_wait_time` :
+    ///           Total time (across all threads) that threads spent waiting
+    ///           for a tile that another thread (or a prefetch) was still
+    ///           reading.
+    ///
+    /// - `int64 stat:tiles_evicted` :
+    ///           Number of tiles removed from the cache to stay within the
+    ///           memory limit.
+    ///
+    /// - `int64 stat:tiles_promoted` :
+    ///           Number of tiles moved to the protected segment by the
+    ///           `"slru"` eviction policy because they were used again.
+    ///
+    /// - `int64 stat:tiles_unevictable` :
+    ///           Number of times the sharded eviction policies passed over
+    ///           a tile because it could not be freed yet (its pixels were
+    ///           still being read).
+    ///
+    /// - `int64 stat:prefetch_requests` :
+    ///           Number of tiles queued for asynchronous reading by
+    ///           `prefetch()` or read-ahead.
+    ///
+    /// - `int64 stat:prefetch_reads` :
+    ///           Number of tiles actually read by the prefetch threads.
+    ///
+    /// - `int64 stat:prefetch_dropped` :
+    ///           Number of prefetch requests discarded because the queue was
+    ///           full.
+    ///
+    /// - `int64 stat:diskcache_hits` :
+    /// - `int64 stat:diskcache_misses` :
+    ///           Number of tile reads satisfied by the disk cache (see
+    ///           `diskcache_dir`), and number that had to go to the file.
+    ///
+    /// - `int64 stat:diskcache_spills` :
+    ///           Number of evicted tiles written to the disk cache.
+    ///
+    /// - `int64 stat:diskcache_bytes_read` :
+    /// - `int64 stat:diskcache_bytes_written` :
+    ///           Bytes of tile data read from and written to the disk cache.
+    ///
+    /// - `int64 stat:batched_reads` :
+    /// - `int64 stat:batched_tiles` :
+    ///           Tile misses on a file that arrive while another thread is
+    ///           reading from it are queued and read together, with runs
+    ///           of adjacent tiles read by one call. These count the calls
+    ///           that read more than one tile, and the tiles they read.
+    ///
+    /// - `float stat:udim_inventory_time` :
+    /// - `float stat:udim_resolve_time` :
+    ///           Time spent finding the tiles of UDIM patterns (listing
+    ///           their directories, which is done again only if the
+    ///           directory has changed or a file in it was invalidated,
+    ///           and matching the entries), and time spent
+    ///           resolving the tiles to cached files, which is done for all
+    ///           the tiles of a pattern at once when the first one is used.
+    ///
+    /// - `int64 stat:catalog_hits` :
+    /// - `int64 stat:catalog_misses` :
+    ///           Number of files whose headers were taken from the header
+    ///           catalog (see `header_catalog`), and number that had to be
+    ///           opened to read them.
+    ///
+    /// - `int64 stat:tiles_compressed` :
+    /// - `int64 stat:tiles_decompressed` :
+    ///           Number of evicted tiles packed into the compressed tier
+    ///           (see `compress_tiles`), and number unpacked back out of it.
+    ///
+    /// - `int64 stat:compressed_raw_bytes` :
+    /// - `int64 stat:compressed_bytes` :
+    ///           Total size of the tiles packed into the compressed tier,
+    ///           before and after compression.
+    ///
+    /// - `int64 stat:compressed_memory_used` :
+    ///           Memory currently held by compressed tiles (this is part of
+    ///           `stat:cache_memory_used`).
+    ///
+    /// - `float stat:decompress_time` :
+    ///           Total time (across all threads) spent unpacking tiles.
+    ///
+    /// - `int64 stat:tiles_mapped` :
+    ///           Number of tiles used in place in memory-mapped disk cache
+    ///           files (see `diskcache_mmap`).
+    ///
+    /// - `int64 stat:mapped_memory_used` :
+    ///           Memory of the tiles currently used in place in mapped disk
+    ///           cache files, which is not counted in
+    ///           `stat:cache_memory_used`.
+    ///
+    /// - `int64 stat:shared_tiles_found` :
+    ///           Number of tiles found already read into the `shared_pool`
+    ///           (by this or another process).
+    ///
+    /// - `int64 stat:shared_tiles_stored` :
+    ///           Number of tiles this process read into the `shared_pool`.
+    ///
+    /// - `int64 stat:shared_memory_used` :
+    ///           Memory of the shared pool tiles this process currently
+    ///           uses (this is part of `stat:cache_memory_used`).
+    ///
+    /// - `int64 stat:tiles_deduplicated` :
+    /// - `int64 stat:dedup_bytes_saved` :
+    ///           Number of tiles read that were found identical to a tile
+    ///           already in memory and shared its pixels (see
+    ///           `deduplicate_tiles`), and the memory that saved.
+    ///
+    /// - `int64 stat:dedup_memory_used` :
+    ///           Memory of the pixels currently shared by several tiles,
+    ///           which is not counted in `stat:cache_memory_used`.
+    ///
     /// The following member functions of ImageCache allow you to set (and
     /// in some cases retrieve) options that control the overall behavior of
     /// the image cache:
@@ -925,7 +1194,8 @@ public:
     /// region to be retrieved, specified by `roi`, includes `begin` but does
     /// not include `end` (much like STL begin/end usage). Requested pixels
     /// that are not part of the valid pixel data region of the image file
-    /// will be filled with zero values.
+    /// will be filled with zero values, as will those of any tiles that
+    /// could not be read (in which case the call returns `false`).
     ///
     /// @param  filename
     ///             The name of the image, as a UTF-8 encoded ustring.
@@ -1216,6 +1486,43 @@ public:
     /// once again be purged from the tile cache if required.
     void release_tile(Tile* tile) const;
 
+    /// Hint that the tiles of the given image (UTF-8 encoded filename),
+    /// subimage and miplevel overlapping `roi` will be needed soon. The
+    /// tiles not already in the cache are queued to be read by background
+    /// threads (see the `prefetch_threads` attribute), and the call returns
+    /// immediately. A later lookup of a tile that is still being read will
+    /// wait for that read rather than issue its own. An undefined `roi`
+    /// means the whole image; the ROI's channel range selects the channels
+    /// of the tiles that are read. This is only a hint: requests may be
+    /// dropped if too many are already waiting, and errors are not
+    /// reported until the tile is actually requested.
+    void prefetch(ustring filename, int subimage, int miplevel,
+                  const ROI& roi = ROI::All());
+    /// A slightly more efficient variety of `prefetch()` for cases where
+    /// you can use an `ImageHandle*` to specify the image and optionally
+    /// have a `Perthread*` for the calling thread.
+    void prefetch(ImageHandle* file, Perthread* thread_info, int subimage,
+                  int miplevel, const ROI& roi = ROI::All());
+
+    /// Open and read the headers of many images (UTF-8 encoded filenames)
+    /// in parallel, filling in the cache's record of their subimages and
+    /// MIP levels, so that the first lookup of each file doesn't have to.
+    /// This is useful to shorten the "time to first pixel" of scenes
+    /// referencing very many textures, where otherwise each render thread
+    /// would serially open each file as it first touched it. At most
+    /// `nthreads` threads are used (0 means the size of the default thread
+    /// pool). Files whose headers were read are closed again if more than
+    /// `max_open_files` files are open; their headers stay in the cache and
+    /// the files will be reopened when pixels are first needed. A UDIM
+    /// pattern stands for all of its tiles, whose files are found and
+    /// preloaded as well.
+    ///
+    /// @returns
+    ///             The number of files that were successfully opened. The
+    ///             statistics `stat:preload_files` and `stat:preload_time`
+    ///             accumulate the files requested and the time taken.
+    int preload_headers(cspan<ustring> filenames, int nthreads = 0);
+
     /// Retrieve the data type of the pixels stored in the tile, which may
     /// be different than the type of the pixels in the disk file.
     TypeDesc tile_format(const Tile* tile) const;
@@ -1330,6 +1637,17 @@ public:
     /// more and more esoteric information.
     std::string getstats(int level = 1) const;
 
+    /// Return the statistics most useful for deciding which textures to
+    /// convert differently, as a JSON object: some totals; a "threads"
+    /// array with each thread's tile lookups, misses, and time spent in
+    /// I/O and waiting on other threads' reads and on file locks; and a
+    /// "files" array with each file's reads and I/O time, and for each of
+    /// its MIP levels (of the first subimage) the resolution, tile size
+    /// and number of tiles read. If the `access_stats` attribute is set,
+    /// each level also has its tile cache hits and misses, redundant
+    /// reads, and time spent reading, waiting and decompressing.
+    std::string getstats_json() const;
+
     /// Reset most statistics to be as they were with a fresh ImageCache.
     /// Caveat emptor: this does not flush the cache itelf, so the resulting
     /// statistics from the next set of texture requests will not match the
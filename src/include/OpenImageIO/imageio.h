@@ -3917,6 +3917,19 @@ OIIO_API std::string geterror(bool clear = true);
 ///   enable globally in an environment where security is a higher priority
 ///   than being tolerant of partially broken image files.
 ///
+/// - `string simd_dispatch` ("auto")
+///
+///   Some hot loops (pixel format conversion in `convert_image()` and
+///   friends, ImageBufAlgo `add`/`sub`/`mul`/`mad`, the float RGBA paths of
+///   `colorconvert`, separable `resize`, and bilinear texture sampling
+///   within a tile) have AVX2 and AVX-512 versions that are chosen at
+///   runtime from the CPU's capabilities, so a build for a baseline x86-64
+///   still uses the full vector width of newer machines. Setting this to
+///   `"generic"`, `"avx2"`, or `"avx512"` caps the level used; `"auto"`
+///   (or the empty string) picks the best one the hardware supports. The
+///   results are identical at every level. Retrieving the attribute gives
+///   the level currently in use.
+///
 /// @version 3.1
 template<typename T>
 inline bool attribute(string_view name, TypeDesc type, span<T> value)
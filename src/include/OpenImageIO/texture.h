@@ -528,6 +528,29 @@ public:
     ///             MipModeStochasticAniso and/or MipModeStochasticTrilinear.
     ///             Bit 1 = sample MIP level, bit 2 = sample anisotropy
     ///             (default=0).
+    /// - `int aniso_simd` :
+    ///             If nonzero (the default), anisotropic bilinear lookups
+    ///             filter their probes along the major axis eight at a
+    ///             time with SIMD arithmetic and gathers. Setting it to 0
+    ///             selects the one-probe-at-a-time reference filter, which
+    ///             may differ from the vectorized one by floating point
+    ///             rounding in the order of accumulation.
+    /// - `int texture3d_bicubic` :
+    ///             If nonzero, volume lookups (`texture3d()`) with
+    ///             `InterpBicubic` filter a 4x4x4 footprint of texels with
+    ///             the cubic B-spline of the 2D bicubic lookups. The
+    ///             default of 0 keeps such lookups trilinear.
+    /// - `string trace_file` :
+    ///             If non-empty, every 2D `texture()` lookup (single point
+    ///             or batched, one record per active lane) is appended to a
+    ///             compact binary trace at this path: the file name, s/t,
+    ///             derivatives and the per-lookup options. The trace can be
+    ///             replayed against a fresh TextureSystem with `testtex
+    ///             --replay`, which makes it possible to tune cache sizes
+    ///             and thread counts on a real renderer's access pattern.
+    ///             Setting it to the empty string (the default) flushes and
+    ///             closes any trace in progress. Recording is meant for
+    ///             diagnostics and should not be left on in production.
     ///
     /// - `string options`
     ///             This catch-all is simply a comma-separated list of
@@ -1728,6 +1751,12 @@ public:
     /// `close()` all files known to the cache.
     void close_all();
 
+    /// Read the headers of many textures in parallel, so that the first
+    /// lookup of each doesn't have to open it. This calls
+    /// `ImageCache::preload_headers(filenames,nthreads)` on the underlying
+    /// ImageCache, and returns the number of files successfully opened.
+    int preload_headers(cspan<ustring> filenames, int nthreads = 0);
+
     /// @}
 
     /// @{
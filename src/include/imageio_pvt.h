@@ -120,6 +120,16 @@ const void*
 parallel_convert_from_float(const float* src, void* dst, size_t nvals,
                             TypeDesc format);
 
+/// Retrieve channels [chbegin,chend) of src for pixels [xbegin,xend) of
+/// scanline y of slice z, as floats, using the same rule as a WrapClamp
+/// iterator: coordinates are clamped to the display window, and anything
+/// that still lands outside the data window is black. Only valid for
+/// images whose data window lies within the display window. scratch is
+/// working space that callers may reuse from row to row.
+void
+clamped_row(const ImageBuf& src, int xbegin, int xend, int y, int z,
+            int chbegin, int chend, std::vector<float>& scratch, float* out);
+
 /// Internal utility: Error checking on the spec -- if it contains texture-
 /// specific metadata but there are clues it's not actually a texture file
 /// written by maketx or `oiiotool -otex`, then assume these metadata are
@@ -20,6 +20,7 @@
 #include <OpenImageIO/sysutil.h>
 
 #include "imageio_pvt.h"
+#include "simd_dispatch.h"
 
 #define MAKE_OCIO_VERSION_HEX(maj, min, patch) \
     (((maj) << 24) | ((min) << 16) | (patch))
@@ -1500,6 +1501,15 @@ public:
                 }
             }
         } else if (channels >= 4 && chanstride == sizeof(float)) {
+            auto simd_matrix = pvt::simd_kernels().matrix_rgba;
+            if (simd_matrix && channels == 4
+                && xstride == 4 * stride_t(sizeof(float))) {
+                // Packed RGBA rows can go a few pixels at a time.
+                for (int y = 0; y < height; ++y)
+                    simd_matrix((float*)((char*)data + y * ystride), width,
+                                &m_M.M44f()[0][0]);
+                return;
+            }
             for (int y = 0; y < height; ++y) {
                 char* d = (char*)data + y * ystride;
                 for (int x = 0; x < width; ++x, d += xstride) {
@@ -2203,14 +2213,17 @@ colorconvert_impl_float_rgba(ImageBuf& R, const ImageBuf& A,
         OIIO_ALLOCATE_STACK_OR_HEAP(scanline, vfloat4, width);
         float* alpha;
         OIIO_ALLOCATE_STACK_OR_HEAP(alpha, float, width);
-        const float fltmin = std::numeric_limits<float>::min();
+        const float fltmin              = std::numeric_limits<float>::min();
+        const pvt::SimdKernels& kernels = pvt::simd_kernels();
         for (int k = roi.zbegin; k < roi.zend; ++k) {
             for (int j = roi.ybegin; j < roi.yend; ++j) {
                 // Load the scanline
                 memcpy((void*)scanline, A.pixeladdr(roi.xbegin, j, k),
                        width * 4 * sizeof(float));
                 // Optionally unpremult
-                if (unpremult) {
+                if (unpremult && kernels.unpremult_rgba) {
+                    kernels.unpremult_rgba((float*)scanline, alpha, width);
+                } else if (unpremult) {
                     for (int i = 0; i < width; ++i) {
                         vfloat4 p(scanline[i]);
                         float a  = extract<3>(p);
@@ -2229,7 +2242,9 @@ colorconvert_impl_float_rgba(ImageBuf& R, const ImageBuf& A,
                                  width * 4 * sizeof(float));
 
                 // Optionally premult
-                if (unpremult) {
+                if (unpremult && kernels.premult_rgba) {
+                    kernels.premult_rgba((float*)scanline, alpha, width);
+                } else if (unpremult) {
                     for (int i = 0; i < width; ++i) {
                         vfloat4 p(scanline[i]);
                         float a = alpha[i];
@@ -10,10 +10,13 @@
 
 #include <OpenImageIO/dassert.h>
 #include <OpenImageIO/filter.h>
+#include <OpenImageIO/fmath.h>
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/platform.h>
+#include <OpenImageIO/simd.h>
 #include <OpenImageIO/thread.h>
 
 #include "imageio_pvt.h"
@@ -814,6 +817,248 @@ convolve_(ImageBuf& dst, const ImageBuf& src, const ImageBuf& kernel,
 
 
 
+// r[i] += w * a[i], for i in [0,n).
+static inline void
+accum_scaled(float* r, const float* a, float w, size_t n)
+{
+    simd::vfloat4 W(w);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        simd::vfloat4 R(r + i), A(a + i);
+        R += W * A;
+        R.store(r + i);
+    }
+    for (; i < n; ++i)
+        r[i] += w * a[i];
+}
+
+
+
+void
+pvt::clamped_row(const ImageBuf& src, int xbegin, int xend, int y, int z,
+                 int chbegin, int chend, std::vector<float>& scratch,
+                 float* out)
+{
+    const ImageSpec& spec(src.spec());
+    int nc = chend - chbegin;
+    std::fill(out, out + size_t(xend - xbegin) * nc, 0.0f);
+    y = clamp(y, spec.full_y, spec.full_y + spec.full_height - 1);
+    z = clamp(z, spec.full_z, spec.full_z + spec.full_depth - 1);
+    if (y < spec.y || y >= spec.y + spec.height || z < spec.z
+        || z >= spec.z + spec.depth)
+        return;
+    int fx0 = spec.full_x, fx1 = spec.full_x + spec.full_width - 1;
+    int x0 = std::max(clamp(xbegin, fx0, fx1), spec.x);
+    int x1 = std::min(clamp(xend - 1, fx0, fx1), spec.x + spec.width - 1);
+    if (x0 > x1)
+        return;
+    scratch.resize(size_t(x1 - x0 + 1) * nc);
+    src.get_pixels(ROI(x0, x1 + 1, y, y + 1, z, z + 1, chbegin, chend),
+                   make_span(scratch));
+    for (int x = xbegin; x < xend; ++x) {
+        int cx = clamp(x, fx0, fx1);
+        if (cx >= x0 && cx <= x1)
+            std::copy_n(&scratch[size_t(cx - x0) * nc], nc,
+                        out + size_t(x - xbegin) * nc);
+    }
+}
+
+
+
+// If the kw x kh kernel k is the outer product of a row and a column (to
+// within float roundoff), return true and those factors. Gaussian, box and
+// most other kernels made by make_kernel() are.
+static bool
+separable_kernel(const std::vector<float>& k, int kw, int kh,
+                 std::vector<float>& row, std::vector<float>& col)
+{
+    // Factor around the largest value, then check every entry.
+    size_t pivot = 0;
+    for (size_t i = 1; i < k.size(); ++i)
+        if (std::abs(k[i]) > std::abs(k[pivot]))
+            pivot = i;
+    float kmax = std::abs(k[pivot]);
+    if (kmax == 0.0f)
+        return false;
+    int px = int(pivot % kw), py = int(pivot / kw);
+    row.assign(k.begin() + size_t(py) * kw, k.begin() + size_t(py + 1) * kw);
+    col.resize(kh);
+    for (int y = 0; y < kh; ++y)
+        col[y] = k[size_t(y) * kw + px] / k[pivot];
+    float tolerance = 1.0e-5f * kmax;
+    for (int y = 0; y < kh; ++y)
+        for (int x = 0; x < kw; ++x)
+            if (std::abs(col[y] * row[x] - k[size_t(y) * kw + x]) > tolerance)
+                return false;
+    return true;
+}
+
+
+
+// Convolve with a separable kernel: filter each source scanline with the
+// row, keeping the last kh filtered scanlines in a ring, then combine them
+// with the column weights. O(kw+kh) per pixel instead of O(kw*kh).
+static bool
+convolve_separable(ImageBuf& dst, const ImageBuf& src,
+                   const std::vector<float>& row,
+                   const std::vector<float>& col, ROI kroi, ROI roi,
+                   int nthreads)
+{
+    int kw = kroi.width(), kh = kroi.height();
+    ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+        int nc        = roi.nchannels();
+        size_t rowlen = size_t(roi.width()) * nc;
+        int xbegin    = roi.xbegin + kroi.xbegin;
+        int xend      = roi.xend + kroi.xend - 1;
+        std::vector<float> in(size_t(xend - xbegin) * nc), scratch;
+        std::vector<float> ring(rowlen * kh), out(rowlen);
+        for (int z = roi.zbegin; z < roi.zend; ++z) {
+            int zz = z + kroi.zbegin;
+            // Source scanlines [ybegin,ynext) have been filtered so far;
+            // scanline y lives in ring slot (y - ybegin) % kh.
+            int ybegin = roi.ybegin + kroi.ybegin, ynext = ybegin;
+            for (int y = roi.ybegin; y < roi.yend; ++y) {
+                for (; ynext < y + kroi.yend; ++ynext) {
+                    pvt::clamped_row(src, xbegin, xend, ynext, zz,
+                                     roi.chbegin, roi.chend, scratch,
+                                     in.data());
+                    float* h = &ring[size_t((ynext - ybegin) % kh) * rowlen];
+                    std::fill(h, h + rowlen, 0.0f);
+                    for (int i = 0; i < kw; ++i)
+                        if (row[i] != 0.0f)
+                            accum_scaled(h, &in[size_t(i) * nc], row[i],
+                                         rowlen);
+                }
+                std::fill(out.begin(), out.end(), 0.0f);
+                for (int j = 0; j < kh; ++j) {
+                    int sy = y + kroi.ybegin + j;
+                    if (col[j] != 0.0f)
+                        accum_scaled(out.data(),
+                                     &ring[size_t((sy - ybegin) % kh) * rowlen],
+                                     col[j], rowlen);
+                }
+                dst.set_pixels(ROI(roi.xbegin, roi.xend, y, y + 1, z, z + 1,
+                                   roi.chbegin, roi.chend),
+                               make_cspan(out));
+            }
+        }
+    });
+    return true;
+}
+
+
+
+// In-place 2D FFT of an ny x nx complex array: the rows, then the columns.
+static void
+fft2d(std::complex<float>* data, int nx, int ny, kissfft<float>& fx,
+      kissfft<float>& fy, std::vector<std::complex<float>>& tmp)
+{
+    tmp.resize(2 * size_t(std::max(nx, ny)));
+    std::complex<float>* t0 = tmp.data();
+    std::complex<float>* t1 = t0 + std::max(nx, ny);
+    for (int y = 0; y < ny; ++y) {
+        fx.transform(data + size_t(y) * nx, t0);
+        std::copy_n(t0, nx, data + size_t(y) * nx);
+    }
+    for (int x = 0; x < nx; ++x) {
+        for (int y = 0; y < ny; ++y)
+            t0[y] = data[size_t(y) * nx + x];
+        fy.transform(t0, t1);
+        for (int y = 0; y < ny; ++y)
+            data[size_t(y) * nx + x] = t1[y];
+    }
+}
+
+
+
+// FFT size for one axis of an overlap-save block: at least twice the
+// kernel so that most of each block is usable output.
+static int
+fft_block_size(int ksize)
+{
+    return std::max(64, int(ceil2(2 * ksize)));
+}
+
+
+
+// Convolve with a large kernel by overlap-save: each nx x ny block of the
+// (clamped) source is transformed, multiplied by the kernel's spectrum and
+// transformed back, and the (nx-kw+1) x (ny-kh+1) outputs that didn't wrap
+// around are kept. Pairs of channels share one complex transform (one as
+// the real part, one as the imaginary), which works because the kernel is
+// real.
+static bool
+convolve_fft(ImageBuf& dst, const ImageBuf& src, const std::vector<float>& k,
+             ROI kroi, ROI roi, int nthreads)
+{
+    using cpx = std::complex<float>;
+    int kw = kroi.width(), kh = kroi.height();
+    int nx = fft_block_size(kw), ny = fft_block_size(kh);
+    int tx = nx - kw + 1, ty = ny - kh + 1;  // outputs per block
+
+    // Spectrum of the kernel, flipped (the direct sum is a correlation)
+    // and with the 1/(nx*ny) of the inverse transform folded in.
+    std::vector<cpx> kspec(size_t(nx) * ny), tmp;
+    float norm = 1.0f / (float(nx) * float(ny));
+    for (int y = 0; y < kh; ++y)
+        for (int x = 0; x < kw; ++x)
+            kspec[size_t(y) * nx + x]
+                = norm * k[size_t(kh - 1 - y) * kw + (kw - 1 - x)];
+    {
+        kissfft<float> fx(nx, false), fy(ny, false);
+        fft2d(kspec.data(), nx, ny, fx, fy, tmp);
+    }
+
+    int bxn = (roi.width() + tx - 1) / tx, byn = (roi.height() + ty - 1) / ty;
+    int64_t nblocks = int64_t(bxn) * byn * roi.depth();
+    parallel_for(
+        int64_t(0), nblocks,
+        [&](int64_t b) {
+            int bx = roi.xbegin + int(b % bxn) * tx;
+            int by = roi.ybegin + int((b / bxn) % byn) * ty;
+            int z  = roi.zbegin + int(b / (int64_t(bxn) * byn));
+            int bw = std::min(tx, roi.xend - bx);
+            int bh = std::min(ty, roi.yend - by);
+            int nc = roi.nchannels();
+            std::vector<float> in(size_t(nx) * ny * nc), scratch;
+            std::vector<float> out(size_t(bw) * bh * nc);
+            std::vector<cpx> data(size_t(nx) * ny), tmp;
+            for (int y = 0; y < ny; ++y)
+                pvt::clamped_row(src, bx + kroi.xbegin,
+                                 bx + kroi.xbegin + nx, by + kroi.ybegin + y,
+                                 z + kroi.zbegin, roi.chbegin, roi.chend,
+                                 scratch, &in[size_t(y) * nx * nc]);
+            kissfft<float> fx(nx, false), fy(ny, false);
+            kissfft<float> ix(nx, true), iy(ny, true);
+            for (int c = 0; c < nc; c += 2) {
+                bool pair = (c + 1 < nc);
+                for (size_t i = 0, e = data.size(); i < e; ++i)
+                    data[i] = cpx(in[i * nc + c], pair ? in[i * nc + c + 1]
+                                                      : 0.0f);
+                fft2d(data.data(), nx, ny, fx, fy, tmp);
+                for (size_t i = 0, e = data.size(); i < e; ++i)
+                    data[i] *= kspec[i];
+                fft2d(data.data(), nx, ny, ix, iy, tmp);
+                for (int y = 0; y < bh; ++y) {
+                    const cpx* v = &data[size_t(y + kh - 1) * nx + kw - 1];
+                    float* o     = &out[size_t(y) * bw * nc + c];
+                    for (int x = 0; x < bw; ++x, o += nc) {
+                        o[0] = v[x].real();
+                        if (pair)
+                            o[1] = v[x].imag();
+                    }
+                }
+            }
+            dst.set_pixels(ROI(bx, bx + bw, by, by + bh, z, z + 1, roi.chbegin,
+                               roi.chend),
+                           make_cspan(out));
+        },
+        paropt(nthreads));
+    return true;
+}
+
+
+
 bool
 ImageBufAlgo::convolve(ImageBuf& dst, const ImageBuf& src,
                        const ImageBuf& kernel, bool normalize, ROI roi,
@@ -830,6 +1075,41 @@ ImageBufAlgo::convolve(ImageBuf& dst, const ImageBuf& src,
         Ktmp.copy(kernel, TypeDesc::FLOAT);
         K = &Ktmp;
     }
+
+    // 2D kernels that are separable or large have much faster paths than
+    // the direct sum below. They reproduce the WrapClamp edge rule of the
+    // iterators only when src has no overscan, so otherwise stick with the
+    // direct sum.
+    const ImageSpec& sspec(src.spec());
+    ROI kroi = K->roi();
+    if (kroi.depth() == 1 && kroi.width() * kroi.height() > 1
+        && sspec.x >= sspec.full_x && sspec.y >= sspec.full_y
+        && sspec.z >= sspec.full_z
+        && sspec.x + sspec.width <= sspec.full_x + sspec.full_width
+        && sspec.y + sspec.height <= sspec.full_y + sspec.full_height
+        && sspec.z + sspec.depth <= sspec.full_z + sspec.full_depth) {
+        int kw = kroi.width(), kh = kroi.height();
+        std::vector<float> k(size_t(kw) * kh);
+        float sum = 0.0f;
+        for (int y = 0; y < kh; ++y) {
+            for (int x = 0; x < kw; ++x) {
+                k[size_t(y) * kw + x] = *(const float*)K->pixeladdr(
+                    kroi.xbegin + x, kroi.ybegin + y, kroi.zbegin);
+                sum += k[size_t(y) * kw + x];
+            }
+        }
+        if (normalize)
+            for (auto& v : k)
+                v *= 1.0f / sum;
+        std::vector<float> row, col;
+        if (separable_kernel(k, kw, kh, row, col))
+            return convolve_separable(dst, src, row, col, kroi, roi, nthreads);
+        // Beyond roughly 16x16 taps, the transforms cost less than the
+        // direct sum.
+        if (kw * kh >= 256)
+            return convolve_fft(dst, src, k, kroi, roi, nthreads);
+    }
+
     OIIO_DISPATCH_COMMON_TYPES2(ok, "convolve", convolve_, dst.spec().format,
                                 src.spec().format, dst, src, *K, normalize, roi,
                                 nthreads);
@@ -1078,18 +1358,174 @@ ImageBufAlgo::laplacian(const ImageBuf& src, ROI roi, int nthreads)
 
 
 
+// Map 8 and 16 bit pixel values to histogram bins that sort in the same
+// order as the values, and back. For half, that means flipping the bits of
+// negative values and setting the sign bit of positive ones.
+template<class T> struct MedianKey {
+    static constexpr int bits = 8 * sizeof(T);
+    static uint16_t key(T v) { return v; }
+    static float value(uint16_t k) { return convert_type<T, float>(T(k)); }
+};
+
+template<> struct MedianKey<half> {
+    static constexpr int bits = 16;
+    static uint16_t key(half v)
+    {
+        uint16_t b = v.bits();
+        return (b & 0x8000) ? uint16_t(~b) : uint16_t(b | 0x8000);
+    }
+    static float value(uint16_t k)
+    {
+        half h;
+        h.setBits((k & 0x8000) ? uint16_t(k & 0x7fff) : uint16_t(~k));
+        return h;
+    }
+};
+
+
+
+// Median filter by Huang's sliding histogram: the window's histogram is
+// updated as the window moves (zig-zagging across the scanlines, so it
+// never has to be rebuilt), at a cost of O(width or height) per pixel
+// rather than a sort of width*height values. The median is found with a
+// coarse histogram of the high bits followed by a fine one of all of them,
+// so a search visits at most 2*sqrt(bins) bins. Exact, for 8 and 16 bit
+// values only. Requires that A's data and display windows are the same,
+// so every clamped window position exists.
+template<class Atype>
+static bool
+median_filter_histogram(ImageBuf& R, const ImageBuf& A, int width, int height,
+                        int w_2, int h_2, ROI roi, int nthreads)
+{
+    using Key                  = MedianKey<Atype>;
+    constexpr int coarse_shift = Key::bits / 2;
+    constexpr int nbins        = 1 << Key::bits;
+    constexpr int ncoarse      = nbins >> coarse_shift;
+    const ImageSpec& spec(A.spec());
+    ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+        int nc = roi.nchannels();
+        // Keys of every source pixel any window of this chunk touches,
+        // resolved through the clamp: block column i is source column
+        // kx0+i, block row j is source row ky0+j.
+        int kx0 = roi.xbegin - w_2, ky0 = roi.ybegin - h_2;
+        int kw  = roi.width() + width - 1, kh = roi.height() + height - 1;
+        int sx0 = std::max(spec.x, kx0);
+        int sx1 = std::min(spec.x + spec.width, kx0 + kw);
+        std::vector<uint16_t> keys(size_t(kw) * kh * nc);
+        std::vector<Atype> row(size_t(std::max(sx1 - sx0, 1)) * nc);
+        std::vector<float> out(size_t(roi.width()) * nc);
+        std::vector<uint32_t> fine(size_t(nbins) * nc, 0);
+        std::vector<uint32_t> coarse(size_t(ncoarse) * nc, 0);
+
+        for (int z = roi.zbegin; z < roi.zend; ++z) {
+            for (int j = 0; j < kh; ++j) {
+                int y = clamp(ky0 + j, spec.y, spec.y + spec.height - 1);
+                A.get_pixels(ROI(sx0, sx1, y, y + 1, z, z + 1, roi.chbegin,
+                                 roi.chend),
+                             make_span(row));
+                uint16_t* k = &keys[size_t(j) * kw * nc];
+                for (int i = 0; i < kw; ++i) {
+                    int x = clamp(kx0 + i, sx0, sx1 - 1);
+                    for (int c = 0; c < nc; ++c)
+                        k[i * nc + c] = Key::key(row[size_t(x - sx0) * nc + c]);
+                }
+            }
+            std::fill(fine.begin(), fine.end(), 0);
+            std::fill(coarse.begin(), coarse.end(), 0);
+
+            // Add (d=1) or remove (d=-1) block column i, rows [j0,j0+n),
+            // or block row j, columns [i0,i0+n).
+            auto update = [&](const uint16_t* k, size_t stride, int n, int d) {
+                for (; n--; k += stride) {
+                    for (int c = 0; c < nc; ++c) {
+                        fine[size_t(c) * nbins + k[c]] += d;
+                        coarse[size_t(c) * ncoarse + (k[c] >> coarse_shift)]
+                            += d;
+                    }
+                }
+            };
+            auto column = [&](int i, int j0, int d) {
+                update(&keys[(size_t(j0) * kw + i) * nc], size_t(kw) * nc,
+                       height, d);
+            };
+            auto scanline = [&](int j, int i0, int d) {
+                update(&keys[(size_t(j) * kw + i0) * nc], nc, width, d);
+            };
+
+            for (int j = 0; j < height; ++j)
+                scanline(j, 0, 1);
+            uint32_t mid = uint32_t(width * height) / 2;
+            for (int y = 0; y < roi.height(); ++y) {
+                if (y > 0) {
+                    // Step down one scanline, at the x where we ended.
+                    int i0 = (y & 1) ? roi.width() - 1 : 0;
+                    scanline(y - 1, i0, -1);
+                    scanline(y - 1 + height, i0, 1);
+                }
+                bool forward = !(y & 1);
+                for (int n = 0; n < roi.width(); ++n) {
+                    int x = forward ? n : roi.width() - 1 - n;
+                    if (n > 0) {
+                        if (forward) {
+                            column(x - 1, y, -1);
+                            column(x - 1 + width, y, 1);
+                        } else {
+                            column(x + width, y, -1);
+                            column(x, y, 1);
+                        }
+                    }
+                    for (int c = 0; c < nc; ++c) {
+                        const uint32_t* cb = &coarse[size_t(c) * ncoarse];
+                        const uint32_t* fb = &fine[size_t(c) * nbins];
+                        uint32_t sum = 0;
+                        int b        = 0;
+                        while (sum + cb[b] <= mid)
+                            sum += cb[b++];
+                        int f = b << coarse_shift;
+                        while (sum + fb[f] <= mid)
+                            sum += fb[f++];
+                        out[size_t(x) * nc + c] = Key::value(uint16_t(f));
+                    }
+                }
+                R.set_pixels(ROI(roi.xbegin, roi.xend, roi.ybegin + y,
+                                 roi.ybegin + y + 1, z, z + 1, roi.chbegin,
+                                 roi.chend),
+                             make_cspan(out));
+            }
+        }
+    });
+    return true;
+}
+
+
+
 template<class Rtype, class Atype>
 static bool
 median_filter_impl(ImageBuf& R, const ImageBuf& A, int width, int height,
                    ROI roi, int nthreads)
 {
+    if (width < 1)
+        width = 1;
+    if (height < 1)
+        height = width;
+    int w_2 = std::max(1, width / 2);
+    int h_2 = std::max(1, height / 2);
+    // For large enough windows over 8 and 16 bit data, a sliding histogram
+    // beats selecting from all the window's values. The 16 bit histograms
+    // take longer to search, so they need a bigger window to pay off.
+    if constexpr (std::is_same_v<Atype, uint8_t>
+                  || std::is_same_v<Atype, uint16_t>
+                  || std::is_same_v<Atype, half>) {
+        const ImageSpec& spec(A.spec());
+        bool nocrop = spec.x == spec.full_x && spec.y == spec.full_y
+                      && spec.width == spec.full_width
+                      && spec.height == spec.full_height;
+        if (nocrop && width * height >= (sizeof(Atype) == 1 ? 25 : 121))
+            return median_filter_histogram<Atype>(R, A, width, height, w_2,
+                                                  h_2, roi, nthreads);
+    }
+
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
-        if (width < 1)
-            width = 1;
-        if (height < 1)
-            height = width;
-        int w_2        = std::max(1, width / 2);
-        int h_2        = std::max(1, height / 2);
         int windowsize = width * height;
         int nchannels  = R.nchannels();
         float** chans  = OIIO_ALLOCA(float*, nchannels);
@@ -1112,7 +1548,7 @@ median_filter_impl(ImageBuf& R, const ImageBuf& A, int width, int height,
             if (n) {
                 int mid = n / 2;
                 for (int c = 0; c < nchannels; ++c) {
-                    std::sort(chans[c] + 0, chans[c] + n);
+                    std::nth_element(chans[c], chans[c] + mid, chans[c] + n);
                     r[c] = chans[c][mid];
                 }
             } else {
@@ -1159,18 +1595,122 @@ ImageBufAlgo::median_filter(const ImageBuf& src, int width, int height, ROI roi,
 
 enum MorphOp { MorphDilate, MorphErode };
 
+
+
+// Van Herk/Gil-Werman running max (or min, depending on op): for each of
+// the n-k+1 windows of k consecutive items of in[0..n-1], each item being
+// nc contiguous floats, out[i] = op of items [i,i+k). The input is split
+// into blocks of k items, with running maxima forward (L) and backward
+// (B) within each block, so that any window is covered by the tail of one
+// block and the head of the next: three comparisons per value, however
+// large the window. L and B are scratch space of n*nc floats. The op
+// should ignore NaNs (see morph_max and morph_min), as the per-pixel
+// filter does, so that one NaN doesn't spread over whole blocks.
+template<class Op>
+static void
+running_extreme(const float* in, int n, int nc, int k, float* out, float* L,
+                float* B, Op op)
+{
+    size_t stride = nc;
+    for (int b = 0; b < n; b += k) {
+        int e = std::min(b + k, n);
+        std::copy_n(in + b * stride, stride, L + b * stride);
+        for (size_t j = (b + 1) * stride; j < e * stride; ++j)
+            L[j] = op(L[j - stride], in[j]);
+        std::copy_n(in + (e - 1) * stride, stride, B + (e - 1) * stride);
+        for (size_t j = (e - 1) * stride; j-- > b * stride;)
+            B[j] = op(B[j + stride], in[j]);
+    }
+    size_t nout = size_t(n - k + 1) * stride, lag = (k - 1) * stride;
+    for (size_t j = 0; j < nout; ++j)
+        out[j] = op(B[j], L[j + lag]);
+}
+
+
+
+// A max (or min) over a width x height rectangle is a max over the rows of
+// maxes along the rows, so filter every source row that any window of the
+// chunk touches, then run the same filter down the columns of the result,
+// treating whole rows as the items. Work is done in vertical stripes so
+// that the scratch space stays small. Requires that A's data and display
+// windows are the same, so that every clamped window position exists.
+template<class Op>
+static bool
+morph_separable(ImageBuf& R, const ImageBuf& A, int width, int height,
+                int w_2, int h_2, Op op, ROI roi, int nthreads)
+{
+    ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+        const int stripe = 256;
+        int nc           = roi.nchannels();
+        int nrows        = roi.height() + height - 1;
+        size_t rowsize   = size_t(std::min(stripe, roi.width())) * nc;
+        size_t insize    = rowsize + size_t(width - 1) * nc;
+        std::vector<float> in(insize), scratch, rows(nrows * rowsize);
+        std::vector<float> L(nrows * insize), B(nrows * insize);
+        std::vector<float> out(size_t(roi.height()) * rowsize);
+        for (int z = roi.zbegin; z < roi.zend; ++z) {
+            for (int x = roi.xbegin; x < roi.xend; x += stripe) {
+                int xend    = std::min(x + stripe, roi.xend);
+                size_t rlen = size_t(xend - x) * nc;
+                for (int j = 0; j < nrows; ++j) {
+                    pvt::clamped_row(A, x - w_2, xend - w_2 + width - 1,
+                                     roi.ybegin - h_2 + j, z, roi.chbegin,
+                                     roi.chend, scratch, in.data());
+                    running_extreme(in.data(), xend - x + width - 1, nc,
+                                    width, &rows[j * rlen], L.data(),
+                                    B.data(), op);
+                }
+                running_extreme(rows.data(), nrows, int(rlen), height,
+                                out.data(), L.data(), B.data(), op);
+                R.set_pixels(ROI(x, xend, roi.ybegin, roi.yend, z, z + 1,
+                                 roi.chbegin, roi.chend),
+                             make_cspan(out.data(), roi.height() * rlen));
+            }
+        }
+    });
+    return true;
+}
+
+
+
+// Max and min that ignore a NaN in either argument
+inline float
+morph_max(float a, float b)
+{
+    return (b > a || a != a) ? b : a;
+}
+
+inline float
+morph_min(float a, float b)
+{
+    return (b < a || a != a) ? b : a;
+}
+
+
+
 template<class Rtype, class Atype>
 static bool
 morph_impl(ImageBuf& R, const ImageBuf& A, int width, int height, MorphOp op,
            ROI roi, int nthreads)
 {
+    if (width < 1)
+        width = 1;
+    if (height < 1)
+        height = width;
+    int w_2 = std::max(1, width / 2);
+    int h_2 = std::max(1, height / 2);
+    const ImageSpec& spec(A.spec());
+    if (spec.x == spec.full_x && spec.y == spec.full_y
+        && spec.width == spec.full_width && spec.height == spec.full_height) {
+        if (op == MorphDilate)
+            return morph_separable(R, A, width, height, w_2, h_2, morph_max,
+                                   roi, nthreads);
+        else
+            return morph_separable(R, A, width, height, w_2, h_2, morph_min,
+                                   roi, nthreads);
+    }
+
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
-        if (width < 1)
-            width = 1;
-        if (height < 1)
-            height = width;
-        int w_2       = std::max(1, width / 2);
-        int h_2       = std::max(1, height / 2);
         int nchannels = R.nchannels();
         float* vals   = OIIO_ALLOCA(float, nchannels);
         ImageBuf::ConstIterator<Atype> a(A, roi);
@@ -19,6 +19,7 @@
 #include <OpenImageIO/imagebufalgo_util.h>
 
 #include "imageio_pvt.h"
+#include "simd_dispatch.h"
 
 
 OIIO_NAMESPACE_BEGIN
@@ -30,6 +31,11 @@ add_impl(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, ROI roi,
          int nthreads)
 {
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+        if (std::is_same<Rtype, float>::value
+            && std::is_same<Atype, float>::value
+            && std::is_same<Btype, float>::value
+            && pvt::simd_float_rows(R, A, B, roi, pvt::simd_kernels().add))
+            return;
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<Atype> a(A, roi);
         ImageBuf::ConstIterator<Btype> b(B, roi);
@@ -159,6 +165,11 @@ sub_impl(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, ROI roi,
          int nthreads)
 {
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+        if (std::is_same<Rtype, float>::value
+            && std::is_same<Atype, float>::value
+            && std::is_same<Btype, float>::value
+            && pvt::simd_float_rows(R, A, B, roi, pvt::simd_kernels().sub))
+            return;
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<Atype> a(A, roi);
         ImageBuf::ConstIterator<Btype> b(B, roi);
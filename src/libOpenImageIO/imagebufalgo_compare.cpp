@@ -17,6 +17,7 @@
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/thread.h>
 
 #include "imageio_pvt.h"
@@ -979,4 +980,268 @@ ImageBufAlgo::histogram(const ImageBuf& src, int channel, int bins, float min,
 }
 
 
+
+namespace {
+
+// Histogram bins and hash block size (in scanlines) used by analyze().
+constexpr int analyze_bins      = 256;
+constexpr int analyze_blocksize = 256;
+
+// Partial results of analyze() for one block of scanlines.
+struct AnalyzeAccum {
+    ImageBufAlgo::PixelStats stats;
+    std::vector<imagesize_t> hist;  // analyze_bins per channel
+    bool constant   = true;
+    bool monochrome = true;
+    bool opaque     = true;
+
+    AnalyzeAccum(int nchannels, int flags)
+        : stats(nchannels)
+    {
+        if (flags & ImageBufAlgo::AnalyzeHistogram)
+            hist.resize(size_t(nchannels) * analyze_bins, 0);
+    }
+
+    void merge(const AnalyzeAccum& a)
+    {
+        stats.merge(a.stats);
+        for (size_t i = 0, e = hist.size(); i < e; ++i)
+            hist[i] += a.hist[i];
+        constant &= a.constant;
+        monochrome &= a.monochrome;
+        opaque &= a.opaque;
+    }
+};
+
+
+
+// Fold npixels contiguous pixels into acc: p holds their native values (all
+// nc channels of each), and f their conversion to float (only needed for
+// the stats and histogram). The flag tests compare native values, like
+// isConstantColor() and isMonochrome() do for a zero threshold.
+template<typename T>
+static void
+analyze_pixels(const T* p, const float* f, size_t npixels, int nc,
+               const ROI& roi, const T* first, int alpha, int flags,
+               AnalyzeAccum& acc)
+{
+    if ((flags & ImageBufAlgo::AnalyzeConstant) && acc.constant) {
+        for (size_t i = 0; i < npixels && acc.constant; ++i)
+            for (int c = roi.chbegin; c < roi.chend; ++c)
+                if (p[i * nc + c] != first[c])
+                    acc.constant = false;
+    }
+    if ((flags & ImageBufAlgo::AnalyzeMonochrome) && acc.monochrome) {
+        for (size_t i = 0; i < npixels && acc.monochrome; ++i) {
+            const T* pixel = p + i * nc;
+            for (int c = roi.chbegin + 1; c < roi.chend; ++c)
+                if (pixel[c] != pixel[roi.chbegin])
+                    acc.monochrome = false;
+        }
+    }
+    if ((flags & ImageBufAlgo::AnalyzeOpaque) && acc.opaque && alpha >= 0) {
+        const T one = convert_type<float, T>(1.0f);
+        for (size_t i = 0; i < npixels && acc.opaque; ++i)
+            if (p[i * nc + alpha] != one)
+                acc.opaque = false;
+    }
+    if (flags & ImageBufAlgo::AnalyzeStats) {
+        ImageBufAlgo::PixelStats& s(acc.stats);
+        for (int c = roi.chbegin; c < roi.chend; ++c) {
+            // Same as val(), with the running values kept in registers
+            double sum = 0.0, sum2 = 0.0;
+            float mn = s.min[c], mx = s.max[c];
+            imagesize_t finite = 0, nans = 0;
+            for (size_t i = 0; i < npixels; ++i) {
+                float v = f[i * nc + c];
+                if (std::isfinite(v)) {
+                    ++finite;
+                    sum += v;
+                    sum2 += double(v) * double(v);
+                    mn = std::min(v, mn);
+                    mx = std::max(v, mx);
+                } else if (std::isnan(v)) {
+                    ++nans;
+                }
+            }
+            s.min[c] = mn;
+            s.max[c] = mx;
+            s.sum[c] += sum;
+            s.sum2[c] += sum2;
+            s.finitecount[c] += finite;
+            s.nancount[c] += nans;
+            s.infcount[c] += npixels - finite - nans;
+        }
+    }
+    if (flags & ImageBufAlgo::AnalyzeHistogram) {
+        for (int c = roi.chbegin; c < roi.chend; ++c) {
+            imagesize_t* h = &acc.hist[size_t(c) * analyze_bins];
+            for (size_t i = 0; i < npixels; ++i) {
+                float v = clamp(f[i * nc + c], 0.0f, 1.0f);
+                ++h[clamp(int(v * analyze_bins), 0, analyze_bins - 1)];
+            }
+        }
+    }
+}
+
+}  // namespace
+
+
+
+template<typename T>
+static bool
+analyze_(const ImageBuf& src, ImageBufAlgo::ImageAnalysis& result, int flags,
+         ROI roi, int nthreads)
+{
+    const ImageSpec& spec(src.spec());
+    int nchannels          = spec.nchannels;
+    size_t pixel_bytes     = spec.pixel_bytes();
+    size_t scanline_pixels = size_t(roi.width());
+    bool hash              = (flags & ImageBufAlgo::AnalyzeHash);
+    bool need_float        = (flags & ImageBufAlgo::AnalyzeStats)
+                      || (flags & ImageBufAlgo::AnalyzeHistogram);
+
+    // Only an alpha channel within roi counts for the opaque test.
+    int alpha = spec.alpha_channel;
+    if (alpha < roi.chbegin || alpha >= roi.chend)
+        alpha = -1;
+
+    // The constant color test compares against the first pixel.
+    std::vector<T> first(nchannels);
+    if (roi.npixels()) {
+        ImageBuf::ConstIterator<T, T> s(src, roi);
+        for (int c = 0; c < nchannels; ++c)
+            first[c] = s[c];
+    }
+
+    // In-memory images with packed pixels, where roi spans whole
+    // scanlines of the data window, can be read in place. Anything else
+    // (including pixels outside the data window, which count as zero) is
+    // copied out a few scanlines at a time.
+    bool inplace = src.localpixels()
+                   && src.pixel_stride() == stride_t(pixel_bytes)
+                   && src.scanline_stride()
+                          == stride_t(pixel_bytes) * spec.width
+                   && roi.xbegin == spec.x && roi.xend == spec.x + spec.width
+                   && roi.ybegin >= spec.y && roi.yend <= spec.y + spec.height
+                   && roi.zbegin >= spec.z && roi.zend <= spec.z + spec.depth;
+    size_t scanline_bytes = std::max(size_t(1), scanline_pixels * pixel_bytes);
+    int chunk             = std::max(1, int((1 << 20) / scanline_bytes));
+
+    // Blocks of scanlines are the units of parallelism. When hashing, they
+    // must be the blocks computePixelHashSHA1() uses, so the block digests
+    // combine to the same final hash.
+    int blocksize = hash ? analyze_blocksize : 64;
+    int nblocks   = (roi.height() + blocksize - 1) / blocksize;
+    std::vector<std::string> digests(hash ? nblocks : 0);
+    AnalyzeAccum total(nchannels, flags);
+    OIIO::spin_mutex mutex;  // protect total when merging
+    parallel_for(
+        int64_t(0), int64_t(nblocks),
+        [&](int64_t b) {
+            int ybegin = roi.ybegin + int(b) * blocksize;
+            int yend   = std::min(ybegin + blocksize, roi.yend);
+            AnalyzeAccum acc(nchannels, flags);
+            SHA1 sha;
+            std::vector<std::byte> tmp;
+            std::vector<float> fbuf;
+            for (int z = roi.zbegin; z < roi.zend; ++z) {
+                for (int y = ybegin; y < yend; y += chunk) {
+                    int y1         = std::min(y + chunk, yend);
+                    size_t npixels = scanline_pixels * size_t(y1 - y);
+                    const void* data;
+                    if (inplace) {
+                        data = src.pixeladdr(roi.xbegin, y, z);
+                    } else {
+                        tmp.resize(npixels * pixel_bytes);
+                        src.get_pixels(ROI(roi.xbegin, roi.xend, y, y1, z,
+                                           z + 1),
+                                       spec.format, tmp);
+                        data = tmp.data();
+                    }
+                    if (hash)
+                        sha.append(data, npixels * pixel_bytes);
+                    const float* f = nullptr;
+                    if (need_float) {
+                        fbuf.resize(npixels * nchannels);
+                        f = pvt::convert_to_float(data, fbuf.data(),
+                                                  int(npixels * nchannels),
+                                                  spec.format);
+                    }
+                    analyze_pixels((const T*)data, f, npixels, nchannels, roi,
+                                   first.data(), alpha, flags, acc);
+                }
+            }
+            if (hash)
+                digests[b] = sha.digest();
+            std::lock_guard<OIIO::spin_mutex> lock(mutex);
+            total.merge(acc);
+        },
+        paropt(nthreads));
+    if (src.has_error())
+        return false;
+
+    if (flags & ImageBufAlgo::AnalyzeStats) {
+        finalize(total.stats);
+        result.stats = std::move(total.stats);
+    }
+    if (flags & ImageBufAlgo::AnalyzeConstant) {
+        result.constant = total.constant && roi.npixels() > 0;
+        result.constant_color.assign(nchannels, 0.0f);
+        for (int c = roi.chbegin; c < roi.chend; ++c)
+            result.constant_color[c] = convert_type<T, float>(first[c]);
+    }
+    if (flags & ImageBufAlgo::AnalyzeMonochrome)
+        result.monochrome = total.monochrome || roi.nchannels() < 2;
+    if (flags & ImageBufAlgo::AnalyzeOpaque)
+        result.opaque = total.opaque;
+    if (flags & ImageBufAlgo::AnalyzeHistogram) {
+        result.histogram.resize(nchannels);
+        for (int c = roi.chbegin; c < roi.chend; ++c)
+            result.histogram[c].assign(
+                total.hist.begin() + size_t(c) * analyze_bins,
+                total.hist.begin() + size_t(c + 1) * analyze_bins);
+    }
+    if (hash) {
+        if (nblocks == 1) {
+            result.sha1 = digests[0];
+        } else {
+            SHA1 sha;
+            for (auto& d : digests)
+                sha.append(d);
+            result.sha1 = sha.digest();
+        }
+    }
+    return true;
+}
+
+
+
+ImageBufAlgo::ImageAnalysis
+ImageBufAlgo::analyze(const ImageBuf& src, int flags, ROI roi, int nthreads)
+{
+    pvt::LoggedTimer logtimer("IBA::analyze");
+    ImageAnalysis result;
+    if (!roi.defined())
+        roi = get_roi(src.spec());
+    else
+        roi.chend = std::min(roi.chend, src.nchannels());
+    if (src.nchannels() == 0) {
+        src.errorfmt("{}-channel images not supported", src.nchannels());
+        return result;
+    }
+    if (src.deep()) {
+        src.errorfmt("deep images not supported");
+        return result;
+    }
+
+    bool ok = true;
+    OIIO_DISPATCH_TYPES(ok, "analyze", analyze_, src.spec().format, src,
+                        result, flags, roi, nthreads);
+    if (!ok)
+        result.stats.reset(0);
+    return result;
+}
+
+
 OIIO_NAMESPACE_END
@@ -13,6 +13,7 @@
 #include <OpenImageIO/imagebufalgo_util.h>
 
 #include "imageio_pvt.h"
+#include "simd_dispatch.h"
 
 
 OIIO_NAMESPACE_BEGIN
@@ -43,6 +44,11 @@ mad_impl(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, const ImageBuf& C,
             // the raw memory very efficiently. Otherwise, we will need the
             // magic of the the Iterators (and pay the price).
             int nxvalues = roi.width() * R.nchannels();
+            // All-float rows can use the widest mad the CPU has.
+            auto simd_mad = (std::is_same<Rtype, float>::value
+                             && std::is_same<ABCtype, float>::value)
+                                ? pvt::simd_kernels().mad
+                                : nullptr;
             for (int z = roi.zbegin; z < roi.zend; ++z)
                 for (int y = roi.ybegin; y < roi.yend; ++y) {
                     Rtype* rraw = (Rtype*)R.pixeladdr(roi.xbegin, y, z);
@@ -53,6 +59,12 @@ mad_impl(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, const ImageBuf& C,
                     const ABCtype* craw
                         = (const ABCtype*)C.pixeladdr(roi.xbegin, y, z);
                     OIIO_DASSERT(araw && braw && craw);
+                    if (simd_mad) {
+                        simd_mad((const float*)araw, (const float*)braw,
+                                 (const float*)craw, (float*)rraw,
+                                 size_t(nxvalues));
+                        continue;
+                    }
                     // The straightforward loop auto-vectorizes very well,
                     // there's no benefit to using explicit SIMD here.
                     for (int x = 0; x < nxvalues; ++x)
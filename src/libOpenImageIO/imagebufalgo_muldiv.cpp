@@ -20,6 +20,7 @@
 #include <OpenImageIO/simd.h>
 
 #include "imageio_pvt.h"
+#include "simd_dispatch.h"
 
 
 OIIO_NAMESPACE_BEGIN
@@ -90,6 +91,11 @@ mul_impl(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, ROI roi,
          int nthreads)
 {
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+        if (std::is_same<Rtype, float>::value
+            && std::is_same<Atype, float>::value
+            && std::is_same<Btype, float>::value
+            && pvt::simd_float_rows(R, A, B, roi, pvt::simd_kernels().mul))
+            return;
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<Atype> a(A, roi);
         ImageBuf::ConstIterator<Btype> b(B, roi);
@@ -6,6 +6,7 @@
 #include <cstdio>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <string>
 
 // Must be first to ensure that half is defined before typedesc.h included
@@ -13,10 +14,12 @@
 
 #include <OpenImageIO/platform.h>
 
+#include <OpenImageIO/Imath.h>
 #include <OpenImageIO/argparse.h>
 #include <OpenImageIO/benchmark.h>
 #include <OpenImageIO/color.h>
 #include <OpenImageIO/filesystem.h>
+#include <OpenImageIO/filter.h>
 #include <OpenImageIO/half.h>
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
@@ -511,6 +514,220 @@ test_mad()
 
 
 
+// Run the operations that have runtime-dispatched SIMD inner loops.
+static std::vector<ImageBuf>
+simd_dispatch_results(const ImageBuf& A, const ImageBuf& B)
+{
+    std::vector<ImageBuf> results;
+    results.push_back(ImageBufAlgo::add(A, B));
+    results.push_back(ImageBufAlgo::sub(A, B));
+    results.push_back(ImageBufAlgo::mul(A, B));
+    results.push_back(ImageBufAlgo::mad(A, B, A));
+    Imath::M44f M(0.9f, 0.1f, 0.05f, 0.0f, 0.2f, 0.7f, 0.1f, 0.0f, 0.05f,
+                  0.15f, 0.8f, 0.0f, 0.01f, 0.02f, 0.03f, 1.0f);
+    results.push_back(ImageBufAlgo::colormatrixtransform(A, M, true));
+    results.push_back(ImageBufAlgo::resize(A, ImageBufAlgo::KWArgs(),
+                                           ROI(0, 29, 0, 17, 0, 1, 0, 4)));
+    int rgb[3] = { 0, 1, 2 };
+    results.push_back(ImageBufAlgo::resize(ImageBufAlgo::channels(A, 3, rgb),
+                                           ImageBufAlgo::KWArgs(),
+                                           ROI(0, 83, 0, 41, 0, 1, 0, 3)));
+    for (TypeDesc t : { TypeUInt8, TypeUInt16, TypeHalf }) {
+        ImageBuf converted, back;
+        converted.copy(A, t);
+        back.copy(converted, TypeFloat);
+        results.push_back(back);
+    }
+    return results;
+}
+
+
+
+// The "simd_dispatch" attribute must not change any results.
+void
+test_simd_dispatch()
+{
+    std::cout << "test simd_dispatch\n";
+    // Odd width so the kernels' tails get exercised, values outside [0,1]
+    // to check clamping of the integer conversions.
+    ROI roi(0, 67, 0, 35, 0, 1, 0, 4);
+    ImageBuf A = ImageBufAlgo::noise("uniform", -0.25f, 1.25f, false, 1, roi);
+    ImageBuf B = ImageBufAlgo::noise("uniform", -0.5f, 2.0f, false, 2, roi);
+
+    OIIO_CHECK_ASSERT(OIIO::attribute("simd_dispatch", "generic"));
+    std::vector<ImageBuf> generic = simd_dispatch_results(A, B);
+    OIIO_CHECK_ASSERT(OIIO::attribute("simd_dispatch", "auto"));
+    std::vector<ImageBuf> best = simd_dispatch_results(A, B);
+    std::cout << "  dispatch level "
+              << OIIO::get_string_attribute("simd_dispatch") << "\n";
+    OIIO_CHECK_ASSERT(!OIIO::attribute("simd_dispatch", "bogus"));
+
+    for (size_t i = 0; i < generic.size(); ++i) {
+        auto comp = ImageBufAlgo::compare(generic[i], best[i], 0.0f, 0.0f);
+        OIIO_CHECK_EQUAL(comp.nfail, 0);
+        OIIO_CHECK_EQUAL(comp.maxerror, 0.0);
+    }
+}
+
+
+
+// Test ImageBufAlgo::convolve: separable kernels, large kernels (which take
+// the FFT path) and small ones should all match a direct, clamped sum.
+void
+test_convolve()
+{
+    std::cout << "test convolve\n";
+    ROI roi(0, 53, 0, 41, 0, 1, 0, 3);
+    ImageBuf A = ImageBufAlgo::noise("uniform", 0.0f, 1.0f, false, 3, roi);
+    for (auto k : { ImageBufAlgo::make_kernel("gaussian", 7, 5),
+                    ImageBufAlgo::make_kernel("disk", 21, 21),
+                    ImageBufAlgo::make_kernel("laplacian", 3, 3, 1, false) }) {
+        ImageBuf R = ImageBufAlgo::convolve(A, k, false);
+        ImageBuf ref(A.spec());
+        ROI kroi = k.roi();
+        for (ImageBuf::Iterator<float> r(ref); !r.done(); ++r) {
+            float sum[3] = { 0, 0, 0 }, pixel[3];
+            for (int y = kroi.ybegin; y < kroi.yend; ++y) {
+                for (int x = kroi.xbegin; x < kroi.xend; ++x) {
+                    float w = k.getchannel(x, y, 0, 0);
+                    A.getpixel(r.x() + x, r.y() + y, 0, pixel, 3,
+                               ImageBuf::WrapClamp);
+                    for (int c = 0; c < 3; ++c)
+                        sum[c] += w * pixel[c];
+                }
+            }
+            for (int c = 0; c < 3; ++c)
+                r[c] = sum[c];
+        }
+        auto comp = ImageBufAlgo::compare(R, ref, 1.0e-4f, 1.0e-4f);
+        OIIO_CHECK_EQUAL(comp.nfail, 0);
+    }
+}
+
+
+
+// The sliding histogram median filter used for 8 and 16 bit images must
+// give the same results as selecting from the window's values, which is
+// what float images use.
+void
+test_median_filter()
+{
+    std::cout << "test median_filter\n";
+    ROI roi(0, 61, 0, 47, 0, 1, 0, 3);
+    ImageBuf F = ImageBufAlgo::noise("uniform", -1.0f, 1.0f, false, 4, roi);
+    for (TypeDesc t : { TypeUInt8, TypeUInt16, TypeHalf }) {
+        ImageBuf A;
+        A.copy(F, t);
+        ImageBuf Afloat;
+        Afloat.copy(A, TypeFloat);
+        for (int w : { 5, 11, 13 }) {
+            ImageBuf R    = ImageBufAlgo::median_filter(A, w, w - 2);
+            ImageBuf Rref = ImageBufAlgo::median_filter(Afloat, w, w - 2);
+            auto comp     = ImageBufAlgo::compare(R, Rref, 0.0f, 0.0f);
+            OIIO_CHECK_EQUAL(comp.nfail, 0);
+        }
+    }
+}
+
+
+
+// dilate and erode must match the max and min over the (clamped) window.
+void
+test_dilate_erode()
+{
+    std::cout << "test dilate/erode\n";
+    ROI roi(0, 300, 0, 23, 0, 1, 0, 3);
+    ImageBuf A = ImageBufAlgo::noise("uniform", 0.0f, 1.0f, false, 5, roi);
+    // NaNs are ignored; only a window with nothing else in it is NaN.
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float nanpixel[3] = { nan, nan, nan };
+    A.setpixel(10, 5, nanpixel);
+    A.setpixel(11, 5, nanpixel);
+    A.setpixel(200, 22, nanpixel);
+    for (int w : { 1, 4, 7, 40 }) {
+        int h      = w / 2 + 1;
+        ImageBuf D = ImageBufAlgo::dilate(A, w, h);
+        ImageBuf E = ImageBufAlgo::erode(A, w, h);
+        int w_2 = std::max(1, w / 2), h_2 = std::max(1, h / 2);
+        int mismatches = 0;
+        for (ImageBuf::ConstIterator<float> d(D), e(E); !d.done(); ++d, ++e) {
+            for (int c = 0; c < 3; ++c) {
+                float hi = -1.0f, lo = 2.0f;
+                for (int y = d.y() - h_2; y < d.y() - h_2 + h; ++y) {
+                    for (int x = d.x() - w_2; x < d.x() - w_2 + w; ++x) {
+                        float v = A.getchannel(clamp(x, 0, 299),
+                                               clamp(y, 0, 22), 0, c);
+                        hi      = std::max(hi, v);
+                        lo      = std::min(lo, v);
+                    }
+                }
+                if (hi < 0.0f)  // Nothing but NaN
+                    mismatches += !std::isnan(d[c]) + !std::isnan(e[c]);
+                else
+                    mismatches += (d[c] != hi) + (e[c] != lo);
+            }
+        }
+        OIIO_CHECK_EQUAL(mismatches, 0);
+    }
+}
+
+
+
+// Separable filters take resize's two-pass path, which must still match a
+// direct sum over each output pixel's filter footprint.
+void
+test_resize()
+{
+    std::cout << "test resize\n";
+    auto filter = Filter2D::create_shared("lanczos3", 6.0f, 6.0f);
+    for (int nc : { 2, 3, 4 }) {
+        ROI roi(0, 67, 0, 45, 0, 1, 0, nc);
+        ImageBuf A = ImageBufAlgo::noise("uniform", 0.0f, 1.0f, false, 5, roi);
+        for (ROI droi : { ROI(0, 17, 0, 13, 0, 1, 0, nc),
+                          ROI(0, 150, 0, 101, 0, 1, 0, nc) }) {
+            ImageBuf R = ImageBufAlgo::resize(A,
+                                              { { "filtername", "lanczos3" },
+                                                { "filterwidth", 6.0f } },
+                                              droi);
+            float xratio = float(droi.width()) / float(roi.width());
+            float yratio = float(droi.height()) / float(roi.height());
+            int radi     = int(ceilf(3.0f / xratio));
+            int radj     = int(ceilf(3.0f / yratio));
+            ImageBuf ref(ImageSpec(droi, TypeFloat));
+            std::vector<float> wx(2 * radi + 1), wy(2 * radj + 1);
+            std::vector<float> pixel(nc), sum(nc);
+            for (ImageBuf::Iterator<float> r(ref); !r.done(); ++r) {
+                float sx = (r.x() + 0.5f) / xratio;
+                float sy = (r.y() + 0.5f) / yratio;
+                int x0 = int(floorf(sx)), y0 = int(floorf(sy));
+                float totx = 0.0f, toty = 0.0f;
+                for (int i = -radi; i <= radi; ++i)
+                    totx += (wx[i + radi] = filter->xfilt(
+                                 xratio * (i - (sx - x0 - 0.5f))));
+                for (int j = -radj; j <= radj; ++j)
+                    toty += (wy[j + radj] = filter->yfilt(
+                                 yratio * (j - (sy - y0 - 0.5f))));
+                std::fill(sum.begin(), sum.end(), 0.0f);
+                for (int j = -radj; j <= radj; ++j) {
+                    for (int i = -radi; i <= radi; ++i) {
+                        float w = wx[i + radi] / totx * wy[j + radj] / toty;
+                        A.getpixel(x0 + i, y0 + j, 0, pixel.data(), nc,
+                                   ImageBuf::WrapClamp);
+                        for (int c = 0; c < nc; ++c)
+                            sum[c] += w * pixel[c];
+                    }
+                }
+                for (int c = 0; c < nc; ++c)
+                    r[c] = sum[c];
+            }
+            auto comp = ImageBufAlgo::compare(R, ref, 1.0e-4f, 1.0e-4f);
+            OIIO_CHECK_EQUAL(comp.nfail, 0);
+        }
+    }
+}
+
+
+
 // Tests ImageBufAlgo::min
 void
 test_min()
@@ -832,6 +1049,76 @@ test_computePixelStats()
 
 
 
+// analyze() must give the same answers as the separate functions it
+// stands in for.
+void
+test_analyze()
+{
+    std::cout << "test analyze\n";
+    // Tall enough for several hash blocks, with some nonfinite values
+    ROI roi(0, 37, 0, 600, 0, 1, 0, 4);
+    ImageBuf F = ImageBufAlgo::noise("uniform", -0.25f, 1.25f, false, 6, roi);
+    float bad[4] = { std::numeric_limits<float>::quiet_NaN(), 0.5f,
+                     std::numeric_limits<float>::infinity(), 1.0f };
+    F.setpixel(3, 300, make_span(bad));
+    F.specmod().alpha_channel = 3;
+    ImageBuf U8;
+    U8.copy(F, TypeUInt8);
+    int grayorder[4]   = { 0, 0, 0, 3 };
+    float flatcolor[4] = { 0.25f, 0.5f, 0.75f, 1.0f };
+    ImageBuf gray = ImageBufAlgo::channels(U8, 4, grayorder);
+    ImageBuf flat = ImageBufAlgo::fill(flatcolor, roi);
+
+    for (const ImageBuf* A : { &F, &U8, &gray, &flat }) {
+        auto r     = ImageBufAlgo::analyze(*A);
+        auto stats = ImageBufAlgo::computePixelStats(*A);
+        for (int c = 0; c < 4; ++c) {
+            OIIO_CHECK_EQUAL(r.stats.min[c], stats.min[c]);
+            OIIO_CHECK_EQUAL(r.stats.max[c], stats.max[c]);
+            OIIO_CHECK_EQUAL_THRESH(r.stats.avg[c], stats.avg[c], 1.0e-6f);
+            OIIO_CHECK_EQUAL_THRESH(r.stats.stddev[c], stats.stddev[c],
+                                    1.0e-6f);
+            OIIO_CHECK_EQUAL(r.stats.nancount[c], stats.nancount[c]);
+            OIIO_CHECK_EQUAL(r.stats.infcount[c], stats.infcount[c]);
+            OIIO_CHECK_EQUAL(r.stats.finitecount[c], stats.finitecount[c]);
+            OIIO_CHECK_ASSERT(r.histogram[c]
+                              == ImageBufAlgo::histogram(*A, c));
+        }
+        std::vector<float> color(4);
+        bool constant = ImageBufAlgo::isConstantColor(*A, 0.0f, color);
+        OIIO_CHECK_EQUAL(r.constant, constant);
+        if (constant)
+            OIIO_CHECK_ASSERT(r.constant_color == color);
+        OIIO_CHECK_EQUAL(r.monochrome, ImageBufAlgo::isMonochrome(*A));
+        OIIO_CHECK_EQUAL(A->spec().alpha_channel, 3);
+        OIIO_CHECK_EQUAL(r.opaque,
+                         ImageBufAlgo::isConstantChannel(*A, 3, 1.0f));
+        OIIO_CHECK_EQUAL(r.sha1, ImageBufAlgo::computePixelHashSHA1(
+                                     *A, "", ROI::All(), 256));
+    }
+    // Whole scanlines, but more of them than the data window has: the
+    // pixels above and below count as zero.
+    ROI tall(0, 37, -10, 620, 0, 1, 0, 4);
+    auto r     = ImageBufAlgo::analyze(F, ImageBufAlgo::AnalyzeAll, tall);
+    auto stats = ImageBufAlgo::computePixelStats(F, tall);
+    for (int c = 0; c < 4; ++c) {
+        OIIO_CHECK_EQUAL(r.stats.min[c], stats.min[c]);
+        OIIO_CHECK_EQUAL(r.stats.max[c], stats.max[c]);
+        OIIO_CHECK_EQUAL(r.stats.finitecount[c], stats.finitecount[c]);
+    }
+    ImageBuf padded = ImageBufAlgo::crop(F, tall);
+    OIIO_CHECK_EQUAL(r.sha1, ImageBufAlgo::computePixelHashSHA1(
+                                 padded, "", ROI::All(), 256));
+
+    OIIO_CHECK_ASSERT(ImageBufAlgo::analyze(flat).constant);
+    OIIO_CHECK_ASSERT(
+        ImageBufAlgo::analyze(gray, ImageBufAlgo::AnalyzeMonochrome,
+                              ROI(0, 37, 0, 600, 0, 1, 0, 3))
+            .monochrome);
+}
+
+
+
 // Tests histogram computation.
 void
 histogram_computation_test()
@@ -1576,6 +1863,11 @@ main(int argc, char** argv)
     test_sub();
     test_mul();
     test_mad();
+    test_simd_dispatch();
+    test_convolve();
+    test_median_filter();
+    test_dilate_erode();
+    test_resize();
     test_min();
     test_max();
     test_over(TypeFloat);
@@ -1587,6 +1879,7 @@ main(int argc, char** argv)
     test_isMonochrome();
     test_computePixelStats();
     histogram_computation_test();
+    test_analyze();
     test_maketx_from_imagebuf();
     test_IBAprep();
     test_validate_st_warp_checks();
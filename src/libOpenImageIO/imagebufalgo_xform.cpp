@@ -7,16 +7,20 @@
 
 
 #include <cmath>
+#include <limits>
 #include <memory>
+#include <vector>
 
 #include <OpenImageIO/Imath.h>
 
 #include "imageio_pvt.h"
+#include "simd_dispatch.h"
 #include <OpenImageIO/dassert.h>
 #include <OpenImageIO/filter.h>
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
+#include <OpenImageIO/simd.h>
 #include <OpenImageIO/thread.h>
 
 #include <Imath/ImathBox.h>
@@ -587,6 +591,161 @@ ImageBufAlgo::rotate(ImageBuf& dst, const ImageBuf& src, float angle,
 
 
 
+// Separable resize of the region roi of dst in two passes. Each source row
+// under the filter is resampled horizontally just once, into a ring of
+// float rows, and each output row is then a weighted sum of ytaps of those
+// rows. We work in vertical stripes narrow enough to keep the ring in
+// cache. xfiltval_all holds the normalized x weights, xtaps = 2*radi+1 for
+// each column of roi. Only for a src whose data window is inside its
+// display window and which has the same channels as dst. Both passes use
+// the runtime-dispatched kernels when there are any.
+static void
+resize_two_pass(ImageBuf& dst, const ImageBuf& src, const Filter2D* filter,
+                const float* xfiltval_all, int radi, int radj, ROI roi)
+{
+    using namespace simd;
+    const ImageSpec& srcspec(src.spec());
+    const ImageSpec& dstspec(dst.spec());
+    const int nc         = dstspec.nchannels;
+    const int xtaps      = 2 * radi + 1;
+    const int ytaps      = 2 * radj + 1;
+    float srcfx          = srcspec.full_x;
+    float srcfy          = srcspec.full_y;
+    float srcfw          = srcspec.full_width;
+    float srcfh          = srcspec.full_height;
+    float yratio         = float(dstspec.full_height) / srcfh;
+    float dstfx          = float(dstspec.full_x);
+    float dstfy          = float(dstspec.full_y);
+    float dstpixelwidth  = 1.0f / float(dstspec.full_width);
+    float dstpixelheight = 1.0f / float(dstspec.full_height);
+
+    // Polyphase table: for each output column, the first source column
+    // with nonzero weight, the number of such taps, and where their
+    // weights start. A column whose weights sum to zero gets no taps, and
+    // so comes out black.
+    const int w = roi.width();
+    std::vector<int> tapfirst(w), tapcount(w), tapweights(w);
+    for (int x = roi.xbegin; x < roi.xend; ++x) {
+        int i           = x - roi.xbegin;
+        float s         = (x - dstfx + 0.5f) * dstpixelwidth;
+        int src_x       = ifloor(srcfx + s * srcfw);
+        const float* wt = xfiltval_all + size_t(i) * xtaps;
+        float total     = 0.0f;
+        for (int t = 0; t < xtaps; ++t)
+            total += wt[t];
+        int b = 0, e = total != 0.0f ? xtaps : 0;
+        while (b < e && wt[b] == 0.0f)
+            ++b;
+        while (e > b && wt[e - 1] == 0.0f)
+            --e;
+        tapfirst[i]   = src_x - radi + b;
+        tapcount[i]   = e - b;
+        tapweights[i] = i * xtaps + b;
+    }
+
+    const pvt::SimdKernels& kernels(pvt::simd_kernels());
+    auto filter_row  = (nc == 4 || nc == 3) ? kernels.filter_row : nullptr;
+    auto axpy        = kernels.axpy;
+    const int stripe = std::max(16, 1024 / nc);
+    float* yfiltval  = OIIO_ALLOCA(float, ytaps);
+    std::vector<float> row, ring, out, scratch;
+    std::vector<int> ringrow(ytaps);
+    for (int xb = roi.xbegin; xb < roi.xend; xb += stripe) {
+        int xe     = std::min(xb + stripe, roi.xend);
+        int rowlen = (xe - xb) * nc;
+        // Span of source columns needed by this stripe
+        int sx0 = std::numeric_limits<int>::max();
+        int sx1 = std::numeric_limits<int>::min();
+        for (int i = xb - roi.xbegin; i < xe - roi.xbegin; ++i) {
+            if (tapcount[i]) {
+                sx0 = std::min(sx0, tapfirst[i]);
+                sx1 = std::max(sx1, tapfirst[i] + tapcount[i]);
+            }
+        }
+        if (sx0 > sx1)
+            sx0 = sx1 = 0;
+        // One float of padding so 3-channel pixels can be loaded 4 at a time
+        row.resize(size_t(sx1 - sx0) * nc + 1);
+        ring.resize(size_t(ytaps) * rowlen);
+        out.resize(rowlen);
+        std::fill(ringrow.begin(), ringrow.end(),
+                  std::numeric_limits<int>::min());
+
+        // Horizontal pass: resample source row sy into ring slot h.
+        auto hpass = [&](int sy, float* h) {
+            pvt::clamped_row(src, sx0, sx1, sy, 0, 0, nc, scratch, row.data());
+            if (filter_row) {
+                size_t i = size_t(xb - roi.xbegin);
+                filter_row(row.data(), sx0, nc, &tapfirst[i], &tapcount[i],
+                           &tapweights[i], xfiltval_all, h, size_t(xe - xb));
+                return;
+            }
+            for (int x = xb; x < xe; ++x, h += nc) {
+                int i           = x - roi.xbegin;
+                const float* p  = row.data() + size_t(tapfirst[i] - sx0) * nc;
+                const float* wt = xfiltval_all + tapweights[i];
+                int n           = tapcount[i];
+                if (nc == 4 || nc == 3) {
+                    vfloat4 acc = vfloat4::Zero();
+                    for (int t = 0; t < n; ++t, p += nc)
+                        acc += vfloat4(wt[t]) * vfloat4(p);
+                    acc.store(h, nc);
+                } else {
+                    for (int c = 0; c < nc; ++c)
+                        h[c] = 0.0f;
+                    for (int t = 0; t < n; ++t, p += nc)
+                        for (int c = 0; c < nc; ++c)
+                            h[c] += wt[t] * p[c];
+                }
+            }
+        };
+
+        for (int y = roi.ybegin; y < roi.yend; ++y) {
+            float t      = (y - dstfy + 0.5f) * dstpixelheight;
+            float src_yf = srcfy + t * srcfh;
+            int src_y;
+            float src_yf_frac   = floorfrac(src_yf, &src_y);
+            float totalweight_y = 0.0f;
+            for (int j = 0; j < ytaps; ++j) {
+                float wy = filter->yfilt(
+                    yratio * (j - radj - (src_yf_frac - 0.5f)));
+                yfiltval[j] = wy;
+                totalweight_y += wy;
+            }
+            std::fill(out.begin(), out.end(), 0.0f);
+            for (int j = 0; j < ytaps && totalweight_y != 0.0f; ++j) {
+                float wy = yfiltval[j] / totalweight_y;
+                if (wy == 0.0f)
+                    continue;
+                // ytaps consecutive source rows never share a slot
+                int sy   = src_y - radj + j;
+                int slot = ((sy % ytaps) + ytaps) % ytaps;
+                float* h = ring.data() + size_t(slot) * rowlen;
+                if (ringrow[slot] != sy) {
+                    hpass(sy, h);
+                    ringrow[slot] = sy;
+                }
+                // Vertical pass: out += wy * h
+                float* r = out.data();
+                if (axpy) {
+                    axpy(wy, h, r, size_t(rowlen));
+                    continue;
+                }
+                int c = 0;
+                vfloat4 W(wy);
+                for (; c + 4 <= rowlen; c += 4)
+                    (vfloat4(r + c) + W * vfloat4(h + c)).store(r + c);
+                for (; c < rowlen; ++c)
+                    r[c] += wy * h[c];
+            }
+            ROI outroi(xb, xe, y, y + 1, roi.zbegin, roi.zbegin + 1, 0, nc);
+            dst.set_pixels(outroi, make_cspan(out));
+        }
+    }
+}
+
+
+
 template<typename DSTTYPE, typename SRCTYPE>
 static bool
 resize_(ImageBuf& dst, const ImageBuf& src, const Filter2D* filter, ROI roi,
@@ -671,6 +830,21 @@ resize_(ImageBuf& dst, const ImageBuf& src, const Filter2D* filter, ROI roi,
         typedef typename Accum_t<DSTTYPE>::type Acc_t;
         Acc_t* pel = OIIO_ALLOCA(Acc_t, nchannels);
 
+        // Separable filters are much cheaper applied as two passes, if the
+        // source data window is inside its display window (so that clamped
+        // rows can be fetched whole) and we don't need double precision.
+        if (separable && std::is_same<Acc_t, float>::value
+            && src.nchannels() == nchannels && roi.depth() == 1
+            && srcspec.depth == 1 && srcspec.x >= srcspec.full_x
+            && srcspec.y >= srcspec.full_y
+            && srcspec.x + srcspec.width <= srcspec.full_x + srcspec.full_width
+            && srcspec.y + srcspec.height
+                   <= srcspec.full_y + srcspec.full_height) {
+            resize_two_pass(dst, src, filter, xfiltval_all.get(), radi, radj,
+                            roi);
+            return;
+        }
+
 #define USE_SPECIAL 0
 #if USE_SPECIAL
         // Special case: src and dst are local memory, float buffers, and we're
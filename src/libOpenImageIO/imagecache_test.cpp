@@ -3,20 +3,34 @@
 // https://github.com/AcademySoftwareFoundation/OpenImageIO
 
 
+#include <OpenImageIO/Imath.h>
 #include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagecache.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/parallel.h>
+#include <OpenImageIO/sysutil.h>
+#include <OpenImageIO/texture.h>
 #include <OpenImageIO/unittest.h>
 
+#include <chrono>
 #include <iostream>
+#include <thread>
+
+#ifndef _WIN32
+#    include <spawn.h>
+#    include <sys/wait.h>
+#    include <unistd.h>
+extern char** environ;
+#endif
 
 using namespace OIIO;
 
 
 static ustring udimpattern;
 static ustring checkertex;
+static ustring bigtex;
 static std::vector<ustring> files_to_delete;
 
 
@@ -41,6 +55,17 @@ create_temp_textures()
         files_to_delete.push_back(checkertex);
     }
 
+    // A 1024x1024 float image in 64x64 tiles, 16 MB in all
+    {
+        std::string temp_dir = Filesystem::temp_directory_path();
+        bigtex = ustring::fmtformat("{}/evictiontest.tif", temp_dir);
+        ImageBuf big(ImageSpec(1024, 1024, 4, TypeFloat));
+        ImageBufAlgo::noise(big, "uniform", 0.0f, 1.0f);
+        big.set_write_tiles(64, 64);
+        OIIO_CHECK_ASSERT(big.write(bigtex));
+        files_to_delete.push_back(bigtex);
+    }
+
     ustring badfile("badfile.exr");
     Filesystem::write_text_file(badfile, "blahblah");
     files_to_delete.push_back(badfile);
@@ -368,9 +393,1210 @@ test_get_cache_dimensions()
 
 
 
+static void
+test_eviction_policies()
+{
+    Strutil::print("\nTesting tile eviction policies\n");
+    // bigtex is 16 MB of float tiles, more than the cache will be allowed
+    // to hold.
+    for (const char* policy : { "clock", "sharded_clock", "slru" }) {
+        auto ic = ImageCache::create(false);
+        ic->attribute("max_memory_MB", 10.0f);
+        OIIO_CHECK_ASSERT(ic->attribute("eviction_policy", policy));
+        std::string policyname;
+        ic->getattribute("eviction_policy", policyname);
+        OIIO_CHECK_EQUAL(policyname, policy);
+        // Two passes over every tile, plus repeated use of one tile that
+        // should stay resident.
+        for (int pass = 0; pass < 2; ++pass) {
+            for (int y = 0; y < 1024; y += 64) {
+                for (int x = 0; x < 1024; x += 64) {
+                    auto tile = ic->get_tile(bigtex, 0, 0, x, y, 0);
+                    OIIO_CHECK_ASSERT(tile != nullptr);
+                    ic->release_tile(tile);
+                    tile = ic->get_tile(bigtex, 0, 0, 0, 0, 0);
+                    ic->release_tile(tile);
+                }
+            }
+        }
+        long long mem = 0, evicted = 0;
+        ic->getattribute("stat:cache_memory_used", TypeInt64, &mem);
+        ic->getattribute("stat:tiles_evicted", TypeInt64, &evicted);
+        Strutil::print("  {}: {} bytes resident, {} tiles evicted\n", policy,
+                       mem, evicted);
+        OIIO_CHECK_LE(mem, 10 * 1024 * 1024);
+        OIIO_CHECK_GT(evicted, 0);
+        if (string_view(policy) == "slru") {
+            // The frequently used tile was protected, so looking it up
+            // from a fresh thread (with an empty microcache) still finds
+            // it in the cache.
+            auto thread_info = ic->create_thread_info();
+            auto handle      = ic->get_image_handle(bigtex, thread_info);
+            int missesbefore = 0, missesafter = 0;
+            ic->getattribute("stat:find_tile_cache_misses", TypeInt,
+                             &missesbefore);
+            auto tile = ic->get_tile(handle, thread_info, 0, 0, 0, 0, 0);
+            OIIO_CHECK_ASSERT(tile != nullptr);
+            ic->release_tile(tile);
+            ic->getattribute("stat:find_tile_cache_misses", TypeInt,
+                             &missesafter);
+            OIIO_CHECK_EQUAL(missesafter, missesbefore);
+            ic->destroy_thread_info(thread_info);
+        }
+        ImageCache::destroy(ic);
+    }
+
+    auto ic = ImageCache::create(false);
+    OIIO_CHECK_FALSE(ic->attribute("eviction_policy", "nonesuch"));
+    std::string policyname;
+    ic->getattribute("eviction_policy", policyname);
+    OIIO_CHECK_EQUAL(policyname, "clock");
+    ImageCache::destroy(ic);
+}
+
+
+
+static void
+test_microcache()
+{
+    Strutil::print("\nTesting per-thread set-associative microcache\n");
+    auto ic = ImageCache::create(false);
+    ic->attribute("microcache_size", 10);
+    int size = 0;
+    ic->getattribute("microcache_size", size);
+    OIIO_CHECK_EQUAL(size, 16);  // rounded up to a power of two
+
+    // Cycling among four tiles defeats the two-tile microcache, but
+    // should be served entirely by the set-associative one after the
+    // first round.
+    auto thread_info = ic->get_perthread_info();
+    auto handle      = ic->get_image_handle(bigtex, thread_info);
+    for (int i = 0; i < 40; ++i) {
+        auto tile = ic->get_tile(handle, thread_info, 0, 0, 64 * (i % 4), 0,
+                                 0);
+        OIIO_CHECK_ASSERT(tile != nullptr);
+        ic->release_tile(tile);
+    }
+    long long assoc_hits = 0, misses = 0;
+    ic->getattribute("stat:find_tile_microcache_assoc_hits", TypeInt64,
+                     &assoc_hits);
+    ic->getattribute("stat:find_tile_microcache_misses", TypeInt64, &misses);
+    OIIO_CHECK_EQUAL(misses, 4);
+    OIIO_CHECK_EQUAL(assoc_hits, 36);
+
+    // Disabled: every lookup of the cycle goes to the shared cache
+    ic->attribute("microcache_size", 0);
+    ic->reset_stats();
+    thread_info = ic->get_perthread_info();
+    for (int i = 0; i < 40; ++i) {
+        auto tile = ic->get_tile(handle, thread_info, 0, 0, 64 * (i % 4), 0,
+                                 0);
+        ic->release_tile(tile);
+    }
+    ic->getattribute("stat:find_tile_microcache_misses", TypeInt64, &misses);
+    OIIO_CHECK_EQUAL(misses, 40);
+    ImageCache::destroy(ic);
+}
+
+
+
+static void
+test_prefetch()
+{
+    Strutil::print("\nTesting prefetch\n");
+    auto ic = ImageCache::create(false);
+    ic->attribute("max_memory_MB", 100.0f);
+    ic->prefetch(bigtex, 0, 0, ROI());
+
+    // Wait for the background threads to bring in all 256 tiles
+    int tiles = 0;
+    for (int i = 0; i < 1000 && tiles < 256; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ic->getattribute("stat:tiles_current", tiles);
+    }
+    OIIO_CHECK_EQUAL(tiles, 256);
+
+    // Now every tile is resident, so looking them up misses nothing
+    int misses0 = 0, misses1 = 0;
+    ic->getattribute("stat:find_tile_cache_misses", misses0);
+    auto thread_info = ic->get_perthread_info();
+    auto handle      = ic->get_image_handle(bigtex, thread_info);
+    for (int y = 0; y < 1024; y += 64)
+        for (int x = 0; x < 1024; x += 64) {
+            auto tile = ic->get_tile(handle, thread_info, 0, 0, x, y, 0);
+            OIIO_CHECK_ASSERT(tile != nullptr);
+            ic->release_tile(tile);
+        }
+    ic->getattribute("stat:find_tile_cache_misses", misses1);
+    OIIO_CHECK_EQUAL(misses1, misses0);
+    ImageCache::destroy(ic);
+
+    // Tearing down the pool with requests still queued, either by
+    // resizing it or by destroying the cache, must not crash.
+    ic = ImageCache::create(false);
+    ic->attribute("prefetch_threads", 1);
+    ic->prefetch(bigtex, 0, 0, ROI());
+    ic->attribute("prefetch_threads", 2);
+    ic->prefetch(bigtex, 0, 0, ROI());
+    ImageCache::destroy(ic);
+}
+
+
+
+static void
+test_diskcache()
+{
+    Strutil::print("\nTesting the disk tile cache\n");
+    std::string dir = Strutil::fmt::format("{}/oiio_diskcache_{}",
+                                           Filesystem::temp_directory_path(),
+                                           Filesystem::unique_path());
+    ImageBuf orig(bigtex);
+    orig.read(0, 0, true, TypeFloat);
+    ROI roi = orig.roi();
+    std::vector<float> pixels(roi.npixels() * roi.nchannels());
+    image_span<float> result(pixels.data(), roi.nchannels(), roi.width(),
+                             roi.height());
+
+    // The first cache reads everything from the file, spilling tiles as
+    // they're evicted; the second pass is then partly read back from disk.
+    auto ic = ImageCache::create(false);
+    ic->attribute("max_memory_MB", 10.0f);
+    OIIO_CHECK_ASSERT(ic->attribute("diskcache_dir", dir));
+    std::string dirattr;
+    ic->getattribute("diskcache_dir", dirattr);
+    OIIO_CHECK_EQUAL(dirattr, dir);
+    for (int pass = 0; pass < 2; ++pass) {
+        OIIO_CHECK_ASSERT(ic->get_pixels(bigtex, 0, 0, roi, result));
+        OIIO_CHECK_ASSERT(0 == memcmp(pixels.data(), orig.localpixels(),
+                                      pixels.size() * sizeof(float)));
+    }
+    long long spills = 0, hits = 0;
+    ic->getattribute("stat:diskcache_spills", TypeInt64, &spills);
+    ic->getattribute("stat:diskcache_hits", TypeInt64, &hits);
+    Strutil::print("  {} tiles spilled, {} read back\n", spills, hits);
+    OIIO_CHECK_GT(spills, 0);
+    OIIO_CHECK_GT(hits, 0);
+    ImageCache::destroy(ic);
+
+    // A fresh cache sharing the directory finds the tiles already there.
+    ic = ImageCache::create(false);
+    ic->attribute("diskcache_dir", dir);
+    OIIO_CHECK_ASSERT(ic->get_pixels(bigtex, 0, 0, roi, result));
+    OIIO_CHECK_ASSERT(0 == memcmp(pixels.data(), orig.localpixels(),
+                                  pixels.size() * sizeof(float)));
+    hits = 0;
+    ic->getattribute("stat:diskcache_hits", TypeInt64, &hits);
+    OIIO_CHECK_GT(hits, 0);
+    ImageCache::destroy(ic);
+
+#ifndef _WIN32
+    // With the slabs mapped, those tiles are used in place.
+    ic = ImageCache::create(false);
+    ic->attribute("diskcache_dir", dir);
+    ic->attribute("diskcache_mmap", 1);
+    OIIO_CHECK_ASSERT(ic->get_pixels(bigtex, 0, 0, roi, result));
+    OIIO_CHECK_ASSERT(0 == memcmp(pixels.data(), orig.localpixels(),
+                                  pixels.size() * sizeof(float)));
+    long long mapped = 0, mappedmem = 0;
+    ic->getattribute("stat:tiles_mapped", TypeInt64, &mapped);
+    ic->getattribute("stat:mapped_memory_used", TypeInt64, &mappedmem);
+    Strutil::print("  {} tiles used in place, {} bytes mapped\n", mapped,
+                   mappedmem);
+    OIIO_CHECK_GT(mapped, 0);
+    OIIO_CHECK_GT(mappedmem, 0);
+    ImageCache::destroy(ic);
+#endif
+
+    // With a size limit, creating the image's 16 MB slab removes the least
+    // recently used files until the directory fits in 20 MB again: the
+    // two oldest of three older 2 MB slabs.
+    Filesystem::remove_all(dir);
+    Filesystem::create_directory(dir);
+    std::vector<std::string> old;
+    for (int i = 0; i < 3; ++i) {
+        old.push_back(Strutil::fmt::format("{}/{:016x}.tiles", dir, i + 1));
+        Filesystem::write_binary_file(old[i], std::vector<char>(2 << 20));
+        Filesystem::last_write_time(old[i],
+                                    std::time(nullptr) - 3000 + 1000 * i);
+    }
+    ic = ImageCache::create(false);
+    ic->attribute("max_memory_MB", 10.0f);
+    ic->attribute("diskcache_max_MB", 20);
+    ic->attribute("diskcache_dir", dir);
+    OIIO_CHECK_ASSERT(ic->get_pixels(bigtex, 0, 0, roi, result));
+    ImageCache::destroy(ic);
+    OIIO_CHECK_ASSERT(!Filesystem::exists(old[0]));
+    OIIO_CHECK_ASSERT(!Filesystem::exists(old[1]));
+    OIIO_CHECK_ASSERT(Filesystem::exists(old[2]));
+    Filesystem::remove_all(dir);
+}
+
+
+
+#ifndef _WIN32
+// A cache attached to the shared pool name, with a single set of slots
+static std::shared_ptr<ImageCache>
+pooled_cache(const std::string& name)
+{
+    auto c = ImageCache::create(false);
+    c->attribute("get_pixels_threads", 1);
+    c->attribute("shared_pool_MB", 1);
+    OIIO_CHECK_ASSERT(c->attribute("shared_pool", name));
+    return c;
+}
+
+
+
+// Run as its own process by test_shared_pool: fill the pool with tiles of
+// the top left corner of file, then die without detaching from it.
+static void
+shared_pool_owner(const std::string& name, ustring file)
+{
+    auto c = pooled_cache(name);
+    std::vector<float> pixels(256 * 256 * 4);
+    bool ok = c->get_pixels(file, 0, 0, ROI(0, 256, 0, 256, 0, 1, 0, 4),
+                            image_span<float>(pixels.data(), 4, 256, 256));
+    _exit(ok ? 0 : 1);
+}
+#endif
+
+
+
+static void
+test_shared_pool()
+{
+#ifndef _WIN32
+    Strutil::print("\nTesting shared tile pool\n");
+    std::string name = Strutil::fmt::format("/oiio_test_{}",
+                                            Filesystem::unique_path());
+    ImageBuf orig(bigtex);
+    orig.read(0, 0, true, TypeFloat);
+    ROI roi = orig.roi();
+    std::vector<float> pixels(roi.npixels() * roi.nchannels());
+    image_span<float> result(pixels.data(), roi.nchannels(), roi.width(),
+                             roi.height());
+
+    // Two caches attached to the same pool stand in for two processes:
+    // the first reads the tiles into the pool, the second finds them
+    // there and doesn't read them again.
+    std::shared_ptr<ImageCache> ic[2];
+    for (auto& c : ic) {
+        c = ImageCache::create(false);
+        c->attribute("shared_pool_MB", 32);
+        OIIO_CHECK_ASSERT(c->attribute("shared_pool", name));
+    }
+    long long found[2] = { 0, 0 }, stored[2] = { 0, 0 }, shmem = 0;
+    for (int i = 0; i < 2; ++i) {
+        OIIO_CHECK_ASSERT(ic[i]->get_pixels(bigtex, 0, 0, roi, result));
+        OIIO_CHECK_ASSERT(0 == memcmp(pixels.data(), orig.localpixels(),
+                                      pixels.size() * sizeof(float)));
+        ic[i]->getattribute("stat:shared_tiles_found", TypeInt64, &found[i]);
+        ic[i]->getattribute("stat:shared_tiles_stored", TypeInt64,
+                            &stored[i]);
+    }
+    ic[1]->getattribute("stat:shared_memory_used", TypeInt64, &shmem);
+    Strutil::print("  {} tiles stored, then {} found ({} bytes)\n",
+                   stored[0], found[1], shmem);
+    OIIO_CHECK_GT(stored[0], 0);
+    OIIO_CHECK_EQUAL(found[1], stored[0]);
+    OIIO_CHECK_EQUAL(stored[1], 0);
+    OIIO_CHECK_GT(shmem, 0);
+    for (auto& c : ic)
+        ImageCache::destroy(c);
+
+    // A process that dies holding tiles of a pool with a single set of
+    // slots fills it up; the next process to find it full takes them back.
+    // The dying process is a fresh run of this program (see main), since
+    // forking one that has threads running isn't safe.
+    auto survivor      = pooled_cache(name);
+    std::string self   = Sysutil::this_program_path();
+    const char* args[] = { self.c_str(), "--shared-pool-owner", name.c_str(),
+                           bigtex.c_str(), nullptr };
+    pid_t pid          = -1;
+    int status         = -1;
+    OIIO_CHECK_EQUAL(posix_spawn(&pid, self.c_str(), nullptr, nullptr,
+                                 (char* const*)args, environ),
+                     0);
+    OIIO_CHECK_EQUAL(waitpid(pid, &status, 0), pid);
+    OIIO_CHECK_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    long long reclaimed = 0;
+    ROI corner(256, 512, 0, 256, 0, 1, 0, roi.nchannels());
+    image_span<float> cornerpix(pixels.data(), roi.nchannels(), 256, 256);
+    OIIO_CHECK_ASSERT(survivor->get_pixels(bigtex, 0, 0, corner, cornerpix));
+    survivor->getattribute("stat:shared_tiles_stored", TypeInt64,
+                           &reclaimed);
+    Strutil::print("  {} tiles stored after a process died\n", reclaimed);
+    OIIO_CHECK_EQUAL(reclaimed, 16);
+    ImageCache::destroy(survivor);
+#    ifdef __linux__
+    // The last one out removed the segment.
+    OIIO_CHECK_ASSERT(!Filesystem::exists("/dev/shm" + name));
+#    endif
+#endif
+}
+
+
+
+static void
+test_deduplicate_tiles()
+{
+    Strutil::print("\nTesting tile deduplication\n");
+    // Two files of the same constant image: every tile of both is the same
+    ImageBuf orig(ImageSpec(256, 256, 4, TypeFloat));
+    float color[] = { 0.25f, 0.5f, 0.75f, 1.0f };
+    ImageBufAlgo::fill(orig, color);
+    orig.set_write_tiles(64, 64);
+    ustring files[2];
+    for (int i = 0; i < 2; ++i) {
+        files[i] = ustring::fmtformat("{}/deduptest{}.exr",
+                                      Filesystem::temp_directory_path(), i);
+        OIIO_CHECK_ASSERT(orig.write(files[i]));
+        files_to_delete.push_back(files[i]);
+    }
+
+    ROI roi = orig.roi();
+    std::vector<float> pixels(roi.npixels() * roi.nchannels());
+    image_span<float> result(pixels.data(), roi.nchannels(), roi.width(),
+                             roi.height());
+    auto ic = ImageCache::create(false);
+    ic->attribute("deduplicate_tiles", 1);
+    for (auto f : files) {
+        OIIO_CHECK_ASSERT(ic->get_pixels(f, 0, 0, roi, result));
+        OIIO_CHECK_ASSERT(0 == memcmp(pixels.data(), orig.localpixels(),
+                                      pixels.size() * sizeof(float)));
+    }
+    long long dedup = 0, saved = 0, mem = 0, shared = 0;
+    ic->getattribute("stat:tiles_deduplicated", TypeInt64, &dedup);
+    ic->getattribute("stat:dedup_bytes_saved", TypeInt64, &saved);
+    ic->getattribute("stat:cache_memory_used", TypeInt64, &mem);
+    ic->getattribute("stat:dedup_memory_used", TypeInt64, &shared);
+    Strutil::print("  {} tiles deduplicated, {} bytes saved, {} used, "
+                   "{} shared\n",
+                   dedup, saved, mem, shared);
+    OIIO_CHECK_EQUAL(dedup, 2 * 16 - 1);
+    OIIO_CHECK_LT(mem, saved);
+    // The one buffer they all share is all that's left, and it doesn't
+    // count as cache memory that eviction could free.
+    OIIO_CHECK_EQUAL(shared, saved / dedup);
+    OIIO_CHECK_LT(mem, shared);
+    ImageCache::destroy(ic);
+}
+
+
+
+static void
+test_compressed_tiles()
+{
+    Strutil::print("\nTesting compressed tiles\n");
+    // 8 MB of smooth half tiles, which pack well
+    std::string filename = Strutil::fmt::format(
+        "{}/compresstest.exr", Filesystem::temp_directory_path());
+    ImageBuf orig(ImageSpec(1024, 1024, 4, TypeHalf));
+    float tl[] = { 0.0f, 0.0f, 0.0f, 1.0f }, tr[] = { 1.0f, 0.0f, 0.5f, 1.0f };
+    float bl[] = { 0.0f, 1.0f, 0.5f, 1.0f }, br[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    ImageBufAlgo::fill(orig, tl, tr, bl, br);
+    orig.set_write_tiles(64, 64);
+    OIIO_CHECK_ASSERT(orig.write(filename));
+    files_to_delete.push_back(ustring(filename));
+
+    ROI roi = orig.roi();
+    std::vector<half> pixels(roi.npixels() * roi.nchannels());
+    image_span<half> result(pixels.data(), roi.nchannels(), roi.width(),
+                            roi.height());
+    auto ic = ImageCache::create(false);
+    ic->attribute("max_memory_MB", 4.0f);
+    ic->attribute("compress_tiles", 1);
+    for (int pass = 0; pass < 2; ++pass) {
+        OIIO_CHECK_ASSERT(
+            ic->get_pixels(ustring(filename), 0, 0, roi, result));
+        OIIO_CHECK_ASSERT(0 == memcmp(pixels.data(), orig.localpixels(),
+                                      pixels.size() * sizeof(half)));
+    }
+    long long packed = 0, unpacked = 0, raw = 0, bytes = 0, mem = 0;
+    ic->getattribute("stat:tiles_compressed", TypeInt64, &packed);
+    ic->getattribute("stat:tiles_decompressed", TypeInt64, &unpacked);
+    ic->getattribute("stat:compressed_raw_bytes", TypeInt64, &raw);
+    ic->getattribute("stat:compressed_bytes", TypeInt64, &bytes);
+    ic->getattribute("stat:cache_memory_used", TypeInt64, &mem);
+    Strutil::print("  {} tiles packed ({} -> {} bytes), {} unpacked\n",
+                   packed, raw, bytes, unpacked);
+    OIIO_CHECK_GT(packed, 0);
+    OIIO_CHECK_GT(unpacked, 0);
+    OIIO_CHECK_LT(bytes, raw);
+    OIIO_CHECK_LE(mem, 4 * 1024 * 1024);
+
+    // Turning it off frees the compressed tier
+    ic->attribute("compress_tiles", 0);
+    ic->getattribute("stat:compressed_memory_used", TypeInt64, &mem);
+    OIIO_CHECK_EQUAL(mem, 0);
+    ImageCache::destroy(ic);
+
+    // Noisy tiles pack poorly, so the compressed tier overflows its half
+    // of a small limit, and must be trimmed back with the clock policy too.
+    std::string noisyname = Strutil::fmt::format(
+        "{}/compressnoise.exr", Filesystem::temp_directory_path());
+    ImageBuf noisy(orig.spec());
+    ImageBufAlgo::noise(noisy, "uniform", 0.0f, 1.0f);
+    noisy.set_write_tiles(64, 64);
+    OIIO_CHECK_ASSERT(noisy.write(noisyname));
+    files_to_delete.push_back(ustring(noisyname));
+    ic = ImageCache::create(false);
+    ic->attribute("max_memory_MB", 1.0f);
+    OIIO_CHECK_ASSERT(ic->attribute("eviction_policy", "clock"));
+    ic->attribute("compress_tiles", 1);
+    for (int pass = 0; pass < 2; ++pass)
+        OIIO_CHECK_ASSERT(
+            ic->get_pixels(ustring(noisyname), 0, 0, roi, result));
+    long long packedmem = 0;
+    ic->getattribute("stat:tiles_compressed", TypeInt64, &packed);
+    ic->getattribute("stat:compressed_memory_used", TypeInt64, &packedmem);
+    ic->getattribute("stat:cache_memory_used", TypeInt64, &mem);
+    Strutil::print("  clock: {} tiles packed, {} of {} bytes compressed\n",
+                   packed, packedmem, mem);
+    OIIO_CHECK_GT(packed, 0);
+    OIIO_CHECK_LE(packedmem, 512 * 1024);
+    OIIO_CHECK_LE(mem, 1024 * 1024);
+    ImageCache::destroy(ic);
+}
+
+
+
+static void
+test_parallel_get_pixels()
+{
+    Strutil::print("\nTesting parallel get_pixels\n");
+    // A region hanging off two edges of bigtex, converted to half. The
+    // serial fetch is the reference for the parallel one.
+    ROI roi(-40, 1000, 100, 1030, 0, 1, 0, 4);
+    size_t nvalues = roi.npixels() * roi.nchannels();
+    std::vector<half> pixels[2];
+    for (int i = 0; i < 2; ++i) {
+        auto ic = ImageCache::create(false);
+        ic->attribute("get_pixels_threads", i == 0 ? 1 : 0);
+        pixels[i].resize(nvalues, half(-1.0f));
+        image_span<half> result(pixels[i].data(), roi.nchannels(),
+                                roi.width(), roi.height());
+        OIIO_CHECK_ASSERT(ic->get_pixels(bigtex, 0, 0, roi, result));
+        ImageCache::destroy(ic);
+    }
+    OIIO_CHECK_ASSERT(pixels[0] == pixels[1]);
+    // Outside the data window is zero, inside is the image
+    OIIO_CHECK_EQUAL(pixels[1][0], 0.0f);
+    ImageBuf orig(bigtex);
+    float texel[4];
+    orig.getpixel(0, 100, texel);
+    OIIO_CHECK_EQUAL(pixels[1][40 * 4], half(texel[0]));
+}
+
+
+
+// A 256x256 image of ones, in 64x64 tiles, one of which can't be read.
+class BadTileInput final : public ImageInput {
+public:
+    const char* format_name() const override { return "badtile"; }
+    bool open(const std::string& /*name*/, ImageSpec& newspec) override
+    {
+        m_spec             = ImageSpec(256, 256, 1, TypeFloat);
+        m_spec.tile_width  = 64;
+        m_spec.tile_height = 64;
+        newspec            = m_spec;
+        return true;
+    }
+    bool close() override { return true; }
+    bool read_native_scanline(int /*subimage*/, int /*miplevel*/, int /*y*/,
+                              int /*z*/, void* /*data*/) override
+    {
+        return false;
+    }
+    bool read_native_tile(int /*subimage*/, int /*miplevel*/, int x, int y,
+                          int /*z*/, void* data) override
+    {
+        if (x == 128 && y == 64) {
+            errorfmt("unreadable tile");
+            return false;
+        }
+        std::fill_n((float*)data, 64 * 64, 1.0f);
+        return true;
+    }
+};
+
+static ImageInput*
+BadTileInputCreator()
+{
+    return new BadTileInput;
+}
+
+
+
+static void
+test_get_pixels_bad_tile()
+{
+    Strutil::print("\nTesting get_pixels with an unreadable tile\n");
+    ustring name("badtile");
+    auto ic = ImageCache::create(false);
+    ic->attribute("get_pixels_threads", 0);
+    OIIO_CHECK_ASSERT(ic->add_file(name, BadTileInputCreator));
+    // Read the top row of tiles first, so that they're in the cache no
+    // matter which piece of the whole image fails first.
+    ROI roi(0, 256, 0, 256, 0, 1, 0, 1);
+    std::vector<float> pixels(roi.npixels(), -1.0f);
+    OIIO_CHECK_ASSERT(ic->get_pixels(name, 0, 0, ROI(0, 256, 0, 64, 0, 1, 0, 1),
+                                     image_span<float>(pixels.data(), 1,
+                                                       256, 64)));
+    // The bad tile fails the whole call, but every pixel is filled in:
+    // zero where tiles couldn't be read, and the tiles that could be
+    // (at least the ones already cached) aren't skipped.
+    std::fill(pixels.begin(), pixels.end(), -1.0f);
+    OIIO_CHECK_ASSERT(!ic->get_pixels(name, 0, 0, roi,
+                                      image_span<float>(pixels.data(), 1,
+                                                        256, 256)));
+    OIIO_CHECK_ASSERT(ic->has_error());
+    (void)ic->geterror();
+    int ones = 0, zeros = 0;
+    for (float p : pixels) {
+        ones += p == 1.0f;
+        zeros += p == 0.0f;
+    }
+    Strutil::print("  {} pixels read, {} zeroed\n", ones, zeros);
+    OIIO_CHECK_EQUAL(ones + zeros, int(pixels.size()));
+    OIIO_CHECK_GE(ones, 256 * 64);
+    OIIO_CHECK_EQUAL(pixels[64 * 256 + 128], 0.0f);
+    ImageCache::destroy(ic);
+}
+
+
+
+static void
+test_access_stats()
+{
+    Strutil::print("\nTesting per-MIP access statistics\n");
+    ROI roi(0, 1024, 0, 1024, 0, 1, 0, 4);
+    std::vector<float> pixels(roi.npixels() * roi.nchannels());
+    image_span<float> result(pixels.data(), roi.nchannels(), roi.width(),
+                             roi.height());
+    auto ic = ImageCache::create(false);
+    ic->attribute("access_stats", 1);
+    ic->attribute("get_pixels_threads", 1);
+    // All 256 tiles miss the first time and are found the second
+    for (int pass = 0; pass < 2; ++pass)
+        OIIO_CHECK_ASSERT(ic->get_pixels(bigtex, 0, 0, roi, result));
+    long long hits = 0, misses = 0;
+    float iotime = 0.0f;
+    OIIO_CHECK_ASSERT(ic->get_image_info(bigtex, 0, 0,
+                                         ustring("stat:mip_hits"),
+                                         TypeDesc(TypeDesc::INT64, 1), &hits));
+    OIIO_CHECK_ASSERT(ic->get_image_info(bigtex, 0, 0,
+                                         ustring("stat:mip_misses"),
+                                         TypeDesc(TypeDesc::INT64, 1),
+                                         &misses));
+    OIIO_CHECK_ASSERT(ic->get_image_info(bigtex, 0, 0,
+                                         ustring("stat:mip_io_time"),
+                                         TypeDesc(TypeDesc::FLOAT, 1),
+                                         &iotime));
+    Strutil::print("  mip 0: {} hits, {} misses, {:.3f}s I/O\n", hits,
+                   misses, iotime);
+    OIIO_CHECK_EQUAL(misses, 256);
+    OIIO_CHECK_GT(hits, 0);
+    OIIO_CHECK_GT(iotime, 0.0f);
+    std::string json = ic->getstats_json();
+    OIIO_CHECK_ASSERT(Strutil::contains(json, bigtex));
+    OIIO_CHECK_ASSERT(Strutil::contains(json, "\"misses\": 256"));
+    ImageCache::destroy(ic);
+}
+
+
+
+// A row of 16 tiles, each filled with its x coordinate. Reading tile 0
+// waits until gated_tile_open is set, so that misses on the other tiles
+// queue up behind it.
+static std::atomic<bool> gated_tile_open(false);
+static std::atomic<bool> gated_tile_reading(false);
+
+class GatedTileInput final : public ImageInput {
+public:
+    const char* format_name() const override { return "gatedtile"; }
+    bool open(const std::string& /*name*/, ImageSpec& newspec) override
+    {
+        m_spec             = ImageSpec(1024, 64, 1, TypeFloat);
+        m_spec.tile_width  = 64;
+        m_spec.tile_height = 64;
+        newspec            = m_spec;
+        return true;
+    }
+    bool close() override { return true; }
+    bool read_native_scanline(int /*subimage*/, int /*miplevel*/, int /*y*/,
+                              int /*z*/, void* /*data*/) override
+    {
+        return false;
+    }
+    bool read_native_tile(int /*subimage*/, int /*miplevel*/, int x, int /*y*/,
+                          int /*z*/, void* data) override
+    {
+        if (x == 0) {
+            gated_tile_reading = true;
+            while (!gated_tile_open)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::fill_n((float*)data, 64 * 64, float(x));
+        return true;
+    }
+};
+
+static ImageInput*
+GatedTileInputCreator()
+{
+    return new GatedTileInput;
+}
+
+
+
+static void
+test_batched_reads()
+{
+    Strutil::print("\nTesting batched tile reads\n");
+    ustring name("gatedtile");
+    auto ic = ImageCache::create(false);
+    OIIO_CHECK_ASSERT(ic->add_file(name, GatedTileInputCreator));
+    std::atomic<int> started(0), failures(0);
+    auto readtile = [&](int x) {
+        std::vector<float> pixels(64 * 64);
+        if (!ic->get_pixels(name, 0, 0, ROI(x, x + 64, 0, 64, 0, 1, 0, 1),
+                            image_span<float>(pixels.data(), 1, 64, 64))
+            || pixels.front() != float(x) || pixels.back() != float(x))
+            ++failures;
+    };
+    // One thread becomes the reader and is held up on tile 0. The others
+    // all miss on the rest of the row meanwhile, and once tile 0 is let
+    // through, their adjacent tiles are read together.
+    gated_tile_open    = false;
+    gated_tile_reading = false;
+    std::thread reader(readtile, 0);
+    while (!gated_tile_reading)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::vector<std::thread> threads;
+    for (int t = 1; t < 16; ++t)
+        threads.emplace_back([&, t]() {
+            ++started;
+            readtile(64 * t);
+        });
+    while (started < 15)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    gated_tile_open = true;
+    reader.join();
+    for (auto& t : threads)
+        t.join();
+    OIIO_CHECK_EQUAL(failures, 0);
+    long long reads = 0, tiles = 0;
+    ic->getattribute("stat:batched_reads", TypeInt64, &reads);
+    ic->getattribute("stat:batched_tiles", TypeInt64, &tiles);
+    Strutil::print("  {} tiles read by {} batched calls\n", tiles, reads);
+    OIIO_CHECK_GT(reads, 0);
+    OIIO_CHECK_GT(tiles, reads);
+    ImageCache::destroy(ic);
+}
+
+
+
+static void
+test_preload_headers()
+{
+    Strutil::print("\nTesting parallel header preload\n");
+    auto ic = ImageCache::create(false);
+    ic->attribute("max_open_files", 1);
+    ustring files[] = { checkertex, bigtex, ustring("noexist.exr"),
+                        ustring("badfile.exr") };
+    OIIO_CHECK_EQUAL(ic->preload_headers(files, 4), 2);
+    ic->geterror();  // clear errors from the bad files
+    // A udim pattern preloads its tiles too
+    OIIO_CHECK_EQUAL(ic->preload_headers(cspan<ustring>(&udimpattern, 1)),
+                     2);
+    long long preloaded = 0;
+    ic->getattribute("stat:preload_files", TypeInt64, &preloaded);
+    OIIO_CHECK_EQUAL(preloaded, 6);
+    // The headers are known without reopening, and pixels still work
+    // even if the preload closed the files again.
+    const ImageSpec* spec = ic->imagespec(bigtex);
+    OIIO_CHECK_ASSERT(spec && spec->width == 1024);
+    float pixel[4];
+    OIIO_CHECK_ASSERT(ic->get_pixels(bigtex, 0, 0, ROI(0, 1, 0, 1, 0, 1, 0, 4),
+                                     image_span<float>(pixel, 4, 1, 1)));
+    ImageCache::destroy(ic);
+}
+
+
+
+static void
+test_header_catalog()
+{
+    Strutil::print("\nTesting the header catalog\n");
+    std::string catalog = Filesystem::temp_directory_path()
+                          + "/oiio_header_catalog.bin";
+    Filesystem::remove(catalog);
+    // The first cache has to open the file, and records its headers
+    auto ic = ImageCache::create(false);
+    ic->attribute("header_catalog", catalog);
+    OIIO_CHECK_ASSERT(ic->imagespec(bigtex) != nullptr);
+    long long hits = 0, misses = 0;
+    ic->getattribute("stat:catalog_misses", TypeInt64, &misses);
+    OIIO_CHECK_EQUAL(misses, 1);
+    ImageCache::destroy(ic);
+
+    // A fresh cache knows the headers without opening the file, until it
+    // needs pixels.
+    ic = ImageCache::create(false);
+    ic->attribute("header_catalog", catalog);
+    const ImageSpec* spec = ic->imagespec(bigtex);
+    OIIO_CHECK_ASSERT(spec && spec->width == 1024 && spec->tile_width == 64);
+    ic->getattribute("stat:catalog_hits", TypeInt64, &hits);
+    OIIO_CHECK_EQUAL(hits, 1);
+    int timesopened = -1;
+    ic->get_image_info(bigtex, 0, 0, ustring("stat:timesopened"), TypeInt,
+                       &timesopened);
+    OIIO_CHECK_EQUAL(timesopened, 0);
+    float pixel[4];
+    OIIO_CHECK_ASSERT(ic->get_pixels(bigtex, 0, 0, ROI(0, 1, 0, 1, 0, 1, 0, 4),
+                                     image_span<float>(pixel, 4, 1, 1)));
+    ic->get_image_info(bigtex, 0, 0, ustring("stat:timesopened"), TypeInt,
+                       &timesopened);
+    OIIO_CHECK_EQUAL(timesopened, 1);
+    ImageCache::destroy(ic);
+
+    // A file that changes after its headers came from the catalog has them
+    // read again once its pixels are needed.
+    ustring changing = ustring::fmtformat("{}/catalogtest.tif",
+                                          Filesystem::temp_directory_path());
+    auto write_changing = [&](int res) {
+        ImageBuf buf(ImageSpec(res, res, 1, TypeUInt8));
+        ImageBufAlgo::fill(buf, { 0.5f });
+        buf.set_write_tiles(16, 16);
+        OIIO_CHECK_ASSERT(buf.write(changing));
+    };
+    write_changing(32);
+    files_to_delete.push_back(changing);
+    ic = ImageCache::create(false);
+    ic->attribute("header_catalog", catalog);
+    OIIO_CHECK_ASSERT(ic->imagespec(changing) != nullptr);
+    ImageCache::destroy(ic);
+    ic = ImageCache::create(false);
+    ic->attribute("header_catalog", catalog);
+    spec = ic->imagespec(changing);
+    OIIO_CHECK_ASSERT(spec && spec->width == 32);
+    write_changing(64);
+    OIIO_CHECK_ASSERT(ic->get_pixels(changing, 0, 0,
+                                     ROI(0, 1, 0, 1, 0, 1, 0, 1),
+                                     image_span<float>(pixel, 1, 1, 1)));
+    spec = ic->imagespec(changing);
+    OIIO_CHECK_ASSERT(spec && spec->width == 64);
+    ImageCache::destroy(ic);
+
+    // Reading pixels first records bigtex again, so half the records are
+    // now dead, and the next cache to load the catalog drops them.
+    ic = ImageCache::create(false);
+    ic->attribute("header_catalog", catalog);
+    OIIO_CHECK_ASSERT(ic->get_pixels(bigtex, 0, 0, ROI(0, 1, 0, 1, 0, 1, 0, 4),
+                                     image_span<float>(pixel, 4, 1, 1)));
+    ImageCache::destroy(ic);
+    uint64_t before = Filesystem::file_size(catalog);
+    ic              = ImageCache::create(false);
+    ic->attribute("header_catalog", catalog);
+    OIIO_CHECK_ASSERT(Filesystem::file_size(catalog) < before);
+    OIIO_CHECK_ASSERT(ic->imagespec(bigtex) && ic->imagespec(changing));
+    ic->getattribute("stat:catalog_hits", TypeInt64, &hits);
+    OIIO_CHECK_EQUAL(hits, 2);
+    ImageCache::destroy(ic);
+    Filesystem::remove(catalog);
+}
+
+
+
+static void
+test_udim_listings()
+{
+    Strutil::print("\nTesting udim tile inventories\n");
+    std::string dir = Filesystem::temp_directory_path() + "/oiio_udimtest";
+    Filesystem::create_directory(dir);
+    ImageBuf tile(ImageSpec(4, 4, 1, TypeUInt8));
+    ImageBufAlgo::fill(tile, { 0.5f });
+    auto write_tile = [&](string_view name) {
+        OIIO_CHECK_ASSERT(tile.write(Strutil::fmt::format("{}/{}", dir, name)));
+    };
+
+    // Two tiles at opposite corners of a 100x100 range are kept in a sparse
+    // index, which must still resolve exactly the populated tiles.
+    write_tile("sparse.u0_v0.tif");
+    write_tile("sparse.u99_v99.tif");
+    auto ts = TextureSystem::create(false);
+    ustring sparse(Strutil::fmt::format("{}/sparse.<uvtile>.tif", dir));
+    std::vector<ustring> filenames;
+    int nutiles = 0, nvtiles = 0;
+    ts->inventory_udim(sparse, filenames, nutiles, nvtiles);
+    OIIO_CHECK_EQUAL(nutiles, 100);
+    OIIO_CHECK_EQUAL(nvtiles, 100);
+    OIIO_CHECK_EQUAL(std::count_if(filenames.begin(), filenames.end(),
+                                   [](ustring f) { return !f.empty(); }),
+                     2);
+    ustring far(Strutil::fmt::format("{}/sparse.u99_v99.tif", dir));
+    OIIO_CHECK_ASSERT(ts->resolve_udim(sparse, 99.5f, 99.5f)
+                      == ts->get_texture_handle(far));
+    OIIO_CHECK_ASSERT(ts->resolve_udim(sparse, 0.5f, 0.5f) != nullptr);
+    OIIO_CHECK_ASSERT(ts->resolve_udim(sparse, 5.5f, 5.5f) == nullptr);
+
+    // The directory listing is remembered, but a file added later is found
+    // by new patterns once it is invalidated, or once the directory's
+    // modification time changes.
+    write_tile("memo.1001.tif");
+    ustring memo1(Strutil::fmt::format("{}/memo.<UDIM>.tif", dir));
+    ts->inventory_udim(memo1, filenames, nutiles, nvtiles);
+    OIIO_CHECK_EQUAL(nutiles, 1);
+    std::time_t dirtime = Filesystem::last_write_time(dir);
+    write_tile("memo.1002.tif");
+    Filesystem::last_write_time(dir, dirtime);  // Hide the change
+    ts->invalidate(ustring(Strutil::fmt::format("{}/memo.1002.tif", dir)));
+    ustring memo2(Strutil::fmt::format("{}/memo.%(UDIM)d.tif", dir));
+    ts->inventory_udim(memo2, filenames, nutiles, nvtiles);
+    OIIO_CHECK_EQUAL(nutiles, 2);
+    write_tile("other.1001.tif");
+    write_tile("other.1002.tif");
+    Filesystem::last_write_time(dir, dirtime + 10);
+    ustring other(Strutil::fmt::format("{}/other.<UDIM>.tif", dir));
+    ts->inventory_udim(other, filenames, nutiles, nvtiles);
+    OIIO_CHECK_EQUAL(nutiles, 2);
+    TextureSystem::destroy(ts);
+    Filesystem::remove_all(dir);
+}
+
+
+
+static void
+test_texture_batch()
+{
+    Strutil::print("\nTesting batched lookups against single-point ones\n");
+    auto ts     = TextureSystem::create(false);
+    const int W = Tex::BatchWidth;
+    // The probes run off the edges, so some lanes of every batch take the
+    // per-lane wrap path and the rest the vectorized interior path.
+    float s[W], t[W], dsdx[W], dtdx[W], dsdy[W], dtdy[W];
+    for (int i = 0; i < W; ++i) {
+        s[i]    = -0.1f + 0.087f * i;
+        t[i]    = 1.05f - 0.071f * i;
+        dsdx[i] = 0.001f + 0.0004f * i;
+        dtdx[i] = 0.0002f;
+        dsdy[i] = -0.0001f;
+        dtdy[i] = 0.0015f;
+    }
+    for (ustring file : { bigtex, checkertex }) {
+        auto handle = ts->get_texture_handle(file);
+        for (auto interp :
+             { Tex::InterpMode::Closest, Tex::InterpMode::Bilinear,
+               Tex::InterpMode::Bicubic, Tex::InterpMode::SmartBicubic }) {
+            for (auto wrap : { Tex::Wrap::Black, Tex::Wrap::Periodic }) {
+                TextureOptBatch bopt;
+                bopt.interpmode = decltype(bopt.interpmode)(interp);
+                bopt.swrap = bopt.twrap = decltype(bopt.swrap)(wrap);
+                TextureOpt opt;
+                opt.interpmode = TextureOpt::InterpMode(interp);
+                opt.swrap = opt.twrap = TextureOpt::Wrap(wrap);
+                float r[4 * W], ds[4 * W], dt[4 * W];
+                OIIO_CHECK_ASSERT(ts->texture(handle, nullptr, bopt,
+                                              Tex::RunMaskOn, s, t, dsdx,
+                                              dtdx, dsdy, dtdy, 4, r, ds, dt));
+                // Derivatives are in texels, so compare them relatively
+                auto close = [](float a, float b, float tol) {
+                    return std::abs(a - b)
+                           <= tol * std::max(1.0f, std::abs(b));
+                };
+                int mismatches = 0;
+                for (int i = 0; i < W; ++i) {
+                    float r1[4], ds1[4], dt1[4];
+                    ts->texture(handle, nullptr, opt, s[i], t[i], dsdx[i],
+                                dtdx[i], dsdy[i], dtdy[i], 4, r1, ds1, dt1);
+                    for (int c = 0; c < 4; ++c)
+                        if (!close(r[c * W + i], r1[c], 1.0e-5f)
+                            || !close(ds[c * W + i], ds1[c], 1.0e-3f)
+                            || !close(dt[c * W + i], dt1[c], 1.0e-3f))
+                            ++mismatches;
+                }
+                OIIO_CHECK_EQUAL(mismatches, 0);
+            }
+        }
+    }
+    TextureSystem::destroy(ts);
+}
+
+
+
+static void
+test_aniso_simd()
+{
+    Strutil::print("\nTesting vectorized anisotropic filtering\n");
+    auto ts = TextureSystem::create(false);
+    TextureOpt opt;
+    opt.swrap = opt.twrap = TextureOpt::WrapPeriodic;
+    // The float texture exercises the gather path, the half one the
+    // converting path; both wrap, so edge probes take the slow path.
+    for (ustring file : { bigtex, checkertex }) {
+        auto handle    = ts->get_texture_handle(file);
+        int mismatches = 0;
+        for (int i = 0; i < 200; ++i) {
+            float s    = 0.005f * i, t = 0.7f - 0.003f * i;
+            float dsdx = 0.02f + 0.0005f * i, dtdx = 0.001f;
+            float dsdy = 0.0f, dtdy = 0.002f;
+            float r0[4], r1[4], ds0[4], ds1[4], dt0[4], dt1[4];
+            ts->attribute("aniso_simd", 0);
+            ts->texture(handle, nullptr, opt, s, t, dsdx, dtdx, dsdy, dtdy, 4,
+                        r0, ds0, dt0);
+            ts->attribute("aniso_simd", 1);
+            ts->texture(handle, nullptr, opt, s, t, dsdx, dtdx, dsdy, dtdy, 4,
+                        r1, ds1, dt1);
+            for (int c = 0; c < 4; ++c)
+                if (std::abs(r0[c] - r1[c]) > 1.0e-4f
+                    || std::abs(ds0[c] - ds1[c]) > 1.0e-2f
+                    || std::abs(dt0[c] - dt1[c]) > 1.0e-2f)
+                    ++mismatches;
+        }
+        OIIO_CHECK_EQUAL(mismatches, 0);
+    }
+    TextureSystem::destroy(ts);
+}
+
+
+
+// Bilinear sampling within a tile is dispatched at runtime, which must
+// not change any results.
+static void
+test_texture_dispatch()
+{
+    Strutil::print("\nTesting dispatched bilinear texture sampling\n");
+    auto ts = TextureSystem::create(false);
+    TextureOpt opt;
+    opt.interpmode = TextureOpt::InterpBilinear;
+    // The float and half textures go through different texel conversions
+    for (ustring file : { bigtex, checkertex }) {
+        auto handle    = ts->get_texture_handle(file);
+        int mismatches = 0;
+        for (int i = 0; i < 200; ++i) {
+            float s = 0.005f * i, t = 0.9f - 0.004f * i;
+            float d = 0.0002f * (i % 20);
+            float r[2][4], ds[2][4], dt[2][4];
+            for (int level = 0; level < 2; ++level) {
+                OIIO::attribute("simd_dispatch", level ? "auto" : "generic");
+                ts->texture(handle, nullptr, opt, s, t, d, 0.0f, 0.0f, d, 4,
+                            r[level], ds[level], dt[level]);
+            }
+            if (memcmp(r[0], r[1], sizeof(r[0]))
+                || memcmp(ds[0], ds[1], sizeof(ds[0]))
+                || memcmp(dt[0], dt[1], sizeof(dt[0])))
+                ++mismatches;
+        }
+        OIIO_CHECK_EQUAL(mismatches, 0);
+    }
+    OIIO::attribute("simd_dispatch", "auto");
+    TextureSystem::destroy(ts);
+}
+
+
+
+// Interpolate channel c of a volume at P (which maps the volume to
+// [0,1]^3), trilinearly with trilerp like the original scalar lookup, or
+// with the cubic B-spline, summed independently of the texture system.
+static float
+volume_reference(const ImageBuf& vol, const float P[3], int c, bool cubic)
+{
+    const ImageSpec& spec(vol.spec());
+    const int res[3] = { spec.width, spec.height, spec.depth };
+    int base[3];
+    float frac[3];
+    for (int a = 0; a < 3; ++a) {
+        float x = P[a] * res[a] - 0.5f;
+        base[a] = int(floorf(x));
+        frac[a] = x - base[a];
+    }
+    auto texel = [&](int i, int j, int k) {
+        return vol.getchannel(base[0] + i, base[1] + j, base[2] + k, c);
+    };
+    if (!cubic)
+        return trilerp(texel(0, 0, 0), texel(1, 0, 0), texel(0, 1, 0),
+                       texel(1, 1, 0), texel(0, 0, 1), texel(1, 0, 1),
+                       texel(0, 1, 1), texel(1, 1, 1), frac[0], frac[1],
+                       frac[2]);
+    double w[3][4];
+    for (int a = 0; a < 3; ++a) {
+        double f = frac[a], g = 1.0 - f;
+        w[a][0]  = g * g * g / 6.0;
+        w[a][1]  = 2.0 / 3.0 - 0.5 * f * f * (2.0 - f);
+        w[a][2]  = 2.0 / 3.0 - 0.5 * g * g * (2.0 - g);
+        w[a][3]  = f * f * f / 6.0;
+    }
+    double sum = 0.0;
+    for (int k = 0; k < 4; ++k)
+        for (int j = 0; j < 4; ++j)
+            for (int i = 0; i < 4; ++i)
+                sum += w[0][i] * w[1][j] * w[2][k] * texel(i - 1, j - 1, k - 1);
+    return float(sum);
+}
+
+
+
+// Serves the tiles of an in-memory volume, since none of the formats we
+// can write hold volumes.
+static ImageBuf volume;
+
+class VolumeInput final : public ImageInput {
+public:
+    const char* format_name() const override { return "volume"; }
+    bool open(const std::string& /*name*/, ImageSpec& newspec) override
+    {
+        m_spec             = volume.spec();
+        m_spec.tile_width  = 16;
+        m_spec.tile_height = 16;
+        m_spec.tile_depth  = 16;
+        newspec            = m_spec;
+        return true;
+    }
+    bool close() override { return true; }
+    bool read_native_scanline(int /*subimage*/, int /*miplevel*/, int /*y*/,
+                              int /*z*/, void* /*data*/) override
+    {
+        return false;
+    }
+    bool read_native_tile(int /*subimage*/, int /*miplevel*/, int x, int y,
+                          int z, void* data) override
+    {
+        int nc = volume.nchannels();
+        return volume.get_pixels(ROI(x, x + 16, y, y + 16, z, z + 16, 0, nc),
+                                 span<float>((float*)data, 16 * 16 * 16 * nc));
+    }
+};
+
+static ImageInput*
+VolumeInputCreator()
+{
+    return new VolumeInput;
+}
+
+
+
+static void
+test_texture3d()
+{
+    Strutil::print("\nTesting volume lookups\n");
+    // A 32^3 volume in 16^3 tiles, so that footprints straddle tiles
+    ImageSpec spec(32, 32, 3, TypeFloat);
+    spec.depth = spec.full_depth = 32;
+    volume.reset(spec);
+    ImageBufAlgo::noise(volume, "uniform", 0.0f, 1.0f);
+    const ImageBuf& vol(volume);
+    ustring volname("volume");
+
+    // Points far enough inside that every footprint is whole
+    const int W = Tex::BatchWidth;
+    float P[3 * W], dPdx[3 * W], dPdy[3 * W], dPdz[3 * W];
+    for (int i = 0; i < W; ++i) {
+        P[i]         = (3.1f + 1.55f * i) / 32.0f;
+        P[i + W]     = (28.7f - 1.45f * i) / 32.0f;
+        P[i + 2 * W] = (5.3f + 1.21f * i) / 32.0f;
+        for (int a = 0; a < 3; ++a) {
+            dPdx[i + a * W] = a == 0 ? 0.01f : 0.0f;
+            dPdy[i + a * W] = a == 1 ? 0.01f : 0.0f;
+            dPdz[i + a * W] = a == 2 ? 0.01f : 0.0f;
+        }
+    }
+
+    auto ts = TextureSystem::create(false);
+    OIIO_CHECK_ASSERT(ts->imagecache()->add_file(volname, VolumeInputCreator));
+    auto handle = ts->get_texture_handle(volname);
+    float trilinear[3 * W];
+    for (int tricubic = 0; tricubic < 2; ++tricubic) {
+        ts->attribute("texture3d_bicubic", tricubic);
+        for (auto interp :
+             { Tex::InterpMode::Bilinear, Tex::InterpMode::Bicubic }) {
+            bool cubic = tricubic && interp == Tex::InterpMode::Bicubic;
+            TextureOptBatch bopt;
+            bopt.interpmode = decltype(bopt.interpmode)(interp);
+            TextureOpt opt;
+            opt.interpmode = interp;
+            float r[3 * W], ds[3 * W], dt[3 * W], dr[3 * W];
+            OIIO_CHECK_ASSERT(ts->texture3d(handle, nullptr, bopt,
+                                            Tex::RunMaskOn, P, dPdx, dPdy,
+                                            dPdz, 3, r, ds, dt, dr));
+            int mismatches = 0, wrong = 0;
+            for (int i = 0; i < W; ++i) {
+                // Batched lookups match single-point ones exactly
+                float r1[3], ds1[3], dt1[3], dr1[3];
+                Imath::V3f Pi(P[i], P[i + W], P[i + 2 * W]);
+                Imath::V3f dx(dPdx[i], dPdx[i + W], dPdx[i + 2 * W]);
+                Imath::V3f dy(dPdy[i], dPdy[i + W], dPdy[i + 2 * W]);
+                Imath::V3f dz(dPdz[i], dPdz[i + W], dPdz[i + 2 * W]);
+                ts->texture3d(handle, nullptr, opt, Pi, dx, dy, dz, 3, r1,
+                              ds1, dt1, dr1);
+                const float Pl[3] = { P[i], P[i + W], P[i + 2 * W] };
+                for (int c = 0; c < 3; ++c) {
+                    if (r[c * W + i] != r1[c] || ds[c * W + i] != ds1[c]
+                        || dt[c * W + i] != dt1[c] || dr[c * W + i] != dr1[c])
+                        ++mismatches;
+                    float ref = volume_reference(vol, Pl, c, cubic);
+                    if (std::abs(r1[c] - ref) > 1.0e-5f)
+                        ++wrong;
+                }
+            }
+            Strutil::print("  {}{}: {} batch mismatches, {} wrong\n",
+                           interp == Tex::InterpMode::Bicubic ? "bicubic"
+                                                              : "bilinear",
+                           tricubic ? " (texture3d_bicubic)" : "",
+                           mismatches, wrong);
+            OIIO_CHECK_EQUAL(mismatches, 0);
+            OIIO_CHECK_EQUAL(wrong, 0);
+            // Unless asked for, bicubic volume lookups stay trilinear
+            if (interp == Tex::InterpMode::Bilinear)
+                std::copy(r, r + 3 * W, trilinear);
+            else if (!tricubic)
+                OIIO_CHECK_ASSERT(std::equal(r, r + 3 * W, trilinear));
+        }
+    }
+    TextureSystem::destroy(ts);
+    volume.clear();
+}
+
+
+
+// Many threads looking up tiles while the cache is small enough that tiles
+// are constantly being evicted, so lookups race with removals.
+static void
+test_concurrent_lookups()
+{
+    Strutil::print("\nTesting concurrent tile lookups\n");
+    auto ic = ImageCache::create(false);
+    ic->attribute("max_memory_MB", 10.0f);
+    std::atomic<int> failures(0);
+    parallel_for(0, 16, [&](int64_t t) {
+        auto thread_info = ic->get_perthread_info();
+        auto handle      = ic->get_image_handle(bigtex, thread_info);
+        for (int i = 0; i < 2000; ++i) {
+            int x     = 64 * ((i * 7 + int(t) * 13) % 16);
+            int y     = 64 * ((i * 5 + int(t) * 3) % 16);
+            auto tile = ic->get_tile(handle, thread_info, 0, 0, x, y, 0);
+            TypeDesc format;
+            if (!tile
+                || ic->tile_roi(tile) != ROI(x, x + 64, y, y + 64, 0, 1, 0, 4)
+                || !ic->tile_pixels(tile, format))
+                ++failures;
+            ic->release_tile(tile);
+        }
+    });
+    OIIO_CHECK_EQUAL(failures, 0);
+    ImageCache::destroy(ic);
+}
+
+
+
 int
-main(int /*argc*/, char* /*argv*/[])
+main(int argc, char* argv[])
 {
+#ifndef _WIN32
+    if (argc == 4 && string_view(argv[1]) == "--shared-pool-owner")
+        shared_pool_owner(argv[2], ustring(argv[3]));
+#endif
     create_temp_textures();
 
     test_get_pixels_cachechannels(0, 10);
@@ -386,6 +1612,25 @@ main(int /*argc*/, char* /*argv*/[])
     test_custom_threadinfo();
     test_imagespec();
     test_get_cache_dimensions();
+    test_eviction_policies();
+    test_microcache();
+    test_prefetch();
+    test_diskcache();
+    test_shared_pool();
+    test_deduplicate_tiles();
+    test_compressed_tiles();
+    test_parallel_get_pixels();
+    test_get_pixels_bad_tile();
+    test_access_stats();
+    test_batched_reads();
+    test_preload_headers();
+    test_header_catalog();
+    test_udim_listings();
+    test_texture_batch();
+    test_aniso_simd();
+    test_texture_dispatch();
+    test_texture3d();
+    test_concurrent_lookups();
 
     auto ic = ImageCache::create();
     Strutil::print("\n\n{}\n", ic->getstats(5));
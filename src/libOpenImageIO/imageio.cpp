@@ -23,6 +23,7 @@
 
 #include "buildopts.h"
 #include "imageio_pvt.h"
+#include "simd_dispatch.h"
 
 OIIO_NAMESPACE_BEGIN
 
@@ -455,6 +456,9 @@ attribute(string_view name, TypeDesc type, const void* val)
         oiio_try_all_readers = *(const int*)val;
         return true;
     }
+    if (name == "simd_dispatch" && type == TypeString) {
+        return pvt::set_simd_dispatch(*(const char**)val);
+    }
 
     return false;
 }
@@ -649,6 +653,10 @@ getattribute(string_view name, TypeDesc type, void* val)
         *(ustring*)val = ustring(oiio_simd_caps());
         return true;
     }
+    if (name == "simd_dispatch" && type == TypeString) {
+        *(ustring*)val = ustring(pvt::simd_kernels().name);
+        return true;
+    }
     if (name == "build:compiler" && type == TypeString) {
         *(ustring*)val = ustring(oiio_build_compiler());
         return true;
@@ -832,14 +840,26 @@ pvt::contiguize(const void* src, int nchannels, stride_t xstride,
 const float*
 pvt::convert_to_float(const void* src, float* dst, int nvals, TypeDesc format)
 {
+    const SimdKernels& kernels(simd_kernels());
     switch (format.basetype) {
     case TypeDesc::FLOAT: return (float*)src;
     case TypeDesc::UINT8:
-        convert_type((const unsigned char*)src, dst, nvals);
+        if (kernels.u8_to_float)
+            kernels.u8_to_float((const uint8_t*)src, dst, nvals);
+        else
+            convert_type((const unsigned char*)src, dst, nvals);
+        break;
+    case TypeDesc::HALF:
+        if (kernels.half_to_float)
+            kernels.half_to_float((const uint16_t*)src, dst, nvals);
+        else
+            convert_type((const half*)src, dst, nvals);
         break;
-    case TypeDesc::HALF: convert_type((const half*)src, dst, nvals); break;
     case TypeDesc::UINT16:
-        convert_type((const unsigned short*)src, dst, nvals);
+        if (kernels.u16_to_float)
+            kernels.u16_to_float((const uint16_t*)src, dst, nvals);
+        else
+            convert_type((const unsigned short*)src, dst, nvals);
         break;
     case TypeDesc::INT8: convert_type((const char*)src, dst, nvals); break;
     case TypeDesc::INT16: convert_type((const short*)src, dst, nvals); break;
@@ -871,14 +891,30 @@ pvt::convert_from_float(const float* src, void* dst, size_t nvals,
         return dst;
     }
 
+    const SimdKernels& kernels(simd_kernels());
     // clang-format off
     switch (format.basetype) {
     case TypeDesc::FLOAT:
         // If it's already float, return the source itself
         return src;
-    case TypeDesc::HALF:   convert_type(src, (half*)    dst, nvals); break;
-    case TypeDesc::UINT8:  convert_type(src, (uint8_t*) dst, nvals); break;
-    case TypeDesc::UINT16: convert_type(src, (uint16_t*)dst, nvals); break;
+    case TypeDesc::HALF:
+        if (kernels.float_to_half)
+            kernels.float_to_half(src, (uint16_t*)dst, nvals);
+        else
+            convert_type(src, (half*)dst, nvals);
+        break;
+    case TypeDesc::UINT8:
+        if (kernels.float_to_u8)
+            kernels.float_to_u8(src, (uint8_t*)dst, nvals);
+        else
+            convert_type(src, (uint8_t*)dst, nvals);
+        break;
+    case TypeDesc::UINT16:
+        if (kernels.float_to_u16)
+            kernels.float_to_u16(src, (uint16_t*)dst, nvals);
+        else
+            convert_type(src, (uint16_t*)dst, nvals);
+        break;
     case TypeDesc::UINT:   convert_type(src, (uint32_t*)dst, nvals); break;
     case TypeDesc::INT8:   convert_type(src, (int8_t*)  dst, nvals); break;
     case TypeDesc::INT16:  convert_type(src, (int16_t*) dst, nvals); break;
@@ -942,9 +978,12 @@ convert_pixel_values(TypeDesc src_type, const void* src, TypeDesc dst_type,
 
     // Convert float to 'dst_type'
     switch (dst_type.basetype) {
-    case TypeDesc::UINT8: convert_type(buf, (unsigned char*)dst, n); break;
-    case TypeDesc::UINT16: convert_type(buf, (unsigned short*)dst, n); break;
-    case TypeDesc::HALF: convert_type(buf, (half*)dst, n); break;
+    case TypeDesc::UINT8:
+    case TypeDesc::UINT16:
+    case TypeDesc::HALF:
+        // The common formats may have wider runtime-dispatched versions
+        pvt::convert_from_float(buf, dst, n, dst_type);
+        break;
     case TypeDesc::INT8: convert_type(buf, (char*)dst, n); break;
     case TypeDesc::INT16: convert_type(buf, (short*)dst, n); break;
     case TypeDesc::INT: convert_type(buf, (int*)dst, n); break;
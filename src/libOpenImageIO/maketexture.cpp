@@ -1386,12 +1386,20 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
         "maketx:monochrome_detect");
     bool compute_average_color
         = configspec.get_int_attribute("maketx:compute_average", 1);
-    ImageBufAlgo::PixelStats pixel_stats;
+    // The constant color, opaque and monochrome tests all come from the
+    // same pass over the pixels as the statistics.
+    ImageBufAlgo::ImageAnalysis analysis;
     bool compute_stats = (constant_color_detect || opaque_detect
                           || compute_average_color || monochrome_detect);
     if (compute_stats) {
-        pixel_stats = ImageBufAlgo::computePixelStats(*src);
-    }
+        int flags = ImageBufAlgo::AnalyzeStats | ImageBufAlgo::AnalyzeConstant;
+        if (opaque_detect)
+            flags |= ImageBufAlgo::AnalyzeOpaque;
+        if (monochrome_detect)
+            flags |= ImageBufAlgo::AnalyzeMonochrome;
+        analysis = ImageBufAlgo::analyze(*src, flags);
+    }
+    ImageBufAlgo::PixelStats& pixel_stats(analysis.stats);
     double stat_pixelstatstime = alltime.lap();
     STATUS("pixelstats", stat_pixelstatstime);
 
@@ -1407,9 +1415,9 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
         && src->spec().full_width == src->spec().width
         && src->spec().full_height == src->spec().height
         && src->spec().full_depth == src->spec().depth) {
-        isConstantColor = (pixel_stats.min == pixel_stats.max);
+        isConstantColor = analysis.constant;
         if (isConstantColor)
-            constantColor = pixel_stats.min;
+            constantColor = analysis.constant_color;
         if (isConstantColor && constant_color_detect) {
             // Reset the image, to a new image, at the tile size
             ImageSpec newspec = src->spec();
@@ -1433,9 +1441,9 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
     int nchannels = configspec.get_int_attribute("maketx:nchannels", -1);
 
     // If requested -- and alpha is 1.0 everywhere -- drop it.
+    bool dropped_alpha = false;
     if (opaque_detect && src->spec().alpha_channel == src->nchannels() - 1
-        && nchannels <= 0 && pixel_stats.min[src->spec().alpha_channel] == 1.0f
-        && pixel_stats.max[src->spec().alpha_channel] == 1.0f) {
+        && nchannels <= 0 && analysis.opaque) {
         if (verbose)
             outstream
                 << "  Alpha==1 image detected. Dropping the alpha channel.\n";
@@ -1444,6 +1452,7 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
                                cspan<int>(), cspan<float>(),
                                cspan<std::string>(), true);
         std::swap(src, newsrc);  // N.B. the old src will delete
+        dropped_alpha = true;
     }
 
     // If requested - and we're a monochrome image - drop the extra channels.
@@ -1451,12 +1460,14 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
     // we also check the stat averages are the same for all three channels (if
     // the channel averages are not identical, they surely cannot be the same
     // for all pixels, so there is no point wasting the time of the call to
-    // isMonochrome().
+    // isMonochrome()). The analysis already tested the original channels,
+    // which only answers the question if we didn't just drop alpha.
     if (monochrome_detect && nchannels <= 0 && src->nchannels() == 3
         && src->spec().alpha_channel < 0
         && pixel_stats.avg[0] == pixel_stats.avg[1]
         && pixel_stats.avg[0] == pixel_stats.avg[2]
-        && ImageBufAlgo::isMonochrome(*src)) {
+        && (dropped_alpha ? ImageBufAlgo::isMonochrome(*src)
+                          : analysis.monochrome)) {
         if (verbose)
             OIIO::print(
                 outstream,
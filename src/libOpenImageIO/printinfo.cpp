@@ -324,7 +324,16 @@ bool
 print_stats(std::ostream& out, string_view indent, const ImageBuf& input,
             const ImageSpec& spec, ROI roi, std::string& err)
 {
-    PixelStats stats = computePixelStats(input, roi);
+    // For flat images, the constant and monochrome tests come from the
+    // same pass over the pixels as the statistics.
+    ImageAnalysis analysis;
+    if (input.deep())
+        analysis.stats = computePixelStats(input, roi);
+    else
+        analysis = analyze(input,
+                           AnalyzeStats | AnalyzeConstant | AnalyzeMonochrome,
+                           roi);
+    const PixelStats& stats(analysis.stats);
     if (!stats.min.size()) {
         err = input.geterror();
         if (err.empty())
@@ -342,20 +351,17 @@ print_stats(std::ostream& out, string_view indent, const ImageBuf& input,
     if (input.deep()) {
         print_deep_stats(out, indent, input, spec);
     } else {
-        std::vector<float> constantValues(input.spec().nchannels);
-        if (isConstantColor(input, 0.0f, constantValues)) {
+        if (analysis.constant) {
             OIIO::print(out, "{}Constant: Yes\n", indent);
             OIIO::print(out, "{}Constant Color: ", indent);
-            for (unsigned int i = 0; i < constantValues.size(); ++i) {
-                OIIO::print(out, "{} ",
-                            stats_num(constantValues[i], maxval, false));
-            }
+            for (float v : analysis.constant_color)
+                OIIO::print(out, "{} ", stats_num(v, maxval, false));
             OIIO::print(out, "{}\n", stats_footer(maxval));
         } else {
             OIIO::print(out, "{}Constant: No\n", indent);
         }
 
-        if (isMonochrome(input)) {
+        if (analysis.monochrome) {
             OIIO::print(out, "{}Monochrome: Yes\n", indent);
         } else {
             OIIO::print(out, "{}Monochrome: No\n", indent);
@@ -0,0 +1,175 @@
+// Copyright Contributors to the OpenImageIO project.
+// SPDX-License-Identifier: Apache-2.0
+// https://github.com/AcademySoftwareFoundation/OpenImageIO
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/platform.h>
+#include <OpenImageIO/simd.h>
+
+#include "simd_dispatch.h"
+
+
+OIIO_NAMESPACE_BEGIN
+namespace pvt {
+
+namespace {
+
+// Baseline: every entry null, callers use their compile-time SIMD paths.
+const SimdKernels simd_kernels_generic = { "generic" };
+
+enum DispatchLevel { Level_Generic = 0, Level_AVX2 = 1, Level_AVX512 = 2 };
+
+std::atomic<int> requested_level(Level_AVX512);
+std::atomic<const SimdKernels*> active_kernels(nullptr);
+
+
+
+// The CPU reporting AVX isn't enough, the OS must also save the wide
+// registers on context switches. Check XCR0 for the YMM (and for AVX-512,
+// the opmask and ZMM) state bits.
+uint64_t
+xcr0()
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) \
+    || defined(_M_AMD64) || defined(_M_IX86)
+    int info[4];
+    cpuid(info, 1, 0);
+    if (!(info[2] & (1 << 27)))  // OSXSAVE
+        return 0;
+#    ifdef _MSC_VER
+    return _xgetbv(0);
+#    else
+    uint32_t eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (uint64_t(edx) << 32) | eax;
+#    endif
+#else
+    return 0;
+#endif
+}
+
+
+
+int
+hw_level()
+{
+    uint64_t xcr = xcr0();
+    bool os_ymm  = (xcr & 0x6) == 0x6;
+    bool os_zmm  = (xcr & 0xe6) == 0xe6;
+    if (os_zmm && cpu_has_avx512f() && cpu_has_avx512bw() && cpu_has_avx512vl()
+        && cpu_has_f16c())
+        return Level_AVX512;
+    if (os_ymm && cpu_has_avx2() && cpu_has_f16c())
+        return Level_AVX2;
+    return Level_Generic;
+}
+
+
+
+// The dispatched float-to-integer conversions round halfway cases away
+// from zero, like the SSE2 (and scalar) code in convert_type. A build
+// that requires SSE4.1 at compile time rounds them to even instead, so
+// there we leave those two conversions to convert_type.
+SimdKernels
+matching_baseline(const SimdKernels& k)
+{
+    SimdKernels m(k);
+#if OIIO_SIMD_SSE >= 4
+    m.float_to_u8  = nullptr;
+    m.float_to_u16 = nullptr;
+#endif
+    return m;
+}
+
+
+
+const SimdKernels*
+select_kernels(int maxlevel)
+{
+    static const int hw = hw_level();
+    int level           = std::min(hw, maxlevel);
+#if defined(OIIO_SIMD_DISPATCH_AVX512) && OIIO_SIMD_DISPATCH_X86
+    static const SimdKernels avx512 = matching_baseline(simd_kernels_avx512);
+    if (level >= Level_AVX512)
+        return &avx512;
+#endif
+#if defined(OIIO_SIMD_DISPATCH_AVX2) && OIIO_SIMD_DISPATCH_X86
+    static const SimdKernels avx2 = matching_baseline(simd_kernels_avx2);
+    if (level >= Level_AVX2)
+        return &avx2;
+#endif
+    return &simd_kernels_generic;
+}
+
+}  // namespace
+
+
+
+const SimdKernels&
+simd_kernels()
+{
+    const SimdKernels* k = active_kernels.load(std::memory_order_acquire);
+    if (!k) {
+        k = select_kernels(requested_level);
+        active_kernels.store(k, std::memory_order_release);
+    }
+    return *k;
+}
+
+
+
+bool
+set_simd_dispatch(const char* level)
+{
+    int l;
+    if (!level || !level[0] || !strcmp(level, "auto")
+        || !strcmp(level, "avx512"))
+        l = Level_AVX512;
+    else if (!strcmp(level, "avx2"))
+        l = Level_AVX2;
+    else if (!strcmp(level, "generic") || !strcmp(level, "none"))
+        l = Level_Generic;
+    else
+        return false;
+    requested_level = l;
+    active_kernels.store(select_kernels(l), std::memory_order_release);
+    return true;
+}
+
+
+
+static bool
+packed_float(const ImageBuf& B, const ROI& roi)
+{
+    return B.localpixels() && B.spec().format == TypeFloat
+           && B.contains_roi(roi) && roi.chbegin == 0
+           && roi.chend == B.nchannels()
+           && B.pixel_stride() == stride_t(B.nchannels() * sizeof(float));
+}
+
+
+
+bool
+simd_float_rows(ImageBuf& R, const ImageBuf& A, const ImageBuf& B,
+                const ROI& roi,
+                void (*kernel)(const float* a, const float* b, float* r,
+                               size_t n))
+{
+    if (!kernel || !packed_float(R, roi) || !packed_float(A, roi)
+        || !packed_float(B, roi))
+        return false;
+    size_t n = size_t(roi.width()) * size_t(roi.nchannels());
+    for (int z = roi.zbegin; z < roi.zend; ++z)
+        for (int y = roi.ybegin; y < roi.yend; ++y)
+            kernel((const float*)A.pixeladdr(roi.xbegin, y, z),
+                   (const float*)B.pixeladdr(roi.xbegin, y, z),
+                   (float*)R.pixeladdr(roi.xbegin, y, z), n);
+    return true;
+}
+
+}  // namespace pvt
+OIIO_NAMESPACE_END
@@ -0,0 +1,140 @@
+// Copyright Contributors to the OpenImageIO project.
+// SPDX-License-Identifier: Apache-2.0
+// https://github.com/AcademySoftwareFoundation/OpenImageIO
+
+/// \file
+/// Runtime CPU dispatch for a handful of hot pixel kernels.
+///
+/// simd.h picks its vector width when OIIO is compiled, so a build for a
+/// baseline x86-64 never uses AVX2 or AVX-512 even on hardware that has
+/// them. The kernels below are compiled a second (and third) time in
+/// their own translation units with wider instruction sets enabled, and
+/// simd_kernels() hands out the best table the running CPU supports.
+///
+/// Rules for the kernel translation units:
+///  - Include only this header and the compiler intrinsics headers. Any
+///    inline function pulled in from elsewhere (including simd.h) would be
+///    compiled with the wider instruction set, and the linker is free to
+///    keep that copy for the whole library.
+///  - Results must be bit-for-bit identical to the code path the caller
+///    takes when the entry is null, so the dispatch level never changes
+///    an image. (That's why the variants are built with
+///    -ffp-contract=off and don't use FMA.)
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <OpenImageIO/oiioversion.h>
+
+// The wider kernels are x86 code. A macOS universal build compiles their
+// sources for arm64 as well, and there they must compile to nothing.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) \
+    || defined(_M_AMD64) || defined(_M_IX86)
+#    define OIIO_SIMD_DISPATCH_X86 1
+#else
+#    define OIIO_SIMD_DISPATCH_X86 0
+#endif
+
+
+OIIO_NAMESPACE_BEGIN
+
+class ImageBuf;
+struct ROI;
+
+namespace pvt {
+
+/// A table of kernels for one instruction set level. A null entry means
+/// "no faster version at this level": the caller keeps using its own
+/// (compile-time SIMD) code.
+struct SimdKernels {
+    const char* name;
+
+    // Format conversions of n contiguous values, with the same scaling,
+    // clamping and rounding as convert_type(). Half values are passed as
+    // their 16 bit patterns.
+    void (*u8_to_float)(const uint8_t* src, float* dst, size_t n);
+    void (*u16_to_float)(const uint16_t* src, float* dst, size_t n);
+    void (*half_to_float)(const uint16_t* src, float* dst, size_t n);
+    void (*float_to_u8)(const float* src, uint8_t* dst, size_t n);
+    void (*float_to_u16)(const float* src, uint16_t* dst, size_t n);
+    void (*float_to_half)(const float* src, uint16_t* dst, size_t n);
+
+    // Pixel math on n contiguous floats: r = a+b, a-b, a*b, a*b+c.
+    void (*add)(const float* a, const float* b, float* r, size_t n);
+    void (*sub)(const float* a, const float* b, float* r, size_t n);
+    void (*mul)(const float* a, const float* b, float* r, size_t n);
+    void (*mad)(const float* a, const float* b, const float* c, float* r,
+                size_t n);
+
+    // Color on n packed RGBA float pixels, in place. unpremult saves each
+    // pixel's alpha to alpha[] and divides RGB by it (if it's at least
+    // FLT_MIN); premult multiplies back by the saved alpha. matrix_rgba
+    // transforms each pixel as a row vector by the row-major 4x4 matrix M.
+    void (*unpremult_rgba)(float* rgba, float* alpha, size_t n);
+    void (*premult_rgba)(float* rgba, const float* alpha, size_t n);
+    void (*matrix_rgba)(float* rgba, size_t n, const float* M);
+
+    // The two passes of a separable resize. axpy is y[i] += a * x[i] for n
+    // floats. filter_row resamples a row of pixels of nchannels (3 or 4)
+    // floats that starts at x = rowx, with one float of padding after its
+    // last pixel: output pixel i is the sum, over t < count[i], of
+    // weight[wstart[i] + t] times the pixel at x = first[i] + t, with the
+    // taps summed in order.
+    void (*axpy)(float a, const float* x, float* y, size_t n);
+    void (*filter_row)(const float* row, int rowx, int nchannels,
+                       const int* first, const int* count, const int* wstart,
+                       const float* weight, float* out, size_t n);
+
+    // Bilinear texture sampling of one 2x2 block of texels in a tile: the
+    // upper left texel is at p, the one to its right pixelstride bytes
+    // later and the row below rowstride bytes later. Four channels of
+    // texeltype are read from each texel and converted like the texture
+    // system does (integers scaled to 0-1). accum[0..3] += weight *
+    // bilerp(texels, sfrac, tfrac), and if dds is not null, dds and ddt
+    // get the weighted s and t derivatives, scaled by width and height.
+    void (*bilerp_texels)(const unsigned char* p, ptrdiff_t pixelstride,
+                          ptrdiff_t rowstride, int texeltype, float sfrac,
+                          float tfrac, float weight, float width,
+                          float height, float* accum, float* dds,
+                          float* ddt);
+};
+
+/// Texel types for SimdKernels::bilerp_texels.
+enum SimdTexelType {
+    SimdTexel_UInt8,
+    SimdTexel_UInt16,
+    SimdTexel_Half,
+    SimdTexel_Float
+};
+
+/// The kernel table for the best level supported by this CPU (and not
+/// above the level requested with the "simd_dispatch" attribute).
+const SimdKernels&
+simd_kernels();
+
+/// Restrict dispatch to at most the named level ("generic", "avx2",
+/// "avx512"); an empty string or "auto" selects the best one available.
+/// Return false if the name is not recognized.
+bool
+set_simd_dispatch(const char* level);
+
+/// If R, A and B are all in-memory float images containing roi, with
+/// packed pixels and roi covering all of their channels, run kernel (one of
+/// the add/sub/mul entries) on each scanline of roi and return true.
+/// Otherwise do nothing and return false.
+bool
+simd_float_rows(ImageBuf& R, const ImageBuf& A, const ImageBuf& B,
+                const ROI& roi,
+                void (*kernel)(const float* a, const float* b, float* r,
+                               size_t n));
+
+// Tables compiled in their own translation units (only present when the
+// build enables them, see OIIO_SIMD_DISPATCH_AVX2/AVX512, and only for
+// x86).
+extern const SimdKernels simd_kernels_avx2;
+extern const SimdKernels simd_kernels_avx512;
+
+}  // namespace pvt
+OIIO_NAMESPACE_END
@@ -0,0 +1,476 @@
+// Copyright Contributors to the OpenImageIO project.
+// SPDX-License-Identifier: Apache-2.0
+// https://github.com/AcademySoftwareFoundation/OpenImageIO
+
+/// \file
+/// AVX2 + F16C versions of the kernels in simd_dispatch.h. This file is
+/// compiled with those instruction sets enabled regardless of the build's
+/// baseline, so read the rules at the top of simd_dispatch.h before
+/// including anything else here.
+
+#include "simd_dispatch.h"
+
+#if OIIO_SIMD_DISPATCH_X86
+
+#    include <immintrin.h>
+
+
+OIIO_NAMESPACE_BEGIN
+namespace pvt {
+
+namespace {
+
+// Finish a float -> uint conversion the way convert_type does past its
+// 4-wide loop: groups of 4 round half away from zero after scaling, the
+// last n%4 values go through scaled_conversion (add 0.5, clamp,
+// truncate).
+template<typename D>
+inline void
+float_to_uint_tail(const float* src, D* dst, size_t n, float max)
+{
+    for (; n >= 4; n -= 4)
+        for (int j = 0; j < 4; ++j, ++src, ++dst) {
+            float t = *src * max;
+            t       = t >= 0.0f ? (t <= max ? t : max) : 0.0f;
+            int r   = int(t);
+            *dst    = D(r + (t - float(r) >= 0.5f));
+        }
+    for (; n; --n, ++src, ++dst) {
+        float t = *src * max + 0.5f;
+        *dst    = D(t >= 0.0f ? (t <= max ? t : max) : 0.0f);
+    }
+}
+
+
+
+// Scale by max, clamp to [0,max] and round half away from zero.
+inline __m256i
+scale_clamp_round(__m256 v, __m256 max)
+{
+    __m256 t  = _mm256_max_ps(_mm256_mul_ps(v, max), _mm256_setzero_ps());
+    t         = _mm256_min_ps(t, max);
+    __m256i r = _mm256_cvttps_epi32(t);
+    __m256 fr = _mm256_sub_ps(t, _mm256_cvtepi32_ps(r));
+    __m256 up = _mm256_cmp_ps(fr, _mm256_set1_ps(0.5f), _CMP_GE_OQ);
+    return _mm256_sub_epi32(r, _mm256_castps_si256(up));  // up is -1
+}
+
+
+
+void
+u8_to_float(const uint8_t* src, float* dst, size_t n)
+{
+    const float scale = 1.0f / 255.0f;
+    const __m256 s    = _mm256_set1_ps(scale);
+    size_t i          = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i b = _mm_loadl_epi64((const __m128i*)(src + i));
+        __m256 f  = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(b));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(f, s));
+    }
+    for (; i < n; ++i)
+        dst[i] = src[i] * scale;
+}
+
+
+
+void
+u16_to_float(const uint16_t* src, float* dst, size_t n)
+{
+    const float scale = 1.0f / 65535.0f;
+    const __m256 s    = _mm256_set1_ps(scale);
+    size_t i          = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+        __m256 f  = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(b));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(f, s));
+    }
+    for (; i < n; ++i)
+        dst[i] = src[i] * scale;
+}
+
+
+
+void
+half_to_float(const uint16_t* src, float* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(
+                                      (const __m128i*)(src + i))));
+    if (i < n) {
+        alignas(32) uint16_t h[8] = {};
+        alignas(32) float f[8];
+        for (size_t j = i; j < n; ++j)
+            h[j - i] = src[j];
+        _mm256_store_ps(f, _mm256_cvtph_ps(_mm_load_si128((const __m128i*)h)));
+        for (size_t j = i; j < n; ++j)
+            dst[j] = f[j - i];
+    }
+}
+
+
+
+void
+float_to_half(const float* src, uint16_t* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm_storeu_si128((__m128i*)(dst + i),
+                         _mm256_cvtps_ph(_mm256_loadu_ps(src + i),
+                                         _MM_FROUND_TO_NEAREST_INT));
+    if (i < n) {
+        alignas(32) float f[8] = {};
+        alignas(32) uint16_t h[8];
+        for (size_t j = i; j < n; ++j)
+            f[j - i] = src[j];
+        __m128i ph = _mm256_cvtps_ph(_mm256_load_ps(f),
+                                     _MM_FROUND_TO_NEAREST_INT);
+        _mm_store_si128((__m128i*)h, ph);
+        for (size_t j = i; j < n; ++j)
+            dst[j] = h[j - i];
+    }
+}
+
+
+
+void
+float_to_u8(const float* src, uint8_t* dst, size_t n)
+{
+    const __m256 max = _mm256_set1_ps(255.0f);
+    size_t i         = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i r   = scale_clamp_round(_mm256_loadu_ps(src + i), max);
+        __m128i p16 = _mm_packus_epi32(_mm256_castsi256_si128(r),
+                                       _mm256_extracti128_si256(r, 1));
+        _mm_storel_epi64((__m128i*)(dst + i), _mm_packus_epi16(p16, p16));
+    }
+    float_to_uint_tail(src + i, dst + i, n - i, 255.0f);
+}
+
+
+
+void
+float_to_u16(const float* src, uint16_t* dst, size_t n)
+{
+    const __m256 max = _mm256_set1_ps(65535.0f);
+    size_t i         = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i r = scale_clamp_round(_mm256_loadu_ps(src + i), max);
+        _mm_storeu_si128((__m128i*)(dst + i),
+                         _mm_packus_epi32(_mm256_castsi256_si128(r),
+                                          _mm256_extracti128_si256(r, 1)));
+    }
+    float_to_uint_tail(src + i, dst + i, n - i, 65535.0f);
+}
+
+
+
+void
+add(const float* a, const float* b, float* r, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(r + i, _mm256_add_ps(_mm256_loadu_ps(a + i),
+                                              _mm256_loadu_ps(b + i)));
+    for (; i < n; ++i)
+        r[i] = a[i] + b[i];
+}
+
+
+
+void
+sub(const float* a, const float* b, float* r, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(r + i, _mm256_sub_ps(_mm256_loadu_ps(a + i),
+                                              _mm256_loadu_ps(b + i)));
+    for (; i < n; ++i)
+        r[i] = a[i] - b[i];
+}
+
+
+
+void
+mul(const float* a, const float* b, float* r, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(r + i, _mm256_mul_ps(_mm256_loadu_ps(a + i),
+                                              _mm256_loadu_ps(b + i)));
+    for (; i < n; ++i)
+        r[i] = a[i] * b[i];
+}
+
+
+
+void
+mad(const float* a, const float* b, const float* c, float* r, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 ab = _mm256_mul_ps(_mm256_loadu_ps(a + i),
+                                  _mm256_loadu_ps(b + i));
+        _mm256_storeu_ps(r + i, _mm256_add_ps(ab, _mm256_loadu_ps(c + i)));
+    }
+    for (; i < n; ++i)
+        r[i] = a[i] * b[i] + c[i];
+}
+
+
+
+// Alpha of each pixel in all four lanes, replaced by 1 if below FLT_MIN
+// (or NaN), then 1 put back in the alpha lanes: (a,a,a,1).
+inline __m256
+rgb_alpha_scale(__m256 a)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 ok = _mm256_cmp_ps(a, _mm256_set1_ps(1.17549435e-38f), _CMP_GE_OQ);
+    return _mm256_blend_ps(_mm256_blendv_ps(one, a, ok), one, 0x88);
+}
+
+
+
+void
+unpremult_rgba(float* rgba, float* alpha, size_t n)
+{
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        float* p     = rgba + 4 * i;
+        alpha[i]     = p[3];
+        alpha[i + 1] = p[7];
+        __m256 v     = _mm256_loadu_ps(p);
+        __m256 a     = rgb_alpha_scale(_mm256_permute_ps(v, 0xff));
+        _mm256_storeu_ps(p, _mm256_div_ps(v, a));
+    }
+    for (; i < n; ++i) {
+        float* p = rgba + 4 * i;
+        float a  = p[3];
+        alpha[i] = a;
+        a        = a >= 1.17549435e-38f ? a : 1.0f;
+        p[0] /= a;
+        p[1] /= a;
+        p[2] /= a;
+    }
+}
+
+
+
+void
+premult_rgba(float* rgba, const float* alpha, size_t n)
+{
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        float* p = rgba + 4 * i;
+        __m256 a = _mm256_set_m128(_mm_set1_ps(alpha[i + 1]),
+                                   _mm_set1_ps(alpha[i]));
+        _mm256_storeu_ps(p, _mm256_mul_ps(_mm256_loadu_ps(p),
+                                          rgb_alpha_scale(a)));
+    }
+    for (; i < n; ++i) {
+        float* p = rgba + 4 * i;
+        float a  = alpha[i] >= 1.17549435e-38f ? alpha[i] : 1.0f;
+        p[0] *= a;
+        p[1] *= a;
+        p[2] *= a;
+    }
+}
+
+
+
+void
+matrix_rgba(float* rgba, size_t n, const float* M)
+{
+    // Same operation order as vfloat4 * matrix44, two pixels at a time.
+    const __m256 m0 = _mm256_broadcast_ps((const __m128*)(M + 0));
+    const __m256 m1 = _mm256_broadcast_ps((const __m128*)(M + 4));
+    const __m256 m2 = _mm256_broadcast_ps((const __m128*)(M + 8));
+    const __m256 m3 = _mm256_broadcast_ps((const __m128*)(M + 12));
+    size_t i        = 0;
+    for (; i + 2 <= n; i += 2) {
+        float* p = rgba + 4 * i;
+        __m256 v = _mm256_loadu_ps(p);
+        __m256 r = _mm256_mul_ps(_mm256_permute_ps(v, 0x00), m0);
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(v, 0x55), m1));
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(v, 0xaa), m2));
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(v, 0xff), m3));
+        _mm256_storeu_ps(p, r);
+    }
+    if (i < n) {
+        float* p = rgba + 4 * i;
+        __m128 v = _mm_loadu_ps(p);
+        __m128 r = _mm_mul_ps(_mm_permute_ps(v, 0x00),
+                              _mm256_castps256_ps128(m0));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_permute_ps(v, 0x55),
+                                     _mm256_castps256_ps128(m1)));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_permute_ps(v, 0xaa),
+                                     _mm256_castps256_ps128(m2)));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_permute_ps(v, 0xff),
+                                     _mm256_castps256_ps128(m3)));
+        _mm_storeu_ps(p, r);
+    }
+}
+
+
+
+void
+axpy(float a, const float* x, float* y, size_t n)
+{
+    const __m256 av = _mm256_set1_ps(a);
+    size_t i        = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(y + i,
+                         _mm256_add_ps(_mm256_loadu_ps(y + i),
+                                       _mm256_mul_ps(av,
+                                                     _mm256_loadu_ps(x + i))));
+    for (; i < n; ++i)
+        y[i] += a * x[i];
+}
+
+
+
+// Continue summing the taps t0..n-1 of one pixel into acc.
+inline __m128
+pixel_taps(__m128 acc, const float* p, int nchannels, const float* w, int t0,
+           int n)
+{
+    for (int t = t0; t < n; ++t, p += nchannels)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[t]), _mm_loadu_ps(p)));
+    return acc;
+}
+
+
+
+void
+filter_row(const float* row, int rowx, int nchannels, const int* first,
+           const int* count, const int* wstart, const float* weight,
+           float* out, size_t n)
+{
+    // Two output pixels at a time, one in each half. Each pixel sums its
+    // own taps in order, so the results match the 4-wide loop.
+    const __m128i mask = _mm_cmpgt_epi32(_mm_set1_epi32(nchannels),
+                                         _mm_setr_epi32(0, 1, 2, 3));
+    size_t i           = 0;
+    for (; i + 2 <= n; i += 2, out += 2 * nchannels) {
+        const float* p0 = row + size_t(first[i] - rowx) * nchannels;
+        const float* p1 = row + size_t(first[i + 1] - rowx) * nchannels;
+        const float* w0 = weight + wstart[i];
+        const float* w1 = weight + wstart[i + 1];
+        int both        = count[i] < count[i + 1] ? count[i] : count[i + 1];
+        __m256 acc      = _mm256_setzero_ps();
+        for (int t = 0; t < both; ++t, p0 += nchannels, p1 += nchannels) {
+            __m256 w = _mm256_set_m128(_mm_set1_ps(w1[t]), _mm_set1_ps(w0[t]));
+            __m256 p = _mm256_set_m128(_mm_loadu_ps(p1), _mm_loadu_ps(p0));
+            acc      = _mm256_add_ps(acc, _mm256_mul_ps(w, p));
+        }
+        __m128 a0 = pixel_taps(_mm256_castps256_ps128(acc), p0, nchannels,
+                               w0, both, count[i]);
+        __m128 a1 = pixel_taps(_mm256_extractf128_ps(acc, 1), p1, nchannels,
+                               w1, both, count[i + 1]);
+        _mm_maskstore_ps(out, mask, a0);
+        _mm_maskstore_ps(out + nchannels, mask, a1);
+    }
+    if (i < n) {
+        const float* p = row + size_t(first[i] - rowx) * nchannels;
+        _mm_maskstore_ps(out, mask,
+                         pixel_taps(_mm_setzero_ps(), p, nchannels,
+                                    weight + wstart[i], 0, count[i]));
+    }
+}
+
+
+
+// Two texels of texeltype (four channels each), at p0 and p1, converted to
+// float in the low and high halves.
+inline __m256
+load_texel_pair(const unsigned char* p0, const unsigned char* p1,
+                int texeltype)
+{
+    if (texeltype == SimdTexel_Float)
+        return _mm256_set_m128(_mm_loadu_ps((const float*)p1),
+                               _mm_loadu_ps((const float*)p0));
+    if (texeltype == SimdTexel_UInt8) {
+        __m128i b = _mm_unpacklo_epi32(
+            _mm_castps_si128(_mm_load_ss((const float*)p0)),
+            _mm_castps_si128(_mm_load_ss((const float*)p1)));
+        __m256 f  = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(b));
+        return _mm256_mul_ps(f, _mm256_set1_ps(1.0f / 255.0f));
+    }
+    __m128i h = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)p0),
+                                   _mm_loadl_epi64((const __m128i*)p1));
+    if (texeltype == SimdTexel_Half)
+        return _mm256_cvtph_ps(h);
+    __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(h));
+    return _mm256_mul_ps(f, _mm256_set1_ps(1.0f / 65535.0f));
+}
+
+
+
+void
+bilerp_texels(const unsigned char* p, ptrdiff_t pixelstride,
+              ptrdiff_t rowstride, int texeltype, float sfrac, float tfrac,
+              float weight, float width, float height, float* accum,
+              float* dds, float* ddt)
+{
+    // Both rows at once: the left texels of the two rows in one vector and
+    // the right ones in another, with the same operation order as bilerp()
+    // and lerp() on vfloat4.
+    __m256 left  = load_texel_pair(p, p + rowstride, texeltype);
+    __m256 right = load_texel_pair(p + pixelstride, p + rowstride + pixelstride,
+                                   texeltype);
+    __m256 rows  = _mm256_add_ps(_mm256_mul_ps(left,
+                                              _mm256_set1_ps(1.0f - sfrac)),
+                                _mm256_mul_ps(right, _mm256_set1_ps(sfrac)));
+    __m128 t1    = _mm_set1_ps(1.0f - tfrac), t = _mm_set1_ps(tfrac);
+    __m128 r     = _mm_add_ps(_mm_mul_ps(t1, _mm256_castps256_ps128(rows)),
+                              _mm_mul_ps(t, _mm256_extractf128_ps(rows, 1)));
+    __m128 w     = _mm_set1_ps(weight);
+    _mm_storeu_ps(accum, _mm_add_ps(_mm_loadu_ps(accum), _mm_mul_ps(w, r)));
+    if (dds) {
+        // ds: right minus left of each row, lerped by t. dt: bottom minus
+        // top of each column, lerped by s.
+        __m256 d  = _mm256_sub_ps(right, left);
+        __m128 ds = _mm_add_ps(_mm_mul_ps(_mm256_castps256_ps128(d), t1),
+                               _mm_mul_ps(_mm256_extractf128_ps(d, 1), t));
+        __m128 dl = _mm_sub_ps(_mm256_extractf128_ps(left, 1),
+                               _mm256_castps256_ps128(left));
+        __m128 dr = _mm_sub_ps(_mm256_extractf128_ps(right, 1),
+                               _mm256_castps256_ps128(right));
+        __m128 dt = _mm_add_ps(_mm_mul_ps(dl, _mm_set1_ps(1.0f - sfrac)),
+                               _mm_mul_ps(dr, _mm_set1_ps(sfrac)));
+        __m128 sx = _mm_mul_ps(w, _mm_set1_ps(width));
+        __m128 sy = _mm_mul_ps(w, _mm_set1_ps(height));
+        _mm_storeu_ps(dds, _mm_add_ps(_mm_loadu_ps(dds), _mm_mul_ps(sx, ds)));
+        _mm_storeu_ps(ddt, _mm_add_ps(_mm_loadu_ps(ddt), _mm_mul_ps(sy, dt)));
+    }
+}
+
+}  // namespace
+
+
+
+const SimdKernels simd_kernels_avx2 = {
+    "avx2",
+    u8_to_float,
+    u16_to_float,
+    half_to_float,
+    float_to_u8,
+    float_to_u16,
+    float_to_half,
+    add,
+    sub,
+    mul,
+    mad,
+    unpremult_rgba,
+    premult_rgba,
+    matrix_rgba,
+    axpy,
+    filter_row,
+    bilerp_texels,
+};
+
+}  // namespace pvt
+OIIO_NAMESPACE_END
+
+#endif  // OIIO_SIMD_DISPATCH_X86
@@ -0,0 +1,490 @@
+// Copyright Contributors to the OpenImageIO project.
+// SPDX-License-Identifier: Apache-2.0
+// https://github.com/AcademySoftwareFoundation/OpenImageIO
+
+/// \file
+/// AVX-512 (F, BW, VL) versions of the kernels in simd_dispatch.h. This
+/// file is compiled with those instruction sets enabled regardless of the
+/// build's baseline, so read the rules at the top of simd_dispatch.h
+/// before including anything else here.
+
+#include "simd_dispatch.h"
+
+#if OIIO_SIMD_DISPATCH_X86
+
+#    include <immintrin.h>
+
+// GCC 12's AVX-512 intrinsics headers trip -Wmaybe-uninitialized on their
+// own _mm512_undefined_*() placeholders (GCC bug 105593).
+#if defined(__GNUC__) && !defined(__clang__)
+#    pragma GCC diagnostic ignored "-Wuninitialized"
+#    pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+
+OIIO_NAMESPACE_BEGIN
+namespace pvt {
+
+namespace {
+
+// Mask of the first n (< 16) lanes.
+inline __mmask16
+first_lanes(size_t n)
+{
+    return __mmask16((1u << n) - 1);
+}
+
+
+
+// Finish a float -> uint conversion the way convert_type does past its
+// 4-wide loop: groups of 4 round half away from zero after scaling, the
+// last n%4 values go through scaled_conversion (add 0.5, clamp,
+// truncate).
+template<typename D>
+inline void
+float_to_uint_tail(const float* src, D* dst, size_t n, float max)
+{
+    for (; n >= 4; n -= 4)
+        for (int j = 0; j < 4; ++j, ++src, ++dst) {
+            float t = *src * max;
+            t       = t >= 0.0f ? (t <= max ? t : max) : 0.0f;
+            int r   = int(t);
+            *dst    = D(r + (t - float(r) >= 0.5f));
+        }
+    for (; n; --n, ++src, ++dst) {
+        float t = *src * max + 0.5f;
+        *dst    = D(t >= 0.0f ? (t <= max ? t : max) : 0.0f);
+    }
+}
+
+
+
+// Scale by max, clamp to [0,max] and round half away from zero.
+inline __m512i
+scale_clamp_round(__m512 v, __m512 max)
+{
+    __m512 t     = _mm512_max_ps(_mm512_mul_ps(v, max), _mm512_setzero_ps());
+    t            = _mm512_min_ps(t, max);
+    __m512i r    = _mm512_cvttps_epi32(t);
+    __m512 fr    = _mm512_sub_ps(t, _mm512_cvtepi32_ps(r));
+    __mmask16 up = _mm512_cmp_ps_mask(fr, _mm512_set1_ps(0.5f), _CMP_GE_OQ);
+    return _mm512_mask_add_epi32(r, up, r, _mm512_set1_epi32(1));
+}
+
+
+
+void
+u8_to_float(const uint8_t* src, float* dst, size_t n)
+{
+    const float scale = 1.0f / 255.0f;
+    const __m512 s    = _mm512_set1_ps(scale);
+    size_t i          = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+        __m512 f  = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(b));
+        _mm512_storeu_ps(dst + i, _mm512_mul_ps(f, s));
+    }
+    if (i < n) {
+        __mmask16 m = first_lanes(n - i);
+        __m128i b   = _mm_maskz_loadu_epi8(m, src + i);
+        __m512 f    = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(b));
+        _mm512_mask_storeu_ps(dst + i, m, _mm512_mul_ps(f, s));
+    }
+}
+
+
+
+void
+u16_to_float(const uint16_t* src, float* dst, size_t n)
+{
+    const float scale = 1.0f / 65535.0f;
+    const __m512 s    = _mm512_set1_ps(scale);
+    size_t i          = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m512 f  = _mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(b));
+        _mm512_storeu_ps(dst + i, _mm512_mul_ps(f, s));
+    }
+    if (i < n) {
+        __mmask16 m = first_lanes(n - i);
+        __m256i b   = _mm256_maskz_loadu_epi16(m, src + i);
+        __m512 f    = _mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(b));
+        _mm512_mask_storeu_ps(dst + i, m, _mm512_mul_ps(f, s));
+    }
+}
+
+
+
+void
+half_to_float(const uint16_t* src, float* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i h = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm512_storeu_ps(dst + i, _mm512_cvtph_ps(h));
+    }
+    if (i < n) {
+        __mmask16 m = first_lanes(n - i);
+        __m256i h   = _mm256_maskz_loadu_epi16(m, src + i);
+        _mm512_mask_storeu_ps(dst + i, m, _mm512_cvtph_ps(h));
+    }
+}
+
+
+
+void
+float_to_half(const float* src, uint16_t* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i h = _mm512_cvtps_ph(_mm512_loadu_ps(src + i),
+                                    _MM_FROUND_TO_NEAREST_INT
+                                        | _MM_FROUND_NO_EXC);
+        _mm256_storeu_si256((__m256i*)(dst + i), h);
+    }
+    if (i < n) {
+        __mmask16 m = first_lanes(n - i);
+        __m256i h   = _mm512_cvtps_ph(_mm512_maskz_loadu_ps(m, src + i),
+                                      _MM_FROUND_TO_NEAREST_INT
+                                          | _MM_FROUND_NO_EXC);
+        _mm256_mask_storeu_epi16(dst + i, m, h);
+    }
+}
+
+
+
+void
+float_to_u8(const float* src, uint8_t* dst, size_t n)
+{
+    const __m512 max = _mm512_set1_ps(255.0f);
+    size_t i         = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i r = scale_clamp_round(_mm512_loadu_ps(src + i), max);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm512_cvtusepi32_epi8(r));
+    }
+    float_to_uint_tail(src + i, dst + i, n - i, 255.0f);
+}
+
+
+
+void
+float_to_u16(const float* src, uint16_t* dst, size_t n)
+{
+    const __m512 max = _mm512_set1_ps(65535.0f);
+    size_t i         = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i r = scale_clamp_round(_mm512_loadu_ps(src + i), max);
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm512_cvtusepi32_epi16(r));
+    }
+    float_to_uint_tail(src + i, dst + i, n - i, 65535.0f);
+}
+
+
+
+void
+add(const float* a, const float* b, float* r, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_ps(r + i, _mm512_add_ps(_mm512_loadu_ps(a + i),
+                                              _mm512_loadu_ps(b + i)));
+    if (i < n) {
+        __mmask16 m = first_lanes(n - i);
+        _mm512_mask_storeu_ps(r + i, m,
+                              _mm512_add_ps(_mm512_maskz_loadu_ps(m, a + i),
+                                            _mm512_maskz_loadu_ps(m, b + i)));
+    }
+}
+
+
+
+void
+sub(const float* a, const float* b, float* r, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_ps(r + i, _mm512_sub_ps(_mm512_loadu_ps(a + i),
+                                              _mm512_loadu_ps(b + i)));
+    if (i < n) {
+        __mmask16 m = first_lanes(n - i);
+        _mm512_mask_storeu_ps(r + i, m,
+                              _mm512_sub_ps(_mm512_maskz_loadu_ps(m, a + i),
+                                            _mm512_maskz_loadu_ps(m, b + i)));
+    }
+}
+
+
+
+void
+mul(const float* a, const float* b, float* r, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_ps(r + i, _mm512_mul_ps(_mm512_loadu_ps(a + i),
+                                              _mm512_loadu_ps(b + i)));
+    if (i < n) {
+        __mmask16 m = first_lanes(n - i);
+        _mm512_mask_storeu_ps(r + i, m,
+                              _mm512_mul_ps(_mm512_maskz_loadu_ps(m, a + i),
+                                            _mm512_maskz_loadu_ps(m, b + i)));
+    }
+}
+
+
+
+void
+mad(const float* a, const float* b, const float* c, float* r, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 ab = _mm512_mul_ps(_mm512_loadu_ps(a + i),
+                                  _mm512_loadu_ps(b + i));
+        _mm512_storeu_ps(r + i, _mm512_add_ps(ab, _mm512_loadu_ps(c + i)));
+    }
+    if (i < n) {
+        __mmask16 m = first_lanes(n - i);
+        __m512 ab   = _mm512_mul_ps(_mm512_maskz_loadu_ps(m, a + i),
+                                    _mm512_maskz_loadu_ps(m, b + i));
+        _mm512_mask_storeu_ps(r + i, m,
+                              _mm512_add_ps(ab,
+                                            _mm512_maskz_loadu_ps(m, c + i)));
+    }
+}
+
+
+
+// Alpha of each pixel in all four of its lanes, replaced by 1 if below
+// FLT_MIN (or NaN), then 1 put back in the alpha lanes: (a,a,a,1).
+inline __m512
+rgb_alpha_scale(__m512 a)
+{
+    const __m512 one = _mm512_set1_ps(1.0f);
+    __mmask16 ok     = _mm512_cmp_ps_mask(a, _mm512_set1_ps(1.17549435e-38f),
+                                          _CMP_GE_OQ);
+    return _mm512_mask_blend_ps(0x8888, _mm512_mask_blend_ps(ok, one, a), one);
+}
+
+
+
+void
+unpremult_rgba(float* rgba, float* alpha, size_t n)
+{
+    // Four pixels per vector; a partial last group is masked.
+    for (size_t i = 0; i < n; i += 4) {
+        size_t np   = n - i < 4 ? n - i : 4;
+        __mmask16 m = first_lanes(4 * np);
+        float* p    = rgba + 4 * i;
+        __m512 v    = _mm512_maskz_loadu_ps(m, p);
+        _mm512_mask_compressstoreu_ps(alpha + i, m & 0x8888, v);
+        __m512 a = rgb_alpha_scale(_mm512_permute_ps(v, 0xff));
+        _mm512_mask_storeu_ps(p, m, _mm512_div_ps(v, a));
+    }
+}
+
+
+
+void
+premult_rgba(float* rgba, const float* alpha, size_t n)
+{
+    const __m512i spread = _mm512_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                             2, 3, 3, 3, 3);
+    for (size_t i = 0; i < n; i += 4) {
+        size_t np   = n - i < 4 ? n - i : 4;
+        __mmask16 m = first_lanes(4 * np);
+        float* p    = rgba + 4 * i;
+        __m512 a    = _mm512_maskz_loadu_ps(first_lanes(np), alpha + i);
+        a           = _mm512_permutexvar_ps(spread, a);
+        __m512 v    = _mm512_maskz_loadu_ps(m, p);
+        _mm512_mask_storeu_ps(p, m, _mm512_mul_ps(v, rgb_alpha_scale(a)));
+    }
+}
+
+
+
+void
+matrix_rgba(float* rgba, size_t n, const float* M)
+{
+    // Same operation order as vfloat4 * matrix44, four pixels at a time.
+    const __m512 m0 = _mm512_setr4_ps(M[0], M[1], M[2], M[3]);
+    const __m512 m1 = _mm512_setr4_ps(M[4], M[5], M[6], M[7]);
+    const __m512 m2 = _mm512_setr4_ps(M[8], M[9], M[10], M[11]);
+    const __m512 m3 = _mm512_setr4_ps(M[12], M[13], M[14], M[15]);
+    for (size_t i = 0; i < n; i += 4) {
+        size_t np   = n - i < 4 ? n - i : 4;
+        __mmask16 m = first_lanes(4 * np);
+        float* p    = rgba + 4 * i;
+        __m512 v    = _mm512_maskz_loadu_ps(m, p);
+        __m512 r    = _mm512_mul_ps(_mm512_permute_ps(v, 0x00), m0);
+        r = _mm512_add_ps(r, _mm512_mul_ps(_mm512_permute_ps(v, 0x55), m1));
+        r = _mm512_add_ps(r, _mm512_mul_ps(_mm512_permute_ps(v, 0xaa), m2));
+        r = _mm512_add_ps(r, _mm512_mul_ps(_mm512_permute_ps(v, 0xff), m3));
+        _mm512_mask_storeu_ps(p, m, r);
+    }
+}
+
+
+
+void
+axpy(float a, const float* x, float* y, size_t n)
+{
+    const __m512 av = _mm512_set1_ps(a);
+    size_t i        = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_ps(y + i,
+                         _mm512_add_ps(_mm512_loadu_ps(y + i),
+                                       _mm512_mul_ps(av,
+                                                     _mm512_loadu_ps(x + i))));
+    if (i < n) {
+        __mmask16 m = first_lanes(n - i);
+        __m512 ax   = _mm512_mul_ps(av, _mm512_maskz_loadu_ps(m, x + i));
+        _mm512_mask_storeu_ps(y + i, m,
+                              _mm512_add_ps(_mm512_maskz_loadu_ps(m, y + i),
+                                            ax));
+    }
+}
+
+
+
+// Continue summing the taps t0..n-1 of one pixel into acc.
+inline __m128
+pixel_taps(__m128 acc, const float* p, int nchannels, const float* w, int t0,
+           int n)
+{
+    for (int t = t0; t < n; ++t, p += nchannels)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[t]), _mm_loadu_ps(p)));
+    return acc;
+}
+
+
+
+void
+filter_row(const float* row, int rowx, int nchannels, const int* first,
+           const int* count, const int* wstart, const float* weight,
+           float* out, size_t n)
+{
+    // Two output pixels at a time, one in each half. Each pixel sums its
+    // own taps in order, so the results match the 4-wide loop.
+    const __mmask8 m = __mmask8((1u << nchannels) - 1);
+    size_t i         = 0;
+    for (; i + 2 <= n; i += 2, out += 2 * nchannels) {
+        const float* p0 = row + size_t(first[i] - rowx) * nchannels;
+        const float* p1 = row + size_t(first[i + 1] - rowx) * nchannels;
+        const float* w0 = weight + wstart[i];
+        const float* w1 = weight + wstart[i + 1];
+        int both        = count[i] < count[i + 1] ? count[i] : count[i + 1];
+        __m256 acc      = _mm256_setzero_ps();
+        for (int t = 0; t < both; ++t, p0 += nchannels, p1 += nchannels) {
+            __m256 w = _mm256_set_m128(_mm_set1_ps(w1[t]), _mm_set1_ps(w0[t]));
+            __m256 p = _mm256_set_m128(_mm_loadu_ps(p1), _mm_loadu_ps(p0));
+            acc      = _mm256_add_ps(acc, _mm256_mul_ps(w, p));
+        }
+        __m128 a0 = pixel_taps(_mm256_castps256_ps128(acc), p0, nchannels,
+                               w0, both, count[i]);
+        __m128 a1 = pixel_taps(_mm256_extractf128_ps(acc, 1), p1, nchannels,
+                               w1, both, count[i + 1]);
+        _mm_mask_storeu_ps(out, m, a0);
+        _mm_mask_storeu_ps(out + nchannels, m, a1);
+    }
+    if (i < n) {
+        const float* p = row + size_t(first[i] - rowx) * nchannels;
+        _mm_mask_storeu_ps(out, m,
+                           pixel_taps(_mm_setzero_ps(), p, nchannels,
+                                      weight + wstart[i], 0, count[i]));
+    }
+}
+
+
+
+// Two texels of texeltype (four channels each), at p0 and p1, converted to
+// float in the low and high halves.
+inline __m256
+load_texel_pair(const unsigned char* p0, const unsigned char* p1,
+                int texeltype)
+{
+    if (texeltype == SimdTexel_Float)
+        return _mm256_set_m128(_mm_loadu_ps((const float*)p1),
+                               _mm_loadu_ps((const float*)p0));
+    if (texeltype == SimdTexel_UInt8) {
+        __m128i b = _mm_unpacklo_epi32(
+            _mm_castps_si128(_mm_load_ss((const float*)p0)),
+            _mm_castps_si128(_mm_load_ss((const float*)p1)));
+        __m256 f  = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(b));
+        return _mm256_mul_ps(f, _mm256_set1_ps(1.0f / 255.0f));
+    }
+    __m128i h = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)p0),
+                                   _mm_loadl_epi64((const __m128i*)p1));
+    if (texeltype == SimdTexel_Half)
+        return _mm256_cvtph_ps(h);
+    __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(h));
+    return _mm256_mul_ps(f, _mm256_set1_ps(1.0f / 65535.0f));
+}
+
+
+
+void
+bilerp_texels(const unsigned char* p, ptrdiff_t pixelstride,
+              ptrdiff_t rowstride, int texeltype, float sfrac, float tfrac,
+              float weight, float width, float height, float* accum,
+              float* dds, float* ddt)
+{
+    // Both rows at once: the left texels of the two rows in one vector and
+    // the right ones in another, with the same operation order as bilerp()
+    // and lerp() on vfloat4.
+    __m256 left  = load_texel_pair(p, p + rowstride, texeltype);
+    __m256 right = load_texel_pair(p + pixelstride, p + rowstride + pixelstride,
+                                   texeltype);
+    __m256 rows  = _mm256_add_ps(_mm256_mul_ps(left,
+                                              _mm256_set1_ps(1.0f - sfrac)),
+                                _mm256_mul_ps(right, _mm256_set1_ps(sfrac)));
+    __m128 t1    = _mm_set1_ps(1.0f - tfrac), t = _mm_set1_ps(tfrac);
+    __m128 r     = _mm_add_ps(_mm_mul_ps(t1, _mm256_castps256_ps128(rows)),
+                              _mm_mul_ps(t, _mm256_extractf128_ps(rows, 1)));
+    __m128 w     = _mm_set1_ps(weight);
+    _mm_storeu_ps(accum, _mm_add_ps(_mm_loadu_ps(accum), _mm_mul_ps(w, r)));
+    if (dds) {
+        // ds: right minus left of each row, lerped by t. dt: bottom minus
+        // top of each column, lerped by s.
+        __m256 d  = _mm256_sub_ps(right, left);
+        __m128 ds = _mm_add_ps(_mm_mul_ps(_mm256_castps256_ps128(d), t1),
+                               _mm_mul_ps(_mm256_extractf128_ps(d, 1), t));
+        __m128 dl = _mm_sub_ps(_mm256_extractf128_ps(left, 1),
+                               _mm256_castps256_ps128(left));
+        __m128 dr = _mm_sub_ps(_mm256_extractf128_ps(right, 1),
+                               _mm256_castps256_ps128(right));
+        __m128 dt = _mm_add_ps(_mm_mul_ps(dl, _mm_set1_ps(1.0f - sfrac)),
+                               _mm_mul_ps(dr, _mm_set1_ps(sfrac)));
+        __m128 sx = _mm_mul_ps(w, _mm_set1_ps(width));
+        __m128 sy = _mm_mul_ps(w, _mm_set1_ps(height));
+        _mm_storeu_ps(dds, _mm_add_ps(_mm_loadu_ps(dds), _mm_mul_ps(sx, ds)));
+        _mm_storeu_ps(ddt, _mm_add_ps(_mm_loadu_ps(ddt), _mm_mul_ps(sy, dt)));
+    }
+}
+
+}  // namespace
+
+
+
+const SimdKernels simd_kernels_avx512 = {
+    "avx512",
+    u8_to_float,
+    u16_to_float,
+    half_to_float,
+    float_to_u8,
+    float_to_u16,
+    float_to_half,
+    add,
+    sub,
+    mul,
+    mad,
+    unpremult_rgba,
+    premult_rgba,
+    matrix_rgba,
+    axpy,
+    filter_row,
+    bilerp_texels,
+};
+
+}  // namespace pvt
+OIIO_NAMESPACE_END
+
+#endif  // OIIO_SIMD_DISPATCH_X86
@@ -3,24 +3,38 @@
 // https://github.com/AcademySoftwareFoundation/OpenImageIO
 
 
+#include <chrono>
 #include <cstring>
 #include <memory>
 #include <regex>
 #include <sstream>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
+#include <zlib.h>
+
+#ifndef _WIN32
+#    include <fcntl.h>
+#    include <signal.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
 #include <OpenImageIO/Imath.h>
 
 #include <OpenImageIO/color.h>
 #include <OpenImageIO/dassert.h>
 #include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/fmath.h>
+#include <OpenImageIO/hash.h>
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagecache.h>
 #include <OpenImageIO/imageio.h>
 #include <OpenImageIO/optparser.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/simd.h>
 #include <OpenImageIO/strutil.h>
 #include <OpenImageIO/sysutil.h>
@@ -67,6 +81,14 @@ static ustring s_averagecolor("averagecolor"), s_averagealpha("averagealpha");
 static ustring s_constantcolor("constantcolor");
 static ustring s_constantalpha("constantalpha");
 
+// Names of the TileEvictionPolicy values, for the "eviction_policy"
+// attribute and for stats.
+static const char* eviction_policy_names[] = { "clock", "sharded_clock",
+                                               "slru" };
+static_assert(std::size(eviction_policy_names)
+                  == size_t(TileEvictionPolicy::Count),
+              "eviction_policy_names must list every policy");
+
 // constantly increasing, so we can avoid issues if an ImageCache pointer is re-used after being freed
 static std::atomic_int64_t imagecache_next_id = 0;
 static thread_local tsl::robin_map<uint64_t, ImageCachePerThreadInfo*>
@@ -127,9 +149,10 @@ void
 ImageCacheStatistics::init()
 {
     // ImageCache stats:
-    find_tile_calls             = 0;
-    find_tile_microcache_misses = 0;
-    find_tile_cache_misses      = 0;
+    find_tile_calls                 = 0;
+    find_tile_microcache_misses     = 0;
+    find_tile_microcache_assoc_hits = 0;
+    find_tile_cache_misses          = 0;
     //    tiles_created = 0;
     //    tiles_current = 0;
     //    tiles_peak = 0;
@@ -146,6 +169,38 @@ ImageCacheStatistics::init()
     tile_locking_time = 0;
     find_file_time    = 0;
     find_tile_time    = 0;
+    tile_wait_time    = 0;
+    prefetch_requests = 0;
+    prefetch_reads    = 0;
+    prefetch_dropped  = 0;
+    tiles_evicted     = 0;
+    tiles_promoted    = 0;
+    tiles_unevictable = 0;
+    for (int p = 0; p < npolicies; ++p)
+        policy_lookups[p] = policy_misses[p] = 0;
+    diskcache_hits          = 0;
+    diskcache_misses        = 0;
+    diskcache_spills        = 0;
+    diskcache_bytes_read    = 0;
+    diskcache_bytes_written = 0;
+    tiles_compressed        = 0;
+    tiles_decompressed      = 0;
+    compressed_raw_bytes    = 0;
+    compressed_bytes        = 0;
+    decompress_time         = 0;
+    tiles_mapped            = 0;
+    shared_tiles_found      = 0;
+    shared_tiles_stored     = 0;
+    tiles_deduplicated      = 0;
+    dedup_bytes_saved       = 0;
+    batched_reads           = 0;
+    batched_tiles           = 0;
+    preload_files           = 0;
+    preload_time            = 0;
+    catalog_hits            = 0;
+    catalog_misses          = 0;
+    udim_inventory_time     = 0;
+    udim_resolve_time       = 0;
 
     // TextureSystem stats:
     texture_queries     = 0;
@@ -175,6 +230,7 @@ ImageCacheStatistics::merge(const ImageCacheStatistics& s)
     // ImageCache stats:
     find_tile_calls += s.find_tile_calls;
     find_tile_microcache_misses += s.find_tile_microcache_misses;
+    find_tile_microcache_assoc_hits += s.find_tile_microcache_assoc_hits;
     find_tile_cache_misses += s.find_tile_cache_misses;
     //    tiles_created += s.tiles_created;
     //    tiles_current += s.tiles_current;
@@ -192,6 +248,40 @@ ImageCacheStatistics::merge(const ImageCacheStatistics& s)
     tile_locking_time += s.tile_locking_time;
     find_file_time += s.find_file_time;
     find_tile_time += s.find_tile_time;
+    tile_wait_time += s.tile_wait_time;
+    diskcache_hits += s.diskcache_hits;
+    diskcache_misses += s.diskcache_misses;
+    diskcache_spills += s.diskcache_spills;
+    diskcache_bytes_read += s.diskcache_bytes_read;
+    diskcache_bytes_written += s.diskcache_bytes_written;
+    tiles_compressed += s.tiles_compressed;
+    tiles_decompressed += s.tiles_decompressed;
+    compressed_raw_bytes += s.compressed_raw_bytes;
+    compressed_bytes += s.compressed_bytes;
+    decompress_time += s.decompress_time;
+    tiles_mapped += s.tiles_mapped;
+    shared_tiles_found += s.shared_tiles_found;
+    shared_tiles_stored += s.shared_tiles_stored;
+    tiles_deduplicated += s.tiles_deduplicated;
+    dedup_bytes_saved += s.dedup_bytes_saved;
+    batched_reads += s.batched_reads;
+    batched_tiles += s.batched_tiles;
+    preload_files += s.preload_files;
+    preload_time += s.preload_time;
+    catalog_hits += s.catalog_hits;
+    catalog_misses += s.catalog_misses;
+    udim_inventory_time += s.udim_inventory_time;
+    udim_resolve_time += s.udim_resolve_time;
+    prefetch_requests += s.prefetch_requests;
+    prefetch_reads += s.prefetch_reads;
+    prefetch_dropped += s.prefetch_dropped;
+    tiles_evicted += s.tiles_evicted;
+    tiles_promoted += s.tiles_promoted;
+    tiles_unevictable += s.tiles_unevictable;
+    for (int p = 0; p < npolicies; ++p) {
+        policy_lookups[p] += s.policy_lookups[p];
+        policy_misses[p] += s.policy_misses[p];
+    }
 
     // TextureSystem stats:
     texture_queries += s.texture_queries;
@@ -351,7 +441,7 @@ LevelInfo::LevelInfo(const LevelInfo& src)
 
 
 ImageCacheFile::ImageCacheFile(ImageCacheImpl& imagecache,
-                               ImageCachePerThreadInfo* /*thread_info*/,
+                               ImageCachePerThreadInfo* thread_info,
                                ustring filename, ImageInput::Creator creator,
                                const ImageSpec* config)
     : m_filename(filename)
@@ -389,7 +479,7 @@ ImageCacheFile::ImageCacheFile(ImageCacheImpl& imagecache,
     // reflected by the fact that m_validspec is false.
 
     // Figure out if it's a UDIM-like virtual texture
-    udim_setup();
+    udim_setup(thread_info);
 
     // If the config has an IOProxy, remember that we should never actually
     // release() it, because the proxy can't be reopened.
@@ -718,8 +808,63 @@ clamp_dimensions(ImageSpec& spec)
 
 
 
+namespace {
+
+// An ImageInput that answers header queries from a header catalog entry
+// instead of the file. It only serves to fill in an ImageCacheFile's
+// subimage and MIP level records, and has no pixels.
+class CatalogImageInput final : public ImageInput {
+public:
+    CatalogImageInput(std::shared_ptr<const ImageCacheCatalog::Entry> entry)
+        : m_entry(std::move(entry))
+    {
+    }
+    const char* format_name() const override
+    {
+        return m_entry->format.c_str();
+    }
+    bool open(const std::string& /*name*/, ImageSpec& newspec) override
+    {
+        if (!seek_subimage(0, 0))
+            return false;
+        newspec = m_spec;
+        return true;
+    }
+    bool close() override { return true; }
+    int current_subimage() const override { return m_subimage; }
+    int current_miplevel() const override { return m_miplevel; }
+    bool seek_subimage(int subimage, int miplevel) override
+    {
+        if (subimage < 0 || subimage >= int(m_entry->specs.size())
+            || miplevel < 0
+            || miplevel >= int(m_entry->specs[subimage].size()))
+            return false;
+        if (subimage != m_subimage || miplevel != m_miplevel) {
+            m_spec = ImageSpec();
+            m_spec.from_xml(m_entry->specs[subimage][miplevel].c_str());
+            m_subimage = subimage;
+            m_miplevel = miplevel;
+        }
+        return true;
+    }
+    bool read_native_scanline(int /*subimage*/, int /*miplevel*/, int /*y*/,
+                              int /*z*/, void* /*data*/) override
+    {
+        return false;
+    }
+
+private:
+    std::shared_ptr<const ImageCacheCatalog::Entry> m_entry;
+    int m_subimage = -1;
+    int m_miplevel = -1;
+};
+
+}  // namespace
+
+
+
 std::shared_ptr<ImageInput>
-ImageCacheFile::open(ImageCachePerThreadInfo* thread_info)
+ImageCacheFile::open(ImageCachePerThreadInfo* thread_info, bool header_only)
 {
     // Simple case -- no lock needed: atomically retrieve a shared pointer
     // to the ImageInput. If it exists, return it. Unless the file is
@@ -759,7 +904,38 @@ ImageCacheFile::open(ImageCachePerThreadInfo* thread_info)
     if (imagecache().unassociatedalpha())
         configspec.attribute("oiio:UnassociatedAlpha", 1);
 
-    if (m_inputcreator)
+    // The first time a file is opened, its headers may be known from the
+    // header catalog. If that's all the caller needs, the file itself can
+    // wait until pixels are wanted.
+    std::shared_ptr<ImageCacheCatalog> catalog;
+    std::shared_ptr<ImageCacheCatalog::Entry> newentry;
+    bool from_catalog = false;
+    if (!validspec() && !m_inputcreator && !m_configspec)
+        catalog = imagecache().catalog();
+    if (catalog) {
+        int64_t mtime = Filesystem::last_write_time(m_filename);
+        uint64_t size = Filesystem::file_size(m_filename);
+        std::shared_ptr<const ImageCacheCatalog::Entry> entry;
+        if (header_only)
+            entry = catalog->find(m_filename, mtime, size);
+        if (entry) {
+            inp.reset(new CatalogImageInput(entry));
+            from_catalog    = true;
+            m_catalog_mtime = mtime;
+            m_catalog_size  = size;
+            ++thread_info->m_stats.catalog_hits;
+        } else {
+            // Collect the native specs as we read them, for the catalog
+            newentry        = std::make_shared<ImageCacheCatalog::Entry>();
+            newentry->mtime = mtime;
+            newentry->size  = size;
+            ++thread_info->m_stats.catalog_misses;
+        }
+    }
+
+    if (from_catalog) {
+        // Already have the header source
+    } else if (m_inputcreator)
         inp.reset(m_inputcreator());
     else {
         // If we are trusting extensions and this isn't a special "REST-ful"
@@ -806,9 +982,28 @@ ImageCacheFile::open(ImageCachePerThreadInfo* thread_info)
         return invalid_file(inp->geterror());
 
     m_fileformat = ustring(inp->format_name());
-    ++m_timesopened;
+    if (!from_catalog)
+        ++m_timesopened;
     use();
 
+    // Headers that came from the catalog are only trusted while the file
+    // still has the modification time and size of the entry they were
+    // built from. If it has changed since, forget them and reread them
+    // from the file, as invalidate() would, refreshing the catalog too.
+    if (m_from_catalog && !from_catalog) {
+        m_from_catalog = false;
+        int64_t mtime  = Filesystem::last_write_time(m_filename);
+        uint64_t size  = Filesystem::file_size(m_filename);
+        if (mtime != m_catalog_mtime || size != m_catalog_size) {
+            invalidate_spec();
+            if ((catalog = imagecache().catalog())) {
+                newentry        = std::make_shared<ImageCacheCatalog::Entry>();
+                newentry->mtime = mtime;
+                newentry->size  = size;
+            }
+        }
+    }
+
     // If we are simply re-opening a closed file, and the spec is still
     // valid, we're done, no need to reread the subimage and mip headers.
     if (validspec()) {
@@ -844,6 +1039,10 @@ ImageCacheFile::open(ImageCachePerThreadInfo* thread_info)
             if (nativespec.nchannels > std::numeric_limits<uint16_t>::max())
                 return invalid_file(
                     "Images with more than 65535 channels are not supported.");
+            if (newentry) {
+                newentry->specs.resize(nsubimages + 1);
+                newentry->specs[nsubimages].push_back(nativespec.to_xml());
+            }
             tempspec = nativespec;
             if (nmip == 0) {
                 sispec = find_or_create_spec(nsubimages, tempspec);
@@ -994,7 +1193,15 @@ ImageCacheFile::open(ImageCachePerThreadInfo* thread_info)
     thread_info->m_stats.files_totalsize_ondisk += m_total_imagesize_ondisk;
 
     init_from_spec();  // Fill in the rest of the fields
-    set_imageinput(inp);
+    if (newentry) {
+        newentry->format = m_fileformat.string();
+        catalog->add(m_filename, newentry);
+    }
+    m_from_catalog = from_catalog;
+    if (from_catalog)
+        inp.reset();  // The file itself is opened when pixels are needed
+    else
+        set_imageinput(inp);
 
     // reduce memory usage if possible
     // if (m_pool_specs.size() > 1024)
@@ -1063,6 +1270,12 @@ ImageCacheFile::init_from_spec()
         maxmip = std::max(maxmip, miplevels(s));
     m_mipreadcount.clear();
     m_mipreadcount.resize(maxmip, 0);
+    // Other threads may be counting into the access stats of a file being
+    // reopened, so they're never reallocated.
+    if (!m_mipaccess) {
+        m_mipaccess.reset(new MipAccessStats[maxmip]);
+        m_nmipaccess = maxmip;
+    }
 
     OIIO_DASSERT(!m_broken);
     m_validspec = true;
@@ -1087,6 +1300,27 @@ ImageCacheFile::read_tile(ImageCachePerThreadInfo* thread_info,
     const SubimageInfo& si(subimageinfo(subimage));
     const ImageDims& dims(si.leveldims(miplevel));
 
+    // If the tile was evicted earlier, it's cheaper to unpack the
+    // compressed copy we kept, or to read it back from the disk cache
+    // (which may have been filled by another process), than to go back to
+    // the file.
+    if (imagecache().decompress_tile(id, data, thread_info->m_stats))
+        return true;
+    std::shared_ptr<ImageCacheDiskCache> diskcache = imagecache().diskcache();
+    if (diskcache) {
+        std::string key;
+        int64_t ntiles, index;
+        size_t tilebytes;
+        if (diskcache_slot(id, key, ntiles, index, tilebytes)) {
+            if (diskcache->read_tile(key, ntiles, index, tilebytes, data)) {
+                ++thread_info->m_stats.diskcache_hits;
+                thread_info->m_stats.diskcache_bytes_read += tilebytes;
+                return true;
+            }
+            ++thread_info->m_stats.diskcache_misses;
+        }
+    }
+
     // Special case for un-MIP-mapped
     if (si.unmipped && miplevel != 0)
         return read_unmipped(thread_info, id, data);
@@ -1100,18 +1334,126 @@ ImageCacheFile::read_tile(ImageCachePerThreadInfo* thread_info,
         return read_untiled(thread_info, inp.get(), id, data);
 
     // Ordinary tiled
+    TypeDesc format = id.file().datatype(subimage);
+    bool ok         = read_tiles_batched(thread_info, inp.get(), id, data);
+    if (ok) {
+        size_t b = si.get_tile_bytes(miplevel);
+        thread_info->m_stats.bytes_read += b;
+        m_bytesread += b;
+        ++m_tilesread;
+        if (id.colortransformid() > 0) {
+            // OIIO::print("CONVERT id {} {},{} to cs {}\n", filename(), id.x(), id.y(),
+            //       id.colortransformid());
+            ImageSpec tilespec(dims.tile_width, dims.tile_height,
+                               dims.nchannels, format);
+            ImageBuf wrapper(tilespec, make_cspan((const std::byte*)data,
+                                                  tilespec.image_bytes()));
+            ImageBufAlgo::colorconvert(
+                wrapper, wrapper,
+                ColorConfig::default_colorconfig().getColorSpaceNameByIndex(
+                    (id.colortransformid() >> 16) - 1),
+                m_imagecache.colorspace(), true, string_view(), string_view(),
+                nullptr, ROI(), 1);
+        }
+    }
+    return ok;
+}
+
+
+
+bool
+ImageCacheFile::read_tiles_batched(ImageCachePerThreadInfo* thread_info,
+                                   ImageInput* inp, const TileID& id,
+                                   void* data)
+{
+    PendingTileRead me { &id, data };
+    std::unique_lock<std::mutex> lock(m_batch_mutex);
+    m_batch_pending.push_back(&me);
+    while (m_batch_leader && !me.done)
+        m_batch_cv.wait(lock);
+    if (me.done)
+        return me.ok;
+
+    // Nobody else is reading, so we'll do it. Each round serves all the
+    // reads that were queued while the previous one was in the plugin. To
+    // keep our own caller from waiting indefinitely, after a few rounds
+    // any stragglers are left to choose a new reader among themselves.
+    m_batch_leader = true;
+    for (int round = 0; round < 4 && m_batch_pending.size(); ++round) {
+        std::vector<PendingTileRead*> batch;
+        batch.swap(m_batch_pending);
+        lock.unlock();
+        // Put adjacent tiles of the same level and channels next to each
+        // other, and read each such run at once.
+        auto order = [](const PendingTileRead* r) {
+            const TileID& t(*r->id);
+            return std::make_tuple(t.subimage(), t.miplevel(), t.chbegin(),
+                                   t.chend(), t.z(), t.y(), t.x());
+        };
+        std::sort(batch.begin(), batch.end(),
+                  [&](const PendingTileRead* a, const PendingTileRead* b) {
+                      return order(a) < order(b);
+                  });
+        for (size_t i = 0, j = 0; i < batch.size(); i = j) {
+            const TileID& first(*batch[i]->id);
+            int tw = subimageinfo(first.subimage())
+                         .leveldims(first.miplevel())
+                         .tile_width;
+            for (j = i + 1; j < batch.size(); ++j) {
+                const TileID& prev(*batch[j - 1]->id);
+                const TileID& next(*batch[j]->id);
+                if (next.subimage() != prev.subimage()
+                    || next.miplevel() != prev.miplevel()
+                    || next.chbegin() != prev.chbegin()
+                    || next.chend() != prev.chend() || next.z() != prev.z()
+                    || next.y() != prev.y() || next.x() != prev.x() + tw)
+                    break;
+            }
+            read_tile_run(thread_info, inp, &batch[i], j - i);
+        }
+        lock.lock();
+        for (PendingTileRead* r : batch)
+            r->done = true;
+        m_batch_cv.notify_all();
+    }
+    m_batch_leader = false;
+    m_batch_cv.notify_all();  // Let any stragglers pick a new reader
+    return me.ok;
+}
+
+
+
+void
+ImageCacheFile::read_tile_run(ImageCachePerThreadInfo* thread_info,
+                              ImageInput* inp, PendingTileRead* const* reads,
+                              size_t n)
+{
+    const TileID& id(*reads[0]->id);
+    int subimage    = id.subimage();
+    int miplevel    = id.miplevel();
     int x           = id.x();
     int y           = id.y();
     int z           = id.z();
     int chbegin     = id.chbegin();
     int chend       = id.chend();
-    TypeDesc format = id.file().datatype(subimage);
+    TypeDesc format = datatype(subimage);
+    const ImageDims& dims(subimageinfo(subimage).leveldims(miplevel));
+    int xend = x + int(n) * dims.tile_width;
+
+    // A lone tile is read directly into place. A run is read into one
+    // buffer and then dealt out to the tiles.
+    size_t tilerow = size_t(dims.tile_width) * id.nchannels() * format.size();
+    size_t nrows   = size_t(dims.tile_height) * dims.tile_depth;
+    std::unique_ptr<char[]> runbuf;
+    if (n > 1)
+        runbuf.reset(new char[n * tilerow * nrows]);
+    void* dest = n > 1 ? (void*)runbuf.get() : reads[0]->data;
 
     bool ok = true;
     for (int tries = 0; tries <= imagecache().failure_retries(); ++tries) {
-        ok = inp->read_tiles(subimage, miplevel, x, x + dims.tile_width, y,
+        ok = inp->read_tiles(subimage, miplevel, x, xend, y,
                              y + dims.tile_height, z, z + dims.tile_depth,
-                             chbegin, chend, format, data);
+                             chbegin, chend, format, dest);
         if (ok) {
             if (tries)  // succeeded, but only after a failure!
                 ++thread_info->m_stats.tile_retry_success;
@@ -1124,6 +1466,13 @@ ImageCacheFile::read_tile(ImageCachePerThreadInfo* thread_info,
             // TODO: should we attempt to close and re-open the file?
         }
     }
+    if (!ok && n > 1) {
+        // Don't let one bad tile spoil the rest of the run
+        (void)inp->geterror();
+        for (size_t t = 0; t < n; ++t)
+            read_tile_run(thread_info, inp, reads + t, 1);
+        return;
+    }
     if (!ok) {
         m_broken        = true;
         std::string err = inp->geterror();
@@ -1132,28 +1481,152 @@ ImageCacheFile::read_tile(ImageCachePerThreadInfo* thread_info,
                                err.size() ? err : std::string("unknown error"));
         }
     }
+    if (ok && n > 1) {
+        for (size_t t = 0; t < n; ++t)
+            for (size_t r = 0; r < nrows; ++r)
+                memcpy((char*)reads[t]->data + r * tilerow,
+                       runbuf.get() + (r * n + t) * tilerow, tilerow);
+        ++thread_info->m_stats.batched_reads;
+        thread_info->m_stats.batched_tiles += n;
+    }
+    for (size_t t = 0; t < n; ++t)
+        reads[t]->ok = ok;
+}
 
-    if (ok) {
-        size_t b = si.get_tile_bytes(miplevel);
-        thread_info->m_stats.bytes_read += b;
-        m_bytesread += b;
-        ++m_tilesread;
-        if (id.colortransformid() > 0) {
-            // OIIO::print("CONVERT id {} {},{} to cs {}\n", filename(), id.x(), id.y(),
-            //       id.colortransformid());
-            ImageSpec tilespec(dims.tile_width, dims.tile_height,
-                               dims.nchannels, format);
-            ImageBuf wrapper(tilespec, make_cspan((const std::byte*)data,
-                                                  tilespec.image_bytes()));
-            ImageBufAlgo::colorconvert(
-                wrapper, wrapper,
-                ColorConfig::default_colorconfig().getColorSpaceNameByIndex(
-                    (id.colortransformid() >> 16) - 1),
-                m_imagecache.colorspace(), true, string_view(), string_view(),
-                nullptr, ROI(), 1);
-        }
+
+
+bool
+ImageCacheFile::diskcache_slot(const TileID& id, std::string& key,
+                               int64_t& ntiles, int64_t& index,
+                               size_t& tilebytes) const
+{
+    // Files read through a custom ImageInput or with configuration hints
+    // might not decode the same way in another process, so leave them be.
+    if (m_inputcreator || m_configspec || m_broken)
+        return false;
+    const SubimageInfo& si(subimageinfo(id.subimage()));
+    const LevelInfo& lev(si.levelinfo(id.miplevel()));
+    const ImageDims& dims(si.leveldims(id.miplevel()));
+    ntiles = int64_t(lev.nxtiles) * lev.nytiles * lev.nztiles;
+    index  = (id.x() - dims.x) / dims.tile_width
+            + int64_t((id.y() - dims.y) / dims.tile_height) * lev.nxtiles
+            + int64_t((id.z() - dims.z) / dims.tile_depth) * lev.nxtiles
+                  * lev.nytiles;
+    tilebytes = size_t(si.get_tile_pixels(id.miplevel())) * id.nchannels()
+                * si.channelsize;
+    // A fingerprint identifies the pixels themselves, wherever they live.
+    // Lacking one, the file name, modification time and size will have to
+    // do.
+    std::string ident = m_fingerprint.size()
+                            ? m_fingerprint.string()
+                            : Strutil::fmt::format("{}@{}:{}", m_filename,
+                                                   int64_t(m_mod_time),
+                                                   m_total_imagesize_ondisk);
+    // The key outlives this process, so a color transform is named by its
+    // color spaces and the config they come from rather than by its id,
+    // which depends on the order transforms were registered in.
+    std::string color;
+    if (id.colortransformid() > 0) {
+        const ColorConfig& cc(ColorConfig::default_colorconfig());
+        color = Strutil::fmt::format(
+            "{}>{}@{}",
+            cc.getColorSpaceNameByIndex((id.colortransformid() >> 16) - 1),
+            m_imagecache.colorspace(), cc.configname());
+    }
+    // Cache options that change the decoded pixels
+    int options = (m_imagecache.unassociatedalpha() ? 1 : 0)
+                  | (m_imagecache.forcefloat() ? 2 : 0);
+    key = Strutil::fmt::format("{}|{}|{}|{}-{}|{}|{}|{}|{}x{}x{}|{}x{}x{}",
+                               ident, id.subimage(), id.miplevel(),
+                               id.chbegin(), id.chend(), color, options,
+                               si.datatype, dims.width, dims.height,
+                               dims.depth, dims.tile_width, dims.tile_height,
+                               dims.tile_depth);
+    return true;
+}
+
+
+
+const char*
+ImageCacheFile::map_tile(ImageCachePerThreadInfo* thread_info,
+                         const TileID& id, std::shared_ptr<void>& keepalive)
+{
+    std::shared_ptr<ImageCacheDiskCache> diskcache = imagecache().diskcache();
+    if (!diskcache || !diskcache->mapped())
+        return nullptr;
+    std::string key;
+    int64_t ntiles, index;
+    size_t tilebytes;
+    if (!diskcache_slot(id, key, ntiles, index, tilebytes))
+        return nullptr;
+    const char* pixels = diskcache->map_tile(key, ntiles, index, tilebytes,
+                                             keepalive);
+    if (pixels) {
+        if (id.miplevel() > 0)
+            m_mipused = true;
+        m_mipreadcount[id.miplevel()]++;
+        ++thread_info->m_stats.diskcache_hits;
+        ++thread_info->m_stats.tiles_mapped;
     }
-    return ok;
+    return pixels;
+}
+
+
+
+const char*
+ImageCacheFile::find_shared_tile(ImageCachePerThreadInfo* thread_info,
+                                 const TileID& id,
+                                 std::shared_ptr<void>& keepalive)
+{
+    std::shared_ptr<ImageCacheSharedPool> pool = imagecache().sharedpool();
+    if (!pool)
+        return nullptr;
+    std::string key;
+    int64_t ntiles, index;
+    size_t tilebytes;
+    if (!diskcache_slot(id, key, ntiles, index, tilebytes)
+        || tilebytes > pool->slotbytes())
+        return nullptr;
+    const char* pixels = pool->find_tile(key, index, keepalive);
+    if (pixels) {
+        if (id.miplevel() > 0)
+            m_mipused = true;
+        m_mipreadcount[id.miplevel()]++;
+        ++thread_info->m_stats.shared_tiles_found;
+    }
+    return pixels;
+}
+
+
+
+const char*
+ImageCacheFile::read_shared_tile(ImageCachePerThreadInfo* thread_info,
+                                 const TileID& id,
+                                 std::shared_ptr<void>& keepalive)
+{
+    std::shared_ptr<ImageCacheSharedPool> pool = imagecache().sharedpool();
+    if (!pool)
+        return nullptr;
+    std::string key;
+    int64_t ntiles, index;
+    size_t tilebytes;
+    if (!diskcache_slot(id, key, ntiles, index, tilebytes)
+        || tilebytes > pool->slotbytes())
+        return nullptr;
+    int64_t slot;
+    char* pixels = pool->reserve_tile(key, index, slot);
+    if (!pixels)
+        return nullptr;
+    // Clear the end pad values so there aren't NaNs sucked up by simd
+    // loads
+    memset(pixels + tilebytes, 0, OIIO_SIMD_MAX_SIZE_BYTES);
+    if (!read_tile(thread_info, id, pixels)) {
+        pool->abandon(slot);
+        return nullptr;
+    }
+    pool->publish(slot, keepalive);
+    ++thread_info->m_stats.shared_tiles_stored;
+    return pixels;
 }
 
 
@@ -1511,6 +1984,7 @@ ImageCacheFile::heapsize() const
     size += pvt::heapsize(m_configspec);
     size += pvt::heapsize(m_input);
     size += pvt::heapsize(m_mipreadcount);
+    size += m_nmipaccess * sizeof(MipAccessStats);
     size += pvt::heapsize(m_udim_lookup);
     return size;
 }
@@ -1539,18 +2013,32 @@ ImageCacheImpl::find_file(ustring filename,
 #if IMAGECACHE_TIME_STATS
         Timer timer;
 #endif
-        size_t bin                  = m_files.lock_bin(filename);
-        FilenameMap::iterator found = m_files.find(filename, false);
-        if (found) {
-            tf = found->second.get();
-        } else {
-            // No such entry in the file cache.  Add it, but don't open yet.
-            tf = new ImageCacheFile(*this, thread_info, filename, creator,
-                                    config);
-            m_files.insert(filename, tf, false);
-            newfile = true;
+        bool found = false;
+#if IMAGECACHE_LOCKFREE_LOOKUP
+        // Most of the time the file is already known to the cache, which
+        // we can establish without locking.
+        ImageCacheFileRef existing;
+        if (!replace && m_files.retrieve(filename, existing)) {
+            tf    = existing.get();
+            found = true;
+        }
+#endif
+        if (!found) {
+            size_t bin                  = m_files.lock_bin(filename);
+            FilenameMap::iterator entry = m_files.find(filename, false);
+            if (entry) {
+                tf    = entry->second.get();
+                found = true;
+            } else {
+                // No such entry in the file cache.  Add it, but don't open
+                // yet.
+                tf = new ImageCacheFile(*this, thread_info, filename, creator,
+                                        config);
+                m_files.insert(filename, tf, false);
+                newfile = true;
+            }
+            m_files.unlock_bin(bin);
         }
-        m_files.unlock_bin(bin);
         if (replace && found) {
             invalidate(filename, true);
             tf->reset(creator, config);
@@ -1601,7 +2089,7 @@ ImageCacheImpl::verify_file(ImageCacheFile* tf,
         recursive_timed_lock_guard guard(tf->m_input_mutex);
         tf->m_mutex_wait_time += input_mutex_timer();
         if (!tf->validspec()) {
-            tf->open(thread_info);
+            tf->open(thread_info, true /*header_only*/);
             OIIO_DASSERT(tf->m_broken || tf->validspec());
             double createtime = timer();
             ImageCacheStatistics& stats(thread_info->m_stats);
@@ -1841,6 +2329,10 @@ ImageCacheTile::ImageCacheTile(const TileID& id, const void* pels,
 ImageCacheTile::~ImageCacheTile()
 {
     m_id.file().imagecache().decr_tiles(memsize());
+    if (m_mapped_size)
+        m_id.file().imagecache().decr_mapped_mem(m_mapped_size);
+    if (m_shared)
+        m_id.file().imagecache().decr_shared_mem(memsize());
     if (m_nofree)
         m_pixels.release();  // release without freeing
 }
@@ -1868,12 +2360,63 @@ ImageCacheTile::read(ImageCachePerThreadInfo* thread_info)
     m_pixelsize   = m_id.nchannels() * m_channelsize;
     size_t size   = memsize_needed();
     OIIO_ASSERT(memsize() == 0 && size > OIIO_SIMD_MAX_SIZE_BYTES);
-    m_pixels.reset(new char[m_pixels_size = size]);
-    // Clear the end pad values so there aren't NaNs sucked up by simd loads
-    memset(m_pixels.get() + size - OIIO_SIMD_MAX_SIZE_BYTES, 0,
-           OIIO_SIMD_MAX_SIZE_BYTES);
-    m_valid = file.read_tile(thread_info, m_id, &m_pixels[0]);
-    file.imagecache().incr_mem(size);
+    // Look for the tile in the shared pool, then in a mapped disk cache
+    // slab. Failing both, read it into the shared pool if there's room.
+    // (Should that read fail, it's retried below, which reports errors.)
+    std::shared_ptr<void> mapping;
+    const char* mapped = nullptr;
+    const char* shared = file.find_shared_tile(thread_info, m_id, mapping);
+    if (!shared && !(mapped = file.map_tile(thread_info, m_id, mapping)))
+        shared = file.read_shared_tile(thread_info, m_id, mapping);
+    if (shared) {
+        // The pixels are in the shared tile pool, where any process on the
+        // host may use them, and they stay pinned there for as long as we
+        // hold this tile. They count toward our memory limit like our own
+        // tiles, but aren't written to the disk cache or compressed when
+        // evicted, since they're likely still in the pool.
+        m_pixels.reset(const_cast<char*>(shared));
+        m_nofree      = true;
+        m_mapping     = std::move(mapping);
+        m_shared      = true;
+        m_pixels_size = size;
+        m_valid       = true;
+        file.imagecache().incr_mem(size);
+        file.imagecache().incr_shared_mem(size);
+    } else if (mapped) {
+        // Use the pixels right where they are in the mapped disk cache
+        // slab (which pads them just like we do): nothing to allocate or
+        // copy, and the pages are shared with every other process using
+        // the slab. They don't count against the memory limit.
+        m_pixels.reset(const_cast<char*>(mapped));
+        m_nofree      = true;
+        m_mapping     = std::move(mapping);
+        m_mapped_size = size;
+        m_valid       = true;
+        file.imagecache().incr_mapped_mem(size);
+    } else {
+        m_pixels.reset(new char[m_pixels_size = size]);
+        // Clear the end pad values so there aren't NaNs sucked up by simd
+        // loads
+        memset(m_pixels.get() + size - OIIO_SIMD_MAX_SIZE_BYTES, 0,
+               OIIO_SIMD_MAX_SIZE_BYTES);
+        m_valid     = file.read_tile(thread_info, m_id, &m_pixels[0]);
+        m_spillable = m_valid;
+        file.imagecache().incr_mem(size);
+        if (m_valid && file.imagecache().deduplicate_tiles()) {
+            // Share the pixels of an identical tile if there is one. The
+            // buffer accounts for its own memory, and since other tiles
+            // may still be using it when this one is evicted, it isn't
+            // worth writing to the disk cache or compressing.
+            char* pixels = m_pixels.release();
+            file.imagecache().deduplicate_pixels(pixels, size, m_mapping,
+                                                 thread_info->m_stats);
+            m_pixels.reset(pixels);
+            m_pixels_size = 0;
+            m_nofree      = true;
+            m_dedup       = true;
+            m_spillable   = false;
+        }
+    }
     if (m_valid) {
         SubimageInfo& si(file.subimageinfo(m_id.subimage()));
         LevelInfo& lev(si.levelinfo(m_id.miplevel()));
@@ -1887,8 +2430,11 @@ ImageCacheTile::read(ImageCachePerThreadInfo* thread_info)
         int index       = whichtile / 64;
         int64_t bitmask = int64_t(1ULL << (whichtile & 63));
         int64_t oldval  = lev.tiles_read[index].fetch_or(bitmask);
-        if (oldval & bitmask)  // Was it previously read?
+        if (oldval & bitmask) {  // Was it previously read?
             file.register_redundant_tile(si.get_tile_bytes(m_id.miplevel()));
+            if (auto a = file.imagecache().mipaccess(m_id))
+                ++a->redundant;
+        }
     } else {
         // (! m_valid)
         m_used = false;  // Don't let it hold mem if invalid
@@ -1948,94 +2494,1081 @@ ImageCacheTile::data(int x, int y, int z, int c) const
 
 
 
-ImageCacheImpl::ImageCacheImpl()
-{
-    imagecache_id = imagecache_next_id.fetch_add(1);
-    init();
+// Pack a tile for the compressed tier. The bytes of each channel value are
+// first split into planes -- all the first bytes, then all the second
+// bytes, and so on -- which puts the slowly varying high bytes of nearby
+// half or float values next to each other, and then deflated at the
+// fastest setting. Return false if the result would not save at least an
+// eighth of the memory, in which case the tile isn't worth keeping.
+static bool
+pack_tile(const char* pixels, size_t size, int valuesize,
+          std::unique_ptr<char[]>& packed, size_t& packedsize)
+{
+    std::unique_ptr<char[]> planes;
+    const char* src = pixels;
+    if (valuesize > 1) {
+        size_t nvalues = size / valuesize;
+        planes.reset(new char[size]);
+        for (size_t v = 0; v < nvalues; ++v)
+            for (int b = 0; b < valuesize; ++b)
+                planes[b * nvalues + v] = pixels[v * valuesize + b];
+        src = planes.get();
+    }
+    uLongf destlen = compressBound(uLong(size));
+    std::unique_ptr<char[]> dest(new char[destlen]);
+    if (compress2((Bytef*)dest.get(), &destlen, (const Bytef*)src,
+                  uLong(size), Z_BEST_SPEED)
+            != Z_OK
+        || destlen > size - size / 8)
+        return false;
+    packed.reset(new char[destlen]);
+    memcpy(packed.get(), dest.get(), destlen);
+    packedsize = destlen;
+    return true;
 }
 
 
 
-void
-ImageCacheImpl::set_max_open_files(int max_open_files)
-{
-    // Clamp to somewhat less than the maximum number of files allowed
-    // by the system.
-    int m = int(std::min(Sysutil::max_open_files(),
-                         size_t(std::numeric_limits<int>::max())));
-    m     = std::max(10, m - 5 * int(Sysutil::hardware_concurrency()));
-    m_max_open_files = std::min(max_open_files, m);
-    // std::cout << "clamped max_open_files = " << m_max_open_files << "\n";
+// Inverse of pack_tile.
+static bool
+unpack_tile(const char* packed, size_t packedsize, int valuesize,
+            char* pixels, size_t size)
+{
+    std::unique_ptr<char[]> planes;
+    char* dest = pixels;
+    if (valuesize > 1) {
+        planes.reset(new char[size]);
+        dest = planes.get();
+    }
+    uLongf destlen = uLongf(size);
+    if (uncompress((Bytef*)dest, &destlen, (const Bytef*)packed,
+                   uLong(packedsize))
+            != Z_OK
+        || destlen != size)
+        return false;
+    if (valuesize > 1) {
+        size_t nvalues = size / valuesize;
+        for (size_t v = 0; v < nvalues; ++v)
+            for (int b = 0; b < valuesize; ++b)
+                pixels[v * valuesize + b] = planes[b * nvalues + v];
+    }
+    return true;
 }
 
 
 
-void
-ImageCacheImpl::init()
-{
-    set_max_open_files(100);
-    m_max_memory_bytes     = 1024LL * 1024 * 1024;  // 1 GB default cache size
-    m_autotile             = 0;
-    m_autoscanline         = false;
-    m_automip              = false;
-    m_forcefloat           = false;
-    m_accept_untiled       = true;
-    m_accept_unmipped      = true;
-    m_deduplicate          = true;
-    m_unassociatedalpha    = false;
-    m_failure_retries      = 0;
-    m_latlong_y_up_default = true;
-    m_Mw2c.makeIdentity();
-    m_colorspace              = ustring("scene_linear");
-    m_mem_used                = 0;
-    m_statslevel              = 0;
-    m_max_errors_per_file     = 100;
-    m_stat_tiles_created      = 0;
-    m_stat_tiles_current      = 0;
-    m_stat_tiles_peak         = 0;
-    m_stat_open_files_created = 0;
-    m_stat_open_files_current = 0;
-    m_stat_open_files_peak    = 0;
-    m_max_open_files_strict   = false;
+// Each disk cache slab starts with this header, followed by the slab's key
+// string and then one "present" byte per tile. The tiles themselves follow,
+// starting at the next page boundary, each at a fixed offset. Every tile is
+// followed by the same zeroed padding as the tiles we allocate, so that a
+// tile can be used right where it is in a memory-mapped slab. The file is
+// created at its full (sparse) size, so all of it can be mapped.
+struct DiskCacheSlabHeader {
+    char magic[8];
+    uint64_t tilebytes;
+    uint64_t ntiles;
+    uint64_t keylen;
+};
 
-    // Allow environment variable to override default options
-    const char* options = getenv("OPENIMAGEIO_IMAGECACHE_OPTIONS");
-    if (options)
-        attribute("options", options);
+static const char diskcache_magic[8] = { 'O', 'I', 'I', 'O',
+                                         'T', 'S', 'L', '2' };
+
+// Distance between the starts of successive tiles in a slab
+inline int64_t
+diskcache_tile_stride(size_t tilebytes)
+{
+    return round_to_multiple(int64_t(tilebytes + OIIO_SIMD_MAX_SIZE_BYTES),
+                             int64_t(64));
 }
 
+// Each open slab holds a file descriptor, so don't keep too many around.
+static const size_t diskcache_max_open_slabs = 128;
 
+// Slabs' modification times record when they were last used, for pruning
+// the least recently used ones. Refresh them at most this often (seconds).
+static const std::time_t diskcache_touch_interval = 60;
 
-ImageCacheImpl::~ImageCacheImpl()
-{
-    printstats();
-    // All the per_thread_infos get destroyed here, regardless of if they were created implicitly
-    // or manually by the caller
+// Measure the directory again after creating this many slabs, to account
+// for those that other processes sharing it have made.
+static const int diskcache_remeasure_slabs = 64;
+
+
+
+struct ImageCacheDiskCache::Slab {
+    std::unique_ptr<Filesystem::IOFile> io;
+    std::string path;
+    int64_t flagsoffset = 0;         ///< Where the "present" bytes start
+    int64_t dataoffset  = 0;         ///< Where the tile data starts
+    int64_t stride      = 0;         ///< Bytes from one tile to the next
+    const char* mapping = nullptr;   ///< Whole slab, if memory-mapped
+    size_t mapsize      = 0;         ///< Size of the mapping
+    std::atomic<std::time_t> touched { 0 };  ///< Last marked as used
+    ~Slab()
     {
-        spin_lock lock(m_perthread_info_mutex);
-        m_all_perthread_info.clear();
+#ifndef _WIN32
+        if (mapping)
+            munmap((void*)mapping, mapsize);
+#endif
+        if (io)
+            io->close();
     }
-    // Erase any leftover errors from this thread
-    // TODO: can we clear other threads' errors?
-    // TODO: potentially unsafe due to the static destruction order fiasco
-    // imcache_error_messages.erase(imagecache_id);
+    // Mark the slab as recently used
+    void touch()
+    {
+        std::time_t now = std::time(nullptr);
+        if (now - touched >= diskcache_touch_interval) {
+            touched = now;
+            Filesystem::last_write_time(path, now);
+        }
+    }
+};
+
+
+
+ImageCacheDiskCache::~ImageCacheDiskCache() {}
+
+
+
+std::shared_ptr<ImageCacheDiskCache::Slab>
+ImageCacheDiskCache::slab(const std::string& key, int64_t ntiles,
+                          size_t tilebytes, bool create)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_slabs.find(key);
+    if (found != m_slabs.end())
+        return found->second;
+
+    DiskCacheSlabHeader header;
+    memcpy(header.magic, diskcache_magic, sizeof(header.magic));
+    header.tilebytes = tilebytes;
+    header.ntiles    = uint64_t(ntiles);
+    header.keylen    = key.size();
+    int64_t flagsoffset = int64_t(sizeof(header) + key.size());
+    int64_t dataoffset  = round_to_multiple(flagsoffset + ntiles,
+                                            int64_t(4096));
+    int64_t stride      = diskcache_tile_stride(tilebytes);
+    int64_t slabsize    = dataoffset + ntiles * stride;
+
+    // Slabs are named by a hash of their key; the key itself is stored in
+    // the header so that a hash collision is recognized as a mismatch.
+    std::string path = Strutil::fmt::format("{}/{:016x}.tiles", m_dir,
+                                            Strutil::strhash64(key));
+    FILE* fd = Filesystem::fopen(path, "r+b");
+    if (!fd && create) {
+        // Write the header and cleared "present" bytes under a temporary
+        // name and then move the slab into place, so that no other thread
+        // or process ever sees a partially written header.
+        std::string tmp = path + "." + Filesystem::unique_path() + ".tmp";
+        bool ok         = false;
+        {
+            Filesystem::IOFile out(tmp, Filesystem::IOProxy::Write);
+            std::vector<char> flags(size_t(ntiles), 0);
+            char end = 0;
+            ok = out.pwrite(&header, sizeof(header), 0) == sizeof(header)
+                 && out.pwrite(key.data(), key.size(), sizeof(header))
+                        == key.size()
+                 && out.pwrite(flags.data(), flags.size(), flagsoffset)
+                        == flags.size()
+                 && out.pwrite(&end, 1, slabsize - 1) == 1;
+        }
+        std::string err;
+        if (ok && Filesystem::rename(tmp, path, err)) {
+            fd = Filesystem::fopen(path, "r+b");
+            if (m_usage >= 0)
+                m_usage += slabsize;
+            if (m_max_bytes > 0
+                && (m_usage < 0 || m_usage > m_max_bytes
+                    || ++m_created >= diskcache_remeasure_slabs))
+                prune(path);
+        } else {
+            Filesystem::remove(tmp, err);
+        }
+    }
+    if (!fd)
+        return nullptr;  // Not cached, so that we look again next time
+
+    auto s = std::make_shared<Slab>();
+    s->io.reset(new Filesystem::IOFile(fd, Filesystem::IOProxy::Write));
+    s->path = path;
+    s->touch();
+    s->flagsoffset = flagsoffset;
+    s->dataoffset  = dataoffset;
+    s->stride      = stride;
+
+    // Make sure the slab really is the one we're after. If it isn't, the
+    // slab is remembered with no file, and never read or written.
+    DiskCacheSlabHeader existing;
+    std::string existingkey(key.size(), '\0');
+    if (s->io->pread(&existing, sizeof(existing), 0) != sizeof(existing)
+        || memcmp(&existing, &header, sizeof(header))
+        || s->io->pread(&existingkey[0], key.size(), sizeof(header))
+               != key.size()
+        || existingkey != key)
+        s->io.reset();
+
+#ifndef _WIN32
+    // N.B. the slab is only mapped if it really is full size, as touching
+    // a mapped page past the end of the file would be fatal.
+    if (m_mmap && s->io && Filesystem::file_size(path) >= uint64_t(slabsize)) {
+        void* m = mmap(nullptr, size_t(slabsize), PROT_READ, MAP_SHARED,
+                       fileno(fd), 0);
+        if (m != MAP_FAILED) {
+            s->mapping = (const char*)m;
+            s->mapsize = size_t(slabsize);
+        }
+    }
+#endif
+
+    if (m_slabs.size() >= diskcache_max_open_slabs)
+        m_slabs.clear();  // Slabs still in use stay open until released
+    m_slabs[key] = s;
+    return s;
 }
 
 
 
 void
-ImageCacheImpl::mergestats(ImageCacheStatistics& stats) const
+ImageCacheDiskCache::prune(const std::string& keep)
 {
-    stats.init();
-    spin_lock lock(m_perthread_info_mutex);
-    for (auto& p : m_all_perthread_info)
-        if (p)
-            stats.merge(p->m_stats);
+    struct SlabFile {
+        std::time_t mtime;
+        int64_t size;
+        std::string path;
+    };
+    std::vector<std::string> names;
+    Filesystem::get_directory_entries(m_dir, names);
+    std::vector<SlabFile> slabs;
+    int64_t total = 0;
+    for (const std::string& name : names) {
+        if (!Strutil::ends_with(name, ".tiles"))
+            continue;  // Skips slabs still being written, too
+        int64_t size = int64_t(Filesystem::file_size(name));
+        total += size;
+        if (name != keep)
+            slabs.push_back({ Filesystem::last_write_time(name), size, name });
+    }
+    std::sort(slabs.begin(), slabs.end(),
+              [](const SlabFile& a, const SlabFile& b) {
+                  return a.mtime < b.mtime;
+              });
+    int64_t limit = m_max_bytes;
+    std::unordered_set<std::string> removed;
+    for (const SlabFile& slab : slabs) {
+        if (total <= limit)
+            break;
+        // Processes using the slab keep their open file (and mapping)
+        // until they let it go, so this is safe even if it's in use.
+        std::string err;
+        if (Filesystem::remove(slab.path, err)) {
+            total -= slab.size;
+            removed.insert(slab.path);
+        }
+    }
+    for (auto s = m_slabs.begin(); s != m_slabs.end();) {
+        if (s->second && removed.count(s->second->path))
+            s = m_slabs.erase(s);
+        else
+            ++s;
+    }
+    m_usage   = total;
+    m_created = 0;
 }
 
 
 
-std::string
+bool
+ImageCacheDiskCache::read_tile(const std::string& key, int64_t ntiles,
+                               int64_t index, size_t tilebytes, void* data)
+{
+    std::shared_ptr<Slab> s = slab(key, ntiles, tilebytes, false);
+    if (!s || !s->io)
+        return false;
+    char present = 0;
+    if (s->io->pread(&present, 1, s->flagsoffset + index) != 1 || !present)
+        return false;
+    s->touch();
+    return s->io->pread(data, tilebytes, s->dataoffset + index * s->stride)
+           == tilebytes;
+}
+
+
+
+const char*
+ImageCacheDiskCache::map_tile(const std::string& key, int64_t ntiles,
+                              int64_t index, size_t tilebytes,
+                              std::shared_ptr<void>& keepalive)
+{
+    std::shared_ptr<Slab> s = slab(key, ntiles, tilebytes, false);
+    if (!s || !s->mapping)
+        return nullptr;
+    if (!((volatile const char*)s->mapping)[s->flagsoffset + index])
+        return nullptr;
+    // Pairs with the writer storing the pixels before the flag
+    std::atomic_thread_fence(std::memory_order_acquire);
+    s->touch();
+    keepalive = s;
+    return s->mapping + s->dataoffset + index * s->stride;
+}
+
+
+
+bool
+ImageCacheDiskCache::write_tile(const std::string& key, int64_t ntiles,
+                                int64_t index, size_t tilebytes,
+                                const void* data)
+{
+    std::shared_ptr<Slab> s = slab(key, ntiles, tilebytes, true);
+    if (!s || !s->io)
+        return false;
+    char present = 0;
+    if (s->io->pread(&present, 1, s->flagsoffset + index) == 1 && present)
+        return false;  // Already there, from an earlier eviction
+    // Write the pixels before marking them present, so that a reader --
+    // possibly in another process -- never finds a partial tile.
+    if (s->io->pwrite(data, tilebytes, s->dataoffset + index * s->stride)
+        != tilebytes)
+        return false;
+    present = 1;
+    return s->io->pwrite(&present, 1, s->flagsoffset + index) == 1;
+}
+
+
+
+// A shared tile pool segment is a header (including the table of the
+// processes attached to it), the table of slots (control word and key of
+// each), each attached process's pin count of every slot, and then the
+// slots' pixels, each slot padded like a disk cache slab tile.
+static const char sharedpool_magic[8] = { 'O', 'I', 'I', 'O',
+                                          'S', 'H', 'M', '2' };
+
+// Slots in each set of the shared tile pool
+static const int64_t sharedpool_ways = 16;
+
+// Most processes (strictly, ImageCaches) attached to a shared tile pool
+static const int sharedpool_owners = 64;
+
+// Fields of a slot's control word. The low 32 bits count its pins. A
+// slot with neither state bit set is empty.
+static const uint64_t sharedslot_pins  = 0xffffffffULL;
+static const uint64_t sharedslot_busy  = 1ULL << 32;  // Being filled in
+static const uint64_t sharedslot_ready = 1ULL << 33;  // Holds a tile
+static const uint64_t sharedslot_used  = 1ULL << 34;  // Recently used
+// A busy slot also records which owner is filling it in.
+static const int sharedslot_owner_shift = 40;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free
+                  && std::atomic<int64_t>::is_always_lock_free
+                  && std::atomic<uint32_t>::is_always_lock_free,
+              "shared tile pool needs address-free atomics");
+
+
+
+struct ImageCacheSharedPool::Header {
+    char magic[8];
+    uint64_t nsets;
+    uint64_t slotbytes;
+    uint64_t stride;               ///< Bytes from one slot to the next
+    uint64_t pinsoffset;           ///< Where the pin counts start
+    uint64_t dataoffset;           ///< Where the slot pixels start
+    std::atomic<uint32_t> ready;   ///< Set once the rest is filled in
+    /// Process id of each attached owner; 0 if the entry is free, -1
+    /// while a dead owner's pins are being taken back.
+    std::atomic<int64_t> owners[sharedpool_owners];
+};
+
+struct ImageCacheSharedPool::Slot {
+    std::atomic<uint64_t> control;  ///< State, used bit and pins
+    std::atomic<uint64_t> key0;     ///< Two hashes of the tile's key
+    std::atomic<uint64_t> key1;
+    uint64_t unused;
+};
+
+
+
+#ifndef _WIN32
+static bool
+sharedpool_owner_dead(int64_t pid)
+{
+    // Processes sharing a pool must share a pid namespace, or this can't
+    // tell that the others are alive.
+    return kill(pid_t(pid), 0) != 0 && errno == ESRCH;
+}
+#endif
+
+
+
+static void
+sharedpool_key(const std::string& key, int64_t index, uint64_t& k0,
+               uint64_t& k1)
+{
+    k0 = farmhash::Hash64WithSeed(key.data(), key.size(), uint64_t(index));
+    k1 = farmhash::Hash64WithSeed(key.data(), key.size(), ~uint64_t(index));
+}
+
+
+
+ImageCacheSharedPool::ImageCacheSharedPool(string_view name,
+                                           size_t poolbytes,
+                                           size_t slotbytes)
+    : m_name(name)
+{
+#ifdef _WIN32
+    m_err = "shared tile pools are not supported on Windows";
+#else
+    int64_t stride     = diskcache_tile_stride(slotbytes);
+    int64_t nsets      = std::max(int64_t(poolbytes)
+                                      / (stride * sharedpool_ways),
+                                  int64_t(1));
+    int64_t nslots     = nsets * sharedpool_ways;
+    int64_t pinsoffset = round_to_multiple(int64_t(sizeof(Header)
+                                                   + nslots * sizeof(Slot)),
+                                           int64_t(64));
+    int64_t dataoffset = round_to_multiple(
+        pinsoffset + sharedpool_owners * nslots * int64_t(sizeof(uint32_t)),
+        int64_t(4096));
+    size_t size = size_t(dataoffset + nslots * stride);
+
+    // Exactly one process creates and sizes the segment; the rest find it
+    // already there. Only the user's own processes may attach to it.
+    bool created = true;
+    int fd = shm_open(m_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        created = false;
+        fd      = shm_open(m_name.c_str(), O_RDWR, 0);
+    }
+    if (fd < 0) {
+        m_err = Strutil::fmt::format("shm_open failed: {}", strerror(errno));
+        return;
+    }
+    if (created && ftruncate(fd, off_t(size)) != 0) {
+        m_err = Strutil::fmt::format("could not size the segment: {}",
+                                     strerror(errno));
+        close(fd);
+        shm_unlink(m_name.c_str());
+        return;
+    }
+    if (!created) {
+        // It may still be getting sized by its creator. Give that a
+        // moment, then take the segment at whatever size it was made.
+        struct stat st {};
+        for (int i = 0; i < 100; ++i) {
+            if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(Header))
+                break;
+            Sysutil::usleep(10000);  // 10 ms
+        }
+        size = size_t(st.st_size);
+    }
+    void* m = size >= sizeof(Header) ? mmap(nullptr, size,
+                                            PROT_READ | PROT_WRITE,
+                                            MAP_SHARED, fd, 0)
+                                     : MAP_FAILED;
+    // Remember which segment this is, for unlink().
+    struct stat st {};
+    if (fstat(fd, &st) == 0) {
+        m_dev = uint64_t(st.st_dev);
+        m_ino = uint64_t(st.st_ino);
+    }
+    close(fd);  // The mapping stays valid
+    if (m == MAP_FAILED) {
+        m_err = "could not map the segment";
+        return;
+    }
+    Header* header = (Header*)m;
+    if (created) {
+        // The segment starts out zeroed, so every slot is empty.
+        memcpy(header->magic, sharedpool_magic, sizeof(header->magic));
+        header->nsets      = uint64_t(nsets);
+        header->slotbytes  = slotbytes;
+        header->stride     = uint64_t(stride);
+        header->pinsoffset = uint64_t(pinsoffset);
+        header->dataoffset = uint64_t(dataoffset);
+        header->ready.store(1, std::memory_order_release);
+    } else {
+        for (int i = 0; i < 100; ++i) {
+            if (header->ready.load(std::memory_order_acquire))
+                break;
+            Sysutil::usleep(10000);  // 10 ms
+        }
+        // Trust the layout only once it's been checked against the size.
+        uint64_t n = header->nsets * uint64_t(sharedpool_ways);
+        bool ok    = header->ready.load(std::memory_order_acquire)
+                  && !memcmp(header->magic, sharedpool_magic,
+                             sizeof(header->magic))
+                  && n > 0
+                  && int64_t(header->stride)
+                         >= diskcache_tile_stride(size_t(header->slotbytes))
+                  && header->pinsoffset >= sizeof(Header) + n * sizeof(Slot)
+                  && header->dataoffset
+                         >= header->pinsoffset
+                                + sharedpool_owners * n * sizeof(uint32_t)
+                  && header->dataoffset + n * header->stride <= size;
+        if (!ok) {
+            munmap(m, size);
+            m_err = "not a tile pool, or one that is still being set up";
+            return;
+        }
+    }
+    m_base      = (char*)m;
+    m_mapsize   = size;
+    m_slotbytes = size_t(header->slotbytes);
+    m_nsets     = int64_t(header->nsets);
+
+    // Clean up after any owners that died, then take an entry of our own
+    // to count our pins in.
+    reclaim_dead_owners();
+    for (int i = 0; i < sharedpool_owners && m_owner < 0; ++i) {
+        int64_t expected = 0;
+        if (header->owners[i].compare_exchange_strong(expected,
+                                                      int64_t(getpid())))
+            m_owner = i;
+    }
+    if (m_owner < 0) {
+        munmap(m, size);
+        m_base = nullptr;
+        m_err  = Strutil::fmt::format("more than {} processes attached",
+                                      sharedpool_owners);
+        return;
+    }
+#endif
+}
+
+
+
+ImageCacheSharedPool::~ImageCacheSharedPool()
+{
+#ifndef _WIN32
+    if (!m_base)
+        return;
+    // Every pin we took has been dropped by now. If nobody else is still
+    // attached, the segment goes too. (A process attaching just now may
+    // be left with a segment nobody else can find; later ones start a
+    // new one.)
+    Header* header = (Header*)m_base;
+    header->owners[m_owner].store(0, std::memory_order_release);
+    bool attached = false;
+    for (auto& owner : header->owners) {
+        int64_t pid = owner.load(std::memory_order_acquire);
+        attached |= pid < 0 || (pid > 0 && !sharedpool_owner_dead(pid));
+    }
+    if (!attached)
+        unlink();
+    munmap(m_base, m_mapsize);
+#endif
+}
+
+
+
+void
+ImageCacheSharedPool::unlink()
+{
+#ifndef _WIN32
+    // Only remove the name if it's still that of our segment; another
+    // process may have made a new one since ours was unlinked.
+    int fd = shm_open(m_name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return;
+    struct stat st {};
+    bool ours = fstat(fd, &st) == 0 && uint64_t(st.st_dev) == m_dev
+                && uint64_t(st.st_ino) == m_ino;
+    close(fd);
+    if (ours)
+        shm_unlink(m_name.c_str());
+#endif
+}
+
+
+
+bool
+ImageCacheSharedPool::reclaim_dead_owners()
+{
+    bool reclaimed = false;
+#ifndef _WIN32
+    Header* header = (Header*)m_base;
+    int64_t nslots = m_nsets * sharedpool_ways;
+    for (int i = 0; i < sharedpool_owners; ++i) {
+        int64_t pid = header->owners[i].load(std::memory_order_acquire);
+        if (pid <= 0 || !sharedpool_owner_dead(pid))
+            continue;
+        // Only one process cleans up after each dead one.
+        if (!header->owners[i].compare_exchange_strong(
+                pid, -1, std::memory_order_acquire))
+            continue;
+        for (int64_t s = 0; s < nslots; ++s) {
+            Slot* sl   = slot(s);
+            uint32_t n = pins(i, s).exchange(0, std::memory_order_relaxed);
+            uint64_t c = sl->control.load(std::memory_order_acquire);
+            if ((c & sharedslot_busy)
+                && int((c >> sharedslot_owner_shift) & 0xff) == i) {
+                abandon(s);  // It died reading the tile in
+            } else if (n) {
+                // An owner's count is raised after it takes a pin and
+                // lowered before it drops one, so it's never more than the
+                // pins it holds. (Dying in between leaves one pin behind.)
+                sl->control.fetch_sub(n, std::memory_order_release);
+            }
+        }
+        header->owners[i].store(0, std::memory_order_release);
+        reclaimed = true;
+    }
+#endif
+    return reclaimed;
+}
+
+
+
+bool
+ImageCacheSharedPool::reclaim_due()
+{
+    int64_t now  = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count();
+    int64_t next = m_next_reclaim.load(std::memory_order_relaxed);
+    return now >= next
+           && m_next_reclaim.compare_exchange_strong(
+               next, now + 1000, std::memory_order_relaxed);
+}
+
+
+
+ImageCacheSharedPool::Slot*
+ImageCacheSharedPool::slot(int64_t s) const
+{
+    return (Slot*)(m_base + sizeof(Header)) + s;
+}
+
+
+
+std::atomic<uint32_t>&
+ImageCacheSharedPool::pins(int owner, int64_t s) const
+{
+    const Header* header = (const Header*)m_base;
+    auto counts = (std::atomic<uint32_t>*)(m_base + header->pinsoffset);
+    return counts[owner * m_nsets * sharedpool_ways + s];
+}
+
+
+
+char*
+ImageCacheSharedPool::slotdata(int64_t s) const
+{
+    const Header* header = (const Header*)m_base;
+    return m_base + header->dataoffset + s * header->stride;
+}
+
+
+
+void
+ImageCacheSharedPool::hold(int64_t s, std::shared_ptr<void>& keepalive)
+{
+    // The last copy of keepalive drops the pin, and the last pin (or the
+    // ImageCache) to go unmaps the pool.
+    std::shared_ptr<ImageCacheSharedPool> self = shared_from_this();
+    keepalive.reset(slotdata(s), [self, s](void*) {
+        self->pins(self->m_owner, s).fetch_sub(1, std::memory_order_relaxed);
+        self->slot(s)->control.fetch_sub(1, std::memory_order_release);
+    });
+}
+
+
+
+const char*
+ImageCacheSharedPool::find_tile(const std::string& key, int64_t index,
+                                std::shared_ptr<void>& keepalive)
+{
+    uint64_t k0, k1;
+    sharedpool_key(key, index, k0, k1);
+    int64_t first = int64_t(k0 % uint64_t(m_nsets)) * sharedpool_ways;
+    for (int64_t s = first; s < first + sharedpool_ways; ++s) {
+        Slot* sl = slot(s);
+        if (sl->key0.load(std::memory_order_relaxed) != k0
+            || sl->key1.load(std::memory_order_relaxed) != k1)
+            continue;
+        // Pin it, if it holds a finished tile. Pairs with the release in
+        // publish(), so that we see the pixels.
+        uint64_t c  = sl->control.load(std::memory_order_relaxed);
+        bool pinned = false;
+        while ((c & sharedslot_ready) && !pinned)
+            pinned = sl->control.compare_exchange_weak(
+                c, (c + 1) | sharedslot_used, std::memory_order_acquire,
+                std::memory_order_relaxed);
+        if (!pinned)
+            continue;
+        // The slot may have been given to another tile between checking
+        // its key and pinning it.
+        if (sl->key0.load(std::memory_order_relaxed) != k0
+            || sl->key1.load(std::memory_order_relaxed) != k1) {
+            sl->control.fetch_sub(1, std::memory_order_release);
+            continue;
+        }
+        pins(m_owner, s).fetch_add(1, std::memory_order_relaxed);
+        hold(s, keepalive);
+        return slotdata(s);
+    }
+    return nullptr;
+}
+
+
+
+char*
+ImageCacheSharedPool::reserve_tile(const std::string& key, int64_t index,
+                                   int64_t& slotindex)
+{
+    uint64_t k0, k1;
+    sharedpool_key(key, index, k0, k1);
+    int64_t first = int64_t(k0 % uint64_t(m_nsets)) * sharedpool_ways;
+    // First look for an empty slot. Failing that, take an unpinned tile
+    // that hasn't been used lately -- a clock sweep over the set: tiles
+    // used since the last sweep lose their used bit and survive this one.
+    // If every slot is pinned or busy, some of that may have been left
+    // behind by processes that died, so (at most once a second) take it
+    // back and look again.
+    uint64_t busy = sharedslot_busy
+                    | (uint64_t(m_owner) << sharedslot_owner_shift);
+    for (int pass = 0; pass < 6; ++pass) {
+        if (pass == 3 && !(reclaim_due() && reclaim_dead_owners()))
+            break;
+        for (int64_t s = first; s < first + sharedpool_ways; ++s) {
+            Slot* sl   = slot(s);
+            uint64_t c = sl->control.load(std::memory_order_relaxed);
+            if (pass % 3 == 0 ? c != 0
+                              : (c & (sharedslot_busy | sharedslot_pins))
+                                || !(c & sharedslot_ready))
+                continue;
+            if (c & sharedslot_used) {
+                sl->control.compare_exchange_strong(
+                    c, c & ~sharedslot_used, std::memory_order_relaxed);
+                continue;
+            }
+            if (sl->control.compare_exchange_strong(
+                    c, busy, std::memory_order_acquire,
+                    std::memory_order_relaxed)) {
+                // Nobody reads a busy slot, so the key and pixels may
+                // change until publish() or abandon().
+                sl->key0.store(k0, std::memory_order_relaxed);
+                sl->key1.store(k1, std::memory_order_relaxed);
+                slotindex = s;
+                return slotdata(s);
+            }
+        }
+    }
+    return nullptr;
+}
+
+
+
+void
+ImageCacheSharedPool::publish(int64_t s, std::shared_ptr<void>& keepalive)
+{
+    // Ready, recently used, and pinned once on behalf of our caller.
+    slot(s)->control.store(sharedslot_ready | sharedslot_used | 1,
+                           std::memory_order_release);
+    pins(m_owner, s).fetch_add(1, std::memory_order_relaxed);
+    hold(s, keepalive);
+}
+
+
+
+void
+ImageCacheSharedPool::abandon(int64_t s)
+{
+    Slot* sl = slot(s);
+    sl->key0.store(0, std::memory_order_relaxed);
+    sl->key1.store(0, std::memory_order_relaxed);
+    sl->control.store(0, std::memory_order_release);
+}
+
+
+
+// The header catalog file is the 8-byte magic followed by records, each a
+// uint64 byte count and then (native endian) the file name, mtime, size,
+// format name, and the XML spec of each subimage and MIP level, where
+// strings and lists are preceded by their uint32 length. A truncated last
+// record (from a crash during an append) is ignored. Records for a file
+// that appears again later are dead, and the catalog is rewritten without
+// them when it is loaded and they outnumber the live ones.
+static const char catalog_magic[8] = { 'O', 'I', 'I', 'O',
+                                       'H', 'C', 'T', '1' };
+
+namespace {
+
+struct CatalogWriter {
+    std::string buf;
+    template<typename T> void put(T val)
+    {
+        buf.append((const char*)&val, sizeof(T));
+    }
+    void put_string(string_view s)
+    {
+        put(uint32_t(s.size()));
+        buf.append(s.data(), s.size());
+    }
+};
+
+struct CatalogReader {
+    const char* p;
+    const char* end;
+    template<typename T> bool get(T& val)
+    {
+        if (end - p < ptrdiff_t(sizeof(T)))
+            return false;
+        memcpy(&val, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+    bool get(std::string& s)
+    {
+        uint32_t len;
+        if (!get(len) || end - p < ptrdiff_t(len))
+            return false;
+        s.assign(p, len);
+        p += len;
+        return true;
+    }
+};
+
+// The whole record for one catalog entry, including its byte count.
+static std::string
+catalog_record(ustring filename, const ImageCacheCatalog::Entry& entry)
+{
+    CatalogWriter rec;
+    rec.put_string(filename);
+    rec.put(entry.mtime);
+    rec.put(entry.size);
+    rec.put_string(entry.format);
+    rec.put(uint32_t(entry.specs.size()));
+    for (auto& levels : entry.specs) {
+        rec.put(uint32_t(levels.size()));
+        for (auto& xml : levels)
+            rec.put_string(xml);
+    }
+    CatalogWriter out;
+    out.put(uint64_t(rec.buf.size()));
+    out.buf += rec.buf;
+    return out.buf;
+}
+
+}  // namespace
+
+
+
+ImageCacheCatalog::ImageCacheCatalog(string_view path)
+    : m_path(path)
+{
+    std::string contents;
+    uint64_t filesize = Filesystem::exists(m_path)
+                            ? Filesystem::file_size(m_path)
+                            : 0;
+    if (filesize) {
+        contents.resize(filesize);
+        contents.resize(
+            Filesystem::read_bytes(m_path, &contents[0], contents.size()));
+        if (contents.size() < 8 || memcmp(contents.data(), catalog_magic, 8))
+            return;  // Not a catalog -- don't touch it
+    }
+    CatalogReader in { contents.data() + std::min(contents.size(), size_t(8)),
+                       contents.data() + contents.size() };
+    uint64_t reclen;
+    size_t nrecords = 0;
+    while (in.get(reclen) && uint64_t(in.end - in.p) >= reclen) {
+        CatalogReader rec { in.p, in.p + reclen };
+        in.p += reclen;
+        ++nrecords;
+        std::string name;
+        uint32_t nsubimages = 0;
+        auto entry          = std::make_shared<Entry>();
+        bool ok = rec.get(name) && rec.get(entry->mtime) && rec.get(entry->size)
+                  && rec.get(entry->format) && rec.get(nsubimages);
+        entry->specs.resize(ok ? nsubimages : 0);
+        for (auto& levels : entry->specs) {
+            uint32_t nmips = 0;
+            ok &= rec.get(nmips);
+            levels.resize(ok ? nmips : 0);
+            for (auto& xml : levels)
+                ok &= rec.get(xml);
+        }
+        if (ok && nsubimages)
+            m_entries[ustring(name)] = entry;
+    }
+    // Rewrite the catalog once dead records make up half of it, and always
+    // after a torn record, which would swallow whatever is appended to it.
+    if (in.p != in.end || (nrecords && nrecords >= 2 * m_entries.size()))
+        compact();
+    m_file = Filesystem::fopen(m_path, "ab");
+    if (m_file && !filesize)
+        fwrite(catalog_magic, 1, 8, m_file);
+}
+
+
+
+ImageCacheCatalog::~ImageCacheCatalog()
+{
+    if (m_file)
+        fclose(m_file);
+}
+
+
+
+std::shared_ptr<const ImageCacheCatalog::Entry>
+ImageCacheCatalog::find(ustring filename, int64_t mtime, uint64_t size) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_entries.find(filename);
+    if (found == m_entries.end() || found->second->mtime != mtime
+        || found->second->size != size)
+        return {};
+    return found->second;
+}
+
+
+
+void
+ImageCacheCatalog::compact()
+{
+    // Write the live entries to a new file and move it over the old one,
+    // so that other processes never see a partly written catalog.
+    std::string tmp = m_path + "." + Filesystem::unique_path() + ".tmp";
+    FILE* file      = Filesystem::fopen(tmp, "wb");
+    if (!file)
+        return;
+    bool ok = fwrite(catalog_magic, 1, 8, file) == 8;
+    for (auto& e : m_entries) {
+        std::string rec = catalog_record(e.first, *e.second);
+        ok &= fwrite(rec.data(), 1, rec.size(), file) == rec.size();
+    }
+    ok &= (fclose(file) == 0);
+    std::string err;
+    if (!ok || !Filesystem::rename(tmp, m_path, err))
+        Filesystem::remove(tmp, err);
+}
+
+
+
+void
+ImageCacheCatalog::add(ustring filename, std::shared_ptr<const Entry> entry)
+{
+    std::string rec = catalog_record(filename, *entry);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries[filename] = std::move(entry);
+    if (m_file) {
+        // Write and flush each record whole, so that other processes
+        // sharing the catalog see complete records.
+        fwrite(rec.data(), 1, rec.size(), m_file);
+        fflush(m_file);
+    }
+}
+
+
+
+ImageCacheImpl::ImageCacheImpl()
+{
+    imagecache_id = imagecache_next_id.fetch_add(1);
+    init();
+}
+
+
+
+void
+ImageCacheImpl::set_max_open_files(int max_open_files)
+{
+    // Clamp to somewhat less than the maximum number of files allowed
+    // by the system.
+    int m = int(std::min(Sysutil::max_open_files(),
+                         size_t(std::numeric_limits<int>::max())));
+    m     = std::max(10, m - 5 * int(Sysutil::hardware_concurrency()));
+    m_max_open_files = std::min(max_open_files, m);
+    // std::cout << "clamped max_open_files = " << m_max_open_files << "\n";
+}
+
+
+
+void
+ImageCacheImpl::init()
+{
+    set_max_open_files(100);
+    m_max_memory_bytes     = 1024LL * 1024 * 1024;  // 1 GB default cache size
+    m_autotile             = 0;
+    m_autoscanline         = false;
+    m_automip              = false;
+    m_forcefloat           = false;
+    m_accept_untiled       = true;
+    m_accept_unmipped      = true;
+    m_deduplicate          = true;
+    m_unassociatedalpha    = false;
+    m_failure_retries      = 0;
+    m_latlong_y_up_default = true;
+    m_Mw2c.makeIdentity();
+    m_colorspace              = ustring("scene_linear");
+    m_mem_used                = 0;
+    m_statslevel              = 0;
+    m_max_errors_per_file     = 100;
+    m_stat_tiles_created      = 0;
+    m_stat_tiles_current      = 0;
+    m_stat_tiles_peak         = 0;
+    m_stat_open_files_created = 0;
+    m_stat_open_files_current = 0;
+    m_stat_open_files_peak    = 0;
+    m_max_open_files_strict   = false;
+    m_prefetch_threads        = 2;
+    m_readahead               = 0;
+    m_microcache_size         = 0;
+    m_get_pixels_threads      = 0;
+    m_prefetch_queued         = 0;
+    m_prefetch_stop           = false;
+    m_eviction_policy         = TileEvictionPolicy::Clock;
+    m_eviction_cursor         = 0;
+    m_compress_tiles          = false;
+    m_compressed_mem          = 0;
+    m_diskcache_mmap          = false;
+    m_diskcache_max_MB        = 10240;
+    m_mapped_mem              = 0;
+    m_shared_pool_MB          = 4096;
+    m_shared_pool_tile_KB     = 64;
+    m_shared_mem              = 0;
+    m_deduplicate_tiles       = false;
+    m_dedup_mem               = 0;
+    m_access_stats            = false;
+
+    // Allow environment variable to override default options
+    const char* options = getenv("OPENIMAGEIO_IMAGECACHE_OPTIONS");
+    if (options)
+        attribute("options", options);
+}
+
+
+
+ImageCacheImpl::~ImageCacheImpl()
+{
+    // Prefetch workers refer to our per-thread infos and tile cache, so
+    // they must be finished before anything else is torn down.
+    stop_prefetch_threads();
+    printstats();
+    // All the per_thread_infos get destroyed here, regardless of if they were created implicitly
+    // or manually by the caller
+    {
+        spin_lock lock(m_perthread_info_mutex);
+        m_all_perthread_info.clear();
+    }
+    // Erase any leftover errors from this thread
+    // TODO: can we clear other threads' errors?
+    // TODO: potentially unsafe due to the static destruction order fiasco
+    // imcache_error_messages.erase(imagecache_id);
+}
+
+
+
+void
+ImageCacheImpl::mergestats(ImageCacheStatistics& stats) const
+{
+    stats.init();
+    spin_lock lock(m_perthread_info_mutex);
+    for (auto& p : m_all_perthread_info)
+        if (p)
+            stats.merge(p->m_stats);
+}
+
+
+
+std::string
 ImageCacheImpl::onefile_stat_line(const ImageCacheFileRef& file, int i,
                                   bool includestats) const
 {
@@ -2205,6 +3738,20 @@ ImageCacheImpl::getstats(int level) const
         INTOPT(deduplicate);
         INTOPT(unassociatedalpha);
         INTOPT(failure_retries);
+        INTOPT(prefetch_threads);
+        INTOPT(readahead);
+        INTOPT(microcache_size);
+        INTOPT(get_pixels_threads);
+        BOOLOPT(compress_tiles);
+        STROPT(diskcache_dir);
+        BOOLOPT(diskcache_mmap);
+        INTOPT(diskcache_max_MB);
+        STROPT(header_catalog);
+        STROPT(shared_pool);
+        INTOPT(shared_pool_MB);
+        INTOPT(shared_pool_tile_KB);
+        BOOLOPT(deduplicate_tiles);
+        BOOLOPT(access_stats);
         opt += Strutil::fmt::format("openexr:core={} ",
                                     OIIO::get_int_attribute("openexr:core"));
 #undef BOOLOPT
@@ -2253,6 +3800,17 @@ ImageCacheImpl::getstats(int level) const
             OIIO::print(out, "    File open time only : {}\n",
                         Strutil::timeintervalformat(stats.fileopen_time));
         }
+        if (stats.preload_files || level > 2)
+            OIIO::print(out, "    Header preload : {} files in {}\n",
+                        stats.preload_files,
+                        Strutil::timeintervalformat(stats.preload_time));
+        if (m_header_catalog.size() || level > 2)
+            OIIO::print(out, "    Header catalog : {} hits, {} misses\n",
+                        stats.catalog_hits, stats.catalog_misses);
+        if (stats.udim_inventory_time > 0.001 || level > 2)
+            OIIO::print(out, "    UDIM inventory : {}, tile resolution : {}\n",
+                        Strutil::timeintervalformat(stats.udim_inventory_time),
+                        Strutil::timeintervalformat(stats.udim_resolve_time));
         if (stats.file_locking_time > 0.001 || level > 2)
             OIIO::print(out, "    File mutex locking time : {}\n",
                         Strutil::timeintervalformat(stats.file_locking_time));
@@ -2266,6 +3824,13 @@ ImageCacheImpl::getstats(int level) const
                         int(m_stat_tiles_peak));
             OIIO::print(out, "    total tile requests : {}\n",
                         stats.find_tile_calls);
+            if (stats.find_tile_microcache_assoc_hits)
+                OIIO::print(out,
+                            "    set-associative micro-cache hits : {} "
+                            "({:.1f}%)\n",
+                            stats.find_tile_microcache_assoc_hits,
+                            100.0 * stats.find_tile_microcache_assoc_hits
+                                / (double)stats.find_tile_calls);
             if (stats.find_tile_microcache_misses)
                 OIIO::print(out, "    micro-cache misses : {} ({:.1f}%)\n",
                             stats.find_tile_microcache_misses,
@@ -2279,6 +3844,86 @@ ImageCacheImpl::getstats(int level) const
             OIIO::print(out, "    redundant reads: {} tiles, {}\n",
                         total_redundant_tiles,
                         Strutil::memformat(total_redundant_bytes));
+            OIIO::print(out, "    eviction policy {}: {} tiles evicted",
+                        eviction_policy_names[int(m_eviction_policy)],
+                        stats.tiles_evicted);
+            if (m_eviction_policy == TileEvictionPolicy::SLRU)
+                OIIO::print(out, ", {} promoted", stats.tiles_promoted);
+            if (stats.tiles_unevictable)
+                OIIO::print(out, ", {} skipped as unevictable",
+                            stats.tiles_unevictable);
+            OIIO::print(out, "\n");
+            for (int p = 0; p < ImageCacheStatistics::npolicies; ++p)
+                if (stats.policy_lookups[p])
+                    OIIO::print(out,
+                                "      main cache hit rate with {} : "
+                                "{:.1f}% of {} lookups\n",
+                                eviction_policy_names[p],
+                                100.0
+                                    * (1.0
+                                       - double(stats.policy_misses[p])
+                                             / stats.policy_lookups[p]),
+                                stats.policy_lookups[p]);
+            if (stats.prefetch_requests || level > 2)
+                OIIO::print(out,
+                            "    prefetch: {} requested, {} read, {} dropped\n",
+                            stats.prefetch_requests, stats.prefetch_reads,
+                            stats.prefetch_dropped);
+            if (stats.tile_wait_time > 0.001 || level > 2)
+                OIIO::print(out, "    wait for in-flight tiles : {}\n",
+                            Strutil::timeintervalformat(
+                                stats.tile_wait_time));
+            if (stats.batched_reads || level > 2)
+                OIIO::print(out,
+                            "    batched reads: {} tiles in {} calls\n",
+                            stats.batched_tiles, stats.batched_reads);
+            if (m_diskcache_dir.size() || level > 2) {
+                OIIO::print(out,
+                            "    disk cache: {} hits, {} misses, "
+                            "{} tiles spilled\n",
+                            stats.diskcache_hits, stats.diskcache_misses,
+                            stats.diskcache_spills);
+                OIIO::print(out, "      {} read back, {} written\n",
+                            Strutil::memformat(stats.diskcache_bytes_read),
+                            Strutil::memformat(
+                                stats.diskcache_bytes_written));
+                if (m_diskcache_mmap || level > 2)
+                    OIIO::print(out,
+                                "      {} tiles used in place, {} mapped\n",
+                                stats.tiles_mapped,
+                                Strutil::memformat(m_mapped_mem));
+            }
+            if (m_shared_pool.size() || level > 2)
+                OIIO::print(out,
+                            "    shared tile pool: {} tiles found, "
+                            "{} stored, {} in use\n",
+                            stats.shared_tiles_found,
+                            stats.shared_tiles_stored,
+                            Strutil::memformat(m_shared_mem));
+            if (m_deduplicate_tiles || level > 2)
+                OIIO::print(out,
+                            "    deduplicated tiles: {} sharing pixels, "
+                            "{} saved, {} shared\n",
+                            stats.tiles_deduplicated,
+                            Strutil::memformat(stats.dedup_bytes_saved),
+                            Strutil::memformat(m_dedup_mem));
+            if (m_compress_tiles || level > 2) {
+                OIIO::print(out,
+                            "    compressed tiles: {} packed, {} unpacked, "
+                            "{} resident\n",
+                            stats.tiles_compressed, stats.tiles_decompressed,
+                            Strutil::memformat(m_compressed_mem));
+                if (stats.compressed_bytes)
+                    OIIO::print(out,
+                                "      {} packed into {} ({:.2f}:1), "
+                                "unpacking time {}\n",
+                                Strutil::memformat(stats.compressed_raw_bytes),
+                                Strutil::memformat(stats.compressed_bytes),
+                                double(stats.compressed_raw_bytes)
+                                    / stats.compressed_bytes,
+                                Strutil::timeintervalformat(
+                                    stats.decompress_time));
+            }
         }
         OIIO::print(out, "    Peak cache memory : {}\n",
                     Strutil::memformat(m_mem_used));
@@ -2312,6 +3957,22 @@ ImageCacheImpl::getstats(int level) const
                 continue;
             }
             OIIO::print(out, "{}\n", onefile_stat_line(file, i + 1));
+            if (!m_access_stats)
+                continue;
+            // Where the file's tile traffic went, level by level
+            for (int m = 0; m < file->mipaccess_levels(); ++m) {
+                const ImageCacheFile::MipAccessStats* a = file->mipaccess(m);
+                if (!a->hits && !a->misses)
+                    continue;
+                OIIO::print(out,
+                            "          mip {:2}: {:8} hits {:7} misses "
+                            "({} redundant), I/O {}, wait {}, unpack {}\n",
+                            m, a->hits.load(), a->misses.load(),
+                            a->redundant.load(),
+                            Strutil::timeintervalformat(a->io_time),
+                            Strutil::timeintervalformat(a->wait_time),
+                            Strutil::timeintervalformat(a->decompress_time));
+            }
         }
         OIIO::print(out,
                     "\n  Tot:  {:4}  {:7}   {:8.1f}   ({:5} {:6.1f}) {:9}\n",
@@ -2438,6 +4099,96 @@ ImageCacheImpl::getstats(int level) const
 
 
 
+std::string
+ImageCacheImpl::getstats_json() const
+{
+    ImageCacheStatistics stats;
+    mergestats(stats);
+    std::ostringstream out;
+    out.imbue(std::locale::classic());  // Force "C" locale with '.' decimal
+    OIIO::print(out, "{{\n");
+    OIIO::print(out,
+                "  \"totals\": {{ \"find_tile_calls\": {}, "
+                "\"cache_misses\": {}, \"bytes_read\": {}, "
+                "\"fileio_time\": {}, \"tile_wait_time\": {}, "
+                "\"decompress_time\": {} }},\n",
+                stats.find_tile_calls, stats.find_tile_cache_misses,
+                stats.bytes_read, stats.fileio_time, stats.tile_wait_time,
+                stats.decompress_time);
+
+    // Each thread's share of the time spent on I/O and waiting for it
+    OIIO::print(out, "  \"threads\": [");
+    {
+        spin_lock lock(m_perthread_info_mutex);
+        const char* sep = "\n";
+        for (auto& p : m_all_perthread_info) {
+            if (!p)
+                continue;
+            const ImageCacheStatistics& s(p->m_stats);
+            OIIO::print(out,
+                        "{}    {{ \"find_tile_calls\": {}, "
+                        "\"cache_misses\": {}, \"fileio_time\": {}, "
+                        "\"tile_wait_time\": {}, "
+                        "\"file_locking_time\": {} }}",
+                        sep, s.find_tile_calls, s.find_tile_cache_misses,
+                        s.fileio_time, s.tile_wait_time, s.file_locking_time);
+            sep = ",\n";
+        }
+    }
+    OIIO::print(out, "\n  ],\n");
+
+    // Each file, with its levels' tile traffic if "access_stats" is set
+    std::vector<ImageCacheFileRef> files;
+    for (FilenameMap::iterator f = m_files.begin(); f != m_files.end(); ++f)
+        files.push_back(f->second);
+    std::sort(files.begin(), files.end(), filename_compare);
+    OIIO::print(out, "  \"files\": [");
+    const char* filesep = "\n";
+    for (const ImageCacheFileRef& file : files) {
+        if (file->is_udim() || file->broken() || !file->validspec()
+            || file->subimages() == 0)
+            continue;
+        OIIO::print(out,
+                    "{}    {{ \"name\": \"{}\", \"format\": \"{}\", "
+                    "\"opens\": {}, \"tiles_read\": {}, "
+                    "\"bytes_read\": {}, \"redundant_tiles\": {}, "
+                    "\"redundant_bytes\": {}, \"io_time\": {},\n"
+                    "      \"mips\": [",
+                    filesep, Strutil::escape_chars(file->filename()),
+                    file->fileformat(), file->timesopened(), file->tilesread(),
+                    file->bytesread(), file->redundant_tiles(),
+                    file->redundant_bytesread(), file->iotime());
+        filesep = ",\n";
+        const SubimageInfo& si(file->subimageinfo(0));
+        for (int m = 0, nmips = file->miplevels(0); m < nmips; ++m) {
+            const ImageDims& dims(si.leveldims(m));
+            OIIO::print(out,
+                        "{}\n        {{ \"level\": {}, \"width\": {}, "
+                        "\"height\": {}, \"tile_width\": {}, "
+                        "\"tile_height\": {}, \"reads\": {}",
+                        m ? "," : "", m, dims.width, dims.height,
+                        dims.tile_width, dims.tile_height,
+                        m < int(file->mipreadcount().size())
+                            ? file->mipreadcount()[m]
+                            : size_t(0));
+            if (const ImageCacheFile::MipAccessStats* a = file->mipaccess(m))
+                OIIO::print(out,
+                            ", \"hits\": {}, \"misses\": {}, "
+                            "\"redundant\": {}, \"io_time\": {}, "
+                            "\"wait_time\": {}, \"decompress_time\": {}",
+                            a->hits.load(), a->misses.load(),
+                            a->redundant.load(), a->io_time.load(),
+                            a->wait_time.load(), a->decompress_time.load());
+            OIIO::print(out, " }}");
+        }
+        OIIO::print(out, " ] }}");
+    }
+    OIIO::print(out, "\n  ]\n}}\n");
+    return out.str();
+}
+
+
+
 void
 ImageCacheImpl::printstats() const
 {
@@ -2466,6 +4217,11 @@ ImageCacheImpl::reset_stats()
             file->m_tilesread   = 0;
             file->m_bytesread   = 0;
             file->m_iotime      = 0;
+            for (int m = 0; m < file->mipaccess_levels(); ++m) {
+                ImageCacheFile::MipAccessStats* a = file->mipaccess(m);
+                a->hits = a->misses = a->redundant = 0;
+                a->io_time = a->wait_time = a->decompress_time = 0.0;
+            }
         }
     }
 }
@@ -2600,6 +4356,130 @@ ImageCacheImpl::attribute(string_view name, TypeDesc type, const void* val)
     } else if (name == "max_mip_res" && type == TypeInt) {
         m_max_mip_res = *(const int*)val;
         do_invalidate = true;
+    } else if (name == "prefetch_threads" && type == TypeInt) {
+        int n = std::max(0, *(const int*)val);
+        if (n != m_prefetch_threads) {
+            // Let any queued reads finish with the old pool; a new one
+            // of the requested size is created on the next prefetch.
+            stop_prefetch_threads();
+            m_prefetch_threads = n;
+        }
+    } else if (name == "readahead" && type == TypeInt) {
+        m_readahead = *(const int*)val;
+    } else if (name == "microcache_size" && type == TypeInt) {
+        // Round up to a power of two number of sets. Each thread resizes
+        // its own microcache the next time it retrieves its thread info.
+        int n       = std::min(*(const int*)val, 256);
+        int entries = 0;
+        if (n > 0) {
+            entries = ImageCachePerThreadInfo::microcache_ways;
+            while (entries < n)
+                entries *= 2;
+        }
+        m_microcache_size = entries;
+    } else if (name == "get_pixels_threads" && type == TypeInt) {
+        m_get_pixels_threads = std::max(*(const int*)val, 0);
+    } else if (name == "compress_tiles" && type == TypeInt) {
+        bool compress = *(const int*)val != 0;
+        if (compress != m_compress_tiles) {
+            m_compress_tiles = compress;
+            if (!compress)
+                clear_compressed_tiles();
+        }
+    } else if (name == "diskcache_dir" && type == TypeDesc::STRING) {
+        std::string dir(*(const char**)val);
+        if (dir != m_diskcache_dir) {
+            std::string err;
+            if (dir.size() && !Filesystem::is_directory(dir)
+                && !Filesystem::create_directories(dir, err)) {
+                error("Could not create disk cache directory \"{}\": {}", dir,
+                      err);
+                return false;
+            }
+            // Tiles already in flight keep using the old disk cache, if
+            // any, until they're done with it.
+            spin_lock lock(m_diskcache_mutex);
+            m_diskcache_dir  = dir;
+            int64_t maxbytes = int64_t(m_diskcache_max_MB) * 1024 * 1024;
+            m_diskcache.reset(dir.size() ? new ImageCacheDiskCache(
+                                               dir, m_diskcache_mmap, maxbytes)
+                                         : nullptr);
+        }
+    } else if (name == "header_catalog" && type == TypeDesc::STRING) {
+        std::string path(*(const char**)val);
+        if (path != m_header_catalog) {
+            // Loading the catalog may take a moment; do it unlocked.
+            std::shared_ptr<ImageCacheCatalog> catalog;
+            if (path.size())
+                catalog.reset(new ImageCacheCatalog(path));
+            spin_lock lock(m_catalog_mutex);
+            m_header_catalog = path;
+            m_catalog      = catalog;
+        }
+    } else if (name == "diskcache_mmap" && type == TypeInt) {
+        bool mmap = *(const int*)val != 0;
+        if (mmap != m_diskcache_mmap) {
+            spin_lock lock(m_diskcache_mutex);
+            m_diskcache_mmap = mmap;
+            if (m_diskcache_dir.size())
+                m_diskcache.reset(new ImageCacheDiskCache(
+                    m_diskcache_dir, mmap,
+                    int64_t(m_diskcache_max_MB) * 1024 * 1024));
+        }
+    } else if (name == "diskcache_max_MB" && type == TypeInt) {
+        spin_lock lock(m_diskcache_mutex);
+        m_diskcache_max_MB = std::max(*(const int*)val, 0);
+        if (m_diskcache)
+            m_diskcache->max_bytes(int64_t(m_diskcache_max_MB) * 1024 * 1024);
+    } else if (name == "shared_pool" && type == TypeDesc::STRING) {
+        std::string poolname(*(const char**)val);
+        if (poolname != m_shared_pool) {
+            std::shared_ptr<ImageCacheSharedPool> pool;
+            if (poolname.size()) {
+                pool = std::make_shared<ImageCacheSharedPool>(
+                    poolname, size_t(m_shared_pool_MB) * 1024 * 1024,
+                    size_t(m_shared_pool_tile_KB) * 1024);
+                if (!pool->valid()) {
+                    error("Could not use shared tile pool \"{}\": {}",
+                          poolname, pool->geterror());
+                    return false;
+                }
+            }
+            // Tiles already in the cache keep their pins (and the old
+            // pool) until they're freed.
+            spin_lock lock(m_sharedpool_mutex);
+            m_shared_pool = poolname;
+            m_sharedpool  = pool;
+        }
+    } else if (name == "shared_pool_MB" && type == TypeInt) {
+        m_shared_pool_MB = std::max(*(const int*)val, 1);
+    } else if (name == "shared_pool_tile_KB" && type == TypeInt) {
+        m_shared_pool_tile_KB = std::max(*(const int*)val, 1);
+    } else if (name == "deduplicate_tiles" && type == TypeInt) {
+        m_deduplicate_tiles = *(const int*)val != 0;
+    } else if (name == "access_stats" && type == TypeInt) {
+        m_access_stats = *(const int*)val != 0;
+    } else if (name == "eviction_policy" && type == TypeDesc::STRING) {
+        string_view pname(*(const char**)val);
+        int p = 0;
+        while (p < int(TileEvictionPolicy::Count)
+               && pname != eviction_policy_names[p])
+            ++p;
+        if (p == int(TileEvictionPolicy::Count))
+            return false;  // Unknown policy name
+        TileEvictionPolicy policy = TileEvictionPolicy(p);
+        if (policy != m_eviction_policy) {
+            // The shards are only maintained by the sharded policies, so
+            // they must be rebuilt from the tile table when switching away
+            // from the global clock, and are dropped when switching to it.
+            bool was_clock = (m_eviction_policy
+                              == TileEvictionPolicy::Clock);
+            m_eviction_policy = policy;
+            if (policy == TileEvictionPolicy::Clock)
+                reset_eviction_shards(false);
+            else if (was_clock)
+                reset_eviction_shards(true);
+        }
     } else {
         // Otherwise, unknown name
         return false;
@@ -2632,6 +4512,21 @@ ImageCacheImpl::getattributetype(string_view name) const
         { "failure_retries", TypeInt },
         { "total_files", TypeInt },
         { "max_mip_res", TypeInt },
+        { "prefetch_threads", TypeInt },
+        { "readahead", TypeInt },
+        { "microcache_size", TypeInt },
+        { "get_pixels_threads", TypeInt },
+        { "eviction_policy", TypeString },
+        { "compress_tiles", TypeInt },
+        { "diskcache_dir", TypeString },
+        { "diskcache_mmap", TypeInt },
+        { "diskcache_max_MB", TypeInt },
+        { "header_catalog", TypeString },
+        { "shared_pool", TypeString },
+        { "shared_pool_MB", TypeInt },
+        { "shared_pool_tile_KB", TypeInt },
+        { "deduplicate_tiles", TypeInt },
+        { "access_stats", TypeInt },
         { "searchpath", TypeString },
         { "plugin_searchpath", TypeString },
         { "worldtocommon", TypeMatrix },
@@ -2647,6 +4542,7 @@ ImageCacheImpl::getattributetype(string_view name) const
         { "stat:open_files_peak", TypeInt },
         { "stat:find_tile_calls", TypeInt64 },
         { "stat:find_tile_microcache_misses", TypeInt64 },
+        { "stat:find_tile_microcache_assoc_hits", TypeInt64 },
         { "stat:find_tile_cache_misses", TypeInt },
         { "stat:files_totalsize", TypeInt64 },
         { "stat:image_size", TypeInt64 },
@@ -2659,6 +4555,40 @@ ImageCacheImpl::getattributetype(string_view name) const
         { "stat:tile_locking_time", TypeFloat },
         { "stat:find_file_time", TypeFloat },
         { "stat:find_tile_time", TypeFloat },
+        { "stat:tile_wait_time", TypeFloat },
+        { "stat:prefetch_requests", TypeInt64 },
+        { "stat:prefetch_reads", TypeInt64 },
+        { "stat:prefetch_dropped", TypeInt64 },
+        { "stat:tiles_evicted", TypeInt64 },
+        { "stat:tiles_promoted", TypeInt64 },
+        { "stat:tiles_unevictable", TypeInt64 },
+        { "stat:diskcache_hits", TypeInt64 },
+        { "stat:diskcache_misses", TypeInt64 },
+        { "stat:diskcache_spills", TypeInt64 },
+        { "stat:diskcache_bytes_read", TypeInt64 },
+        { "stat:diskcache_bytes_written", TypeInt64 },
+        { "stat:tiles_compressed", TypeInt64 },
+        { "stat:tiles_decompressed", TypeInt64 },
+        { "stat:compressed_raw_bytes", TypeInt64 },
+        { "stat:compressed_bytes", TypeInt64 },
+        { "stat:compressed_memory_used", TypeInt64 },
+        { "stat:decompress_time", TypeFloat },
+        { "stat:tiles_mapped", TypeInt64 },
+        { "stat:mapped_memory_used", TypeInt64 },
+        { "stat:shared_tiles_found", TypeInt64 },
+        { "stat:shared_tiles_stored", TypeInt64 },
+        { "stat:shared_memory_used", TypeInt64 },
+        { "stat:tiles_deduplicated", TypeInt64 },
+        { "stat:dedup_bytes_saved", TypeInt64 },
+        { "stat:dedup_memory_used", TypeInt64 },
+        { "stat:batched_reads", TypeInt64 },
+        { "stat:batched_tiles", TypeInt64 },
+        { "stat:preload_files", TypeInt64 },
+        { "stat:preload_time", TypeFloat },
+        { "stat:catalog_hits", TypeInt64 },
+        { "stat:catalog_misses", TypeInt64 },
+        { "stat:udim_inventory_time", TypeFloat },
+        { "stat:udim_resolve_time", TypeFloat },
         { "stat:texture_queries", TypeInt64 },
         { "stat:texture3d_queries", TypeInt64 },
         { "stat:environment_queries", TypeInt64 },
@@ -2711,6 +4641,17 @@ ImageCacheImpl::getattribute(string_view name, TypeDesc type, void* val) const
     ATTR_DECODE("failure_retries", int, m_failure_retries);
     ATTR_DECODE("total_files", int, m_files.size());
     ATTR_DECODE("max_mip_res", int, m_max_mip_res);
+    ATTR_DECODE("prefetch_threads", int, m_prefetch_threads);
+    ATTR_DECODE("readahead", int, m_readahead);
+    ATTR_DECODE("microcache_size", int, m_microcache_size);
+    ATTR_DECODE("get_pixels_threads", int, m_get_pixels_threads);
+    ATTR_DECODE("compress_tiles", int, m_compress_tiles);
+    ATTR_DECODE("diskcache_mmap", int, m_diskcache_mmap);
+    ATTR_DECODE("diskcache_max_MB", int, m_diskcache_max_MB);
+    ATTR_DECODE("shared_pool_MB", int, m_shared_pool_MB);
+    ATTR_DECODE("shared_pool_tile_KB", int, m_shared_pool_tile_KB);
+    ATTR_DECODE("deduplicate_tiles", int, m_deduplicate_tiles);
+    ATTR_DECODE("access_stats", int, m_access_stats);
 
     // The cases that don't fit in the simple ATTR_DECODE scheme
     if (name == "searchpath" && type == TypeDesc::STRING) {
@@ -2721,6 +4662,26 @@ ImageCacheImpl::getattribute(string_view name, TypeDesc type, void* val) const
         *(ustring*)val = m_plugin_searchpath;
         return true;
     }
+    if (name == "diskcache_dir" && type == TypeDesc::STRING) {
+        spin_lock lock(m_diskcache_mutex);
+        *(ustring*)val = ustring(m_diskcache_dir);
+        return true;
+    }
+    if (name == "header_catalog" && type == TypeDesc::STRING) {
+        spin_lock lock(m_catalog_mutex);
+        *(ustring*)val = ustring(m_header_catalog);
+        return true;
+    }
+    if (name == "shared_pool" && type == TypeDesc::STRING) {
+        spin_lock lock(m_sharedpool_mutex);
+        *(ustring*)val = ustring(m_shared_pool);
+        return true;
+    }
+    if (name == "eviction_policy" && type == TypeDesc::STRING) {
+        *(ustring*)val = ustring(
+            eviction_policy_names[int(m_eviction_policy)]);
+        return true;
+    }
     if (name == "worldtocommon"
         && (type == TypeMatrix || type == TypeDesc(TypeDesc::FLOAT, 16))) {
         *(Imath::M44f*)val = m_Mw2c;
@@ -2776,6 +4737,8 @@ ImageCacheImpl::getattribute(string_view name, TypeDesc type, void* val) const
         ATTR_DECODE("stat:find_tile_calls", long long, stats.find_tile_calls);
         ATTR_DECODE("stat:find_tile_microcache_misses", long long,
                     stats.find_tile_microcache_misses);
+        ATTR_DECODE("stat:find_tile_microcache_assoc_hits", long long,
+                    stats.find_tile_microcache_assoc_hits);
         ATTR_DECODE("stat:find_tile_cache_misses", int,
                     stats.find_tile_cache_misses);
         ATTR_DECODE("stat:files_totalsize", long long,
@@ -2790,6 +4753,57 @@ ImageCacheImpl::getattribute(string_view name, TypeDesc type, void* val) const
         ATTR_DECODE("stat:tile_locking_time", float, stats.tile_locking_time);
         ATTR_DECODE("stat:find_file_time", float, stats.find_file_time);
         ATTR_DECODE("stat:find_tile_time", float, stats.find_tile_time);
+        ATTR_DECODE("stat:tile_wait_time", float, stats.tile_wait_time);
+        ATTR_DECODE("stat:prefetch_requests", long long,
+                    stats.prefetch_requests);
+        ATTR_DECODE("stat:prefetch_reads", long long, stats.prefetch_reads);
+        ATTR_DECODE("stat:prefetch_dropped", long long,
+                    stats.prefetch_dropped);
+        ATTR_DECODE("stat:tiles_evicted", long long, stats.tiles_evicted);
+        ATTR_DECODE("stat:tiles_promoted", long long, stats.tiles_promoted);
+        ATTR_DECODE("stat:tiles_unevictable", long long,
+                    stats.tiles_unevictable);
+        ATTR_DECODE("stat:diskcache_hits", long long, stats.diskcache_hits);
+        ATTR_DECODE("stat:diskcache_misses", long long,
+                    stats.diskcache_misses);
+        ATTR_DECODE("stat:diskcache_spills", long long,
+                    stats.diskcache_spills);
+        ATTR_DECODE("stat:diskcache_bytes_read", long long,
+                    stats.diskcache_bytes_read);
+        ATTR_DECODE("stat:diskcache_bytes_written", long long,
+                    stats.diskcache_bytes_written);
+        ATTR_DECODE("stat:tiles_compressed", long long,
+                    stats.tiles_compressed);
+        ATTR_DECODE("stat:tiles_decompressed", long long,
+                    stats.tiles_decompressed);
+        ATTR_DECODE("stat:compressed_raw_bytes", long long,
+                    stats.compressed_raw_bytes);
+        ATTR_DECODE("stat:compressed_bytes", long long,
+                    stats.compressed_bytes);
+        ATTR_DECODE("stat:compressed_memory_used", long long,
+                    m_compressed_mem);
+        ATTR_DECODE("stat:decompress_time", float, stats.decompress_time);
+        ATTR_DECODE("stat:tiles_mapped", long long, stats.tiles_mapped);
+        ATTR_DECODE("stat:mapped_memory_used", long long, m_mapped_mem);
+        ATTR_DECODE("stat:shared_tiles_found", long long,
+                    stats.shared_tiles_found);
+        ATTR_DECODE("stat:shared_tiles_stored", long long,
+                    stats.shared_tiles_stored);
+        ATTR_DECODE("stat:shared_memory_used", long long, m_shared_mem);
+        ATTR_DECODE("stat:tiles_deduplicated", long long,
+                    stats.tiles_deduplicated);
+        ATTR_DECODE("stat:dedup_bytes_saved", long long,
+                    stats.dedup_bytes_saved);
+        ATTR_DECODE("stat:dedup_memory_used", long long, m_dedup_mem);
+        ATTR_DECODE("stat:batched_reads", long long, stats.batched_reads);
+        ATTR_DECODE("stat:batched_tiles", long long, stats.batched_tiles);
+        ATTR_DECODE("stat:preload_files", long long, stats.preload_files);
+        ATTR_DECODE("stat:preload_time", float, stats.preload_time);
+        ATTR_DECODE("stat:catalog_hits", long long, stats.catalog_hits);
+        ATTR_DECODE("stat:catalog_misses", long long, stats.catalog_misses);
+        ATTR_DECODE("stat:udim_inventory_time", float,
+                    stats.udim_inventory_time);
+        ATTR_DECODE("stat:udim_resolve_time", float, stats.udim_resolve_time);
         ATTR_DECODE("stat:texture_queries", long long, stats.texture_queries);
         ATTR_DECODE("stat:texture3d_queries", long long,
                     stats.texture3d_queries);
@@ -2802,109 +4816,669 @@ ImageCacheImpl::getattribute(string_view name, TypeDesc type, void* val) const
     }
 
     return false;
-#undef ATTR_DECODE
+#undef ATTR_DECODE
+}
+
+
+
+bool
+ImageCacheImpl::find_tile_main_cache(const TileID& id, ImageCacheTileRef& tile,
+                                     ImageCachePerThreadInfo* thread_info)
+{
+    OIIO_DASSERT(!id.file().broken());
+    ImageCacheStatistics& stats(thread_info->m_stats);
+
+    ++stats.find_tile_microcache_misses;
+    ++stats.policy_lookups[int(m_eviction_policy)];
+
+    {
+#if IMAGECACHE_TIME_STATS
+        Timer timer1;
+#endif
+        bool found = m_tilecache.retrieve(id, tile);
+#if IMAGECACHE_TIME_STATS
+        stats.find_tile_time += timer1();
+#endif
+        if (found) {
+            // We found the tile in the cache, but we need to make sure we
+            // wait until the pixels are ready to read.  We purposely have
+            // released the lock (above) before calling wait_pixels_ready,
+            // otherwise we could deadlock if another thread reading the
+            // pixels needs to lock the cache because it's doing automip.
+            auto access = mipaccess(id);
+            if (!tile->pixels_ready()) {
+                Timer waittimer;
+                tile->wait_pixels_ready();
+                double wait = waittimer();
+                stats.tile_wait_time += wait;
+                if (access)
+                    atomic_fetch_add(access->wait_time, wait);
+            }
+            if (access)
+                ++access->hits;
+            tile->use();
+            OIIO_DASSERT(id == tile->id());
+            OIIO_DASSERT(tile);
+            return true;
+        }
+    }
+
+    // The tile was not found in cache.
+
+    ++stats.find_tile_cache_misses;
+    ++stats.policy_misses[int(m_eviction_policy)];
+
+    // Yes, we're creating and reading a tile with no lock -- this is to
+    // prevent all the other threads from blocking because of our
+    // expensive disk read.  We believe this is safe, since underneath
+    // the ImageCacheFile will lock itself for the read_tile and there are
+    // no other non-threadsafe side effects.
+    tile = new ImageCacheTile(id);
+    // N.B. the ImageCacheTile ctr starts the tile out as 'used'
+    OIIO_DASSERT(tile);
+    OIIO_DASSERT(id == tile->id());
+
+    bool ok = add_tile_to_cache(tile, thread_info);
+    OIIO_DASSERT(id == tile->id());
+    if (ok && m_readahead)
+        readahead(id, thread_info);
+    return ok && tile->valid();
+}
+
+
+
+bool
+ImageCacheImpl::add_tile_to_cache(ImageCacheTileRef& tile,
+                                  ImageCachePerThreadInfo* thread_info)
+{
+    bool ourtile = m_tilecache.insert_retrieve(tile->id(), tile, tile);
+
+    // If we added a new tile to the cache, we may still need to read the
+    // pixels; and if we found the tile in cache, we may need to wait for
+    // somebody else to read the pixels.
+    bool ok = true;
+    if (ourtile) {
+        if (!tile->pixels_ready()) {
+            Timer timer;
+            ok              = tile->read(thread_info);
+            double readtime = timer();
+            thread_info->m_stats.fileio_time += readtime;
+            tile->id().file().iotime() += readtime;
+            if (auto a = mipaccess(tile->id())) {
+                ++a->misses;
+                atomic_fetch_add(a->io_time, readtime);
+            }
+        }
+        if (m_eviction_policy != TileEvictionPolicy::Clock)
+            track_tile(tile->id());
+        check_max_mem(thread_info);
+    } else {
+        // Somebody else already added the tile to the cache before we
+        // could, so we'll use their reference, but we need to wait until it
+        // has read in the pixels.
+        if (!tile->pixels_ready()) {
+            Timer waittimer;
+            tile->wait_pixels_ready();
+            double wait = waittimer();
+            thread_info->m_stats.tile_wait_time += wait;
+            if (auto a = mipaccess(tile->id()))
+                atomic_fetch_add(a->wait_time, wait);
+        }
+    }
+    return ok;
+}
+
+
+
+void
+ImageCacheImpl::queue_prefetch(const TileID& id,
+                               ImageCachePerThreadInfo* thread_info)
+{
+    if (m_prefetch_threads <= 0 || m_prefetch_stop)
+        return;
+    if (tile_in_cache(id, thread_info))
+        return;
+    ImageCacheStatistics& stats(thread_info->m_stats);
+    ++stats.prefetch_requests;
+    // Prefetch is only a hint. Rather than let the queue grow without
+    // bound when the renderer outruns the disk, drop the request; a real
+    // lookup will read the tile synchronously if it is still needed.
+    const int max_queued = 4096;
+    if (m_prefetch_queued >= max_queued) {
+        ++stats.prefetch_dropped;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_prefetch_mutex);
+    if (m_prefetch_stop)
+        return;  // The pool is being shut down
+    if (!m_prefetch_pool)
+        m_prefetch_pool.reset(new thread_pool(m_prefetch_threads));
+    ++m_prefetch_queued;
+    // Hold a reference to the file so it can't be freed while the request
+    // is waiting in the queue.
+    ImageCacheFileRef file(id.file_ptr());
+    m_prefetch_pool->push([this, id, file](int /*thread_id*/) {
+        --m_prefetch_queued;
+        if (!m_prefetch_stop)
+            prefetch_tile(id);
+    });
+}
+
+
+
+void
+ImageCacheImpl::prefetch_tile(const TileID& id)
+{
+    // Each worker thread gets its own per-thread info, so its stats are
+    // merged along with everyone else's.
+    ImageCachePerThreadInfo* thread_info = get_perthread_info();
+    if (id.file().broken() || tile_in_cache(id, thread_info))
+        return;
+    ImageCacheTileRef tile       = new ImageCacheTile(id);
+    const ImageCacheTile* ourtile = tile.get();
+    if (add_tile_to_cache(tile, thread_info) && tile.get() == ourtile)
+        ++thread_info->m_stats.prefetch_reads;
+}
+
+
+
+void
+ImageCacheImpl::readahead(const TileID& id,
+                          ImageCachePerThreadInfo* thread_info)
+{
+    ImageCacheFile& file(id.file());
+    int subimage = id.subimage();
+    int miplevel = id.miplevel();
+    const SubimageInfo& si(file.subimageinfo(subimage));
+    const ImageDims& dims(si.leveldims(miplevel));
+
+    // Coherent access tends to march across rows of tiles, then down.
+    if (id.x() + dims.tile_width < dims.x + dims.width)
+        queue_prefetch(TileID(file, subimage, miplevel,
+                              id.x() + dims.tile_width, id.y(), id.z(),
+                              id.chbegin(), id.chend(), id.colortransformid()),
+                       thread_info);
+    if (id.y() + dims.tile_height < dims.y + dims.height)
+        queue_prefetch(TileID(file, subimage, miplevel, id.x(),
+                              id.y() + dims.tile_height, id.z(), id.chbegin(),
+                              id.chend(), id.colortransformid()),
+                       thread_info);
+
+    // Filtered lookups blend with the next coarser level, so the tile
+    // covering the same region there is likely to be wanted soon, too.
+    if (miplevel + 1 < si.miplevels()) {
+        const ImageDims& cdims(si.leveldims(miplevel + 1));
+        int xtile = int(int64_t(id.x() - dims.x) * cdims.width
+                        / (int64_t(dims.width) * cdims.tile_width));
+        int ytile = int(int64_t(id.y() - dims.y) * cdims.height
+                        / (int64_t(dims.height) * cdims.tile_height));
+        int ztile = int(int64_t(id.z() - dims.z) * cdims.depth
+                        / (int64_t(dims.depth) * cdims.tile_depth));
+        queue_prefetch(TileID(file, subimage, miplevel + 1,
+                              cdims.x + xtile * cdims.tile_width,
+                              cdims.y + ytile * cdims.tile_height,
+                              cdims.z + ztile * cdims.tile_depth, id.chbegin(),
+                              id.chend(), id.colortransformid()),
+                       thread_info);
+    }
+}
+
+
+
+void
+ImageCacheImpl::stop_prefetch_threads()
+{
+    std::unique_ptr<thread_pool> pool;
+    {
+        // Raise the stop flag before taking the pool, under the same lock
+        // queue_prefetch holds, so no request can be pushed onto a new
+        // pool while this one is draining.
+        std::lock_guard<std::mutex> lock(m_prefetch_mutex);
+        m_prefetch_stop = true;
+        pool.swap(m_prefetch_pool);
+    }
+    // Queued requests see the stop flag and return without reading;
+    // destroying the pool waits for any read already in progress.
+    pool.reset();
+    std::lock_guard<std::mutex> lock(m_prefetch_mutex);
+    m_prefetch_stop = false;
+}
+
+
+
+void
+ImageCacheImpl::check_max_mem(ImageCachePerThreadInfo* thread_info)
+{
+    OIIO_DASSERT(m_mem_used < (long long)m_max_memory_bytes * 10);  // sanity
+#if 0
+    static atomic_int n;
+    if (! (n++ % 64) || m_mem_used >= (long long)m_max_memory_bytes)
+        std::cerr << "mem used: " << m_mem_used << ", max = " << m_max_memory_bytes << "\n";
+#endif
+    // Early out if the cache is empty
+    if (m_tilecache.empty())
+        return;
+    // Early out if we aren't exceeding the tile memory limit
+    if (m_mem_used < (long long)m_max_memory_bytes)
+        return;
+
+    if (m_eviction_policy == TileEvictionPolicy::Clock) {
+        check_max_mem_clock(thread_info);
+        return;
+    }
+
+    // Sharded policies: visit the shards round-robin, freeing one tile
+    // from each, so that no one shard (and no one thread) carries all the
+    // eviction work and the tiles freed are spread across the whole cache.
+    // Shards that another thread is already sweeping are skipped rather
+    // than waited on. Keep going until we're back under the limit or a
+    // full round of shards has nothing left to give.
+    ImageCacheStatistics& stats(thread_info->m_stats);
+    unsigned int s = m_eviction_cursor++;
+    int fruitless  = 0;
+    while (m_mem_used >= (long long)m_max_memory_bytes
+           && fruitless < TILE_EVICTION_SHARDS) {
+        TileEvictionShard& shard(m_eviction_shards[s++ % TILE_EVICTION_SHARDS]);
+        bool freed = false;
+        ImageCacheTileRef victim;
+        if (shard.mutex.try_lock()) {
+            freed = evict_one_tile(shard, victim, stats);
+            // With nothing left to evict, fall back on the compressed tier
+            if (!freed)
+                freed = drop_compressed_tile(shard);
+            shard.mutex.unlock();
+        }
+        if (victim) {
+            spill_tile(victim, stats);
+            compress_tile(victim, stats);
+            victim.reset();  // Its memory is given back here
+        }
+        fruitless = freed ? 0 : fruitless + 1;
+    }
+}
+
+
+
+void
+ImageCacheImpl::track_tile(const TileID& id)
+{
+    TileEvictionShard& shard(
+        m_eviction_shards[id.hash() % TILE_EVICTION_SHARDS]);
+    spin_lock lock(shard.mutex);
+    shard.probation.push_back(id);
+}
+
+
+
+bool
+ImageCacheImpl::evict_one_tile(TileEvictionShard& shard,
+                               ImageCacheTileRef& victim,
+                               ImageCacheStatistics& stats)
+{
+    // With the clock policy, "probation" is the whole ring. With SLRU,
+    // new tiles start out on probation, and ones that get used again
+    // before reaching the front are promoted to the protected segment,
+    // which is capped at 80% of the shard. Tiles that are referenced
+    // repeatedly -- such as the coarse MIP levels that nearly every
+    // lookup touches -- thus stay resident while one-shot tiles from a
+    // streaming access pattern are the first to go.
+    //
+    // The scan is bounded so that one eviction costs O(1) no matter how
+    // big the shard is. If it gives up, the caller moves on to the next
+    // shard, and the tiles looked at have had their use bits cleared, so
+    // the next sweep of this shard will find a victim among them.
+    const bool slru    = (m_eviction_policy == TileEvictionPolicy::SLRU);
+    const int max_scan = 32;
+    for (int steps = 0; steps < max_scan; ++steps) {
+        if (slru
+            && shard.protect.size() * 5
+                   > (shard.probation.size() + shard.protect.size()) * 4) {
+            shard.probation.push_back(shard.protect.front());
+            shard.protect.pop_front();
+        }
+        bool from_probation = !shard.probation.empty();
+        std::deque<TileID>& queue(from_probation ? shard.probation
+                                                 : shard.protect);
+        if (queue.empty())
+            return false;
+        TileID id = queue.front();
+        queue.pop_front();
+
+        // Look the tile up while holding its bin lock, so that nobody can
+        // retrieve it between our deciding to evict it and erasing it.
+        size_t bin = m_tilecache.lock_bin(id);
+        bool evict = false, stale = true, pinned = false;
+        {
+            TileCache::iterator found = m_tilecache.find(id, false);
+            if (found) {
+                const ImageCacheTileRef& tile(found->second);
+                stale  = false;
+                pinned = !tile->pixels_ready() || !tile->valid();
+                evict  = !tile->release();
+                if (evict)
+                    victim = found->second;
+            }
+        }
+        if (evict)
+            m_tilecache.erase(id, false);
+        m_tilecache.unlock_bin(bin);
+
+        if (evict) {
+            ++stats.tiles_evicted;
+            return true;
+        }
+        if (stale)
+            continue;  // Tile already left the cache; just drop the entry
+        if (pinned) {
+            // Still being read (or invalid), so it can't go yet. It wasn't
+            // used again, though, so it keeps its place in the segment.
+            ++stats.tiles_unevictable;
+            queue.push_back(id);
+            continue;
+        }
+        // Recently used: give it a second chance.
+        if (slru) {
+            shard.protect.push_back(id);
+            if (from_probation)
+                ++stats.tiles_promoted;
+        } else {
+            queue.push_back(id);
+        }
+    }
+    return false;
+}
+
+
+
+void
+ImageCacheImpl::spill_tile(const ImageCacheTileRef& tile,
+                           ImageCacheStatistics& stats)
+{
+    std::shared_ptr<ImageCacheDiskCache> dc = diskcache();
+    if (!dc || !tile->spillable() || !tile->pixels_ready())
+        return;
+    const TileID& id(tile->id());
+    std::string key;
+    int64_t ntiles, index;
+    size_t tilebytes;
+    if (id.file().diskcache_slot(id, key, ntiles, index, tilebytes)
+        && dc->write_tile(key, ntiles, index, tilebytes, tile->data())) {
+        ++stats.diskcache_spills;
+        stats.diskcache_bytes_written += tilebytes;
+    }
+}
+
+
+
+TileDedupShard::Buffer::~Buffer()
+{
+    delete[] pixels;
+    if (shared)
+        imagecache.decr_dedup_mem(size);
+    else
+        imagecache.decr_mem(size);
+}
+
+
+
+bool
+ImageCacheImpl::deduplicate_pixels(char*& pixels, size_t size,
+                                   std::shared_ptr<void>& keepalive,
+                                   ImageCacheStatistics& stats)
+{
+    // The end pad is zeroed, so hashing and comparing all of it is fine.
+    uint64_t hash = farmhash::Fingerprint64(pixels, size);
+    TileDedupShard& shard(m_dedup_shards[hash % TILE_DEDUP_SHARDS]);
+    std::shared_ptr<TileDedupShard::Buffer> other;
+    {
+        spin_lock lock(shard.mutex);
+        auto found = shard.buffers.find(hash);
+        if (found != shard.buffers.end())
+            other = found->second.lock();
+    }
+    // Compare outside the lock: the strong reference keeps the candidate
+    // alive, and tile pixels never change once read.
+    if (other && other->size == size && !memcmp(other->pixels, pixels, size)) {
+        delete[] pixels;
+        decr_mem(size);
+        // The first time a buffer is shared, its memory stops counting
+        // toward what eviction can free.
+        if (!other->shared.exchange(true)) {
+            decr_mem(size);
+            incr_dedup_mem(size);
+        }
+        pixels    = other->pixels;
+        keepalive = std::shared_ptr<void>(other, pixels);
+        ++stats.tiles_deduplicated;
+        stats.dedup_bytes_saved += size;
+        return true;
+    }
+
+    // No match: start a buffer that later duplicates may share.
+    auto buffer = std::make_shared<TileDedupShard::Buffer>(*this, pixels,
+                                                           size);
+    keepalive   = std::shared_ptr<void>(buffer, pixels);
+    spin_lock lock(shard.mutex);
+    std::weak_ptr<TileDedupShard::Buffer>& slot(shard.buffers[hash]);
+    if (slot.expired())
+        slot = buffer;  // Don't displace a live buffer that collided
+    if (shard.buffers.size() >= shard.prune_at) {
+        for (auto b = shard.buffers.begin(); b != shard.buffers.end();) {
+            if (b->second.expired())
+                b = shard.buffers.erase(b);
+            else
+                ++b;
+        }
+        shard.prune_at = std::max(size_t(1024), 2 * shard.buffers.size());
+    }
+    return false;
+}
+
+
+
+void
+ImageCacheImpl::compress_tile(const ImageCacheTileRef& tile,
+                              ImageCacheStatistics& stats)
+{
+    if (!m_compress_tiles || !tile->spillable() || !tile->pixels_ready())
+        return;
+    const TileID& id(tile->id());
+    const SubimageInfo& si(id.file().subimageinfo(id.subimage()));
+    TileEvictionShard::CompressedTile packed;
+    packed.rawsize = size_t(si.get_tile_pixels(id.miplevel()))
+                     * tile->pixelsize();
+    if (!pack_tile((const char*)tile->data(), packed.rawsize,
+                   tile->channelsize(), packed.data, packed.size))
+        return;
+    ++stats.tiles_compressed;
+    stats.compressed_raw_bytes += packed.rawsize;
+    stats.compressed_bytes += packed.size;
+
+    // The compressed tier may use up to half of the memory limit. Beyond
+    // that, the oldest compressed tiles make room, those of this tile's
+    // shard first and then those of the others. If there still isn't room
+    // (other threads filled it in the meantime), the tile isn't kept.
+    long long limit    = m_max_memory_bytes / 2;
+    long long size     = (long long)packed.size;
+    unsigned int first = id.hash() % TILE_EVICTION_SHARDS;
+    for (unsigned int s = 0;
+         s < TILE_EVICTION_SHARDS && m_compressed_mem + size > limit; ++s) {
+        TileEvictionShard& other(
+            m_eviction_shards[(first + s) % TILE_EVICTION_SHARDS]);
+        spin_lock lock(other.mutex);
+        while (m_compressed_mem + size > limit && drop_compressed_tile(other)) {
+        }
+    }
+    TileEvictionShard& shard(m_eviction_shards[first]);
+    spin_lock lock(shard.mutex);
+    if (m_compressed_mem + size > limit)
+        return;
+    packed.serial = shard.coldserial++;
+    shard.coldqueue.emplace_back(id, packed.serial);
+    TileEvictionShard::CompressedTile& slot(shard.cold[id]);
+    if (slot.data) {
+        // Another thread re-read and evicted the tile while we packed it
+        m_compressed_mem -= (long long)slot.size;
+        m_mem_used -= (long long)slot.size;
+    }
+    slot = std::move(packed);
+    m_compressed_mem += size;
+    incr_mem(size);
+}
+
+
+
+bool
+ImageCacheImpl::drop_compressed_tile(TileEvictionShard& shard)
+{
+    while (!shard.coldqueue.empty()) {
+        std::pair<TileID, unsigned int> oldest = shard.coldqueue.front();
+        shard.coldqueue.pop_front();
+        auto found = shard.cold.find(oldest.first);
+        if (found == shard.cold.end() || found->second.serial != oldest.second)
+            continue;  // Stale: decompressed or replaced since
+        m_compressed_mem -= (long long)found->second.size;
+        m_mem_used -= (long long)found->second.size;
+        shard.cold.erase(found);
+        return true;
+    }
+    return false;
 }
 
 
 
 bool
-ImageCacheImpl::find_tile_main_cache(const TileID& id, ImageCacheTileRef& tile,
-                                     ImageCachePerThreadInfo* thread_info)
+ImageCacheImpl::drop_compressed_tile()
 {
-    OIIO_DASSERT(!id.file().broken());
-    ImageCacheStatistics& stats(thread_info->m_stats);
+    if (m_compressed_mem == 0)
+        return false;
+    unsigned int s = m_eviction_cursor++;
+    for (int i = 0; i < TILE_EVICTION_SHARDS; ++i) {
+        TileEvictionShard& shard(
+            m_eviction_shards[(s + i) % TILE_EVICTION_SHARDS]);
+        spin_lock lock(shard.mutex);
+        if (drop_compressed_tile(shard))
+            return true;
+    }
+    return false;
+}
+
 
-    ++stats.find_tile_microcache_misses;
 
+bool
+ImageCacheImpl::decompress_tile(const TileID& id, void* data,
+                                ImageCacheStatistics& stats)
+{
+    if (m_compressed_mem == 0)
+        return false;  // Nothing compressed, or the tier is disabled
+    TileEvictionShard& shard(
+        m_eviction_shards[id.hash() % TILE_EVICTION_SHARDS]);
+    TileEvictionShard::CompressedTile packed;
     {
-#if IMAGECACHE_TIME_STATS
-        Timer timer1;
-#endif
-        bool found = m_tilecache.retrieve(id, tile);
-#if IMAGECACHE_TIME_STATS
-        stats.find_tile_time += timer1();
-#endif
-        if (found) {
-            // We found the tile in the cache, but we need to make sure we
-            // wait until the pixels are ready to read.  We purposely have
-            // released the lock (above) before calling wait_pixels_ready,
-            // otherwise we could deadlock if another thread reading the
-            // pixels needs to lock the cache because it's doing automip.
-            tile->wait_pixels_ready();
-            tile->use();
-            OIIO_DASSERT(id == tile->id());
-            OIIO_DASSERT(tile);
-            return true;
+        spin_lock lock(shard.mutex);
+        auto found = shard.cold.find(id);
+        if (found == shard.cold.end())
+            return false;
+        packed = std::move(found->second);
+        shard.cold.erase(found);
+        // Don't let the stale queue entries left behind pile up.
+        if (shard.cold.empty()) {
+            shard.coldqueue.clear();
+        } else if (shard.coldqueue.size() > 4 * shard.cold.size()) {
+            auto stale = [&](const std::pair<TileID, unsigned int>& e) {
+                auto f = shard.cold.find(e.first);
+                return f == shard.cold.end() || f->second.serial != e.second;
+            };
+            shard.coldqueue.erase(std::remove_if(shard.coldqueue.begin(),
+                                                 shard.coldqueue.end(), stale),
+                                  shard.coldqueue.end());
         }
     }
+    m_compressed_mem -= (long long)packed.size;
+    m_mem_used -= (long long)packed.size;
+
+    Timer timer;
+    bool ok = unpack_tile(packed.data.get(), packed.size,
+                          int(id.file().channelsize(id.subimage())),
+                          (char*)data, packed.rawsize);
+    double time = timer();
+    stats.decompress_time += time;
+    if (auto a = mipaccess(id))
+        atomic_fetch_add(a->decompress_time, time);
+    if (ok)
+        ++stats.tiles_decompressed;
+    return ok;
+}
 
-    // The tile was not found in cache.
-
-    ++stats.find_tile_cache_misses;
 
-    // Yes, we're creating and reading a tile with no lock -- this is to
-    // prevent all the other threads from blocking because of our
-    // expensive disk read.  We believe this is safe, since underneath
-    // the ImageCacheFile will lock itself for the read_tile and there are
-    // no other non-threadsafe side effects.
-    tile = new ImageCacheTile(id);
-    // N.B. the ImageCacheTile ctr starts the tile out as 'used'
-    OIIO_DASSERT(tile);
-    OIIO_DASSERT(id == tile->id());
 
-    bool ok = add_tile_to_cache(tile, thread_info);
-    OIIO_DASSERT(id == tile->id());
-    return ok && tile->valid();
+void
+ImageCacheImpl::clear_compressed_tiles()
+{
+    for (auto& shard : m_eviction_shards) {
+        spin_lock lock(shard.mutex);
+        for (auto& c : shard.cold) {
+            m_compressed_mem -= (long long)c.second.size;
+            m_mem_used -= (long long)c.second.size;
+        }
+        shard.cold.clear();
+        shard.coldqueue.clear();
+    }
 }
 
 
 
-bool
-ImageCacheImpl::add_tile_to_cache(ImageCacheTileRef& tile,
-                                  ImageCachePerThreadInfo* thread_info)
+void
+ImageCacheImpl::reset_eviction_shards(bool repopulate)
 {
-    bool ourtile = m_tilecache.insert_retrieve(tile->id(), tile, tile);
+    for (auto& shard : m_eviction_shards) {
+        spin_lock lock(shard.mutex);
+        shard.probation.clear();
+        shard.protect.clear();
+    }
+    if (repopulate) {
+        std::vector<TileID> ids;
+        ids.reserve(m_tilecache.size());
+        for (TileCache::iterator t = m_tilecache.begin(), e = m_tilecache.end();
+             t != e; ++t)
+            ids.push_back(t->first);
+        // N.B. we hold no tile cache locks while filling the shards
+        for (const TileID& id : ids)
+            track_tile(id);
+    }
+}
 
-    // If we added a new tile to the cache, we may still need to read the
-    // pixels; and if we found the tile in cache, we may need to wait for
-    // somebody else to read the pixels.
-    bool ok = true;
-    if (ourtile) {
-        if (!tile->pixels_ready()) {
-            Timer timer;
-            ok              = tile->read(thread_info);
-            double readtime = timer();
-            thread_info->m_stats.fileio_time += readtime;
-            tile->id().file().iotime() += readtime;
+
+
+void
+ImageCacheImpl::forget_tiles(const ImageCacheFile* file)
+{
+    auto fromfile = [file](const TileID& id) { return id.file_ptr() == file; };
+    for (auto& shard : m_eviction_shards) {
+        spin_lock lock(shard.mutex);
+        shard.probation.erase(std::remove_if(shard.probation.begin(),
+                                             shard.probation.end(), fromfile),
+                              shard.probation.end());
+        shard.protect.erase(std::remove_if(shard.protect.begin(),
+                                           shard.protect.end(), fromfile),
+                            shard.protect.end());
+        for (auto c = shard.cold.begin(); c != shard.cold.end();) {
+            if (fromfile(c->first)) {
+                m_compressed_mem -= (long long)c->second.size;
+                m_mem_used -= (long long)c->second.size;
+                c = shard.cold.erase(c);
+            } else {
+                ++c;
+            }
         }
-        check_max_mem(thread_info);
-    } else {
-        // Somebody else already added the tile to the cache before we
-        // could, so we'll use their reference, but we need to wait until it
-        // has read in the pixels.
-        tile->wait_pixels_ready();
     }
-    return ok;
 }
 
 
 
 void
-ImageCacheImpl::check_max_mem(ImageCachePerThreadInfo* /*thread_info*/)
+ImageCacheImpl::check_max_mem_clock(ImageCachePerThreadInfo* thread_info)
 {
-    OIIO_DASSERT(m_mem_used < (long long)m_max_memory_bytes * 10);  // sanity
-#if 0
-    static atomic_int n;
-    if (! (n++ % 64) || m_mem_used >= (long long)m_max_memory_bytes)
-        std::cerr << "mem used: " << m_mem_used << ", max = " << m_max_memory_bytes << "\n";
-#endif
-    // Early out if the cache is empty
-    if (m_tilecache.empty())
-        return;
-    // Early out if we aren't exceeding the tile memory limit
-    if (m_mem_used < (long long)m_max_memory_bytes)
-        return;
-
     // Try to grab the tile_sweep_mutex lock. If somebody else holds it,
     // just return -- leave the memory limit enforcement to whomever is
     // already in this function, no need for two threads to do it at
@@ -2933,12 +5507,19 @@ ImageCacheImpl::check_max_mem(ImageCachePerThreadInfo* /*thread_info*/)
 
     // Loop while we still use too much tile memory.  Also, be careful
     // of looping for too long, exit the loop if we just keep spinning
-    // uncontrollably.
-    int full_loops = 0;
+    // uncontrollably. Two whole sweeps that free nothing mean that what's
+    // left over the limit is compressed tiles, which we drop below.
+    int full_loops = 0, fruitless_loops = 0;
+    bool freed     = false;
     while (m_mem_used >= (long long)m_max_memory_bytes && full_loops < 100) {
         // If we have fallen off the end of the cache, loop back to the
         // beginning and increment our full_loops count.
         if (!sweep) {
+            if (full_loops > 0)
+                fruitless_loops = freed ? 0 : fruitless_loops + 1;
+            freed = false;
+            if (fruitless_loops >= 2 && m_compressed_mem > 0)
+                break;
             sweep = m_tilecache.begin();
             ++full_loops;
         }
@@ -2951,9 +5532,11 @@ ImageCacheImpl::check_max_mem(ImageCachePerThreadInfo* /*thread_info*/)
         if (!sweep->second->release()) {
             // This is a tile we should delete.  To keep iterating
             // safely, we have a good trick:
-            // 1. remember the TileID of the tile to delete
-            TileID todelete = sweep->first;
-            size_t size     = sweep->second->memsize();
+            // 1. remember the TileID of the tile to delete, and hold on
+            // to the tile itself so it can be spilled to the disk cache
+            TileID todelete          = sweep->first;
+            ImageCacheTileRef victim = sweep->second;
+            size_t size              = sweep->second->memsize();
             OIIO_DASSERT(m_mem_used >= (long long)size);
             // 2. Find the TileID of the NEXT item. We do this by
             // incrementing the sweep iterator and grabbing its id.
@@ -2962,6 +5545,11 @@ ImageCacheImpl::check_max_mem(ImageCachePerThreadInfo* /*thread_info*/)
             // 3. Release the bin lock and erase the tile we wish to delete.
             sweep.unlock();
             m_tilecache.erase(todelete);
+            ++thread_info->m_stats.tiles_evicted;
+            spill_tile(victim, thread_info->m_stats);
+            compress_tile(victim, thread_info->m_stats);
+            victim.reset();
+            freed = true;
             // 4. Re-establish a locked iterator for the next item, since
             // the old iterator may have been invalidated by the erasure.
             if (!m_tile_sweep_id.empty())
@@ -2978,6 +5566,12 @@ ImageCacheImpl::check_max_mem(ImageCachePerThreadInfo* /*thread_info*/)
     // Now we must save the tileid for next time.  Just set it to an
     // empty ID if we don't have a valid iterator at this point.
     m_tile_sweep_id = (sweep ? sweep->first : TileID());
+    sweep.unlock();
+
+    // With nothing left to evict, fall back on the compressed tier.
+    while (m_mem_used >= (long long)m_max_memory_bytes
+           && drop_compressed_tile()) {
+    }
     m_tile_sweep_mutex.unlock();
 
     // N.B. As we exit, the iterators will go out of scope and we will
@@ -3067,6 +5661,40 @@ ImageCacheImpl::get_image_info(ImageCacheFile* file,
         ATTR_DECODE("stat:image_size", long long, file->m_total_imagesize);
         ATTR_DECODE("stat:file_size", long long,
                     file->m_total_imagesize_ondisk);
+        // Per-MIP-level access counters (see "access_stats"), as arrays
+        // with an entry for each level
+        static const char* mipstats[] = { "stat:mip_hits",
+                                          "stat:mip_misses",
+                                          "stat:mip_redundant_tiles",
+                                          "stat:mip_io_time",
+                                          "stat:mip_wait_time",
+                                          "stat:mip_decompress_time" };
+        int which = 0;
+        while (which < 6 && dataname != mipstats[which])
+            ++which;
+        bool counts = which < 3;
+        if (which < 6 && datatype.is_sized_array()
+            && datatype.elementtype() == (counts ? TypeInt64 : TypeFloat)) {
+            for (int m = 0; m < datatype.arraylen; ++m) {
+                const ImageCacheFile::MipAccessStats* a = file->mipaccess(m);
+                double v = 0.0;
+                if (a) {
+                    switch (which) {
+                    case 0: v = double(a->hits); break;
+                    case 1: v = double(a->misses); break;
+                    case 2: v = double(a->redundant); break;
+                    case 3: v = a->io_time; break;
+                    case 4: v = a->wait_time; break;
+                    default: v = a->decompress_time; break;
+                    }
+                }
+                if (counts)
+                    ((long long*)data)[m] = (long long)v;
+                else
+                    ((float*)data)[m] = float(v);
+            }
+            return true;
+        }
     }
 
     if (file->broken()) {
@@ -3563,7 +6191,6 @@ ImageCacheImpl::get_pixels(ImageCacheFile* file,
         thread_info = get_perthread_info();
     const SubimageInfo& si(file->subimageinfo(subimage));
     const ImageDims& dims(si.leveldims(miplevel));
-    bool ok = true;
 
     // Compute channels and stride if not given (assume all channels,
     // contiguous data layout for strides).
@@ -3591,101 +6218,185 @@ ImageCacheImpl::get_pixels(ImageCacheFile* file,
     stride_t result_pixelsize   = result_nchans * formatsize;
     bool xcontig                = (result_pixelsize == xstride
                     && result_nchans == cache_nchans);
-    stride_t scanlinesize       = (xend - xbegin) * result_pixelsize;
-    stride_t zplanesize         = (yend - ybegin) * scanlinesize;
     OIIO_DASSERT(dims.depth >= 1 && dims.tile_depth >= 1);
 
-    imagesize_t npixelsread = 0;
-    char* zptr              = (char*)result;
-    for (int z = zbegin; z < zend; ++z, zptr += zstride) {
-        if (z < dims.z || z >= (dims.z + dims.depth)) {
-            // nonexistent planes
-            if (xstride == result_pixelsize && ystride == scanlinesize) {
-                // Can zero out the plane in one shot
-                memset(zptr, 0, zplanesize);
-            } else {
-                // Non-contiguous strides -- zero out individual pixels
-                char* yptr = zptr;
-                for (int y = ybegin; y < yend; ++y, yptr += ystride) {
-                    char* xptr = yptr;
-                    for (int x = xbegin; x < xend; ++x, xptr += xstride)
-                        memset(xptr, 0, result_pixelsize);
-                }
-            }
-            continue;
-        }
-        int old_tx = -100000, old_ty = -100000, old_tz = -100000;
-        int tz     = z - ((z - dims.z) % dims.tile_depth);
-        char* yptr = zptr;
-        int ty     = ybegin - ((ybegin - dims.y) % dims.tile_height);
-        int tyend  = ty + dims.tile_height;
-        for (int y = ybegin; y < yend; ++y, yptr += ystride) {
-            if (y == tyend) {
-                ty = tyend;
-                tyend += dims.tile_height;
-            }
-            if (y < dims.y || y >= (dims.y + dims.height)) {
-                // nonexistent scanlines
-                if (xstride == result_pixelsize) {
-                    // Can zero out the scanline in one shot
-                    memset(yptr, 0, scanlinesize);
+    // Copy the part r of the region into its place in the result, using
+    // the per-thread info ti (fetch_region may split the region among
+    // threads).
+    auto fetch = [&](const ROI& r, ImageCachePerThreadInfo* ti) -> bool {
+        bool ok                 = true;
+        stride_t scanlinesize   = r.width() * result_pixelsize;
+        stride_t zplanesize     = r.height() * scanlinesize;
+        imagesize_t npixelsread = 0;
+        char* zptr = (char*)result + (r.zbegin - zbegin) * zstride
+                     + (r.ybegin - ybegin) * ystride
+                     + (r.xbegin - xbegin) * xstride;
+        for (int z = r.zbegin; z < r.zend; ++z, zptr += zstride) {
+            if (z < dims.z || z >= (dims.z + dims.depth)) {
+                // nonexistent planes
+                if (xstride == result_pixelsize && ystride == scanlinesize) {
+                    // Can zero out the plane in one shot
+                    memset(zptr, 0, zplanesize);
                 } else {
                     // Non-contiguous strides -- zero out individual pixels
-                    char* xptr = yptr;
-                    for (int x = xbegin; x < xend; ++x, xptr += xstride)
-                        memset(xptr, 0, result_pixelsize);
+                    char* yptr = zptr;
+                    for (int y = r.ybegin; y < r.yend; ++y, yptr += ystride) {
+                        char* xptr = yptr;
+                        for (int x = r.xbegin; x < r.xend;
+                             ++x, xptr += xstride)
+                            memset(xptr, 0, result_pixelsize);
+                    }
                 }
                 continue;
             }
-            // int ty = y - ((y - dims.y) % dims.tile_height);
-            char* xptr       = yptr;
-            const char* data = NULL;
-            for (int x = xbegin; x < xend;
-                 ++x, xptr += xstride, ++npixelsread) {
-                if (x < dims.x || x >= (dims.x + dims.width)) {
-                    // nonexistent columns
-                    memset(xptr, 0, result_pixelsize);
-                    continue;
-                }
-                int tx = x - ((x - dims.x) % dims.tile_width);
-                if (old_tx != tx || old_ty != ty || old_tz != tz) {
-                    // Only do a find_tile and re-setup of the data
-                    // pointer when we move across a tile boundary.
-                    TileID tileid(*file, subimage, miplevel, tx, ty, tz,
-                                  cache_chbegin, cache_chend);
-                    ok &= find_tile(tileid, thread_info, npixelsread == 0);
-                    if (!ok)
-                        return false;  // Just stop if file read failed
-                    old_tx = tx;
-                    old_ty = ty;
-                    old_tz = tz;
-                    data   = NULL;
+            int old_tx = -100000, old_ty = -100000, old_tz = -100000;
+            int tz     = z - ((z - dims.z) % dims.tile_depth);
+            char* yptr = zptr;
+            int ty     = r.ybegin - ((r.ybegin - dims.y) % dims.tile_height);
+            int tyend  = ty + dims.tile_height;
+            for (int y = r.ybegin; y < r.yend; ++y, yptr += ystride) {
+                if (y == tyend) {
+                    ty = tyend;
+                    tyend += dims.tile_height;
                 }
-                if (!data) {
-                    ImageCacheTileRef& tile(thread_info->tile);
-                    OIIO_DASSERT(tile);
-                    data = (const char*)tile->data(x, y, z, chbegin);
-                    OIIO_DASSERT(data);
+                if (y < dims.y || y >= (dims.y + dims.height)) {
+                    // nonexistent scanlines
+                    if (xstride == result_pixelsize) {
+                        // Can zero out the scanline in one shot
+                        memset(yptr, 0, scanlinesize);
+                    } else {
+                        // Non-contiguous strides -- zero out individual
+                        // pixels
+                        char* xptr = yptr;
+                        for (int x = r.xbegin; x < r.xend;
+                             ++x, xptr += xstride)
+                            memset(xptr, 0, result_pixelsize);
+                    }
+                    continue;
                 }
-                if (xcontig) {
-                    // Special case for a contiguous span within one tile
-                    int spanend   = std::min(tx + dims.tile_width, xend);
-                    stride_t span = spanend - x;
-                    convert_pixel_values(cachetype, data, format, xptr,
-                                         result_nchans * span);
-                    x += (span - 1);
-                    xptr += xstride * (span - 1);
-                    // no need to increment data, since next read will
-                    // be from a different tile
-                } else {
-                    convert_pixel_values(cachetype, data, format, xptr,
-                                         result_nchans);
-                    data += cache_stride;
+                // int ty = y - ((y - dims.y) % dims.tile_height);
+                char* xptr       = yptr;
+                const char* data = NULL;
+                bool tileok      = true;
+                for (int x = r.xbegin; x < r.xend;
+                     ++x, xptr += xstride, ++npixelsread) {
+                    if (x < dims.x || x >= (dims.x + dims.width)) {
+                        // nonexistent columns
+                        memset(xptr, 0, result_pixelsize);
+                        continue;
+                    }
+                    int tx = x - ((x - dims.x) % dims.tile_width);
+                    if (old_tx != tx || old_ty != ty || old_tz != tz) {
+                        // Only do a find_tile and re-setup of the data
+                        // pointer when we move across a tile boundary.
+                        TileID tileid(*file, subimage, miplevel, tx, ty, tz,
+                                      cache_chbegin, cache_chend);
+                        tileok = find_tile(tileid, ti, npixelsread == 0);
+                        ok &= tileok;
+                        old_tx = tx;
+                        old_ty = ty;
+                        old_tz = tz;
+                        data   = NULL;
+                    }
+                    if (!tileok) {
+                        // Zero the pixels of a tile that couldn't be read,
+                        // and carry on with the rest
+                        memset(xptr, 0, result_pixelsize);
+                        continue;
+                    }
+                    if (!data) {
+                        ImageCacheTileRef& tile(ti->tile);
+                        OIIO_DASSERT(tile);
+                        data = (const char*)tile->data(x, y, z, chbegin);
+                        OIIO_DASSERT(data);
+                    }
+                    if (xcontig) {
+                        // Special case for a contiguous span within one
+                        // tile
+                        int spanend   = std::min(tx + dims.tile_width, r.xend);
+                        stride_t span = spanend - x;
+                        convert_pixel_values(cachetype, data, format, xptr,
+                                             result_nchans * span);
+                        x += (span - 1);
+                        xptr += xstride * (span - 1);
+                        // no need to increment data, since next read will
+                        // be from a different tile
+                    } else {
+                        convert_pixel_values(cachetype, data, format, xptr,
+                                             result_nchans);
+                        data += cache_stride;
+                    }
                 }
             }
         }
-    }
 
+        return ok;
+    };
+    return fetch_region(dims,
+                        ROI(xbegin, xend, ybegin, yend, zbegin, zend, chbegin,
+                            chend),
+                        thread_info, fetch);
+}
+
+
+
+bool
+ImageCacheImpl::fetch_region(
+    const ImageDims& dims, const ROI& region,
+    ImageCachePerThreadInfo* thread_info,
+    function_view<bool(const ROI&, ImageCachePerThreadInfo*)> fetch)
+{
+    // The pieces are the region's intersections with the tile grid, which
+    // is extended past the data window (the fetch zeroes those parts).
+    int tw = dims.tile_width, th = dims.tile_height;
+    int td = std::max(dims.tile_depth, 1);
+    int x0 = dims.x + round_down_to_multiple(region.xbegin - dims.x, tw);
+    int y0 = dims.y + round_down_to_multiple(region.ybegin - dims.y, th);
+    int z0 = dims.z + round_down_to_multiple(region.zbegin - dims.z, td);
+    int64_t nx = (region.xend - x0 + tw - 1) / tw;
+    int64_t ny = (region.yend - y0 + th - 1) / th;
+    int64_t nz = (region.zend - z0 + td - 1) / td;
+    if (m_get_pixels_threads == 1 || nx <= 0 || ny <= 0 || nz <= 0
+        || nx * ny * nz < 4)
+        return fetch(region, thread_info);
+
+    std::thread::id caller = std::this_thread::get_id();
+    std::atomic<bool> ok(true);
+    std::mutex err_mutex;
+    std::string errors;
+    // A failed piece doesn't stop the others, so every tile that can be
+    // read still ends up in the result.
+    parallel_for(
+        int64_t(0), nx * ny * nz,
+        [&](int64_t i) {
+            int x = x0 + int(i % nx) * tw;
+            int y = y0 + int((i / nx) % ny) * th;
+            int z = z0 + int(i / (nx * ny)) * td;
+            ROI piece(std::max(x, region.xbegin),
+                      std::min(x + tw, region.xend),
+                      std::max(y, region.ybegin),
+                      std::min(y + th, region.yend),
+                      std::max(z, region.zbegin),
+                      std::min(z + td, region.zend), region.chbegin,
+                      region.chend);
+            bool mine = std::this_thread::get_id() == caller;
+            if (fetch(piece, mine ? thread_info : get_perthread_info()))
+                return;
+            ok = false;
+            std::string err = mine ? std::string() : geterror();
+            if (err.size()) {
+                // Pieces of a bad file tend to fail the same way
+                std::lock_guard<std::mutex> lock(err_mutex);
+                if (errors.find(err) == std::string::npos) {
+                    if (errors.size())
+                        errors += '\n';
+                    errors += err;
+                }
+            }
+        },
+        paropt(m_get_pixels_threads));
+    if (errors.size())
+        append_error(errors);
     return ok;
 }
 
@@ -3823,6 +6534,101 @@ ImageCacheImpl::release_tile(ImageCache::Tile* tile) const
 
 
 
+void
+ImageCacheImpl::prefetch(ustring filename, int subimage, int miplevel,
+                         const ROI& roi)
+{
+    ImageCachePerThreadInfo* thread_info = get_perthread_info();
+    ImageCacheFile* file                 = find_file(filename, thread_info);
+    prefetch(file, thread_info, subimage, miplevel, roi);
+}
+
+
+
+void
+ImageCacheImpl::prefetch(ImageHandle* file, Perthread* thread_info,
+                         int subimage, int miplevel, const ROI& roi)
+{
+    if (!thread_info)
+        thread_info = get_perthread_info();
+    file = verify_file(file, thread_info);
+    if (!file || file->broken() || file->is_udim())
+        return;
+    if (subimage < 0 || subimage >= file->subimages() || miplevel < 0
+        || miplevel >= file->miplevels(subimage))
+        return;
+    const SubimageInfo& si(file->subimageinfo(subimage));
+    const ImageDims& dims(si.leveldims(miplevel));
+    ROI datawin(dims.x, dims.x + dims.width, dims.y, dims.y + dims.height,
+                dims.z, dims.z + dims.depth, 0, dims.nchannels);
+    ROI r = roi.defined() ? roi_intersection(roi, datawin) : datawin;
+    if (r.width() <= 0 || r.height() <= 0 || r.depth() <= 0
+        || r.nchannels() <= 0)
+        return;
+    // Snap the region to tile corners and queue every tile it touches.
+    int x0 = dims.x + ((r.xbegin - dims.x) / dims.tile_width) * dims.tile_width;
+    int y0 = dims.y
+             + ((r.ybegin - dims.y) / dims.tile_height) * dims.tile_height;
+    int z0 = dims.z + ((r.zbegin - dims.z) / dims.tile_depth) * dims.tile_depth;
+    for (int z = z0; z < r.zend; z += dims.tile_depth)
+        for (int y = y0; y < r.yend; y += dims.tile_height)
+            for (int x = x0; x < r.xend; x += dims.tile_width)
+                queue_prefetch(TileID(*file, subimage, miplevel, x, y, z,
+                                      r.chbegin, r.chend),
+                               thread_info);
+}
+
+
+
+int
+ImageCacheImpl::preload_headers(cspan<ustring> filenames, int nthreads)
+{
+    Timer timer;
+    // A udim pattern stands for all of its tiles, which are resolved in
+    // bulk here and then have their headers read like any other file.
+    std::vector<ustring> udimtiles;
+    ImageCachePerThreadInfo* caller_info = get_perthread_info();
+    for (ustring f : filenames) {
+        ImageCacheFile* file = find_file(f, caller_info);
+        if (!file->is_udim())
+            continue;
+        resolve_udim_tiles(file, caller_info);
+        for (auto& ud : file->m_udim_lookup)
+            if (!ud.filename.empty())
+                udimtiles.push_back(ud.filename);
+    }
+    auto name = [&](int64_t i) {
+        return i < int64_t(filenames.size())
+                   ? filenames[i]
+                   : udimtiles[i - int64_t(filenames.size())];
+    };
+    atomic_int nvalid(0);
+    parallel_for(
+        int64_t(0), int64_t(filenames.size() + udimtiles.size()),
+        [&](int64_t i) {
+            ImageCachePerThreadInfo* thread_info = get_perthread_info();
+            ImageCacheFile* file = find_file(name(i), thread_info);
+            bool wasopen         = file->validspec();
+            file = verify_file(file, thread_info, true /*header_only*/);
+            if (!file || file->broken())
+                return;
+            ++nvalid;
+            // Only the header was wanted. Keep a big preload from holding
+            // more handles than max_open_files allows: the spec stays in
+            // the cache and the first tile read cheaply reopens the file.
+            if (!wasopen && !file->is_udim()
+                && m_stat_open_files_current >= m_max_open_files)
+                file->close();
+        },
+        paropt(nthreads));
+    ImageCacheStatistics& stats(caller_info->m_stats);
+    stats.preload_files += int64_t(filenames.size() + udimtiles.size());
+    stats.preload_time += timer();
+    return nvalid;
+}
+
+
+
 TypeDesc
 ImageCacheImpl::tile_format(const Tile* tile) const
 {
@@ -3949,8 +6755,11 @@ ImageCacheImpl::invalidate(ustring filename, bool force)
     ImageCacheFileRef file;
     {
         bool found = m_files.retrieve(filename, file);
-        if (!found)
-            return;  // no such file
+        if (!found) {
+            // We don't know the file, but it may be a new udim tile
+            forget_directory_listing(filename);
+            return;
+        }
     }
 
     invalidate(file.get(), force);
@@ -3963,6 +6772,10 @@ ImageCacheImpl::invalidate(ImageHandle* handle, bool force)
 {
     ImageCacheFileRef file(handle);
 
+    // Udim patterns listed from now on should see the file's directory as
+    // it is now.
+    forget_directory_listing(file->filename());
+
     if (!force) {
         // If not in force mode, we don't do anything if the modification
         // time of the file has not changed since we opened it.
@@ -3985,6 +6798,8 @@ ImageCacheImpl::invalidate(ImageHandle* handle, bool force)
     // Safely erase all the tiles we found
     for (const TileID& id : tiles_to_delete)
         m_tilecache.erase(id);
+    // N.B. the file may have compressed tiles even if none are resident
+    forget_tiles(file.get());
 
     const ustring fingerprint = file->fingerprint();
 
@@ -4005,11 +6820,16 @@ ImageCacheImpl::invalidate(ImageHandle* handle, bool force)
 void
 ImageCacheImpl::invalidate_all(bool force)
 {
+    // Files may have been added since we listed their directories
+    clear_directory_listings();
+
     // Special case: invalidate EVERYTHING -- we can take some shortcuts
     // to do it all in one shot.
     if (force) {
         // Clear the whole tile cache
         m_tilecache.clear();
+        reset_eviction_shards(false);
+        clear_compressed_tiles();
         // Invalidate (close and clear spec) all individual files
         for (FilenameMap::iterator fileit = m_files.begin(), e = m_files.end();
              fileit != e; ++fileit) {
@@ -4105,17 +6925,11 @@ ImageCacheImpl::close_all()
 
 
 void
-ImageCacheFile::udim_setup()
+ImageCacheFile::udim_setup(ImageCachePerThreadInfo* thread_info)
 {
     m_udim_nutiles = 0;  // assume it's not a udim at all
     m_udim_nvtiles = 0;
 
-    // If it's a literal, existing file, always treat it as a regular
-    // texture, even if it has what looks like udim pattern markers.
-    if (Filesystem::exists(m_filename)) {
-        return;
-    }
-
     // Look for udim pattern markers, which identify this as a udim pattern.
     // We separately identify whether it's the kind of pattern that has a
     // single index, or separate u and v indices (and for separate, whether
@@ -4138,16 +6952,30 @@ ImageCacheFile::udim_setup()
     if (!is_udim)
         return;
 
+    // If it's a literal, existing file, always treat it as a regular
+    // texture, even if it has what looks like udim pattern markers. (We
+    // only check once we know there are markers, which saves a stat of
+    // every ordinary file.)
+    if (Filesystem::exists(m_filename)) {
+        return;
+    }
+
     // Enumerate all the matching textures by looking at all files in the
     // directory portion of the pattern, and seeing if they match a regex
-    // we derive from the non-directory part of the pattern.
-    std::vector<std::string> filenames;
+    // we derive from the non-directory part of the pattern. The directory
+    // listing is shared by all the patterns in the same directory.
+    Timer timer;
     std::string dirname = Filesystem::parent_path(m_filename);
     if (dirname.empty())
         dirname = ".";
-    std::string pat = udim_to_wildcard(Filesystem::filename(m_filename));
-    Filesystem::get_directory_entries(dirname, filenames, false /*recurse*/,
-                                      pat);
+    std::string fnpattern = Filesystem::filename(m_filename);
+    std::string pat       = udim_to_wildcard(fnpattern);
+    std::shared_ptr<const std::vector<std::string>> filenames
+        = imagecache().directory_listing(dirname);
+    // The part of the pattern before the first marker must match
+    // literally, which is much cheaper to check than the regex.
+    std::string prefix = fnpattern.substr(
+        0, std::min(fnpattern.find_first_of("<%*?"), fnpattern.find("_u##")));
 
     // Now we have all the matching filenames, and we need to associate
     // these with uv tile numbering, for which we again use the regex
@@ -4156,8 +6984,10 @@ ImageCacheFile::udim_setup()
     std::vector<UdimInfo> udim_list;  // temporary -- we don't know extent
     udim_list.reserve(100);
     std::regex decoder(pat);
-    for (auto udim_tile_name : filenames) {
+    for (auto& udim_tile_name : *filenames) {
         std::string fnpart = Filesystem::filename(udim_tile_name);
+        if (!Strutil::starts_with(fnpart, prefix))
+            continue;
         std::match_results<std::string::const_iterator> match;
         if (std::regex_match(fnpart, match, decoder) && match.size() > 1) {
             int u = Strutil::stoi(std::string(match[1].first, match[1].second));
@@ -4185,12 +7015,44 @@ ImageCacheFile::udim_setup()
     }
 
     // Now that we have the inventory, we can reassemble the udim info into
-    // a simply indexed vector.
+    // a simply indexed vector -- unless the tiles are so sparsely spread
+    // over their range (as can happen with separate u and v numbers) that
+    // we're better off keeping just the populated tiles, sorted so that
+    // they can be found by binary search.
+    size_t ntiles  = size_t(m_udim_nutiles) * size_t(m_udim_nvtiles);
+    m_udim_sparse  = ntiles > std::max(size_t(4096), 4 * udim_list.size());
     m_udim_lookup.clear();
-    m_udim_lookup.resize(int(m_udim_nutiles) * int(m_udim_nvtiles));
-    for (auto& ud : udim_list) {
-        m_udim_lookup[ud.v * m_udim_nutiles + ud.u] = ud;
+    if (m_udim_sparse) {
+        std::sort(udim_list.begin(), udim_list.end(),
+                  [](const UdimInfo& a, const UdimInfo& b) {
+                      return a.v < b.v || (a.v == b.v && a.u < b.u);
+                  });
+        m_udim_lookup = udim_list;
+    } else {
+        m_udim_lookup.resize(ntiles);
+        for (auto& ud : udim_list) {
+            m_udim_lookup[ud.v * m_udim_nutiles + ud.u] = ud;
+        }
     }
+    if (thread_info)
+        thread_info->m_stats.udim_inventory_time += timer();
+}
+
+
+
+UdimInfo*
+ImageCacheFile::udim_tile(int u, int v)
+{
+    if (!m_udim_sparse)
+        return &m_udim_lookup[v * m_udim_nutiles + u];
+    auto found = std::lower_bound(m_udim_lookup.begin(), m_udim_lookup.end(),
+                                  std::make_pair(v, u),
+                                  [](const UdimInfo& a, std::pair<int, int> b) {
+                                      return std::make_pair(a.v, a.u) < b;
+                                  });
+    if (found == m_udim_lookup.end() || found->u != u || found->v != v)
+        return nullptr;
+    return &(*found);
 }
 
 
@@ -4233,25 +7095,100 @@ ImageCacheImpl::resolve_udim(ImageCacheFile* udimfile, Perthread* thread_info,
     // If udimfile exists, then we've already inventoried the matching
     // files and filled in udimfile->udim_lookup. That vector, and the
     // filename fields, are set and can be accessed without locks. The
-    // `ImageCacheFile*` within it, however, should use rw lock access.
-    int index = utile + vtile * udimfile->m_udim_nutiles;
-    OIIO_DASSERT(index >= 0 && size_t(index) < udimfile->m_udim_lookup.size());
-    UdimInfo& udiminfo(udimfile->m_udim_lookup[index]);
+    // `ImageCacheFile*` within it is atomic.
+    UdimInfo* udiminfo = udimfile->udim_tile(utile, vtile);
 
     // An empty filename in the record means that tile is not populated.
-    if (udiminfo.filename.empty())
+    if (!udiminfo || udiminfo->filename.empty())
         return nullptr;
 
-    ImageCacheFile* realfile = udiminfo.icfile;
+    ImageCacheFile* realfile = udiminfo->icfile;
     if (!realfile) {
-        realfile        = find_file(udiminfo.filename, thread_info);
-        udiminfo.icfile = realfile;
+        // The first lookup of any tile of the set resolves them all, so
+        // that the rest never need to go through find_file.
+        resolve_udim_tiles(udimfile, thread_info);
+        realfile = udiminfo->icfile;
     }
     return realfile;
 }
 
 
 
+void
+ImageCacheImpl::resolve_udim_tiles(ImageCacheFile* udimfile,
+                                   ImageCachePerThreadInfo* thread_info)
+{
+    if (!thread_info)
+        thread_info = get_perthread_info();
+    std::call_once(udimfile->m_udim_resolved, [&]() {
+        Timer timer;
+        auto& tiles = udimfile->m_udim_lookup;
+        auto resolve = [&](int64_t i, ImageCachePerThreadInfo* info) {
+            if (!tiles[i].filename.empty() && !tiles[i].icfile)
+                tiles[i].icfile = find_file(tiles[i].filename, info);
+        };
+        // Each find_file may have to stat (or search for) its file, so a
+        // big set is worth spreading over threads.
+        if (tiles.size() >= 64)
+            parallel_for(int64_t(0), int64_t(tiles.size()), [&](int64_t i) {
+                resolve(i, get_perthread_info());
+            });
+        else
+            for (int64_t i = 0, e = int64_t(tiles.size()); i < e; ++i)
+                resolve(i, thread_info);
+        thread_info->m_stats.udim_resolve_time += timer();
+    });
+}
+
+
+
+std::shared_ptr<const std::vector<std::string>>
+ImageCacheImpl::directory_listing(const std::string& dirname)
+{
+    // Adding or removing a file changes its directory's modification time,
+    // which tells us when a remembered listing is out of date.
+    std::time_t mtime = Filesystem::last_write_time(dirname);
+    {
+        std::lock_guard<std::mutex> lock(m_dir_listings_mutex);
+        auto found = m_dir_listings.find(dirname);
+        if (found != m_dir_listings.end() && found->second.mtime == mtime)
+            return found->second.entries;
+    }
+    // List it without holding the lock. If another thread lists the same
+    // directory at the same time, the last one to finish wins.
+    auto listing = std::make_shared<std::vector<std::string>>();
+    Filesystem::get_directory_entries(dirname, *listing, false /*recurse*/);
+    std::lock_guard<std::mutex> lock(m_dir_listings_mutex);
+    if (m_dir_listings.size() >= max_dir_listings
+        && !m_dir_listings.count(dirname))
+        m_dir_listings.clear();  // Rarely needed: just start over
+    m_dir_listings[dirname] = { mtime, listing };
+    return listing;
+}
+
+
+
+void
+ImageCacheImpl::forget_directory_listing(ustring filename)
+{
+    std::string dirname = Filesystem::parent_path(filename);
+    if (dirname.empty())
+        dirname = ".";
+    std::lock_guard<std::mutex> lock(m_dir_listings_mutex);
+    m_dir_listings.erase(dirname);
+}
+
+
+
+void
+ImageCacheImpl::clear_directory_listings()
+{
+    std::lock_guard<std::mutex> lock(m_dir_listings_mutex);
+    m_dir_listings.clear();
+}
+
+
+
 void
 ImageCacheImpl::inventory_udim(ImageCacheFile* udimfile, Perthread* thread_info,
                                std::vector<ustring>& filenames, int& nutiles,
@@ -4265,12 +7202,11 @@ ImageCacheImpl::inventory_udim(ImageCacheFile* udimfile, Perthread* thread_info,
     }
     nutiles = udimfile->m_udim_nutiles;
     nvtiles = udimfile->m_udim_nvtiles;
-    int n   = nutiles * nvtiles;
-    filenames.resize(n);
-    for (int i = 0; i < n; ++i) {
-        const UdimInfo& udiminfo(udimfile->m_udim_lookup[i]);
-        filenames[i] = udiminfo.filename;
-    }
+    filenames.clear();
+    filenames.resize(size_t(nutiles) * size_t(nvtiles));
+    for (const UdimInfo& udiminfo : udimfile->m_udim_lookup)
+        if (!udiminfo.filename.empty())
+            filenames[udiminfo.v * nutiles + udiminfo.u] = udiminfo.filename;
 }
 
 
@@ -4327,9 +7263,12 @@ ImageCacheImpl::get_perthread_info(ImageCachePerThreadInfo* p)
         spin_lock lock(m_perthread_info_mutex);
         p->tile     = NULL;
         p->lasttile = NULL;
-        p->purge    = 0;
+        p->clear_microcache();
+        p->purge = 0;
         p->m_thread_files.clear();
     }
+    if (p->microcache_size() != m_microcache_size)
+        p->resize_microcache(m_microcache_size);
     return p;
 }
 
@@ -4862,6 +7801,32 @@ ImageCache::release_tile(Tile* tile) const
 
 
 
+void
+ImageCache::prefetch(ustring filename, int subimage, int miplevel,
+                     const ROI& roi)
+{
+    m_impl->prefetch(filename, subimage, miplevel, roi);
+}
+
+
+
+void
+ImageCache::prefetch(ImageHandle* file, Perthread* thread_info, int subimage,
+                     int miplevel, const ROI& roi)
+{
+    m_impl->prefetch(file, thread_info, subimage, miplevel, roi);
+}
+
+
+
+int
+ImageCache::preload_headers(cspan<ustring> filenames, int nthreads)
+{
+    return m_impl->preload_headers(filenames, nthreads);
+}
+
+
+
 TypeDesc
 ImageCache::tile_format(const Tile* tile) const
 {
@@ -4950,4 +7915,12 @@ ImageCache::reset_stats()
 }
 
 
+
+std::string
+ImageCache::getstats_json() const
+{
+    return m_impl->getstats_json();
+}
+
+
 OIIO_NAMESPACE_END
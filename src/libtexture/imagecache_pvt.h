@@ -10,15 +10,21 @@
 #ifndef OPENIMAGEIO_IMAGECACHE_PVT_H
 #define OPENIMAGEIO_IMAGECACHE_PVT_H
 
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+
 #include <tsl/robin_map.h>
 
 #include <OpenImageIO/Imath.h>
 #include <OpenImageIO/export.h>
+#include <OpenImageIO/function_view.h>
 #include <OpenImageIO/hash.h>
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/memory.h>
 #include <OpenImageIO/refcnt.h>
 #include <OpenImageIO/texture.h>
+#include <OpenImageIO/thread.h>
 #include <OpenImageIO/timer.h>
 #include <OpenImageIO/unordered_map_concurrent.h>
 
@@ -35,8 +41,14 @@ OIIO_NAMESPACE_BEGIN
 
 #define IMAGECACHE_USE_RW_MUTEX 1
 
+// Use unordered_map_readmostly, which has lock-free lookups, for the tile
+// and file tables. Set to 0 to use plain unordered_map_concurrent.
+#define IMAGECACHE_LOCKFREE_LOOKUP 1
+
 #define FILE_CACHE_SHARDS 64
 #define TILE_CACHE_SHARDS 128
+#define TILE_EVICTION_SHARDS 64
+#define TILE_DEDUP_SHARDS 64
 
 
 
@@ -55,15 +67,485 @@ texture_type_name(TexFormat f);
 
 
 
+/// A variant of unordered_map_concurrent for tables that are read far
+/// more often than they are changed, such as the tile and file caches.
+/// Writers, iteration, and explicit bin locking behave just as they do for
+/// unordered_map_concurrent, which keeps the authoritative contents. But
+/// retrieve() and contains() take no lock at all: each bin also has an
+/// open-addressed index of its entries, which writers update (under the
+/// bin lock) with atomic stores and readers probe with atomic loads.
+///
+/// An entry removed from the index is freed only once every reader that
+/// might still be looking at it has finished. Readers announce themselves
+/// by incrementing one of a set of striped counters tagged with the parity
+/// of the current epoch. Removed entries go on a shared list tagged with
+/// the epoch they were removed in, and are freed once the epoch has moved
+/// on twice. Writers move the epoch along opportunistically, whenever no
+/// reader is left from the epoch before the current one; they never wait
+/// for readers, so erasing doesn't serialize the threads that do it (only
+/// clear() waits).
+///
+/// The index holds its own copy of each value, so values must not be
+/// changed in place (through an iterator) once inserted: lock-free
+/// readers would keep seeing the old one. Replace an entry by erasing and
+/// inserting it instead. The find_or_insert() method of the base class is
+/// not supported, since it returns a writable iterator that would bypass
+/// the index.
+template<class KEY, class VALUE, class HASH = std::hash<KEY>,
+         class PRED = std::equal_to<KEY>, size_t BINS = 16,
+         class BINMAP = std::unordered_map<KEY, VALUE, HASH, PRED>>
+class unordered_map_readmostly
+    : public unordered_map_concurrent<KEY, VALUE, HASH, PRED, BINS, BINMAP> {
+    using Base = unordered_map_concurrent<KEY, VALUE, HASH, PRED, BINS, BINMAP>;
+
+public:
+    using iterator = typename Base::iterator;
+
+    unordered_map_readmostly() = default;
+    unordered_map_readmostly(const unordered_map_readmostly&) = delete;
+    unordered_map_readmostly& operator=(const unordered_map_readmostly&)
+        = delete;
+
+    ~unordered_map_readmostly()
+    {
+        for (auto& shard : m_shards) {
+            if (Slots* s = shard.slots.load(std::memory_order_relaxed)) {
+                for (size_t i = 0; i <= s->mask; ++i) {
+                    Node* n = s->slot[i].load(std::memory_order_relaxed);
+                    if (n && n != tombstone())
+                        delete n;
+                }
+                delete s;
+            }
+            for (Node* n : shard.retired_nodes)
+                delete n;
+            for (Slots* s : shard.retired_slots)
+                delete s;
+        }
+        for (Retired& r : m_limbo) {
+            delete r.node;
+            delete r.slots;
+        }
+    }
+
+    /// Search for key. If found, return true and store the value. If not
+    /// found, return false and do not alter value. This never locks, so
+    /// do_lock is ignored.
+    bool retrieve(const KEY& key, VALUE& value, bool /*do_lock*/ = true)
+    {
+        size_t hash = m_hash(key);
+        ReadGuard guard(*this);
+        const Node* n = lookup(m_shards[whichbin(hash)], hash, key);
+        if (n)
+            value = n->value;
+        return n != nullptr;
+    }
+
+    /// Is the key in the map? This never locks.
+    bool contains(const KEY& key)
+    {
+        size_t hash = m_hash(key);
+        ReadGuard guard(*this);
+        return lookup(m_shards[whichbin(hash)], hash, key) != nullptr;
+    }
+
+    /// Insert <key,value> into the map if it's not already there, with the
+    /// same semantics as unordered_map_concurrent::insert_retrieve.
+    bool insert_retrieve(const KEY& key, VALUE& value, VALUE& mapvalue,
+                         bool do_lock = true)
+    {
+        size_t hash = m_hash(key);
+        size_t bin  = whichbin(hash);
+        if (do_lock)
+            lock_bin(key);
+        bool added = Base::insert_retrieve(key, value, mapvalue, false);
+        if (added)
+            index_insert(m_shards[bin], hash, key, value);
+        if (do_lock)
+            unlock_bin(bin);
+        return added;
+    }
+
+    /// Insert <key,value> into the map if it's not already there, with the
+    /// same semantics as unordered_map_concurrent::insert.
+    bool insert(const KEY& key, const VALUE& value, bool do_lock = true)
+    {
+        size_t hash = m_hash(key);
+        size_t bin  = whichbin(hash);
+        if (do_lock)
+            lock_bin(key);
+        bool added = Base::insert(key, value, false);
+        if (added)
+            index_insert(m_shards[bin], hash, key, value);
+        if (do_lock)
+            unlock_bin(bin);
+        return added;
+    }
+
+    /// If the key is in the map, safely erase it. If do_lock is false,
+    /// the caller must hold the bin lock, and the entry is freed when the
+    /// caller calls unlock_bin().
+    void erase(const KEY& key, bool do_lock = true)
+    {
+        size_t hash = m_hash(key);
+        size_t bin  = whichbin(hash);
+        if (do_lock)
+            lock_bin(key);
+        // The index mirrors the map exactly, so only touch the map (and
+        // its size) if the key was really there.
+        if (index_erase(m_shards[bin], hash, key))
+            Base::erase(key, false);
+        if (do_lock)
+            unlock_bin(bin);
+    }
+
+    /// Removes all items from the map.
+    void clear()
+    {
+        for (auto& shard : m_shards)
+            shard.mutex.lock();
+        Base::clear();
+        std::vector<Node*> nodes;
+        for (auto& shard : m_shards) {
+            if (Slots* s = shard.slots.load(std::memory_order_relaxed)) {
+                for (size_t i = 0; i <= s->mask; ++i) {
+                    Node* n = s->slot[i].load(std::memory_order_relaxed);
+                    if (n && n != tombstone())
+                        nodes.push_back(n);
+                    s->slot[i].store(nullptr, std::memory_order_release);
+                }
+            }
+            shard.live = shard.used = 0;
+        }
+        for (auto& shard : m_shards)
+            shard.mutex.unlock();
+        if (nodes.size()) {
+            retire(nodes, {});
+            synchronize();
+        }
+    }
+
+    /// Explicitly lock the bin that will contain the key (regardless of
+    /// whether there is such an entry in the map), and return its bin
+    /// number.
+    size_t lock_bin(const KEY& key)
+    {
+        size_t bin = whichbin(m_hash(key));
+        m_shards[bin].mutex.lock();
+        OIIO_MAYBE_UNUSED size_t b = Base::lock_bin(key);
+        OIIO_DASSERT(b == bin);
+        return bin;
+    }
+
+    /// Explicitly unlock the specified bin (this assumes that the caller
+    /// holds the lock), then retire anything erased while it was held.
+    void unlock_bin(size_t bin)
+    {
+        Shard& shard(m_shards[bin]);
+        std::vector<Node*> nodes;
+        std::vector<Slots*> slots;
+        nodes.swap(shard.retired_nodes);
+        slots.swap(shard.retired_slots);
+        Base::unlock_bin(bin);
+        shard.mutex.unlock();
+        if (nodes.size() || slots.size())
+            retire(nodes, slots);
+    }
+
+    std::pair<iterator, bool> find_or_insert(const KEY& key,
+                                             const VALUE& value,
+                                             bool do_lock = true)
+        = delete;
+
+private:
+    // A copy of the entry, which readers use without locking. Never
+    // modified once published (see the class comment).
+    struct Node {
+        size_t hash;
+        KEY key;
+        const VALUE value;
+    };
+
+    struct Slots {
+        explicit Slots(size_t size)
+            : mask(size - 1)
+            , slot(new std::atomic<Node*>[size])
+        {
+            for (size_t i = 0; i < size; ++i)
+                slot[i].store(nullptr, std::memory_order_relaxed);
+        }
+        size_t mask;
+        std::unique_ptr<std::atomic<Node*>[]> slot;
+    };
+
+    struct Shard {
+        OIIO_CACHE_ALIGN spin_mutex mutex;  // Serializes writers of this bin
+        std::atomic<Slots*> slots { nullptr };
+        size_t live = 0;  // Entries in the index
+        size_t used = 0;  // Slots that are not empty (live + tombstones)
+        std::vector<Node*> retired_nodes;  // Erased, free after grace period
+        std::vector<Slots*> retired_slots;  // Replaced by a bigger table
+    };
+
+    // Something unlinked from an index, waiting to be freed
+    struct Retired {
+        uint64_t epoch;  // Epoch when it was retired
+        Node* node;
+        Slots* slots;
+    };
+
+    struct ReaderStripe {
+        OIIO_CACHE_ALIGN std::atomic<int> count[2] = { 0, 0 };
+    };
+
+    static constexpr int reader_stripes = 64;
+
+    // Keeps the calling thread registered as a reader of the current
+    // epoch for as long as it exists.
+    class ReadGuard {
+    public:
+        ReadGuard(unordered_map_readmostly& map)
+        {
+            ReaderStripe& stripe(map.m_readers[thread_stripe()]);
+            for (;;) {
+                uint64_t epoch = map.m_epoch.load();
+                m_count        = &stripe.count[epoch & 1];
+                m_count->fetch_add(1);
+                // If a writer bumped the epoch between our reading it and
+                // registering, it may not have seen us; try again.
+                if (map.m_epoch.load() == epoch)
+                    break;
+                m_count->fetch_sub(1, std::memory_order_release);
+            }
+        }
+        ~ReadGuard() { m_count->fetch_sub(1, std::memory_order_release); }
+
+    private:
+        std::atomic<int>* m_count;
+    };
+
+    static int thread_stripe()
+    {
+        static std::atomic<int> next { 0 };
+        thread_local int stripe = next++ % reader_stripes;
+        return stripe;
+    }
+
+    static Node* tombstone()
+    {
+        static char marker;
+        return reinterpret_cast<Node*>(&marker);
+    }
+
+    static constexpr int log2(unsigned n)
+    {
+        return n < 2 ? 0 : 1 + log2(n / 2);
+    }
+
+    // Must agree with unordered_map_concurrent's choice of bin.
+    static size_t whichbin(size_t hash)
+    {
+        return hash >> (8 * sizeof(size_t) - log2(BINS));
+    }
+
+    const Node* lookup(const Shard& shard, size_t hash, const KEY& key) const
+    {
+        const Slots* s = shard.slots.load(std::memory_order_acquire);
+        if (!s)
+            return nullptr;
+        for (size_t i = hash & s->mask, n = 0; n <= s->mask;
+             i = (i + 1) & s->mask, ++n) {
+            const Node* node = s->slot[i].load(std::memory_order_acquire);
+            if (!node)
+                return nullptr;
+            if (node != tombstone() && node->hash == hash
+                && m_pred(node->key, key))
+                return node;
+        }
+        return nullptr;
+    }
+
+    // Caller holds the shard lock, and the key is known to be absent.
+    void index_insert(Shard& shard, size_t hash, const KEY& key,
+                      const VALUE& value)
+    {
+        Slots* s = shard.slots.load(std::memory_order_relaxed);
+        if (!s || 2 * (shard.used + 1) > s->mask + 1) {
+            size_t size = 16;
+            while (size < 4 * (shard.live + 1))
+                size *= 2;
+            s = rehash(shard, size);
+        }
+        size_t i = hash & s->mask;
+        Node* cur;
+        while ((cur = s->slot[i].load(std::memory_order_relaxed))
+               && cur != tombstone())
+            i = (i + 1) & s->mask;
+        if (!cur)
+            ++shard.used;  // Reusing a tombstone doesn't use a new slot
+        ++shard.live;
+        s->slot[i].store(new Node { hash, key, value },
+                         std::memory_order_release);
+    }
+
+    // Caller holds the shard lock. Return true if the key was found.
+    bool index_erase(Shard& shard, size_t hash, const KEY& key)
+    {
+        Slots* s = shard.slots.load(std::memory_order_relaxed);
+        if (!s)
+            return false;
+        for (size_t i = hash & s->mask, n = 0; n <= s->mask;
+             i = (i + 1) & s->mask, ++n) {
+            Node* node = s->slot[i].load(std::memory_order_relaxed);
+            if (!node)
+                return false;
+            if (node != tombstone() && node->hash == hash
+                && m_pred(node->key, key)) {
+                s->slot[i].store(tombstone(), std::memory_order_release);
+                --shard.live;
+                shard.retired_nodes.push_back(node);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Caller holds the shard lock. Build a new table holding just the live
+    // entries and publish it; the old one is retired.
+    Slots* rehash(Shard& shard, size_t size)
+    {
+        Slots* old = shard.slots.load(std::memory_order_relaxed);
+        Slots* s   = new Slots(size);
+        if (old) {
+            for (size_t j = 0; j <= old->mask; ++j) {
+                Node* node = old->slot[j].load(std::memory_order_relaxed);
+                if (!node || node == tombstone())
+                    continue;
+                size_t i = node->hash & s->mask;
+                while (s->slot[i].load(std::memory_order_relaxed))
+                    i = (i + 1) & s->mask;
+                s->slot[i].store(node, std::memory_order_relaxed);
+            }
+            shard.retired_slots.push_back(old);
+        }
+        shard.used = shard.live;
+        shard.slots.store(s, std::memory_order_release);
+        return s;
+    }
+
+    // Move on to the next epoch, which is only allowed once no reader is
+    // left from the epoch before the current one, since new readers will
+    // reuse its counters. Unless wait is true, give up (returning false)
+    // rather than wait for stragglers or for another thread that is
+    // advancing the epoch already.
+    bool advance(bool wait)
+    {
+        std::unique_lock<std::mutex> lock(m_grace_mutex, std::defer_lock);
+        if (wait)
+            lock.lock();
+        else if (!lock.try_lock())
+            return false;
+        uint64_t epoch = m_epoch.load();
+        for (auto& stripe : m_readers) {
+            const std::atomic<int>& count(stripe.count[(epoch + 1) & 1]);
+            atomic_backoff backoff;
+            while (count.load(std::memory_order_acquire)) {
+                if (!wait)
+                    return false;
+                backoff();
+            }
+        }
+        m_epoch.store(epoch + 1);
+        return true;
+    }
+
+    // Free everything retired at least two epochs ago. A reader that could
+    // have seen it registered no later than the epoch it was retired in,
+    // and the second advance since then proved all such readers gone.
+    void reclaim()
+    {
+        uint64_t epoch = m_epoch.load();
+        std::vector<Retired> done;
+        {
+            spin_lock lock(m_limbo_mutex);
+            auto safe = std::partition(m_limbo.begin(), m_limbo.end(),
+                                       [=](const Retired& r) {
+                                           return r.epoch + 2 > epoch;
+                                       });
+            done.assign(safe, m_limbo.end());
+            m_limbo.erase(safe, m_limbo.end());
+        }
+        for (Retired& r : done) {
+            delete r.node;
+            delete r.slots;
+        }
+    }
+
+    // Queue things just unlinked from an index to be freed once no reader
+    // can still see them, then free whatever is safe by now. When no
+    // lookups are in flight the two advances both succeed, so the entries
+    // just queued go right away; otherwise a later call frees them.
+    void retire(const std::vector<Node*>& nodes,
+                const std::vector<Slots*>& slots)
+    {
+        // Read the epoch after unlinking, so later readers can't see these
+        uint64_t epoch = m_epoch.load();
+        {
+            spin_lock lock(m_limbo_mutex);
+            for (Node* n : nodes)
+                m_limbo.push_back({ epoch, n, nullptr });
+            for (Slots* s : slots)
+                m_limbo.push_back({ epoch, nullptr, s });
+        }
+        if (advance(false))
+            advance(false);
+        reclaim();
+    }
+
+    // Wait until no reader can still hold a pointer to anything that was
+    // retired before this call, and free it all.
+    void synchronize()
+    {
+        advance(true);
+        advance(true);
+        reclaim();
+    }
+
+    HASH m_hash;
+    PRED m_pred;
+    Shard m_shards[BINS];
+    ReaderStripe m_readers[reader_stripes];
+    std::atomic<uint64_t> m_epoch { 0 };
+    std::mutex m_grace_mutex;      // Serializes advancing the epoch
+    spin_mutex m_limbo_mutex;      // Protects m_limbo
+    std::vector<Retired> m_limbo;  // Retired, not yet known to be safe
+};
+
+
+
+/// Algorithms for choosing which tiles to free when the cache exceeds
+/// its memory limit, selected with the "eviction_policy" attribute.
+enum class TileEvictionPolicy {
+    Clock,         ///< One clock hand sweeping the whole tile table
+    ShardedClock,  ///< Independent clock per eviction shard
+    SLRU,          ///< Segmented LRU per eviction shard
+    Count
+};
+
+
+
 /// Structure to hold IC and TS statistics.  We combine into a single
 /// structure to minimize the number of costly ImageCachePerThreadInfo
 /// retrievals.  If somebody is using the ImageCache without a
 /// TextureSystem, a few extra stats come along for the ride, but this
 /// has no performance penalty.
 struct ImageCacheStatistics {
+    static constexpr int npolicies = int(TileEvictionPolicy::Count);
+
     // First, the ImageCache-specific fields:
     long long find_tile_calls;
     long long find_tile_microcache_misses;
+    long long find_tile_microcache_assoc_hits;
     int find_tile_cache_misses;
     long long files_totalsize;
     long long files_totalsize_ondisk;
@@ -83,6 +565,39 @@ struct ImageCacheStatistics {
     double tile_locking_time;
     double find_file_time;
     double find_tile_time;
+    double tile_wait_time;
+    long long tiles_compressed;
+    long long tiles_decompressed;
+    long long compressed_raw_bytes;
+    long long compressed_bytes;
+    double decompress_time;
+    long long tiles_mapped;
+    long long shared_tiles_found;
+    long long shared_tiles_stored;
+    long long tiles_deduplicated;
+    long long dedup_bytes_saved;
+    long long batched_reads;
+    long long batched_tiles;
+    long long preload_files;
+    double preload_time;
+    long long catalog_hits;
+    long long catalog_misses;
+    double udim_inventory_time;
+    double udim_resolve_time;
+    long long diskcache_hits;
+    long long diskcache_misses;
+    long long diskcache_spills;
+    long long diskcache_bytes_read;
+    long long diskcache_bytes_written;
+    long long prefetch_requests;
+    long long prefetch_reads;
+    long long prefetch_dropped;
+    long long tiles_evicted;
+    long long tiles_promoted;
+    long long tiles_unevictable;
+    // Main cache lookups and misses, by the eviction policy in effect
+    long long policy_lookups[npolicies];
+    long long policy_misses[npolicies];
 
     // TextureSystem-specific fields below:
     long long texture_queries;
@@ -207,6 +722,28 @@ public:
     bool read_tile(ImageCachePerThreadInfo* thread_info, const TileID& id,
                    void* data);
 
+    /// If the disk cache is memory-mapped and holds the tile, return a
+    /// pointer to its pixels in the mapping, and set keepalive to keep the
+    /// mapping alive for as long as they are used. Otherwise return
+    /// nullptr.
+    const char* map_tile(ImageCachePerThreadInfo* thread_info,
+                         const TileID& id, std::shared_ptr<void>& keepalive);
+
+    /// If the shared tile pool holds the tile, return a pointer to its
+    /// pixels there, and set keepalive to keep it pinned for as long as
+    /// they are used. Otherwise return nullptr.
+    const char* find_shared_tile(ImageCachePerThreadInfo* thread_info,
+                                 const TileID& id,
+                                 std::shared_ptr<void>& keepalive);
+
+    /// Read the tile into a free slot of the shared tile pool, return a
+    /// pointer to its pixels there and set keepalive as for
+    /// find_shared_tile. Return nullptr if the tile can't be put in the
+    /// pool or could not be read.
+    const char* read_shared_tile(ImageCachePerThreadInfo* thread_info,
+                                 const TileID& id,
+                                 std::shared_ptr<void>& keepalive);
+
     /// Mark the file as recently used.
     ///
     void use(void) { m_used = true; }
@@ -236,6 +773,29 @@ public:
         return m_mipreadcount;
     }
 
+    /// Access counters of one MIP level (over all subimages), kept when
+    /// the "access_stats" attribute is set: tiles found in the shared tile
+    /// cache, tiles read (and how many of those had been read before),
+    /// and the time spent reading them, waiting for other threads to read
+    /// them, and unpacking them from the compressed tier.
+    struct MipAccessStats {
+        atomic_ll hits { 0 };                         ///< In the tile cache
+        atomic_ll misses { 0 };                       ///< Read
+        atomic_ll redundant { 0 };                    ///< Read again
+        std::atomic<double> io_time { 0.0 };          ///< Reading
+        std::atomic<double> wait_time { 0.0 };        ///< Awaiting reads
+        std::atomic<double> decompress_time { 0.0 };  ///< Unpacking
+    };
+
+    /// The access counters of a MIP level, or nullptr if there are none.
+    /// They're allocated when the file is first opened, for the number of
+    /// MIP levels it has then.
+    MipAccessStats* mipaccess(int miplevel) const
+    {
+        return miplevel < m_nmipaccess ? &m_mipaccess[miplevel] : nullptr;
+    }
+    int mipaccess_levels() const { return m_nmipaccess; }
+
     void invalidate();
 
     size_t timesopened() const { return m_timesopened; }
@@ -527,6 +1087,8 @@ private:
     volatile bool m_validspec;           ///< If false, reread spec upon open
     mutable int m_errors_issued;         ///< Errors issued for this file
     std::vector<size_t> m_mipreadcount;  ///< Tile reads per mip level
+    std::unique_ptr<MipAccessStats[]> m_mipaccess;  ///< Per mip level
+    std::atomic<int> m_nmipaccess { 0 };  ///< Length of m_mipaccess
     ImageCacheImpl& m_imagecache;        ///< Back pointer for ImageCache
     mutable std::recursive_timed_mutex
         m_input_mutex;              ///< Mutex protecting the ImageInput
@@ -539,6 +1101,25 @@ private:
     std::unique_ptr<ImageSpec> m_configspec;  // Optional configuration hints
     std::vector<UdimInfo> m_udim_lookup;      ///< Used for decoding udim tiles
                                               /// protected by mutex elsewhere!
+    bool m_udim_sparse = false;  ///< m_udim_lookup holds only the populated
+                                 ///<   tiles, sorted by v then u
+    std::once_flag m_udim_resolved;  ///< Resolve the udim tiles only once
+    bool m_from_catalog = false;  ///< Specs came from the header catalog
+    int64_t m_catalog_mtime = 0;  ///< File mtime the catalog entry matched
+    uint64_t m_catalog_size = 0;  ///< File size the catalog entry matched
+
+    /// A tile read queued to be coalesced with others (see
+    /// read_tiles_batched).
+    struct PendingTileRead {
+        const TileID* id;   ///< Which tile
+        void* data;         ///< Where its pixels go
+        bool ok   = false;  ///< Was it read successfully?
+        bool done = false;  ///< Finished (protected by m_batch_mutex)
+    };
+    std::mutex m_batch_mutex;            ///< Protect the batch state below
+    std::condition_variable m_batch_cv;  ///< Signals finished batches
+    std::vector<PendingTileRead*> m_batch_pending;  ///< Queued tile reads
+    bool m_batch_leader = false;  ///< Is a thread reading for the others?
 
     // Thread-safe retrieve a shared pointer to the ImageInput (which may
     // not currently be open). The one returned is safe to use as long as
@@ -554,8 +1135,11 @@ private:
     /// Retrieve a shared pointer to the file's open ImageInput (opening if
     /// necessary, and maintaining the limit on number of open files). For a
     /// broken file, return an empty shared ptr. This is thread-safe and
-    /// requires no external lock.
-    std::shared_ptr<ImageInput> open(ImageCachePerThreadInfo* thread_info);
+    /// requires no external lock. If header_only is true and the headers
+    /// could be filled in from the header catalog, the file is not opened
+    /// at all and an empty pointer is returned even though it's not broken.
+    std::shared_ptr<ImageInput> open(ImageCachePerThreadInfo* thread_info,
+                                     bool header_only = false);
 
     /// Release the ImageInput, if currently open. It will close and destroy
     /// when the last thread holding it is done with its shared ptr. This
@@ -576,6 +1160,27 @@ private:
     bool read_unmipped(ImageCachePerThreadInfo* thread_info, const TileID& id,
                        void* data);
 
+    /// Load the requested tile from an ordinary tiled file. Tile misses on
+    /// the file that arrive while another thread is in the middle of a
+    /// read are queued, and then all read together by that thread, with
+    /// horizontally adjacent tiles of the same level read by a single
+    /// read_tiles call.
+    bool read_tiles_batched(ImageCachePerThreadInfo* thread_info,
+                            ImageInput* inp, const TileID& id, void* data);
+
+    /// Read a run of n horizontally adjacent tiles of the same subimage,
+    /// MIP level, and channel range, setting each one's ok flag.
+    void read_tile_run(ImageCachePerThreadInfo* thread_info, ImageInput* inp,
+                       PendingTileRead* const* reads, size_t n);
+
+    /// Find where the disk cache keeps the tile: the key of the slab
+    /// holding its subimage, MIP level, channel range, and color
+    /// transform, the number of tiles in the slab and the tile's index
+    /// among them, and the tile's size in bytes. Return false if tiles of
+    /// this file should not be kept in the disk cache at all.
+    bool diskcache_slot(const TileID& id, std::string& key, int64_t& ntiles,
+                        int64_t& index, size_t& tilebytes) const;
+
     /// helpers for ImageCacheFile::open(...):
     /// search for a matching ImageSpec within the existing subimages
     ImageSpec* find_spec(int subimage, const ImageSpec& spec);
@@ -599,7 +1204,11 @@ private:
 
     // Helper for ctr: evaluate udim information, including setting
     // m_udim_tiles.
-    void udim_setup();
+    void udim_setup(ImageCachePerThreadInfo* thread_info);
+
+    // The record of udim tile (u,v), or nullptr if that tile isn't
+    // populated. Only valid for a udim file, with u and v in range.
+    UdimInfo* udim_tile(int u, int v);
 
     friend class ImageCacheImpl;
     friend class TextureSystemImpl;
@@ -614,10 +1223,17 @@ typedef intrusive_ptr<ImageCacheFile> ImageCacheFileRef;
 
 
 /// Map file names to file references
+#if IMAGECACHE_LOCKFREE_LOOKUP
+typedef unordered_map_readmostly<ustring, ImageCacheFileRef, std::hash<ustring>,
+                                 std::equal_to<ustring>, FILE_CACHE_SHARDS,
+                                 tsl::robin_map<ustring, ImageCacheFileRef>>
+    FilenameMap;
+#else
 typedef unordered_map_concurrent<ustring, ImageCacheFileRef, std::hash<ustring>,
                                  std::equal_to<ustring>, FILE_CACHE_SHARDS,
                                  tsl::robin_map<ustring, ImageCacheFileRef>>
     FilenameMap;
+#endif
 typedef tsl::robin_map<ustring, ImageCacheFileRef> FingerprintMap;
 
 
@@ -828,6 +1444,20 @@ public:
     /// read from disk.
     bool pixels_ready() const { return m_pixels_ready; }
 
+    /// May the tile be written to the disk cache when it is evicted?
+    /// Only tiles read from their files are; tiles whose pixels were
+    /// supplied by the application are not.
+    bool spillable() const { return m_spillable; }
+
+    /// Are the pixels used in place in a memory-mapped disk cache slab?
+    bool mapped() const { return m_mapped_size != 0; }
+
+    /// Are the pixels used in place in the shared tile pool?
+    bool shared() const { return m_shared; }
+
+    /// Are the pixels in a buffer that identical tiles may share?
+    bool deduplicated() const { return m_dedup; }
+
     /// Spin until the pixels have been read and are ready for use.
     ///
     void wait_pixels_ready() const;
@@ -857,6 +1487,11 @@ private:
     int m_tile_width { 0 };            ///< Tile width
     bool m_valid { false };            ///< Valid pixels
     bool m_nofree { false };  ///< We do NOT own the pixels, do not free!
+    bool m_spillable { false };  ///< Read from the file, may go to disk cache
+    size_t m_mapped_size { 0 };  ///< Mapped bytes (not in m_pixels_size)
+    bool m_shared { false };     ///< Pixels are in the shared tile pool
+    bool m_dedup { false };      ///< Pixels are in a dedup buffer
+    std::shared_ptr<void> m_mapping;  ///< Keeps mapped or shared pixels alive
     volatile bool m_pixels_ready { false };  // Pixels have been read from disk
     atomic_int m_used { 1 };                 ///< Used recently
 };
@@ -871,10 +1506,285 @@ typedef intrusive_ptr<ImageCacheTile> ImageCacheTileRef;
 
 /// Hash table that maps TileID to ImageCacheTileRef -- this is the type of the
 /// main tile cache.
+#if IMAGECACHE_LOCKFREE_LOOKUP
+typedef unordered_map_readmostly<
+    TileID, ImageCacheTileRef, TileID::Hasher, std::equal_to<TileID>,
+    TILE_CACHE_SHARDS, tsl::robin_map<TileID, ImageCacheTileRef, TileID::Hasher>>
+    TileCache;
+#else
 typedef unordered_map_concurrent<
     TileID, ImageCacheTileRef, TileID::Hasher, std::equal_to<TileID>,
     TILE_CACHE_SHARDS, tsl::robin_map<TileID, ImageCacheTileRef, TileID::Hasher>>
     TileCache;
+#endif
+
+
+
+/// One shard of the bookkeeping used by the sharded eviction policies.
+/// Every tile added to the cache is queued (by TileID) in the shard
+/// selected by its hash, and each shard is swept independently under its
+/// own lock, so eviction never serializes the whole cache.  Entries whose
+/// tiles have already left the cache are simply discarded when they reach
+/// the front of a queue.  The shard also holds the compressed copies of
+/// evicted tiles that hash to it, when the compressed tier is enabled.
+struct TileEvictionShard {
+    /// An evicted tile kept in compressed form (see "compress_tiles").
+    struct CompressedTile {
+        std::unique_ptr<char[]> data;  ///< Compressed pixels
+        size_t size         = 0;       ///< Compressed size, in bytes
+        size_t rawsize      = 0;       ///< Uncompressed size, in bytes
+        unsigned int serial = 0;       ///< Identifies its coldqueue entry
+    };
+
+    OIIO_CACHE_ALIGN spin_mutex mutex;
+    std::deque<TileID> probation;  ///< Clock ring, or SLRU probation segment
+    std::deque<TileID> protect;    ///< SLRU protected (reused) segment
+    /// Compressed tiles, oldest first. Entries whose serial no longer
+    /// matches the one in `cold` are stale and are skipped.
+    std::deque<std::pair<TileID, unsigned int>> coldqueue;
+    std::unordered_map<TileID, CompressedTile, TileID::Hasher> cold;
+    unsigned int coldserial = 0;  ///< Serial for the next compressed tile
+};
+
+
+
+/// Second-level tile cache on local disk. Tiles evicted from memory are
+/// written, uncompressed and already in the cache's internal data type,
+/// to "slab" files in the cache directory -- one slab for each file,
+/// subimage, MIP level, channel range, and color transform, with every
+/// tile at a fixed offset. Tile misses consult the slab before going back
+/// to the original file, so revisiting a texture after its tiles have
+/// been evicted costs a local read instead of another round of network
+/// I/O and decompression. Slabs are keyed by the file's fingerprint (or
+/// its name and modification time), so they may be shared by several
+/// processes and outlive them, and no longer match once a file changes.
+/// Optionally, slabs are also memory-mapped, so that tiles found there can
+/// be used in place, with the pages shared by every process using them.
+/// This is the only zero-copy path: tiles of the original files are never
+/// mapped, whatever their compression.
+class ImageCacheDiskCache {
+public:
+    ImageCacheDiskCache(string_view directory, bool mmap = false,
+                        int64_t max_bytes = 0)
+        : m_dir(directory)
+        , m_mmap(mmap)
+        , m_max_bytes(max_bytes)
+    {
+    }
+    ~ImageCacheDiskCache();
+
+    const std::string& directory() const { return m_dir; }
+
+    /// Are tiles served in place from memory-mapped slabs?
+    bool mapped() const { return m_mmap; }
+
+    /// Limit the total size of the slabs in the directory (0 means no
+    /// limit). Whenever a new slab takes the directory over the limit,
+    /// the least recently used slabs are removed.
+    void max_bytes(int64_t bytes) { m_max_bytes = bytes; }
+
+    /// If the slab named by key holds tile number `index` (of `ntiles`),
+    /// copy its `tilebytes` bytes into data and return true, otherwise
+    /// return false.
+    bool read_tile(const std::string& key, int64_t ntiles, int64_t index,
+                   size_t tilebytes, void* data);
+
+    /// Like read_tile, but for a mapped slab, return a pointer to the
+    /// tile's pixels in the mapping (followed by the usual SIMD padding)
+    /// and set keepalive to keep the mapping alive as long as the pointer
+    /// is used. Return nullptr if the tile isn't there or the slab isn't
+    /// mapped.
+    const char* map_tile(const std::string& key, int64_t ntiles,
+                         int64_t index, size_t tilebytes,
+                         std::shared_ptr<void>& keepalive);
+
+    /// Store the tile in the slab named by key, creating the slab if
+    /// needed. Return true if the tile was written, false if it was
+    /// already present or could not be written.
+    bool write_tile(const std::string& key, int64_t ntiles, int64_t index,
+                    size_t tilebytes, const void* data);
+
+private:
+    struct Slab;
+    std::shared_ptr<Slab> slab(const std::string& key, int64_t ntiles,
+                               size_t tilebytes, bool create);
+    // Remove least recently used slabs other than `keep` until the
+    // directory is within the limit. Caller holds m_mutex.
+    void prune(const std::string& keep);
+
+    std::string m_dir;  ///< Directory holding the slab files
+    bool m_mmap;        ///< Map the slabs?
+    std::atomic<int64_t> m_max_bytes;  ///< Size limit of the directory
+    std::mutex m_mutex;  ///< Protect m_slabs, m_usage, m_created
+    std::unordered_map<std::string, std::shared_ptr<Slab>> m_slabs;
+    int64_t m_usage = -1;  ///< Estimated size of the directory, -1 unknown
+    int m_created   = 0;   ///< Slabs created since m_usage was measured
+};
+
+
+
+/// One shard of the table of tile pixel buffers that identical tiles share
+/// (see "deduplicate_tiles"), keyed by a hash of the pixels. The table
+/// holds only weak references: a buffer lives as long as some tile uses
+/// it, and entries for buffers that are gone are pruned as the shard
+/// grows.
+struct TileDedupShard {
+    /// A tile's pixels (allocated with new[]), which are freed, and their
+    /// memory uncounted, when the last tile using them goes away. While
+    /// only one tile uses them they count toward the cache memory like
+    /// any tile's; once shared, evicting one of the tiles would give back
+    /// nothing, so they're counted as dedup memory instead.
+    struct Buffer {
+        Buffer(ImageCacheImpl& imagecache, char* pixels, size_t size)
+            : imagecache(imagecache)
+            , pixels(pixels)
+            , size(size)
+        {
+        }
+        ~Buffer();
+        ImageCacheImpl& imagecache;
+        char* pixels;
+        size_t size;
+        std::atomic<bool> shared { false };  ///< Used by several tiles
+    };
+
+    OIIO_CACHE_ALIGN spin_mutex mutex;
+    std::unordered_map<uint64_t, std::weak_ptr<Buffer>> buffers;
+    size_t prune_at = 1024;  ///< Size at which to next prune
+};
+
+
+
+/// Tile pool in a POSIX shared memory segment, so that the ImageCaches of
+/// several processes on one host can use a single copy of each tile. The
+/// pool is a set-associative table of fixed-size slots: a tile's key picks
+/// a set of slots, and the tile may go in any of them. Each slot has one
+/// atomic control word holding its state, a recently-used bit and the
+/// number of pins -- references from tiles in any process' cache -- and
+/// all lookups and insertions are lock-free compare-and-swaps on those
+/// words. A slot is only reused for another tile when it is unpinned and
+/// hasn't been used since the last time a new tile looked at it. Tiles
+/// are keyed like the disk cache slabs, so a changed file never matches
+/// the tiles read from its old contents.
+///
+/// Each attached pool has an entry, stamped with its process id, in a
+/// table in the segment, along with its own count of each slot's pins,
+/// and marks the slots it reserves with its entry. The pins and
+/// reservations of processes that died are taken back when another
+/// process attaches or finds a set with no free slot. The last pool to
+/// detach removes the segment.
+class ImageCacheSharedPool
+    : public std::enable_shared_from_this<ImageCacheSharedPool> {
+public:
+    /// Attach to the shared memory segment called name, first creating it
+    /// with room for poolbytes of tiles, in slots that each hold a tile of
+    /// up to slotbytes, if there is no such segment yet. On failure,
+    /// valid() is false and geterror() says why.
+    ImageCacheSharedPool(string_view name, size_t poolbytes,
+                         size_t slotbytes);
+    ~ImageCacheSharedPool();
+
+    bool valid() const { return m_base != nullptr; }
+    const std::string& name() const { return m_name; }
+    const std::string& geterror() const { return m_err; }
+
+    /// Largest tile (not counting padding) that fits in a slot.
+    size_t slotbytes() const { return m_slotbytes; }
+
+    /// If the pool holds tile number `index` of the slab named by key,
+    /// pin it and return a pointer to its pixels, setting keepalive to
+    /// hold the pin for as long as they are used. Otherwise return nullptr.
+    const char* find_tile(const std::string& key, int64_t index,
+                          std::shared_ptr<void>& keepalive);
+
+    /// Claim a slot for the tile and return a pointer to it, for the
+    /// caller to fill in with the tile's pixels and then either publish()
+    /// or abandon(). Return nullptr if every slot of the tile's set is in
+    /// use.
+    char* reserve_tile(const std::string& key, int64_t index, int64_t& slot);
+
+    /// Make the pixels of a reserved slot visible to everyone, and set
+    /// keepalive to pin them as for find_tile.
+    void publish(int64_t slot, std::shared_ptr<void>& keepalive);
+
+    /// Give back a reserved slot whose pixels could not be read.
+    void abandon(int64_t slot);
+
+private:
+    struct Header;
+    struct Slot;
+    Slot* slot(int64_t s) const;
+    char* slotdata(int64_t s) const;
+    /// The number of pins of slot s held by the given owner.
+    std::atomic<uint32_t>& pins(int owner, int64_t s) const;
+    /// Set keepalive to hold a pin of slot s, taken by the caller.
+    void hold(int64_t s, std::shared_ptr<void>& keepalive);
+    /// Drop the pins and reservations of owners whose process is gone.
+    /// Return true if there were any.
+    bool reclaim_dead_owners();
+    /// Return true at most once a second, when it's time to look for dead
+    /// owners again.
+    bool reclaim_due();
+    /// Remove the segment's name, if it still names our segment.
+    void unlink();
+
+    std::string m_name;        ///< Name of the segment
+    std::string m_err;         ///< Why the segment couldn't be used
+    char* m_base       = nullptr;  ///< The mapped segment
+    size_t m_mapsize   = 0;        ///< Size of the mapping
+    size_t m_slotbytes = 0;        ///< Tile bytes a slot holds
+    int64_t m_nsets    = 0;        ///< Number of sets of slots
+    int m_owner        = -1;       ///< Our entry in the owner table
+    uint64_t m_dev     = 0;        ///< Identity of the segment
+    uint64_t m_ino     = 0;
+    std::atomic<int64_t> m_next_reclaim { 0 };  ///< ms, steady clock
+};
+
+
+
+/// Persistent catalog of image headers. It records the native spec of
+/// every subimage and MIP level of each file the cache opens, so that a
+/// later process can fill in its record of the file without opening it
+/// again. Entries are keyed by file name and only used while the file's
+/// modification time and size still match. New entries are appended to
+/// the catalog file as files are opened, so it may be shared by several
+/// processes; when a file appears more than once, the last entry wins,
+/// and the dead entries are dropped the next time the catalog is loaded
+/// if they make up half of it.
+class ImageCacheCatalog {
+public:
+    /// Everything the catalog knows about one file.
+    struct Entry {
+        int64_t mtime = 0;   ///< Modification time of the file
+        uint64_t size = 0;   ///< Size of the file in bytes
+        std::string format;  ///< Format name of the ImageInput
+        /// Native specs as XML, indexed by [subimage][miplevel]
+        std::vector<std::vector<std::string>> specs;
+    };
+
+    /// Load the catalog at path, if it exists, and open it for appending.
+    ImageCacheCatalog(string_view path);
+    ~ImageCacheCatalog();
+
+    const std::string& path() const { return m_path; }
+
+    /// Return the entry for filename if it matches the given modification
+    /// time and size, otherwise null.
+    std::shared_ptr<const Entry> find(ustring filename, int64_t mtime,
+                                      uint64_t size) const;
+
+    /// Record (or replace) the entry for filename.
+    void add(ustring filename, std::shared_ptr<const Entry> entry);
+
+private:
+    /// Replace the catalog file with one holding only the live entries.
+    void compact();
+
+    std::string m_path;          ///< Catalog file
+    FILE* m_file = nullptr;      ///< Open for appending, or null
+    mutable std::mutex m_mutex;  ///< Protect m_entries and m_file
+    std::unordered_map<ustring, std::shared_ptr<const Entry>> m_entries;
+};
 
 
 
@@ -897,6 +1807,15 @@ public:
     atomic_int purge;  // If set, tile ptrs need purging!
     ImageCacheStatistics m_stats;
 
+    // Tiles that fall out of tile/lasttile are kept a while longer in a
+    // small set-associative cache, so that access patterns cycling among
+    // a handful of tiles (trilinear lookups straddling tile boundaries,
+    // several textures per shade) still don't need the shared cache. Each
+    // set is kept in most-recently-used order.
+    static constexpr int microcache_ways = 4;
+    std::vector<ImageCacheTileRef> m_microcache;  // sets * ways entries
+    size_t m_microcache_setmask = 0;
+
     ImageCachePerThreadInfo()
     {
         // std::cout << "Creating PerThreadInfo " << (void*)this << "\n";
@@ -921,11 +1840,72 @@ public:
         return f == m_thread_files.end() ? nullptr : f->second;
     }
 
+    // Resize the set-associative microcache (discarding its contents).
+    // The entries must be 0 or a power of two multiple of the ways.
+    void resize_microcache(int entries)
+    {
+        OIIO_DASSERT(entries % microcache_ways == 0);
+        m_microcache.clear();
+        m_microcache.resize(entries);
+        m_microcache.shrink_to_fit();
+        m_microcache_setmask = entries ? entries / microcache_ways - 1 : 0;
+    }
+
+    int microcache_size() const { return int(m_microcache.size()); }
+
+    // Drop all tiles held by the set-associative microcache.
+    void clear_microcache()
+    {
+        for (auto& t : m_microcache)
+            t.reset();
+    }
+
+    // If the tile is in the set-associative microcache, store it in tile,
+    // make it the most recently used of its set, and return true.
+    bool microcache_find(const TileID& id, ImageCacheTileRef& tile)
+    {
+        if (m_microcache.empty())
+            return false;
+        ImageCacheTileRef* set = microcache_set(id);
+        for (int w = 0; w < microcache_ways; ++w) {
+            if (set[w] && set[w]->id() == id) {
+                for (; w > 0; --w)
+                    set[w].swap(set[w - 1]);
+                tile = set[0];
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Add the tile to the set-associative microcache as the most recently
+    // used of its set, displacing the least recently used one if needed.
+    void microcache_insert(const ImageCacheTileRef& tile)
+    {
+        if (m_microcache.empty())
+            return;
+        ImageCacheTileRef* set = microcache_set(tile->id());
+        int w                  = 0;
+        while (w < microcache_ways - 1 && set[w] != tile)
+            ++w;
+        for (; w > 0; --w)
+            set[w].swap(set[w - 1]);
+        set[0] = tile;
+    }
+
     size_t heapsize() const
     {
         /// TODO: this should take into account the two last tiles, if their refcount is zero.
         constexpr size_t sizeofPair = sizeof(ustring) + sizeof(ImageCacheFile*);
-        return m_thread_files.size() * sizeofPair;
+        return m_thread_files.size() * sizeofPair
+               + m_microcache.capacity() * sizeof(ImageCacheTileRef);
+    }
+
+private:
+    ImageCacheTileRef* microcache_set(const TileID& id)
+    {
+        return &m_microcache[(id.hash() & m_microcache_setmask)
+                             * microcache_ways];
     }
 };
 
@@ -1059,6 +2039,23 @@ public:
     void inventory_udim(ImageCacheFile* udimfile, Perthread* thread_info,
                         std::vector<ustring>& filenames, int& nutiles,
                         int& nvtiles);
+    /// Find the ImageCacheFile of every populated tile of the udim file at
+    /// once, so that later resolve_udim calls are simple lookups. Only the
+    /// first call for a udim file does any work (in parallel if there are
+    /// many tiles); concurrent callers wait for it to finish.
+    void resolve_udim_tiles(ImageCacheFile* udimfile,
+                            ImageCachePerThreadInfo* thread_info);
+
+    /// The entries of a directory (full paths), remembered so that udim
+    /// patterns sharing a directory don't each list it again. A remembered
+    /// listing is used only while the directory's modification time is
+    /// unchanged.
+    std::shared_ptr<const std::vector<std::string>>
+    directory_listing(const std::string& dirname);
+
+    /// Forget the remembered listing of the directory holding filename,
+    /// thread-safe.
+    void forget_directory_listing(ustring filename);
 
     bool get_thumbnail(ustring filename, ImageBuf& thumbnail, int subimage = 0);
     bool get_thumbnail(ImageHandle* file, Perthread* thread_info,
@@ -1097,6 +2094,21 @@ public:
                     stride_t zstride = AutoStride, int cache_chbegin = 0,
                     int cache_chend = -1);
 
+    /// Fetch the region of a MIP level with the given dims by calling
+    /// fetch(piece, thread_info) for the pieces of it lying in each tile.
+    /// If the region touches enough tiles (and "get_pixels_threads"
+    /// allows it), the pieces are fetched in parallel so that the reads
+    /// of the missing tiles overlap, otherwise the whole region is one
+    /// piece. Each piece gets the per-thread info of the thread fetching
+    /// it (the given one on the calling thread), and errors issued on
+    /// other threads are moved to the calling thread. A piece that fails
+    /// doesn't keep the others from being fetched. Return false if any
+    /// piece failed.
+    bool fetch_region(
+        const ImageCacheFile::ImageDims& dims, const ROI& region,
+        ImageCachePerThreadInfo* thread_info,
+        function_view<bool(const ROI&, ImageCachePerThreadInfo*)> fetch);
+
     // Find the ImageCacheFile record for the named image, adding an entry
     // if it is not already in the cache. This returns a plain old pointer,
     // which is ok because the file hash table has ref-counted pointers and
@@ -1141,8 +2153,12 @@ public:
     bool tile_in_cache(const TileID& id,
                        ImageCachePerThreadInfo* /*thread_info*/)
     {
+#if IMAGECACHE_LOCKFREE_LOOKUP
+        return m_tilecache.contains(id);
+#else
         TileCache::iterator found = m_tilecache.find(id);
         return (found != m_tilecache.end());
+#endif
     }
 
     /// Add the tile to the cache.  This will also enforce cache memory
@@ -1178,6 +2194,19 @@ public:
                 return true;
             }
         }
+        // Not either of the last two tiles. The older of them is about to
+        // be displaced; it moves to the set-associative microcache, but
+        // only after we've searched it, so it can't evict what we seek.
+        ImageCacheTileRef displaced;
+        displaced.swap(tile);
+        bool found = thread_info->microcache_find(id, tile);
+        if (displaced)
+            thread_info->microcache_insert(displaced);
+        if (found) {
+            tile->use();
+            ++thread_info->m_stats.find_tile_microcache_assoc_hits;
+            return true;
+        }
         return find_tile_main_cache(id, tile, thread_info);
         // N.B. find_tile_main_cache marks the tile as used
     }
@@ -1187,6 +2216,10 @@ public:
     Tile* get_tile(ImageHandle* file, Perthread* thread_info, int subimage,
                    int miplevel, int x, int y, int z, int chbegin, int chend);
     void release_tile(Tile* tile) const;
+    void prefetch(ustring filename, int subimage, int miplevel, const ROI& roi);
+    int preload_headers(cspan<ustring> filenames, int nthreads);
+    void prefetch(ImageHandle* file, Perthread* thread_info, int subimage,
+                  int miplevel, const ROI& roi);
     TypeDesc tile_format(const Tile* tile) const;
     ROI tile_roi(const Tile* tile) const;
     const void* tile_pixels(Tile* tile, TypeDesc& format) const;
@@ -1208,6 +2241,7 @@ public:
     bool has_error() const;
     std::string geterror(bool clear = true) const;
     std::string getstats(int level = 1) const;
+    std::string getstats_json() const;
     void reset_stats();
     void invalidate(ustring filename, bool force);
     void invalidate(ImageHandle* file, bool force);
@@ -1245,6 +2279,42 @@ public:
     /// Called when a tile's pixel memory is allocated, but a new tile
     /// is not created.
     void incr_mem(size_t size) { m_mem_used += size; }
+    void decr_mem(size_t size) { m_mem_used -= size; }
+
+    /// Track the memory of tiles used in place in mapped disk cache slabs,
+    /// which is not subject to the memory limit.
+    void incr_mapped_mem(size_t size) { m_mapped_mem += size; }
+    void decr_mapped_mem(size_t size) { m_mapped_mem -= size; }
+
+    /// Track the part of the tile memory that is in the shared tile pool.
+    void incr_shared_mem(size_t size) { m_shared_mem += size; }
+    void decr_shared_mem(size_t size) { m_shared_mem -= size; }
+
+    /// Track the memory of pixel buffers shared by several tiles, which
+    /// is not subject to the memory limit.
+    void incr_dedup_mem(size_t size) { m_dedup_mem += size; }
+    void decr_dedup_mem(size_t size) { m_dedup_mem -= size; }
+
+    /// The access counters of the tile's MIP level if "access_stats" is
+    /// set, otherwise nullptr.
+    ImageCacheFile::MipAccessStats* mipaccess(const TileID& id) const
+    {
+        return m_access_stats ? id.file().mipaccess(id.miplevel()) : nullptr;
+    }
+
+    /// Is per-tile deduplication enabled?
+    bool deduplicate_tiles() const { return m_deduplicate_tiles; }
+
+    /// Take ownership of a freshly read tile's pixels (size bytes,
+    /// allocated with new[] and already counted in the cache memory) and
+    /// look for an identical buffer among the tiles already in memory. If
+    /// there is one, free ours, point pixels at that one instead, and
+    /// return true. Otherwise put ours in a buffer that later duplicates
+    /// may share, and return false. Either way, keepalive is set to hold
+    /// the buffer, which accounts for its memory from then on.
+    bool deduplicate_pixels(char*& pixels, size_t size,
+                            std::shared_ptr<void>& keepalive,
+                            ImageCacheStatistics& stats);
 
     /// Called when a tile is destroyed, to update all the stats.
     ///
@@ -1281,6 +2351,32 @@ public:
 
     ustring colorspace() const noexcept { return m_colorspace; }
 
+    /// If the compressed tier holds the tile, move it back out of the
+    /// tier, decompressing its pixels into data, and return true.
+    bool decompress_tile(const TileID& id, void* data,
+                         ImageCacheStatistics& stats);
+
+    /// The disk tile cache, or null if it is disabled.
+    std::shared_ptr<ImageCacheDiskCache> diskcache() const
+    {
+        spin_lock lock(m_diskcache_mutex);
+        return m_diskcache;
+    }
+
+    /// The shared memory tile pool, or null if it is disabled.
+    std::shared_ptr<ImageCacheSharedPool> sharedpool() const
+    {
+        spin_lock lock(m_sharedpool_mutex);
+        return m_sharedpool;
+    }
+
+    /// The persistent header catalog, or null if it is disabled.
+    std::shared_ptr<ImageCacheCatalog> catalog() const
+    {
+        spin_lock lock(m_catalog_mutex);
+        return m_catalog;
+    }
+
     size_t heapsize() const;
     size_t footprint(ImageCacheFootprint& output) const;
 
@@ -1296,6 +2392,64 @@ private:
     /// Enforce the max memory for tile data.
     void check_max_mem(ImageCachePerThreadInfo* thread_info);
 
+    /// The original eviction: one clock hand over the whole tile table.
+    void check_max_mem_clock(ImageCachePerThreadInfo* thread_info);
+
+    /// Record a newly added tile in its eviction shard.
+    void track_tile(const TileID& id);
+
+    /// Sweep the (locked) shard until one tile is freed, returning true,
+    /// or until the shard has nothing evictable, returning false. The
+    /// freed tile is handed back in victim, so that the caller can spill
+    /// it to the disk cache after unlocking the shard.
+    bool evict_one_tile(TileEvictionShard& shard, ImageCacheTileRef& victim,
+                        ImageCacheStatistics& stats);
+
+    /// Write a tile that is leaving the cache to the disk cache, if there
+    /// is one and the tile is eligible.
+    void spill_tile(const ImageCacheTileRef& tile,
+                    ImageCacheStatistics& stats);
+
+    /// Keep a compressed copy of a tile that is leaving the cache, if the
+    /// compressed tier is enabled and the tile compresses well, then trim
+    /// the tier back to its share of the memory limit.
+    void compress_tile(const ImageCacheTileRef& tile,
+                       ImageCacheStatistics& stats);
+
+    /// Free the oldest compressed tile of the (locked) shard, returning
+    /// true, or return false if the shard holds none.
+    bool drop_compressed_tile(TileEvictionShard& shard);
+
+    /// Free one compressed tile from whichever shard has one, returning
+    /// false if there are none.
+    bool drop_compressed_tile();
+
+    /// Free every compressed tile.
+    void clear_compressed_tiles();
+
+    /// Empty the eviction shards, and if repopulate is true, refill them
+    /// with every tile currently in the cache.
+    void reset_eviction_shards(bool repopulate);
+
+    /// Remove the eviction entries for all tiles of the given file.
+    void forget_tiles(const ImageCacheFile* file);
+
+    /// Queue an asynchronous read of the tile, unless it is already
+    /// resident or the prefetch queue is full.
+    void queue_prefetch(const TileID& id, ImageCachePerThreadInfo* thread_info);
+
+    /// Called by a prefetch worker: page in the tile if it is not
+    /// already in the cache.
+    void prefetch_tile(const TileID& id);
+
+    /// After a tile miss, queue the tiles most likely to be needed next:
+    /// the neighbors to the right and below, and the tile covering the
+    /// same region on the next coarser MIP level.
+    void readahead(const TileID& id, ImageCachePerThreadInfo* thread_info);
+
+    /// Drain and shut down the prefetch thread pool, if there is one.
+    void stop_prefetch_threads();
+
     /// Internal statistics printing routine
     ///
     void printstats() const;
@@ -1319,6 +2473,9 @@ private:
     /// Clear the fingerprint list, thread-safe.
     void clear_fingerprints();
 
+    /// Forget the remembered directory listings, thread-safe.
+    void clear_directory_listings();
+
     uint64_t imagecache_id;
     std::vector<std::unique_ptr<ImageCachePerThreadInfo>> m_all_perthread_info;
     static spin_mutex m_perthread_info_mutex;  ///< Thread safety for perthread
@@ -1352,15 +2509,59 @@ private:
 
     spin_mutex m_fingerprints_mutex;  ///< Protect m_fingerprints
     FingerprintMap m_fingerprints;    ///< Map fingerprints to files
+    /// A remembered directory listing, and the directory's modification
+    /// time when it was listed.
+    struct DirListing {
+        std::time_t mtime;
+        std::shared_ptr<const std::vector<std::string>> entries;
+    };
+    std::mutex m_dir_listings_mutex;  ///< Protect m_dir_listings
+    std::unordered_map<std::string, DirListing>
+        m_dir_listings;  ///< Remembered directory listings (for udims)
+    /// The most directory listings remembered at once
+    static const size_t max_dir_listings = 1024;
 
     /// FIXME: if unordered_map_concurrent had const iterators,
     /// m_tilecache wouldn't need to be mutable
     mutable TileCache m_tilecache;  ///< Our in-memory tile cache
     TileID m_tile_sweep_id;         ///< Sweeper for "clock" paging algorithm
     spin_mutex m_tile_sweep_mutex;  ///< Ensure only one in check_max_mem
+    TileEvictionPolicy m_eviction_policy;  ///< How to choose tiles to free
+    TileEvictionShard m_eviction_shards[TILE_EVICTION_SHARDS];
+    std::atomic<unsigned int> m_eviction_cursor;  ///< Next shard to sweep
 
     atomic_ll m_mem_used;       ///< Memory being used for tiles
     int m_statslevel;           ///< Statistics level
+
+    int m_prefetch_threads;    ///< Background threads for prefetch
+    int m_readahead;           ///< Prefetch neighbors of missed tiles?
+    int m_microcache_size;     ///< Per-thread set-associative tile cache
+    int m_get_pixels_threads;  ///< Max threads for one region fetch
+    std::unique_ptr<thread_pool> m_prefetch_pool;  ///< Created on demand
+    std::mutex m_prefetch_mutex;                   ///< Protect the pool
+    atomic_int m_prefetch_queued;       ///< Tiles waiting in the queue
+    std::atomic<bool> m_prefetch_stop;  ///< Shutting down the pool
+    std::string m_diskcache_dir;  ///< Directory for the disk tile cache
+    std::shared_ptr<ImageCacheDiskCache> m_diskcache;  ///< null if disabled
+    mutable spin_mutex m_diskcache_mutex;  ///< Protect m_diskcache
+    bool m_compress_tiles;       ///< Keep evicted tiles compressed?
+    atomic_ll m_compressed_mem;  ///< Memory used by compressed tiles
+    bool m_diskcache_mmap;       ///< Use disk cache tiles in place?
+    int m_diskcache_max_MB;      ///< Size limit of the disk cache (0: none)
+    atomic_ll m_mapped_mem;      ///< Memory of tiles used in place
+    std::string m_shared_pool;   ///< Name of the shared tile pool segment
+    int m_shared_pool_MB;        ///< Size of a newly created pool
+    int m_shared_pool_tile_KB;   ///< Slot size of a newly created pool
+    std::shared_ptr<ImageCacheSharedPool> m_sharedpool;  ///< null if disabled
+    mutable spin_mutex m_sharedpool_mutex;  ///< Protect m_sharedpool
+    atomic_ll m_shared_mem;      ///< Memory of tiles in the shared pool
+    bool m_deduplicate_tiles;    ///< Share buffers of identical tiles?
+    atomic_ll m_dedup_mem;       ///< Memory of buffers tiles share
+    bool m_access_stats;         ///< Keep per-file, per-mip access stats?
+    TileDedupShard m_dedup_shards[TILE_DEDUP_SHARDS];
+    std::string m_header_catalog;  ///< Persistent header catalog file
+    std::shared_ptr<ImageCacheCatalog> m_catalog;  ///< null if disabled
+    mutable spin_mutex m_catalog_mutex;            ///< Protect m_catalog
     int m_max_errors_per_file;  ///< Max errors to print for each file.
 
     // For debugging -- keep track of who holds the tile and file mutex
@@ -14,6 +14,7 @@
 #include <OpenImageIO/fmath.h>
 #include <OpenImageIO/imagecache.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/simd.h>
 #include <OpenImageIO/strutil.h>
 #include <OpenImageIO/texture.h>
 #include <OpenImageIO/typedesc.h>
@@ -24,6 +25,7 @@
 
 OIIO_NAMESPACE_BEGIN
 using namespace pvt;
+using namespace simd;
 using LevelInfo    = ImageCacheFile::LevelInfo;
 using SubimageInfo = ImageCacheFile::SubimageInfo;
 using ImageDims    = ImageCacheFile::ImageDims;
@@ -48,6 +50,74 @@ float2float(float val)
     return val;
 }
 
+
+
+// Cubic B-spline weights (and their derivatives, if dw is not null) for
+// the four texels around a lookup, the same filter the 2D bicubic lookups
+// use.
+inline void
+bspline_weights(float fraction, float w[4], float dw[4])
+{
+    float one_frac = 1.0f - fraction;
+    w[0] = (1.0f / 6.0f) * one_frac * one_frac * one_frac;
+    w[1] = (2.0f / 3.0f) - 0.5f * fraction * fraction * (2.0f - fraction);
+    w[2] = (2.0f / 3.0f) - 0.5f * one_frac * one_frac * (2.0f - one_frac);
+    w[3] = (1.0f / 6.0f) * fraction * fraction * fraction;
+    if (dw) {
+        dw[0] = -0.5f * one_frac * one_frac;
+        dw[1] = 0.5f * fraction * (3.0f * fraction - 4.0f);
+        dw[2] = -0.5f * one_frac * (3.0f * one_frac - 4.0f);
+        dw[3] = 0.5f * fraction * fraction;
+    }
+}
+
+
+
+// The tiles touched by a single volume lookup. Neighboring texels of a
+// trilinear or tricubic footprint nearly always share a tile, so each
+// distinct tile is asked of the ImageCache (and its per-thread microcache)
+// only once per lookup, and the references held here keep the tiles
+// resident until the lookup is done. N must be at least the number of
+// distinct tiles the footprint can span (8 for trilinear, 64 for tricubic).
+template<int N> class FootprintTiles {
+public:
+    // Return the tile with origin (x,y,z), calling find(x,y,z) -- which
+    // returns an ImageCacheTileRef -- only the first time it's needed.
+    template<class Find>
+    ImageCacheTile* get(int x, int y, int z, Find&& find)
+    {
+        if (m_last >= 0 && same(m_last, x, y, z))
+            return m_tiles[m_last].get();
+        for (int i = 0; i < m_n; ++i) {
+            if (same(i, x, y, z)) {
+                m_last = i;
+                return m_tiles[i].get();
+            }
+        }
+        OIIO_DASSERT(m_n < N);
+        ImageCacheTileRef tile = find(x, y, z);
+        if (!tile || m_n == N)
+            return nullptr;
+        m_xyz[m_n][0] = x;
+        m_xyz[m_n][1] = y;
+        m_xyz[m_n][2] = z;
+        m_tiles[m_n]  = tile;
+        m_last        = m_n++;
+        return m_tiles[m_last].get();
+    }
+
+private:
+    bool same(int i, int x, int y, int z) const
+    {
+        return m_xyz[i][0] == x && m_xyz[i][1] == y && m_xyz[i][2] == z;
+    }
+
+    int m_n    = 0;
+    int m_last = -1;
+    int m_xyz[N][3];
+    ImageCacheTileRef m_tiles[N];
+};
+
 }  // end anonymous namespace
 
 bool
@@ -280,10 +350,15 @@ TextureSystemImpl::texture3d_lookup_nomip(
         // Must be in the same order as InterpMode enum
         &TextureSystemImpl::accum3d_sample_closest,
         &TextureSystemImpl::accum3d_sample_bilinear,
-        &TextureSystemImpl::accum3d_sample_bilinear,  // FIXME: bicubic,
+        &TextureSystemImpl::accum3d_sample_bilinear,
         &TextureSystemImpl::accum3d_sample_bilinear,
     };
-    accum3d_prototype accumer = accum_functions[(int)options.interpmode];
+    // Tricubic volume lookups are opt-in (see "texture3d_bicubic").
+    bool tricubic = options.interpmode == TextureOpt::InterpBicubic
+                    && m_texture3d_bicubic;
+    accum3d_prototype accumer = tricubic
+                                    ? &TextureSystemImpl::accum3d_sample_bicubic
+                                    : accum_functions[(int)options.interpmode];
     bool ok = (this->*accumer)(P, 0, texturefile, thread_info, options,
                                nchannels_result, actualchannels, 1.0f, result,
                                dresultds, dresultdt, dresultdr);
@@ -469,6 +544,56 @@ trilerp_accum(float* accum, float* daccumds, float* daccumdt, float* daccumdr,
 
 
 
+// SIMD version of trilerp_accum for up to 4 channels: all channels of the
+// 8 texels are loaded and interpolated at once. The arithmetic is the same
+// as the scalar version, so the results are too.
+template<class T>
+void
+trilerp_accum_simd(float* accum, float* daccumds, float* daccumdt,
+                   float* daccumdr, const unsigned char* texel[2][2][2],
+                   float sfrac, float tfrac, float rfrac, int actualchannels,
+                   float weight, const ImageDims& dims)
+{
+    OIIO_DASSERT(actualchannels <= 4);
+    vfloat4 v[2][2][2];
+    for (int k = 0; k < 2; ++k)
+        for (int j = 0; j < 2; ++j)
+            for (int i = 0; i < 2; ++i)
+                v[k][j][i] = pvt::load_texel4<T>(texel[k][j][i]);
+    vfloat4 a;
+    a.load(accum, actualchannels);
+    a += weight
+         * trilerp(v[0][0][0], v[0][0][1], v[0][1][0], v[0][1][1], v[1][0][0],
+                   v[1][0][1], v[1][1][0], v[1][1][1], sfrac, tfrac, rfrac);
+    a.store(accum, actualchannels);
+    if (daccumds) {
+        float scalex = weight * dims.full_width;
+        float scaley = weight * dims.full_height;
+        float scalez = weight * dims.full_depth;
+        vfloat4 ds, dt, dr;
+        ds.load(daccumds, actualchannels);
+        dt.load(daccumdt, actualchannels);
+        dr.load(daccumdr, actualchannels);
+        ds += scalex
+              * bilerp(v[0][0][1] - v[0][0][0], v[0][1][1] - v[0][1][0],
+                       v[1][0][1] - v[1][0][0], v[1][1][1] - v[1][1][0], tfrac,
+                       rfrac);
+        dt += scaley
+              * bilerp(v[0][1][0] - v[0][0][0], v[0][1][1] - v[0][0][1],
+                       v[1][1][0] - v[1][0][0], v[1][1][1] - v[1][0][1], sfrac,
+                       rfrac);
+        dr += scalez
+              * bilerp(v[0][1][0] - v[1][1][0], v[0][1][1] - v[1][1][1],
+                       v[0][0][1] - v[1][0][0], v[0][1][1] - v[1][1][1], sfrac,
+                       tfrac);
+        ds.store(daccumds, actualchannels);
+        dt.store(daccumdt, actualchannels);
+        dr.store(daccumdr, actualchannels);
+    }
+}
+
+
+
 bool
 TextureSystemImpl::accum3d_sample_bilinear(
     const Imath::V3f& P, int miplevel, TextureFile& texturefile,
@@ -566,7 +691,7 @@ TextureSystemImpl::accum3d_sample_bilinear(
     int tileheightmask = dims.tile_height - 1;
     int tiledepthmask  = dims.tile_depth - 1;
     const unsigned char* texel[2][2][2];
-    TileRef savetile[2][2][2];
+    FootprintTiles<8> footprint;
     static float black[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
     int tile_s            = (stex[0] - dims.x) % dims.tile_width;
     int tile_t            = (ttex[0] - dims.y) % dims.tile_height;
@@ -615,6 +740,14 @@ TextureSystemImpl::accum3d_sample_bilinear(
         texel[1][1][1] = b + pixelsize * dims.tile_width + pixelsize;
     } else {
         bool firstsample = true;
+        auto find        = [&](int x, int y, int z) {
+            id.xyz(x, y, z);
+            bool ok = find_tile(id, thread_info, firstsample);
+            if (!ok)
+                error("{}", m_imagecache->geterror());
+            firstsample = false;
+            return thread_info->tile;
+        };
         for (int k = 0; k < 2; ++k) {
             for (int j = 0; j < 2; ++j) {
                 for (int i = 0; i < 2; ++i) {
@@ -625,16 +758,12 @@ TextureSystemImpl::accum3d_sample_bilinear(
                     tile_s = (stex[i] - dims.x) % dims.tile_width;
                     tile_t = (ttex[j] - dims.y) % dims.tile_height;
                     tile_r = (rtex[k] - dims.z) % dims.tile_depth;
-                    id.xyz(stex[i] - tile_s, ttex[j] - tile_t,
-                           rtex[k] - tile_r);
-                    bool ok = find_tile(id, thread_info, firstsample);
-                    if (!ok)
-                        error("{}", m_imagecache->geterror());
-                    firstsample = false;
-                    TileRef& tile(thread_info->tile);
-                    if (!tile->valid())
+                    ImageCacheTile* tile = footprint.get(stex[i] - tile_s,
+                                                         ttex[j] - tile_t,
+                                                         rtex[k] - tile_r,
+                                                         find);
+                    if (!tile || !tile->valid())
                         return false;
-                    savetile[k][j][i]   = tile;
                     imagesize_t tilepel = (tile_r * dims.tile_height
                                            + imagesize_t(tile_t))
                                               * dims.tile_width
@@ -651,14 +780,29 @@ TextureSystemImpl::accum3d_sample_bilinear(
 #endif
                     OIIO_DASSERT((size_t)offset < si.get_tile_bytes(miplevel));
                     texel[k][j][i] = tile->bytedata() + offset;
-                    OIIO_DASSERT(tile->id() == id);
                 }
             }
         }
     }
-    // FIXME -- optimize the above loop by unrolling
 
-    if (pixeltype == TypeDesc::UINT8) {
+    if (actualchannels <= 4) {
+        if (pixeltype == TypeDesc::UINT8)
+            trilerp_accum_simd<uint8_t>(accum, daccumds, daccumdt, daccumdr,
+                                        texel, sfrac, tfrac, rfrac,
+                                        actualchannels, weight, dims);
+        else if (pixeltype == TypeDesc::UINT16)
+            trilerp_accum_simd<uint16_t>(accum, daccumds, daccumdt, daccumdr,
+                                         texel, sfrac, tfrac, rfrac,
+                                         actualchannels, weight, dims);
+        else if (pixeltype == TypeDesc::HALF)
+            trilerp_accum_simd<half>(accum, daccumds, daccumdt, daccumdr,
+                                     texel, sfrac, tfrac, rfrac,
+                                     actualchannels, weight, dims);
+        else
+            trilerp_accum_simd<float>(accum, daccumds, daccumdt, daccumdr,
+                                      texel, sfrac, tfrac, rfrac,
+                                      actualchannels, weight, dims);
+    } else if (pixeltype == TypeDesc::UINT8) {
         trilerp_accum<uint8_t>(accum, daccumds, daccumdt, daccumdr, texel,
                                sfrac, tfrac, rfrac, actualchannels, weight, si,
                                miplevel, uchar2float);
@@ -682,20 +826,216 @@ TextureSystemImpl::accum3d_sample_bilinear(
 
 
 
+bool
+TextureSystemImpl::accum3d_sample_bicubic(
+    const Imath::V3f& P, int miplevel, TextureFile& texturefile,
+    PerThreadInfo* thread_info, TextureOpt& options, int nchannels_result,
+    int actualchannels, float weight, float* accum, float* daccumds,
+    float* daccumdt, float* daccumdr)
+{
+    const SubimageInfo& si(texturefile.subimageinfo(options.subimage));
+    const LevelInfo& lvl(si.levelinfo(miplevel));
+    const ImageDims& dims(si.leveldims(miplevel));
+    TypeDesc::BASETYPE pixeltype = texturefile.pixeltype(options.subimage);
+    // Remap to texel coords, with samples at texel centers, as for the
+    // trilinear lookup. The 4x4x4 footprint starts one texel before the
+    // one to the "upper left" of the lookup point.
+    float s = P.x * dims.full_width + dims.full_x - 0.5f;
+    float t = P.y * dims.full_height + dims.full_y - 0.5f;
+    float r = P.z * dims.full_depth + dims.full_z - 0.5f;
+    int sint, tint, rint;
+    float sfrac = floorfrac(s, &sint);
+    float tfrac = floorfrac(t, &tint);
+    float rfrac = floorfrac(r, &rint);
+
+    wrap_impl swrap_func = wrap_functions[(int)options.swrap];
+    wrap_impl twrap_func = wrap_functions[(int)options.twrap];
+    wrap_impl rwrap_func = wrap_functions[(int)options.rwrap];
+    int stex[4], ttex[4], rtex[4];
+    bool svalid[4], tvalid[4], rvalid[4];
+    bool anyvalid[3] = { false, false, false };
+    for (int i = 0; i < 4; ++i) {
+        stex[i]   = sint - 1 + i;
+        ttex[i]   = tint - 1 + i;
+        rtex[i]   = rint - 1 + i;
+        svalid[i] = swrap_func(stex[i], dims.x, dims.width);
+        tvalid[i] = twrap_func(ttex[i], dims.y, dims.height);
+        rvalid[i] = rwrap_func(rtex[i], dims.z, dims.depth);
+        if (!lvl.full_pixel_range) {
+            svalid[i] &= (stex[i] >= dims.x && stex[i] < dims.x + dims.width);
+            tvalid[i] &= (ttex[i] >= dims.y && ttex[i] < dims.y + dims.height);
+            rvalid[i] &= (rtex[i] >= dims.z && rtex[i] < dims.z + dims.depth);
+        }
+        anyvalid[0] |= svalid[i];
+        anyvalid[1] |= tvalid[i];
+        anyvalid[2] |= rvalid[i];
+    }
+    if (!(anyvalid[0] && anyvalid[1] && anyvalid[2])) {
+        // All texels we need were out of range and using 'black' wrap.
+        return true;
+    }
+
+    float ws[4], wt[4], wr[4], dws[4], dwt[4], dwr[4];
+    bspline_weights(sfrac, ws, daccumds ? dws : nullptr);
+    bspline_weights(tfrac, wt, daccumds ? dwt : nullptr);
+    bspline_weights(rfrac, wr, daccumds ? dwr : nullptr);
+
+    if (nchannels_result > actualchannels && options.fill) {
+        // Add appropriate amount of "fill" color to extra channels in
+        // non-"black"-wrapped regions.
+        float sv = 0.0f, tv = 0.0f, rv = 0.0f;
+        for (int i = 0; i < 4; ++i) {
+            sv += svalid[i] ? ws[i] : 0.0f;
+            tv += tvalid[i] ? wt[i] : 0.0f;
+            rv += rvalid[i] ? wr[i] : 0.0f;
+        }
+        float f = sv * tv * rv * weight * options.fill;
+        for (int c = actualchannels; c < nchannels_result; ++c)
+            accum[c] += f;
+    }
+    if (actualchannels <= 0)
+        return true;
+
+    int tile_chbegin = 0, tile_chend = dims.nchannels;
+    if (dims.nchannels > m_max_tile_channels) {
+        // For files with many channels, narrow the range we cache
+        tile_chbegin = options.firstchannel;
+        tile_chend   = options.firstchannel + actualchannels;
+    }
+    TileID id(texturefile, options.subimage, miplevel, 0, 0, 0, tile_chbegin,
+              tile_chend, options.colortransformid);
+    size_t channelsize    = texturefile.channelsize(options.subimage);
+    int startchan_in_tile = options.firstchannel - id.chbegin();
+    int tile_s[4], tile_t[4], tile_r[4];
+    for (int i = 0; i < 4; ++i) {
+        tile_s[i] = (stex[i] - dims.x) % dims.tile_width;
+        tile_t[i] = (ttex[i] - dims.y) % dims.tile_height;
+        tile_r[i] = (rtex[i] - dims.z) % dims.tile_depth;
+    }
+
+    FootprintTiles<64> footprint;
+    bool firstsample = true;
+    auto find        = [&](int x, int y, int z) {
+        id.xyz(x, y, z);
+        bool ok = find_tile(id, thread_info, firstsample);
+        if (!ok)
+            error("{}", m_imagecache->geterror());
+        firstsample = false;
+        return thread_info->tile;
+    };
+    auto load = [=](const unsigned char* p) {
+        if (pixeltype == TypeDesc::UINT8)
+            return pvt::load_texel4<uint8_t>(p);
+        if (pixeltype == TypeDesc::UINT16)
+            return pvt::load_texel4<uint16_t>(p);
+        if (pixeltype == TypeDesc::HALF)
+            return pvt::load_texel4<half>(p);
+        return pvt::load_texel4<float>(p);
+    };
+
+    // Separable filter, four channels at a time: each row of 4 texels is
+    // filtered in s, the rows in t, and the planes in r. The derivative in
+    // each direction swaps in the derivative weights along that axis.
+    for (int cbegin = 0; cbegin < actualchannels; cbegin += 4) {
+        int nc = std::min(actualchannels - cbegin, 4);
+        vfloat4 sum = vfloat4::Zero(), ds = sum, dt = sum, dr = sum;
+        for (int k = 0; k < 4; ++k) {
+            if (!rvalid[k])
+                continue;
+            vfloat4 plane = vfloat4::Zero(), plane_ds = plane, plane_dt = plane;
+            for (int j = 0; j < 4; ++j) {
+                if (!tvalid[j])
+                    continue;
+                vfloat4 row = vfloat4::Zero(), row_ds = row;
+                for (int i = 0; i < 4; ++i) {
+                    if (!svalid[i])
+                        continue;
+                    ImageCacheTile* tile
+                        = footprint.get(stex[i] - tile_s[i],
+                                        ttex[j] - tile_t[j],
+                                        rtex[k] - tile_r[k], find);
+                    if (!tile || !tile->valid())
+                        return false;
+                    imagesize_t tilepel
+                        = (tile_r[k] * dims.tile_height
+                           + imagesize_t(tile_t[j]))
+                              * dims.tile_width
+                          + tile_s[i];
+                    imagesize_t offset = (dims.nchannels * tilepel
+                                          + startchan_in_tile + cbegin)
+                                         * channelsize;
+                    OIIO_DASSERT(offset < si.get_tile_bytes(miplevel));
+                    vfloat4 texel = load(tile->bytedata() + offset);
+                    row += ws[i] * texel;
+                    if (daccumds)
+                        row_ds += dws[i] * texel;
+                }
+                plane += wt[j] * row;
+                if (daccumds) {
+                    plane_ds += wt[j] * row_ds;
+                    plane_dt += dwt[j] * row;
+                }
+            }
+            sum += wr[k] * plane;
+            if (daccumds) {
+                ds += wr[k] * plane_ds;
+                dt += wr[k] * plane_dt;
+                dr += dwr[k] * plane;
+            }
+        }
+        vfloat4 a;
+        a.load(accum + cbegin, nc);
+        a += weight * sum;
+        a.store(accum + cbegin, nc);
+        if (daccumds) {
+            vfloat4 d;
+            d.load(daccumds + cbegin, nc);
+            d += (weight * dims.full_width) * ds;
+            d.store(daccumds + cbegin, nc);
+            d.load(daccumdt + cbegin, nc);
+            d += (weight * dims.full_height) * dt;
+            d.store(daccumdt + cbegin, nc);
+            d.load(daccumdr + cbegin, nc);
+            d += (weight * dims.full_depth) * dr;
+            d.store(daccumdr + cbegin, nc);
+        }
+    }
+    return true;
+}
+
+
+
 bool
 TextureSystemImpl::texture3d(TextureHandle* texture_handle,
-                             Perthread* thread_info, TextureOptBatch& options,
+                             Perthread* thread_info_, TextureOptBatch& options,
                              Tex::RunMask mask, const float* P,
                              const float* dPdx, const float* dPdy,
                              const float* dPdz, int nchannels, float* result,
                              float* dresultds, float* dresultdt,
                              float* dresultdr)
 {
-    // (FIXME) CHEAT! Texture points individually
+    mask &= Tex::RunMaskOn;
+    if (!mask)
+        return true;
+
+    // Everything that is uniform across the batch -- file verification,
+    // subimage, wrap modes -- is done once for the whole batch rather than
+    // once per lane.
+    PerThreadInfo* thread_info = m_imagecache->get_perthread_info(
+        (PerThreadInfo*)thread_info_);
+    TextureFile* texturefile = verify_texturefile((TextureFile*)texture_handle,
+                                                  thread_info);
+
+    int nlanes = 0;
+    for (int i = 0; i < Tex::BatchWidth; ++i)
+        nlanes += (mask >> i) & 1;
+    ImageCacheStatistics& stats(thread_info->m_stats);
+    ++stats.texture3d_batches;
+    stats.texture3d_queries += nlanes;
+
     TextureOpt opt;
     opt.firstchannel        = options.firstchannel;
     opt.subimage            = options.subimage;
-    opt.subimagename        = options.subimagename;
     opt.swrap               = (TextureOpt::Wrap)options.swrap;
     opt.twrap               = (TextureOpt::Wrap)options.twrap;
     opt.mipmode             = (TextureOpt::MipMode)options.mipmode;
@@ -705,46 +1045,114 @@ TextureSystemImpl::texture3d(TextureHandle* texture_handle,
     opt.fill                = options.fill;
     opt.missingcolor        = options.missingcolor;
     opt.rwrap               = (TextureOpt::Wrap)options.rwrap;
-
-    bool ok          = true;
-    Tex::RunMask bit = 1;
-    float* r         = OIIO_ALLOCA(float, 4 * nchannels * Tex::BatchWidth);
-    float* drds      = r + 1 * nchannels * Tex::BatchWidth;
-    float* drdt      = r + 2 * nchannels * Tex::BatchWidth;
-    float* drdr      = r + 3 * nchannels * Tex::BatchWidth;
-    for (int i = 0; i < Tex::BatchWidth; ++i, bit <<= 1) {
-        if (mask & bit) {
-            opt.sblur  = options.sblur[i];
-            opt.tblur  = options.tblur[i];
-            opt.rblur  = options.rblur[i];
-            opt.swidth = options.swidth[i];
-            opt.twidth = options.twidth[i];
-            opt.rwidth = options.rwidth[i];
-            Imath::V3f P_(P[i], P[i + Tex::BatchWidth],
-                          P[i + 2 * Tex::BatchWidth]);
-            Imath::V3f dPdx_(dPdx[i], dPdx[i + Tex::BatchWidth],
-                             dPdx[i + 2 * Tex::BatchWidth]);
-            Imath::V3f dPdy_(dPdy[i], dPdy[i + Tex::BatchWidth],
-                             dPdy[i + 2 * Tex::BatchWidth]);
-            Imath::V3f dPdz_(dPdz[i], dPdz[i + Tex::BatchWidth],
-                             dPdz[i + 2 * Tex::BatchWidth]);
-            if (dresultds) {
-                ok &= texture3d(texture_handle, thread_info, opt, P_, dPdx_,
-                                dPdy_, dPdz_, nchannels, r, drds, drdt, drdr);
-                for (int c = 0; c < nchannels; ++c) {
-                    result[c * Tex::BatchWidth + i]    = r[c];
-                    dresultds[c * Tex::BatchWidth + i] = drds[c];
-                    dresultdt[c * Tex::BatchWidth + i] = drdt[c];
-                    dresultdr[c * Tex::BatchWidth + i] = drdr[c];
-                }
-            } else {
-                ok &= texture3d(texture_handle, thread_info, opt, P_, dPdx_,
-                                dPdy_, dPdz_, nchannels, r);
-                for (int c = 0; c < nchannels; ++c) {
-                    result[c * Tex::BatchWidth + i] = r[c];
-                }
+    opt.colortransformid    = options.colortransformid;
+
+    float* r    = OIIO_ALLOCA(float, 4 * nchannels);
+    float* drds = r + 1 * nchannels;
+    float* drdt = r + 2 * nchannels;
+    float* drdr = r + 3 * nchannels;
+
+    // Scatter one lane's worth of contiguous results into the SoA outputs.
+    auto store_lane = [&](int lane) {
+        for (int c = 0; c < nchannels; ++c)
+            result[c * Tex::BatchWidth + lane] = r[c];
+        if (dresultds) {
+            for (int c = 0; c < nchannels; ++c) {
+                dresultds[c * Tex::BatchWidth + lane] = drds[c];
+                dresultdt[c * Tex::BatchWidth + lane] = drdt[c];
+                dresultdr[c * Tex::BatchWidth + lane] = drdr[c];
             }
         }
+    };
+    auto missing_lanes = [&]() {
+        bool ok = true;
+        for (int i = 0; i < Tex::BatchWidth; ++i) {
+            if (mask & (Tex::RunMask(1) << i)) {
+                ok &= missing_texture(opt, nchannels, r,
+                                      dresultds ? drds : nullptr, drdt, drdr);
+                store_lane(i);
+            }
+        }
+        return ok;
+    };
+
+    if (!texturefile || texturefile->broken())
+        return missing_lanes();
+
+    if (!options.subimagename.empty()) {
+        // If subimage was specified by name, figure out its index.
+        int s = m_imagecache->subimage_from_name(texturefile,
+                                                 options.subimagename);
+        if (s < 0) {
+            error("Unknown subimage \"{}\" in texture \"{}\"",
+                  options.subimagename, texturefile->filename());
+            return missing_lanes();
+        }
+        opt.subimage = s;
+    }
+    if (opt.subimage < 0 || opt.subimage >= texturefile->subimages()) {
+        error("Unknown subimage \"{}\" in texture \"{}\"", options.subimagename,
+              texturefile->filename());
+        return missing_lanes();
+    }
+
+    const SubimageInfo& si(texturefile->subimageinfo(opt.subimage));
+    const ImageSpec& spec(si.spec());
+
+    // Figure out the wrap functions
+    if (opt.swrap == TextureOpt::WrapDefault)
+        opt.swrap = (TextureOpt::Wrap)texturefile->swrap();
+    if (opt.swrap == TextureOpt::WrapPeriodic && ispow2(spec.width))
+        opt.swrap = TextureOpt::WrapPeriodicPow2;
+    if (opt.twrap == TextureOpt::WrapDefault)
+        opt.twrap = (TextureOpt::Wrap)texturefile->twrap();
+    if (opt.twrap == TextureOpt::WrapPeriodic && ispow2(spec.height))
+        opt.twrap = TextureOpt::WrapPeriodicPow2;
+    if (opt.rwrap == TextureOpt::WrapDefault)
+        opt.rwrap = (TextureOpt::Wrap)texturefile->rwrap();
+    if (opt.rwrap == TextureOpt::WrapPeriodic && ispow2(spec.depth))
+        opt.rwrap = TextureOpt::WrapPeriodicPow2;
+
+    int actualchannels = OIIO::clamp(spec.nchannels - opt.firstchannel, 0,
+                                     nchannels);
+    bool gray_to_rgb   = (actualchannels < nchannels && opt.firstchannel == 0
+                        && m_gray_to_rgb);
+
+    // Transform the points of all lanes into local space at once, with the
+    // same arithmetic as Imath's multVecMatrix.
+    Tex::FloatWide x(P), y(P + Tex::BatchWidth), z(P + 2 * Tex::BatchWidth);
+    if (si.Mlocal) {
+        const Imath::M44f& M(*si.Mlocal);
+        Tex::FloatWide a = x * M[0][0] + y * M[1][0] + z * M[2][0] + M[3][0];
+        Tex::FloatWide b = x * M[0][1] + y * M[1][1] + z * M[2][1] + M[3][1];
+        Tex::FloatWide c = x * M[0][2] + y * M[1][2] + z * M[2][2] + M[3][2];
+        Tex::FloatWide w = x * M[0][3] + y * M[1][3] + z * M[2][3] + M[3][3];
+        x                = a / w;
+        y                = b / w;
+        z                = c / w;
+    }
+    alignas(Tex::BatchAlign) float xval[Tex::BatchWidth],
+        yval[Tex::BatchWidth], zval[Tex::BatchWidth];
+    x.store(xval);
+    y.store(yval);
+    z.store(zval);
+
+    // The volume lookups don't filter, so the derivatives of P are unused
+    // (see the single-point texture3d).
+    const Imath::V3f dPzero(0.0f);
+    bool ok = true;
+    for (int i = 0; i < Tex::BatchWidth; ++i) {
+        if (!(mask & (Tex::RunMask(1) << i)))
+            continue;
+        ok &= texture3d_lookup_nomip(*texturefile, thread_info, opt, nchannels,
+                                     actualchannels,
+                                     Imath::V3f(xval[i], yval[i], zval[i]),
+                                     dPzero, dPzero, dPzero, r,
+                                     dresultds ? drds : nullptr, drdt, drdr);
+        if (gray_to_rgb)
+            fill_gray_channels(spec, nchannels, r, dresultds ? drds : nullptr,
+                               drdt, drdr);
+        store_lane(i);
     }
     return ok;
 }
@@ -17,6 +17,7 @@ OIIO_NAMESPACE_BEGIN
 
 class ImageCache;
 class TextureSystemImpl;
+class TextureTraceRecorder;
 class Filter1D;
 
 #ifndef OPENIMAGEIO_IMAGECACHE_PVT_H
@@ -242,6 +243,7 @@ public:
     void invalidate_all(bool force = false);
     void close(ustring filename);
     void close_all();
+    int preload_headers(cspan<ustring> filenames, int nthreads);
 
     // void operator delete(void* todel) { ::delete ((char*)todel); }
 
@@ -329,6 +331,34 @@ public:
         float _dsdx, float _dtdx, float _dsdy, float _dtdy, float* result,
         float* dresultds, float* resultdt);
 
+    /// Look up texture for all the lanes of a batch that are enabled in
+    /// `mask`. The batch-wide options (wrap, interp, mip mode, subimage)
+    /// come from `options`, the per-lane ones (blur, width, rnd) from
+    /// `batchopt`. The s, t, and derivative inputs are arrays of
+    /// Tex::BatchWidth floats, already remapped for flip_t and overscan.
+    /// Results are accumulated into zero-initialized, BatchAlign-aligned
+    /// arrays laid out as result[c*Tex::BatchWidth + lane].
+    bool texture_lookup_batch(TextureFile& texfile, PerThreadInfo* thread_info,
+                              TextureOpt& options,
+                              const TextureOptBatch& batchopt,
+                              Tex::RunMask mask, int nchannels_result,
+                              int actualchannels, const float* s,
+                              const float* t, const float* dsdx,
+                              const float* dtdx, const float* dsdy,
+                              const float* dtdy, float* result,
+                              float* dresultds, float* dresultdt);
+
+    /// Fallback for batches that can't use texture_lookup_batch (UDIM
+    /// files, whose lanes may each resolve to a different file, or more
+    /// than 4 channels): do each lane individually with the single point
+    /// texture() call.
+    bool texture_lanes(TextureHandle* texture_handle, Perthread* thread_info,
+                       TextureOptBatch& options, Tex::RunMask mask,
+                       const float* s, const float* t, const float* dsdx,
+                       const float* dtdx, const float* dsdy, const float* dtdy,
+                       int nchannels, float* result, float* dresultds,
+                       float* dresultdt);
+
     // For the samplers, it's guaranteed that all float* inputs and outputs
     // are padded to length 'simd' and aligned to a simd*4-byte boundary
     // (for example, 4 for SSE). This means that the functions can behave AS
@@ -359,6 +389,34 @@ public:
                         simd::vfloat4* accum, simd::vfloat4* daccumds,
                         simd::vfloat4* daccumdt);
 
+    /// Drop-in replacement for sample_bilinear (same prototype) that
+    /// filters the probes of one anisotropic lookup eight at a time: the
+    /// texel coordinates, tile membership and bilinear weights of a group
+    /// of probes are computed in vfloat8 lanes, and the four corner texels
+    /// of every probe interior to a resident tile are fetched with SIMD
+    /// gathers. Probes that touch a tile edge, wrap, or leave the data
+    /// window fall back to sample_bilinear together.
+    bool sample_bilinear_aniso(int nsamples, const float* s, const float* t,
+                               int level, TextureFile& texturefile,
+                               PerThreadInfo* thread_info, TextureOpt& options,
+                               int nchannels_result, int actualchannels,
+                               const float* weight, simd::vfloat4* accum,
+                               simd::vfloat4* daccumds,
+                               simd::vfloat4* daccumdt);
+
+    /// Bilinear sample of one MIP level for every lane of a batch enabled
+    /// in `mask`, one probe per lane, weighted by weight[lane] and added to
+    /// the SoA accumulators (accum[c*Tex::BatchWidth + lane]). Lanes whose
+    /// 2x2 footprint is interior to a single tile are gathered one tile at
+    /// a time and filtered together in SIMD across lanes; the rest (tile
+    /// edges, wrapping, fill) go through sample_bilinear individually.
+    bool sample_bilinear_batch(Tex::RunMask mask, const float* s,
+                               const float* t, const float* weight, int level,
+                               TextureFile& texturefile,
+                               PerThreadInfo* thread_info, TextureOpt& options,
+                               int nchannels_result, int actualchannels,
+                               float* accum, float* daccumds, float* daccumdt);
+
     // Define a prototype of a member function pointer for texture3d
     // lookups.
     typedef bool (TextureSystemImpl::*texture3d_lookup_prototype)(
@@ -391,6 +449,12 @@ public:
                                  int actualchannels, float weight, float* accum,
                                  float* daccumds, float* daccumdt,
                                  float* daccumdr);
+    bool accum3d_sample_bicubic(const Imath::V3f& P, int level,
+                                TextureFile& texturefile,
+                                PerThreadInfo* thread_info, TextureOpt& options,
+                                int nchannels_result, int actualchannels,
+                                float weight, float* accum, float* daccumds,
+                                float* daccumdt, float* daccumdr);
 
     /// Helper function to calculate the anisotropic aspect ratio from
     /// the major and minor ellipse axis lengths.  The "clamped" aspect
@@ -469,6 +533,8 @@ public:
     int m_max_tile_channels;  ///< narrow tile ID channel range when
                               ///<   the file has more channels
     int m_stochastic;
+    int m_aniso_simd;  ///< Use the vectorized anisotropic probe filter?
+    int m_texture3d_bicubic;  ///< Tricubic volume lookups for InterpBicubic?
     static EightBitConverter<float> uchar2float;
 
     enum StochasticStrategyBits {
@@ -480,6 +546,14 @@ public:
 
     std::unique_ptr<Filter1D> hq_filter;  // Better filter for magnification
     int m_statslevel;
+    std::string m_trace_file;  ///< Where lookups are being recorded
+    /// The recorder in use, if any. Lookups fetch it once and use their
+    /// copy; recorders that are replaced are only closed, and stay in
+    /// m_traces until the TextureSystem is destroyed, so a lookup still
+    /// holding one never touches freed memory.
+    std::atomic<TextureTraceRecorder*> m_trace { nullptr };
+    std::vector<std::unique_ptr<TextureTraceRecorder>> m_traces;
+    mutable std::mutex m_trace_mutex;  ///< Protects m_trace_file, m_traces
     friend class TextureSystem;
 };
 
@@ -554,6 +628,51 @@ TextureSystemImpl::st_to_texel(float s, float t, TextureFile& texturefile,
 }
 
 
+
+namespace pvt {
+
+// Load the first four channels of a texel of tile data of type T as
+// floats, scaled like the scalar converters (uint8 and uint16 map to
+// [0,1]). Tiles are allocated with padding past their last texel, so
+// reading four channels is always safe.
+template<class T>
+OIIO_FORCEINLINE simd::vfloat4
+load_texel4(const unsigned char* p);
+
+template<>
+OIIO_FORCEINLINE simd::vfloat4
+load_texel4<float>(const unsigned char* p)
+{
+    simd::vfloat4 v;
+    v.load((const float*)p);
+    return v;
+}
+
+template<>
+OIIO_FORCEINLINE simd::vfloat4
+load_texel4<half>(const unsigned char* p)
+{
+    return simd::vfloat4((const half*)p);
+}
+
+template<>
+OIIO_FORCEINLINE simd::vfloat4
+load_texel4<uint8_t>(const unsigned char* p)
+{
+    return simd::vfloat4((const unsigned char*)p)
+           * simd::vfloat4(1.0f / 255.0f);
+}
+
+template<>
+OIIO_FORCEINLINE simd::vfloat4
+load_texel4<uint16_t>(const unsigned char* p)
+{
+    return simd::vfloat4((const unsigned short*)p)
+           * simd::vfloat4(1.0f / 65535.0f);
+}
+
+}  // namespace pvt
+
 OIIO_NAMESPACE_END
 
 #endif  // OPENIMAGEIO_TEXTURE_PVT_H
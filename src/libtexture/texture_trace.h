@@ -0,0 +1,46 @@
+// Copyright Contributors to the OpenImageIO project.
+// SPDX-License-Identifier: Apache-2.0
+// https://github.com/AcademySoftwareFoundation/OpenImageIO
+
+
+/// \file
+/// Layout of the texture lookup traces written by the TextureSystem
+/// "trace_file" attribute and read back by testtex --replay.
+
+
+#pragma once
+
+#include <cstdint>
+
+#include <OpenImageIO/oiioversion.h>
+
+
+OIIO_NAMESPACE_BEGIN
+
+namespace pvt {
+
+// Trace file layout (native endian): the 8-byte magic "OIIOTTR1" followed
+// by a stream of records, each introduced by a one-byte tag:
+//   'N'  uint32 id, uint32 length, name chars   -- defines a name id
+//   'L'  TextureTraceLookup                      -- one 2D lookup
+// Names (texture files and subimage names) are defined before the first
+// lookup that refers to them. Name ids start at 1; 0 means "no name".
+static const char texture_trace_magic[8] = { 'O', 'I', 'I', 'O',
+                                             'T', 'T', 'R', '1' };
+
+struct TextureTraceLookup {
+    uint32_t file;          // name id of the texture file
+    uint32_t subimagename;  // name id of the subimage name, 0 if none
+    float s, t, dsdx, dtdx, dsdy, dtdy;
+    float sblur, tblur, swidth, twidth, fill, rnd;
+    int32_t firstchannel, subimage, colortransformid;
+    uint16_t anisotropic;
+    uint8_t nchannels, swrap, twrap, mipmode, interpmode;
+    uint8_t flags;  // 1 = conservative_filter, 2 = derivatives requested
+};
+static_assert(sizeof(TextureTraceLookup) == 76,
+              "texture trace records must keep their size");
+
+}  // namespace pvt
+
+OIIO_NAMESPACE_END
@@ -6,14 +6,17 @@
 #include <cmath>
 #include <cstring>
 #include <list>
+#include <mutex>
 #include <random>
 #include <sstream>
 #include <string>
+#include <thread>
 
 #include <OpenImageIO/Imath.h>
 
 #include <OpenImageIO/color.h>
 #include <OpenImageIO/dassert.h>
+#include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/filter.h>
 #include <OpenImageIO/fmath.h>
 #include <OpenImageIO/imagebuf.h>
@@ -29,8 +32,10 @@
 #include <OpenImageIO/typedesc.h>
 #include <OpenImageIO/ustring.h>
 
+#include "../libOpenImageIO/simd_dispatch.h"
 #include "imagecache_pvt.h"
 #include "texture_pvt.h"
+#include "texture_trace.h"
 
 #define TEX_FAST_MATH 1
 
@@ -85,6 +90,155 @@ static const OIIO_SIMD4_ALIGN vbool4 channel_masks[5] = {
 
 
 
+/// Records texture lookups to a trace file (see texture_trace.h). Lookups
+/// are appended to one of a handful of buffers chosen by thread, so that
+/// recording from many threads does not serialize on a single lock; full
+/// buffers are written to the file in whole records.
+class TextureTraceRecorder {
+public:
+    TextureTraceRecorder(FILE* file)
+        : m_file(file)
+    {
+        fwrite(texture_trace_magic, 1, sizeof(texture_trace_magic), m_file);
+    }
+    ~TextureTraceRecorder() { close(); }
+
+    /// Write out everything recorded so far and close the file. Lookups
+    /// that arrive later (from threads that fetched the recorder before it
+    /// was replaced) are ignored.
+    void close()
+    {
+        for (auto& shard : m_shards) {
+            spin_lock lock(shard.mutex);
+            write_buffer(shard);
+            shard.closed = true;
+            std::vector<char>().swap(shard.buffer);
+            shard.names.clear();
+        }
+        std::lock_guard<std::mutex> lock(m_file_mutex);
+        if (m_file) {
+            fclose(m_file);
+            m_file = nullptr;
+        }
+    }
+
+    void record(ustring filename, const TextureOpt& opt, float s, float t,
+                float dsdx, float dtdx, float dsdy, float dtdy, int nchannels,
+                bool derivs)
+    {
+        size_t shardindex = std::hash<std::thread::id>()(
+                                std::this_thread::get_id())
+                            % nshards;
+        Shard& shard(m_shards[shardindex]);
+        spin_lock lock(shard.mutex);
+        if (shard.closed)
+            return;
+
+        TextureTraceLookup rec;
+        rec.file             = name_id(shard, filename);
+        rec.subimagename     = opt.subimagename.empty()
+                                   ? 0
+                                   : name_id(shard, opt.subimagename);
+        rec.s                = s;
+        rec.t                = t;
+        rec.dsdx             = dsdx;
+        rec.dtdx             = dtdx;
+        rec.dsdy             = dsdy;
+        rec.dtdy             = dtdy;
+        rec.sblur            = opt.sblur;
+        rec.tblur            = opt.tblur;
+        rec.swidth           = opt.swidth;
+        rec.twidth           = opt.twidth;
+        rec.fill             = opt.fill;
+        rec.rnd              = opt.rnd;
+        rec.firstchannel     = opt.firstchannel;
+        rec.subimage         = opt.subimage;
+        rec.colortransformid = opt.colortransformid;
+        rec.anisotropic      = opt.anisotropic;
+        rec.nchannels        = uint8_t(nchannels);
+        rec.swrap            = uint8_t(opt.swrap);
+        rec.twrap            = uint8_t(opt.twrap);
+        rec.mipmode          = uint8_t(opt.mipmode);
+        rec.interpmode       = uint8_t(opt.interpmode);
+        rec.flags = (opt.conservative_filter ? 1 : 0) | (derivs ? 2 : 0);
+        shard.buffer.push_back('L');
+        const char* bytes = (const char*)&rec;
+        shard.buffer.insert(shard.buffer.end(), bytes, bytes + sizeof(rec));
+        if (shard.buffer.size() >= buffer_size)
+            write_buffer(shard);
+    }
+
+    /// Write out everything recorded so far.
+    void flush()
+    {
+        for (auto& shard : m_shards) {
+            spin_lock lock(shard.mutex);
+            write_buffer(shard);
+        }
+        std::lock_guard<std::mutex> lock(m_file_mutex);
+        if (m_file)
+            fflush(m_file);
+    }
+
+private:
+    static constexpr size_t nshards     = 16;
+    static constexpr size_t buffer_size = 1 << 20;
+
+    struct Shard {
+        spin_mutex mutex;
+        bool closed = false;
+        std::vector<char> buffer;
+        std::unordered_map<ustring, uint32_t> names;  // local id cache
+    };
+
+    // Return the id of the name, writing its definition straight to the
+    // file the first time it's seen. Because definitions bypass the
+    // shard buffers, they always land ahead of any lookup that uses them.
+    // Caller must hold the shard's lock.
+    uint32_t name_id(Shard& shard, ustring name)
+    {
+        auto local = shard.names.find(name);
+        if (local != shard.names.end())
+            return local->second;
+        uint32_t id = global_name_id(name);
+        shard.names.emplace(name, id);
+        return id;
+    }
+
+    uint32_t global_name_id(ustring name)
+    {
+        std::lock_guard<std::mutex> lock(m_file_mutex);
+        auto found = m_names.find(name);
+        if (found != m_names.end())
+            return found->second;
+        uint32_t id  = uint32_t(m_names.size()) + 1;
+        uint32_t len = uint32_t(name.size());
+        m_names.emplace(name, id);
+        fputc('N', m_file);
+        fwrite(&id, sizeof(id), 1, m_file);
+        fwrite(&len, sizeof(len), 1, m_file);
+        fwrite(name.c_str(), 1, len, m_file);
+        return id;
+    }
+
+    // Caller must hold the shard's lock.
+    void write_buffer(Shard& shard)
+    {
+        if (shard.buffer.empty())
+            return;
+        std::lock_guard<std::mutex> lock(m_file_mutex);
+        fwrite(shard.buffer.data(), 1, shard.buffer.size(), m_file);
+        shard.buffer.clear();
+    }
+
+    FILE* m_file;
+    std::mutex m_file_mutex;  // guards m_file and m_names
+    std::unordered_map<ustring, uint32_t> m_names;
+    Shard m_shards[nshards];
+};
+
+
+
 void
 TextureSystem::impl_deleter(TextureSystemImpl* todel)
 {
@@ -513,6 +667,14 @@ TextureSystem::close_all()
 
 
 
+int
+TextureSystem::preload_headers(cspan<ustring> filenames, int nthreads)
+{
+    return m_impl->preload_headers(filenames, nthreads);
+}
+
+
+
 bool
 TextureSystem::has_error() const
 {
@@ -748,6 +910,8 @@ TextureSystemImpl::init()
     m_flip_t            = false;
     m_max_tile_channels = 6;
     m_stochastic        = StochasticStrategy_None;
+    m_aniso_simd        = 1;
+    m_texture3d_bicubic = 0;
     hq_filter.reset(Filter1D::create("b-spline", 4));
     m_statslevel = 0;
 
@@ -765,6 +929,8 @@ TextureSystemImpl::init()
 TextureSystemImpl::~TextureSystemImpl()
 {
     printstats();
+    m_trace = nullptr;
+    m_traces.clear();  // flush and close any lookup trace
     // Erase any leftover errors from this thread
     // TODO: can we clear other threads' errors?
     // TODO: potentially unsafe due to the static destruction order fiasco
@@ -802,6 +968,9 @@ TextureSystemImpl::getstats(int level, bool icstats) const
         INTOPT(flip_t);
         INTOPT(max_tile_channels);
         INTOPT(stochastic);
+        INTOPT(aniso_simd);
+        INTOPT(texture3d_bicubic);
+        STROPT(trace_file);
 #undef BOOLOPT
 #undef INTOPT
 #undef STROPT
@@ -893,6 +1062,35 @@ TextureSystemImpl::attribute(string_view name, TypeDesc type, const void* val)
         m_stochastic = *(const int*)val;
         return true;
     }
+    if (name == "aniso_simd" && type == TypeInt) {
+        m_aniso_simd = *(const int*)val;
+        return true;
+    }
+    if (name == "texture3d_bicubic" && type == TypeInt) {
+        m_texture3d_bicubic = *(const int*)val;
+        return true;
+    }
+    if (name == "trace_file" && type == TypeString) {
+        std::string filename(*(const char**)val);
+        std::lock_guard<std::mutex> lock(m_trace_mutex);
+        // Lookups in flight may still be using the current recorder, so it
+        // is only closed (flushing the trace) here, and freed along with
+        // the TextureSystem.
+        if (TextureTraceRecorder* trace = m_trace.exchange(nullptr))
+            trace->close();
+        m_trace_file.clear();
+        if (filename.empty())
+            return true;
+        FILE* file = Filesystem::fopen(filename, "wb");
+        if (!file) {
+            error("Could not open texture trace file \"{}\"", filename);
+            return false;
+        }
+        m_traces.emplace_back(new TextureTraceRecorder(file));
+        m_trace      = m_traces.back().get();
+        m_trace_file = filename;
+        return true;
+    }
     if (name == "statistics:level" && type == TypeInt) {
         m_statslevel = *(const int*)val;
         // DO NOT RETURN! pass the same message to the image cache
@@ -924,6 +1122,9 @@ TextureSystemImpl::getattributetype(string_view name) const
         { "flip_t", TypeInt },
         { "max_tile_channels", TypeInt },
         { "stochastic", TypeInt },
+        { "aniso_simd", TypeInt },
+        { "texture3d_bicubic", TypeInt },
+        { "trace_file", TypeString },
     };
     // clang-format on
 
@@ -973,6 +1174,19 @@ TextureSystemImpl::getattribute(string_view name, TypeDesc type,
         *(int*)val = m_stochastic;
         return true;
     }
+    if (name == "aniso_simd" && type == TypeInt) {
+        *(int*)val = m_aniso_simd;
+        return true;
+    }
+    if (name == "texture3d_bicubic" && type == TypeInt) {
+        *(int*)val = m_texture3d_bicubic;
+        return true;
+    }
+    if (name == "trace_file" && type == TypeString) {
+        std::lock_guard<std::mutex> lock(m_trace_mutex);
+        *(ustring*)val = ustring(m_trace_file);
+        return true;
+    }
 
     // If not one of these, maybe it's an attribute meant for the image cache?
     return m_imagecache->getattribute(name, type, val);
@@ -1243,11 +1457,6 @@ TextureSystemImpl::get_texels(TextureHandle* texture_handle_,
     const SubimageInfo& si(texfile->subimageinfo(subimage));
     const ImageDims& dims(si.leveldims(miplevel));
 
-    // FIXME -- this could be WAY more efficient than starting from
-    // scratch for each pixel within the rectangle.  Instead, we should
-    // grab a whole tile at a time and memcpy it rapidly.  But no point
-    // doing anything more complicated (not to mention bug-prone) until
-    // somebody reports this routine as being a bottleneck.
     int nchannels      = chend - chbegin;
     int actualchannels = OIIO::clamp(dims.nchannels - chbegin, 0, nchannels);
     int tile_chbegin = 0, tile_chend = dims.nchannels;
@@ -1256,57 +1465,92 @@ TextureSystemImpl::get_texels(TextureHandle* texture_handle_,
         tile_chbegin = chbegin;
         tile_chend   = chbegin + actualchannels;
     }
-    TileID tileid(*texfile, subimage, miplevel, 0, 0, 0, tile_chbegin,
-                  tile_chend, options.colortransformid);
+    TypeDesc cachetype       = texfile->datatype(subimage);
     size_t formatchannelsize = format.size();
     size_t formatpixelsize   = nchannels * formatchannelsize;
     size_t scanlinesize      = (xend - xbegin) * formatpixelsize;
     size_t zplanesize        = (yend - ybegin) * scanlinesize;
-    imagesize_t npixelsread  = 0;
-    bool ok                  = true;
-    for (int z = zbegin; z < zend; ++z) {
-        if (z < dims.z || z >= (dims.z + std::max(dims.depth, 1))) {
-            // nonexistent planes
-            memset(result, 0, zplanesize);
-            result = (void*)((char*)result + zplanesize);
-            continue;
-        }
-        tileid.z(z - ((z - dims.z) % std::max(1, dims.tile_depth)));
-        for (int y = ybegin; y < yend; ++y) {
-            if (y < dims.y || y >= (dims.y + dims.height)) {
-                // nonexistent scanlines
-                memset(result, 0, scanlinesize);
-                result = (void*)((char*)result + scanlinesize);
+
+    // Fill the part r of the region, using the per-thread info ti. Within
+    // each tile, a scanline's run of texels is converted in one call when
+    // the tile holds exactly the channels asked for.
+    auto fetch = [&](const ROI& r, ImageCachePerThreadInfo* ti) -> bool {
+        TileID tileid(*texfile, subimage, miplevel, 0, 0, 0, tile_chbegin,
+                      tile_chend, options.colortransformid);
+        size_t rowsize          = r.width() * formatpixelsize;
+        imagesize_t npixelsread = 0;
+        bool ok                 = true;
+        for (int z = r.zbegin; z < r.zend; ++z) {
+            char* zptr = (char*)result + (z - zbegin) * zplanesize
+                         + (r.ybegin - ybegin) * scanlinesize
+                         + (r.xbegin - xbegin) * formatpixelsize;
+            if (z < dims.z || z >= (dims.z + std::max(dims.depth, 1))) {
+                // nonexistent planes
+                for (int y = r.ybegin; y < r.yend; ++y, zptr += scanlinesize)
+                    memset(zptr, 0, rowsize);
                 continue;
             }
-            tileid.y(y - ((y - dims.y) % dims.tile_height));
-            for (int x = xbegin; x < xend; ++x, ++npixelsread) {
-                if (x < dims.x || x >= (dims.x + dims.width)) {
-                    // nonexistent columns
-                    memset(result, 0, formatpixelsize);
-                    result = (void*)((char*)result + formatpixelsize);
+            tileid.z(z - ((z - dims.z) % std::max(1, dims.tile_depth)));
+            char* yptr = zptr;
+            for (int y = r.ybegin; y < r.yend; ++y, yptr += scanlinesize) {
+                if (y < dims.y || y >= (dims.y + dims.height)) {
+                    // nonexistent scanlines
+                    memset(yptr, 0, rowsize);
                     continue;
                 }
-                tileid.x(x - ((x - dims.x) % dims.tile_width));
-                ok &= find_tile(tileid, thread_info, npixelsread == 0);
-                TileRef& tile(thread_info->tile);
-                const char* data;
-                if (tile
-                    && (data = (const char*)tile->data(x, y, z, chbegin))) {
-                    convert_pixel_values(texfile->datatype(subimage), data,
-                                         format, result, actualchannels);
-                    for (int c = actualchannels; c < nchannels; ++c)
-                        convert_pixel_values(TypeFloat, &options.fill, format,
-                                             (char*)result
-                                                 + c * formatchannelsize,
-                                             1);
-                } else {
-                    memset(result, 0, formatpixelsize);
+                tileid.y(y - ((y - dims.y) % dims.tile_height));
+                char* xptr = yptr;
+                for (int x = r.xbegin; x < r.xend;) {
+                    if (x < dims.x || x >= (dims.x + dims.width)) {
+                        // nonexistent columns
+                        memset(xptr, 0, formatpixelsize);
+                        ++x;
+                        xptr += formatpixelsize;
+                        continue;
+                    }
+                    int tx      = x - ((x - dims.x) % dims.tile_width);
+                    int spanend = std::min({ tx + dims.tile_width, r.xend,
+                                             dims.x + dims.width });
+                    int span    = spanend - x;
+                    tileid.x(tx);
+                    ok &= find_tile(tileid, ti, npixelsread == 0);
+                    npixelsread += span;
+                    TileRef& tile(ti->tile);
+                    const char* data;
+                    if (!tile
+                        || !(data = (const char*)tile->data(x, y, z,
+                                                            chbegin))) {
+                        memset(xptr, 0, span * formatpixelsize);
+                    } else if (actualchannels == nchannels
+                               && tile->pixelsize()
+                                      == nchannels * tile->channelsize()) {
+                        convert_pixel_values(cachetype, data, format, xptr,
+                                             span * nchannels);
+                    } else {
+                        char* p = xptr;
+                        for (int i = 0; i < span; ++i) {
+                            convert_pixel_values(cachetype, data, format, p,
+                                                 actualchannels);
+                            for (int c = actualchannels; c < nchannels; ++c)
+                                convert_pixel_values(TypeFloat, &options.fill,
+                                                     format,
+                                                     p + c * formatchannelsize,
+                                                     1);
+                            data += tile->pixelsize();
+                            p += formatpixelsize;
+                        }
+                    }
+                    x += span;
+                    xptr += span * formatpixelsize;
                 }
-                result = (void*)((char*)result + formatpixelsize);
             }
         }
-    }
+        return ok;
+    };
+    bool ok = m_imagecache->fetch_region(dims,
+                                         ROI(xbegin, xend, ybegin, yend,
+                                             zbegin, zend, chbegin, chend),
+                                         thread_info, fetch);
     if (!ok) {
         std::string err = m_imagecache->geterror();
         if (!err.empty())
@@ -1424,6 +1668,14 @@ TextureSystemImpl::close_all()
 
 
 
+int
+TextureSystemImpl::preload_headers(cspan<ustring> filenames, int nthreads)
+{
+    return m_imagecache->preload_headers(filenames, nthreads);
+}
+
+
+
 bool
 TextureSystemImpl::missing_texture(TextureOpt& options, int nchannels,
                                    float* result, float* dresultds,
@@ -1548,6 +1800,11 @@ TextureSystemImpl::texture(TextureHandle* texture_handle_,
         return true;
     }
 
+    if (TextureTraceRecorder* trace = m_trace.load(std::memory_order_acquire))
+        trace->record(((TextureFile*)texture_handle_)->filename(), options, s,
+                      t, dsdx, dtdx, dsdy, dtdy, nchannels,
+                      dresultds != nullptr);
+
     static const texture_lookup_prototype lookup_functions[] = {
         // Must be in the same order as Mipmode enum
         &TextureSystemImpl::texture_lookup,
@@ -1713,14 +1970,211 @@ TextureSystemImpl::texture(ustring filename, TextureOptBatch& options,
 
 
 bool
-TextureSystemImpl::texture(TextureHandle* texture_handle,
-                           Perthread* thread_info, TextureOptBatch& options,
-                           Tex::RunMask mask, const float* s, const float* t,
-                           const float* dsdx, const float* dtdx,
-                           const float* dsdy, const float* dtdy, int nchannels,
-                           float* result, float* dresultds, float* dresultdt)
+TextureSystemImpl::texture(TextureHandle* texture_handle_,
+                           Perthread* thread_info_, TextureOptBatch& options,
+                           Tex::RunMask mask, const float* s_, const float* t_,
+                           const float* dsdx_, const float* dtdx_,
+                           const float* dsdy_, const float* dtdy_,
+                           int nchannels, float* result, float* dresultds,
+                           float* dresultdt)
+{
+    mask &= Tex::RunMaskOn;
+    if (!mask)
+        return true;
+    TextureFile* texturefile = (TextureFile*)texture_handle_;
+    if (!texturefile || texturefile->is_udim() || nchannels > 4)
+        return texture_lanes(texture_handle_, thread_info_, options, mask, s_,
+                             t_, dsdx_, dtdx_, dsdy_, dtdy_, nchannels, result,
+                             dresultds, dresultdt);
+
+    // Everything that is uniform across the batch -- file verification,
+    // subimage, wrap modes, constant images -- is done once for the whole
+    // batch rather than once per lane.
+    PerThreadInfo* thread_info = m_imagecache->get_perthread_info(
+        (PerThreadInfo*)thread_info_);
+    texturefile = verify_texturefile(texturefile, thread_info);
+
+    int nlanes = 0;
+    for (int i = 0; i < Tex::BatchWidth; ++i)
+        nlanes += (mask >> i) & 1;
+    ImageCacheStatistics& stats(thread_info->m_stats);
+    ++stats.texture_batches;
+    stats.texture_queries += nlanes;
+
+    TextureOpt opt;
+    opt.firstchannel        = options.firstchannel;
+    opt.subimage            = options.subimage;
+    opt.swrap               = (TextureOpt::Wrap)options.swrap;
+    opt.twrap               = (TextureOpt::Wrap)options.twrap;
+    opt.mipmode             = (TextureOpt::MipMode)options.mipmode;
+    opt.interpmode          = (TextureOpt::InterpMode)options.interpmode;
+    opt.anisotropic         = options.anisotropic;
+    opt.conservative_filter = options.conservative_filter;
+    opt.fill                = options.fill;
+    opt.missingcolor        = options.missingcolor;
+    opt.colortransformid    = options.colortransformid;
+
+    if (TextureTraceRecorder* trace = m_trace.load(
+            std::memory_order_acquire)) {
+        // The lanes that take the texture_lanes path above are recorded by
+        // the single-point texture(); here we record the fast path.
+        TextureOpt laneopt   = opt;
+        laneopt.subimagename = options.subimagename;
+        for (int i = 0; i < Tex::BatchWidth; ++i) {
+            if (!(mask & (Tex::RunMask(1) << i)))
+                continue;
+            laneopt.sblur  = options.sblur[i];
+            laneopt.tblur  = options.tblur[i];
+            laneopt.swidth = options.swidth[i];
+            laneopt.twidth = options.twidth[i];
+            laneopt.rnd    = options.rnd[i];
+            trace->record(((TextureFile*)texture_handle_)->filename(),
+                          laneopt, s_[i], t_[i], dsdx_[i], dtdx_[i], dsdy_[i],
+                          dtdy_[i], nchannels, dresultds != nullptr);
+        }
+    }
+
+    // Scatter one lane's worth of contiguous results into the SoA outputs.
+    auto store_lane = [&](int lane, const float* r, const float* drds,
+                          const float* drdt) {
+        for (int c = 0; c < nchannels; ++c)
+            result[c * Tex::BatchWidth + lane] = r[c];
+        if (dresultds) {
+            for (int c = 0; c < nchannels; ++c) {
+                dresultds[c * Tex::BatchWidth + lane] = drds[c];
+                dresultdt[c * Tex::BatchWidth + lane] = drdt[c];
+            }
+        }
+    };
+    auto missing_lanes = [&]() {
+        bool ok = true;
+        float r[4], drds[4], drdt[4];
+        for (int i = 0; i < Tex::BatchWidth; ++i) {
+            if (mask & (Tex::RunMask(1) << i)) {
+                ok &= missing_texture(opt, nchannels, r,
+                                      dresultds ? drds : nullptr, drdt);
+                store_lane(i, r, drds, drdt);
+            }
+        }
+        return ok;
+    };
+
+    if (!texturefile || texturefile->broken())
+        return missing_lanes();
+
+    if (!options.subimagename.empty()) {
+        // If subimage was specified by name, figure out its index.
+        int s = m_imagecache->subimage_from_name(texturefile,
+                                                 options.subimagename);
+        if (s < 0) {
+            error("Unknown subimage \"{}\" in texture \"{}\"",
+                  options.subimagename, texturefile->filename());
+            return missing_lanes();
+        }
+        opt.subimage = s;
+    }
+
+    const SubimageInfo& si(texturefile->subimageinfo(opt.subimage));
+    const ImageSpec& spec(si.spec());
+
+    int actualchannels = OIIO::clamp(spec.nchannels - opt.firstchannel, 0,
+                                     nchannels);
+    bool gray_to_rgb   = (actualchannels < nchannels && opt.firstchannel == 0
+                        && m_gray_to_rgb);
+
+    // Figure out the wrap functions
+    if (opt.swrap == TextureOpt::WrapDefault)
+        opt.swrap = (TextureOpt::Wrap)texturefile->swrap();
+    if (opt.swrap == TextureOpt::WrapPeriodic && ispow2(spec.width))
+        opt.swrap = TextureOpt::WrapPeriodicPow2;
+    if (opt.twrap == TextureOpt::WrapDefault)
+        opt.twrap = (TextureOpt::Wrap)texturefile->twrap();
+    if (opt.twrap == TextureOpt::WrapPeriodic && ispow2(spec.height))
+        opt.twrap = TextureOpt::WrapPeriodicPow2;
+
+    if (si.is_constant_image && opt.swrap != TextureOpt::WrapBlack
+        && opt.twrap != TextureOpt::WrapBlack && opt.colortransformid <= 0) {
+        // Lookup of constant color texture, non-black wrap -- every lane
+        // gets the same answer, skip all the hard stuff.
+        float r[4], drds[4] = { 0, 0, 0, 0 }, drdt[4] = { 0, 0, 0, 0 };
+        for (int c = 0; c < actualchannels; ++c)
+            r[c] = si.average_color[c + opt.firstchannel];
+        for (int c = actualchannels; c < nchannels; ++c)
+            r[c] = opt.fill;
+        if (gray_to_rgb)
+            fill_gray_channels(spec, nchannels, r, drds, drdt);
+        for (int i = 0; i < Tex::BatchWidth; ++i)
+            if (mask & (Tex::RunMask(1) << i))
+                store_lane(i, r, drds, drdt);
+        return true;
+    }
+
+    // Remap the coordinates and derivatives of all lanes at once.
+    Tex::FloatWide s(s_), t(t_), dsdx(dsdx_), dtdx(dtdx_), dsdy(dsdy_),
+        dtdy(dtdy_);
+    if (m_flip_t) {
+        t    = 1.0f - t;
+        dtdx = -dtdx;
+        dtdy = -dtdy;
+    }
+    if (!si.full_pixel_range) {  // remap st for overscan or crop
+        s = s * si.sscale + si.soffset;
+        dsdx *= si.sscale;
+        dsdy *= si.sscale;
+        t = t * si.tscale + si.toffset;
+        dtdx *= si.tscale;
+        dtdy *= si.tscale;
+    }
+    alignas(Tex::BatchAlign) float sval[Tex::BatchWidth], tval[Tex::BatchWidth],
+        dsdxval[Tex::BatchWidth], dtdxval[Tex::BatchWidth],
+        dsdyval[Tex::BatchWidth], dtdyval[Tex::BatchWidth];
+    s.store(sval);
+    t.store(tval);
+    dsdx.store(dsdxval);
+    dtdx.store(dtdxval);
+    dsdy.store(dsdyval);
+    dtdy.store(dtdyval);
+
+    alignas(Tex::BatchAlign) float r[4 * Tex::BatchWidth]    = {};
+    alignas(Tex::BatchAlign) float drds[4 * Tex::BatchWidth] = {};
+    alignas(Tex::BatchAlign) float drdt[4 * Tex::BatchWidth] = {};
+    bool ok = texture_lookup_batch(*texturefile, thread_info, opt, options,
+                                   mask, nchannels, actualchannels, sval, tval,
+                                   dsdxval, dtdxval, dsdyval, dtdyval, r,
+                                   dresultds ? drds : nullptr,
+                                   dresultds ? drdt : nullptr);
+
+    for (int i = 0; i < Tex::BatchWidth; ++i) {
+        if (!(mask & (Tex::RunMask(1) << i)))
+            continue;
+        float lr[4], lds[4], ldt[4];
+        for (int c = 0; c < nchannels; ++c) {
+            lr[c]  = r[c * Tex::BatchWidth + i];
+            lds[c] = drds[c * Tex::BatchWidth + i];
+            ldt[c] = drdt[c * Tex::BatchWidth + i];
+            if (m_flip_t)
+                ldt[c] = -ldt[c];
+        }
+        if (gray_to_rgb)
+            fill_gray_channels(spec, nchannels, lr, dresultds ? lds : nullptr,
+                               ldt);
+        store_lane(i, lr, lds, ldt);
+    }
+    return ok;
+}
+
+
+
+bool
+TextureSystemImpl::texture_lanes(TextureHandle* texture_handle,
+                                 Perthread* thread_info,
+                                 TextureOptBatch& options, Tex::RunMask mask,
+                                 const float* s, const float* t,
+                                 const float* dsdx, const float* dtdx,
+                                 const float* dsdy, const float* dtdy,
+                                 int nchannels, float* result,
+                                 float* dresultds, float* dresultdt)
 {
-    // (FIXME) CHEAT! Texture points individually
     TextureOpt opt;
     opt.firstchannel        = options.firstchannel;
     opt.subimage            = options.subimage;
@@ -2322,6 +2776,13 @@ TextureSystemImpl::texture_lookup(TextureFile& texturefile,
     }
 #endif
 
+    // Several bilinear probes along the major axis are filtered together
+    // by the vectorized engine, unless it's been turned off.
+    sampler_prototype sample_bilinear_probes
+        = (m_aniso_simd && nsamples > 1)
+              ? &TextureSystemImpl::sample_bilinear_aniso
+              : &TextureSystemImpl::sample_bilinear;
+
     vfloat4 r_sum, drds_sum, drdt_sum;
     r_sum.clear();
     if (dresultds) {
@@ -2342,11 +2803,10 @@ TextureSystemImpl::texture_lookup(TextureFile& texturefile,
             ++closestprobes;
             break;
         case TextureOpt::InterpBilinear:
-            ok &= sample_bilinear(nsamples, sval, tval, lev, texturefile,
-                                  thread_info, options, nchannels_result,
-                                  actualchannels, lineweight, &r,
-                                  dresultds ? &drds : NULL,
-                                  dresultds ? &drdt : NULL);
+            ok &= (this->*sample_bilinear_probes)(
+                nsamples, sval, tval, lev, texturefile, thread_info, options,
+                nchannels_result, actualchannels, lineweight, &r,
+                dresultds ? &drds : NULL, dresultds ? &drdt : NULL);
             ++bilinearprobes;
             break;
         case TextureOpt::InterpBicubic:
@@ -2370,11 +2830,10 @@ TextureSystemImpl::texture_lookup(TextureFile& texturefile,
                                      dresultds ? &drdt : NULL);
                 ++bicubicprobes;
             } else {
-                ok &= sample_bilinear(nsamples, sval, tval, lev, texturefile,
-                                      thread_info, options, nchannels_result,
-                                      actualchannels, lineweight, &r,
-                                      dresultds ? &drds : NULL,
-                                      dresultds ? &drdt : NULL);
+                ok &= (this->*sample_bilinear_probes)(
+                    nsamples, sval, tval, lev, texturefile, thread_info,
+                    options, nchannels_result, actualchannels, lineweight,
+                    &r, dresultds ? &drds : NULL, dresultds ? &drdt : NULL);
                 ++bilinearprobes;
             }
             break;
@@ -2409,6 +2868,219 @@ TextureSystemImpl::texture_lookup(TextureFile& texturefile,
 
 
 
+bool
+TextureSystemImpl::texture_lookup_batch(
+    TextureFile& texturefile, PerThreadInfo* thread_info, TextureOpt& options,
+    const TextureOptBatch& batchopt, Tex::RunMask mask, int nchannels_result,
+    int actualchannels, const float* s, const float* t, const float* dsdx_,
+    const float* dtdx_, const float* dsdy_, const float* dtdy_, float* result,
+    float* dresultds, float* dresultdt)
+{
+    OIIO_DASSERT((dresultds == NULL) == (dresultdt == NULL));
+    enum { Closest = 0, Bilinear = 1, Bicubic = 2 };
+    static const sampler_prototype sample_functions[] = {
+        &TextureSystemImpl::sample_closest,
+        &TextureSystemImpl::sample_bilinear,
+        &TextureSystemImpl::sample_bicubic,
+    };
+    const SubimageInfo& si(texturefile.subimageinfo(options.subimage));
+    ImageCacheStatistics& stats(thread_info->m_stats);
+
+    // Which of the single-point lookup functions would handle this mip
+    // mode (see the lookup_functions table in texture()).
+    bool nomip     = (options.mipmode == TextureOpt::MipModeNoMIP);
+    bool trilinear = (options.mipmode == TextureOpt::MipModeOneLevel
+                      || options.mipmode == TextureOpt::MipModeTrilinear);
+    int interp     = (options.interpmode == TextureOpt::InterpClosest) ? Closest
+                     : (options.interpmode == TextureOpt::InterpBicubic)
+                         ? Bicubic
+                         : Bilinear;
+    bool smartcubic = (options.interpmode == TextureOpt::InterpSmartBicubic);
+
+    // Phase 1: per-lane filter footprint -- MIP levels and weights, and
+    // the positions and weights of the probes along the major axis.
+    int maxsamples = round_to_multiple_of_pow2(2 * options.anisotropic, 4);
+    float* probe_s = OIIO_ALLOCA(float, (3 * Tex::BatchWidth + 2) * maxsamples);
+    float* probe_t = probe_s + Tex::BatchWidth * maxsamples;
+    float* probe_w = probe_t + Tex::BatchWidth * maxsamples;
+    float* lineweight = probe_w + Tex::BatchWidth * maxsamples;
+    float* samplepos  = lineweight + maxsamples;
+    int nsamples[Tex::BatchWidth];
+    int miplevel[2][Tex::BatchWidth];
+    float levelweight[2][Tex::BatchWidth];
+    int levelinterp[2][Tex::BatchWidth];
+    int maxprobes = 0;
+    for (int i = 0; i < Tex::BatchWidth; ++i) {
+        nsamples[i]       = 0;
+        levelweight[0][i] = levelweight[1][i] = 0.0f;
+        if (!(mask & (Tex::RunMask(1) << i)))
+            continue;
+        options.sblur  = batchopt.sblur[i];
+        options.tblur  = batchopt.tblur[i];
+        options.swidth = batchopt.swidth[i];
+        options.twidth = batchopt.twidth[i];
+        options.rnd    = batchopt.rnd[i];
+        float dsdx = dsdx_[i], dtdx = dtdx_[i];
+        float dsdy = dsdy_[i], dtdy = dtdy_[i];
+        int lev[2]     = { -1, -1 };
+        float lw[2]    = { 0, 0 };
+        int n          = 1;
+        lineweight[0]  = 1.0f;
+        samplepos[0]   = 0.0f;
+        float smajor   = 0.0f, tmajor = 0.0f;
+        bool stoch     = (options.rnd >= 0.0f);
+        bool stoch_mip = stoch && (m_stochastic & StochasticStrategy_MIP);
+        levelinterp[0][i] = levelinterp[1][i] = interp;
+        if (nomip) {
+            lev[0] = si.min_mip_level;
+            lw[0]  = 1.0f;
+        } else if (trilinear) {
+            adjust_width(dsdx, dtdx, dsdy, dtdy, options.swidth,
+                         options.twidth);
+            float sfilt     = std::max(fabsf(dsdx), fabsf(dsdy));
+            float tfilt     = std::max(fabsf(dtdx), fabsf(dtdy));
+            float filtwidth = options.conservative_filter
+                                  ? std::max(sfilt, tfilt)
+                                  : std::min(sfilt, tfilt);
+            filtwidth += std::max(options.sblur, options.tblur);
+            float aspect = 1.0f;
+            compute_miplevels(texturefile, options, stoch_mip, filtwidth,
+                              filtwidth, aspect, lev, lw);
+        } else {
+            float sfilt_noblur = std::max(std::max(fabsf(dsdx), fabsf(dsdy)),
+                                          1e-8f);
+            float tfilt_noblur = std::max(std::max(fabsf(dtdx), fabsf(dtdy)),
+                                          1e-8f);
+            int naturalsres    = (int)(1.0f / sfilt_noblur);
+            int naturaltres    = (int)(1.0f / tfilt_noblur);
+            bool stoch_aniso   = stoch
+                               && (m_stochastic & StochasticStrategy_Aniso);
+            adjust_width(dsdx, dtdx, dsdy, dtdy, options.swidth,
+                         options.twidth);
+            float majorlength, minorlength, theta;
+            ellipse_axes(dsdx, dtdx, dsdy, dtdy, majorlength, minorlength,
+                         theta);
+            adjust_blur(majorlength, minorlength, theta, options.sblur,
+                        options.tblur);
+            float aspect, trueaspect;
+            aspect = anisotropic_aspect(majorlength, minorlength, options,
+                                        trueaspect);
+            compute_miplevels(texturefile, options, stoch_mip, majorlength,
+                              minorlength, aspect, lev, lw);
+            float invsamples;
+            n = compute_ellipse_sampling(aspect, theta, majorlength,
+                                         minorlength, smajor, tmajor,
+                                         invsamples, lineweight, samplepos,
+                                         stoch_aniso, options.rnd);
+            smajor *= 0.5f;
+            tmajor *= 0.5f;
+            if (trueaspect > stats.max_aniso)
+                stats.max_aniso = trueaspect;  // FIXME?
+            if (smartcubic) {
+                for (int level = 0; level < 2; ++level) {
+                    const ImageDims& dims(
+                        si.leveldims(std::max(lev[level], 0)));
+                    if (lev[level] == 0 || dims.width < naturalsres / 2
+                        || dims.height < naturaltres / 2)
+                        levelinterp[level][i] = Bicubic;
+                }
+            }
+        }
+        float* ps = probe_s + i * maxsamples;
+        float* pt = probe_t + i * maxsamples;
+        float* pw = probe_w + i * maxsamples;
+        for (int sample = 0; sample < n; ++sample) {
+            ps[sample] = s[i] + samplepos[sample] * smajor;
+            pt[sample] = t[i] + samplepos[sample] * tmajor;
+            pw[sample] = lineweight[sample];
+        }
+        nsamples[i] = n;
+        maxprobes   = std::max(maxprobes, n);
+        for (int level = 0; level < 2; ++level) {
+            miplevel[level][i]    = lev[level];
+            levelweight[level][i] = lw[level];
+            if (!lw[level])
+                continue;
+            // Match the stats kept by the single-point lookups
+            ++stats.aniso_queries;
+            stats.aniso_probes += n;
+            switch (levelinterp[level][i]) {
+            case Closest: stats.closest_interps += n; break;
+            case Bilinear: stats.bilinear_interps += n; break;
+            case Bicubic: stats.cubic_interps += n; break;
+            }
+        }
+    }
+
+    // Phase 2: take the probes in rounds -- round k is the k-th probe of
+    // every lane that has one -- so that lanes of a coherent batch touch
+    // the same tiles at the same time. Bilinear probes on the same MIP
+    // level are filtered together; other interpolation modes fall back to
+    // the single-probe samplers.
+    bool ok = true;
+    alignas(Tex::BatchAlign) float sval[Tex::BatchWidth];
+    alignas(Tex::BatchAlign) float tval[Tex::BatchWidth];
+    alignas(Tex::BatchAlign) float wval[Tex::BatchWidth];
+    for (int sample = 0; sample < maxprobes; ++sample) {
+        for (int level = 0; level < 2; ++level) {
+            Tex::RunMask bilerp_lanes = 0;
+            for (int i = 0; i < Tex::BatchWidth; ++i) {
+                if (sample >= nsamples[i] || !levelweight[level][i])
+                    continue;
+                int p   = i * maxsamples + sample;
+                sval[i] = probe_s[p];
+                tval[i] = probe_t[p];
+                wval[i] = levelweight[level][i] * probe_w[p];
+                if (levelinterp[level][i] == Bilinear) {
+                    bilerp_lanes |= Tex::RunMask(1) << i;
+                    continue;
+                }
+                // Single probe through the ordinary sampler, unit weight,
+                // then scaled (so that fill is apportioned correctly).
+                OIIO_SIMD4_ALIGN float ps[4] = { sval[i], 0.0f, 0.0f, 0.0f };
+                OIIO_SIMD4_ALIGN float pt[4] = { tval[i], 0.0f, 0.0f, 0.0f };
+                static OIIO_SIMD4_ALIGN float one[4] = { 1.0f, 0.0f, 0.0f,
+                                                         0.0f };
+                vfloat4 r, drds, drdt;
+                sampler_prototype sampler
+                    = sample_functions[levelinterp[level][i]];
+                ok &= (this->*sampler)(1, ps, pt, miplevel[level][i],
+                                       texturefile, thread_info, options,
+                                       nchannels_result, actualchannels, one,
+                                       &r, dresultds ? &drds : nullptr,
+                                       dresultds ? &drdt : nullptr);
+                for (int c = 0; c < nchannels_result; ++c) {
+                    result[c * Tex::BatchWidth + i] += wval[i] * r[c];
+                    if (dresultds) {
+                        dresultds[c * Tex::BatchWidth + i] += wval[i] * drds[c];
+                        dresultdt[c * Tex::BatchWidth + i] += wval[i] * drdt[c];
+                    }
+                }
+            }
+            while (bilerp_lanes) {
+                // Gather the remaining lanes that share a MIP level
+                int first = 0;
+                while (!(bilerp_lanes & (Tex::RunMask(1) << first)))
+                    ++first;
+                int lev            = miplevel[level][first];
+                Tex::RunMask group = 0;
+                for (int i = first; i < Tex::BatchWidth; ++i)
+                    if ((bilerp_lanes & (Tex::RunMask(1) << i))
+                        && miplevel[level][i] == lev)
+                        group |= Tex::RunMask(1) << i;
+                bilerp_lanes &= ~group;
+                ok &= sample_bilinear_batch(group, sval, tval, wval, lev,
+                                            texturefile, thread_info, options,
+                                            nchannels_result, actualchannels,
+                                            result, dresultds, dresultdt);
+            }
+        }
+    }
+    return ok;
+}
+
+
+
 const float*
 TextureSystemImpl::pole_color(TextureFile& texturefile,
                               PerThreadInfo* /*thread_info*/, TileRef& tile,
@@ -2674,6 +3346,15 @@ TextureSystemImpl::sample_bilinear(
     // we don't need to worry about fill, which is the comparatively rare
     // case, we do a lot less math and have fewer rounding errors.
 
+    // A runtime-dispatched kernel, if this CPU has one, converts and
+    // filters the texels of samples that lie within one tile.
+    auto bilerp_texels = need_pole ? nullptr
+                                   : pvt::simd_kernels().bilerp_texels;
+    int texeltype = pixeltype == TypeDesc::UINT8    ? pvt::SimdTexel_UInt8
+                    : pixeltype == TypeDesc::UINT16 ? pvt::SimdTexel_UInt16
+                    : pixeltype == TypeDesc::HALF   ? pvt::SimdTexel_Half
+                                                    : pvt::SimdTexel_Float;
+
     vfloat4 accum, daccumds, daccumdt;
     accum.clear();
     if (daccumds_) {
@@ -2755,6 +3436,15 @@ TextureSystemImpl::sample_bilinear(
             const unsigned char* p = tile->bytedata() + offset
                                      + channelsize
                                            * (firstchannel - id.chbegin());
+            if (bilerp_texels) {
+                bilerp_texels(p, pixelsize, pixelsize * dims.tile_width,
+                              texeltype, sfrac, tfrac, weight,
+                              float(dims.width), float(dims.height),
+                              (float*)&accum,
+                              daccumds_ ? (float*)&daccumds : nullptr,
+                              (float*)&daccumdt);
+                continue;
+            }
             if (pixeltype == TypeDesc::UINT8) {
                 texel_simd[0][0] = uchar2float4(p);
                 texel_simd[0][1] = uchar2float4(p + pixelsize);
@@ -2889,6 +3579,430 @@ TextureSystemImpl::sample_bilinear(
 }
 
 
+bool
+TextureSystemImpl::sample_bilinear_aniso(
+    int nsamples, const float* s_, const float* t_, int miplevel,
+    TextureFile& texturefile, PerThreadInfo* thread_info, TextureOpt& options,
+    int nchannels_result, int actualchannels, const float* weight_,
+    vfloat4* accum_, vfloat4* daccumds_, vfloat4* daccumdt_)
+{
+    const SubimageInfo& si(texturefile.subimageinfo(options.subimage));
+    const LevelInfo& lvl(si.levelinfo(miplevel));
+    const ImageDims& dims(si.leveldims(miplevel));
+    bool need_pole = (options.envlayout == LayoutLatLong && lvl.onetile);
+    if (need_pole || nsamples < 2) {
+        // Nothing to gain, or fade_to_pole needs the probes one by one.
+        return sample_bilinear(nsamples, s_, t_, miplevel, texturefile,
+                               thread_info, options, nchannels_result,
+                               actualchannels, weight_, accum_, daccumds_,
+                               daccumdt_);
+    }
+    TypeDesc::BASETYPE pixeltype = texturefile.pixeltype(options.subimage);
+    size_t channelsize           = texturefile.channelsize(options.subimage);
+    bool use_fill    = (nchannels_result > actualchannels && options.fill);
+    int firstchannel = options.firstchannel;
+    int tile_chbegin = 0, tile_chend = dims.nchannels;
+    if (dims.nchannels > m_max_tile_channels) {
+        // For files with many channels, narrow the range we cache
+        tile_chbegin = options.firstchannel;
+        tile_chend   = options.firstchannel + actualchannels;
+    }
+    TileID id(texturefile, options.subimage, miplevel, 0, 0, 0, tile_chbegin,
+              tile_chend, options.colortransformid);
+    // Float tiles can be gathered straight from tile memory as long as
+    // every byte offset fits in the 32 bit gather index.
+    bool gather = (pixeltype == TypeDesc::FLOAT
+                   && si.get_tile_bytes(miplevel) < imagesize_t(1) << 31);
+    // Same interior test as sample_bilinear_batch: a probe is fast if its
+    // whole 2x2 footprint is inside the data window and inside one tile.
+    int swidth  = dims.width
+                 - (options.swrap == TextureOpt::WrapPeriodicSharedBorder);
+    int theight = dims.height
+                  - (options.twrap == TextureOpt::WrapPeriodicSharedBorder);
+
+    // Probes that can't take the fast path are compacted here and handed
+    // to sample_bilinear in one call at the end. It reads them four at a
+    // time, so round the storage up.
+    int slowcap   = round_to_multiple_of_pow2(nsamples, 4);
+    float* slow_s = OIIO_ALLOCA(float, 3 * slowcap);
+    float* slow_t = slow_s + slowcap;
+    float* slow_w = slow_s + 2 * slowcap;
+    int nslow     = 0;
+    float slowweight = 0.0f, fastweight = 0.0f;
+
+    vfloat8 sum[4], dsum[4], dtsum[4];  // per channel, across probes
+    for (int c = 0; c < 4; ++c) {
+        sum[c].clear();
+        dsum[c].clear();
+        dtsum[c].clear();
+    }
+    for (int base = 0; base < nsamples; base += 8) {
+        int n = std::min(8, nsamples - base);
+        vfloat8 s, t, weight;
+        s.load(s_ + base, n);
+        t.load(t_ + base, n);
+        weight.load(weight_ + base, n);
+        if (texturefile.sample_border() == 0) {
+            s = s * float(dims.width) + (dims.x - 0.5f);
+            t = t * float(dims.height) + (dims.y - 0.5f);
+        } else {
+            s = s * float(dims.width - 1) + float(dims.x);
+            t = t * float(dims.height - 1) + float(dims.y);
+        }
+        vint8 sint, tint;
+        vfloat8 sfrac = floorfrac(s, &sint);
+        vfloat8 tfrac = floorfrac(t, &tint);
+        vint8 tile_s  = (sint - dims.x) % dims.tile_width;
+        vint8 tile_t  = (tint - dims.y) % dims.tile_height;
+        vbool8 fast   = (sint >= dims.x) & (sint + 1 < dims.x + swidth)
+                      & (tint >= dims.y) & (tint + 1 < dims.y + theight)
+                      & (tile_s != dims.tile_width - 1)
+                      & (tile_t != dims.tile_height - 1)
+                      & (vint8::Iota() < n);
+        int fastbits = fast.bitmask();
+        int slowbits = ((1 << n) - 1) & ~fastbits;
+        for (int i = 0; slowbits; ++i) {
+            if (!(slowbits & (1 << i)))
+                continue;
+            slowbits &= ~(1 << i);
+            slow_s[nslow] = s_[base + i];
+            slow_t[nslow] = t_[base + i];
+            slow_w[nslow] = weight_[base + i];
+            slowweight += weight_[base + i];
+            ++nslow;
+        }
+        if (!fastbits)
+            continue;
+
+        // Fetch the four corners of every fast probe, one tile at a time:
+        // all probes on the same tile as the first remaining one are
+        // served by a single find_tile (along the major axis they usually
+        // all are).
+        vfloat8 texel[4][4];  // [corner][channel]
+        OIIO_SIMD8_ALIGN float texelbuf[4][4][8] = {};
+        OIIO_SIMD8_ALIGN int tile_s_[8], tile_t_[8], tile_x_[8], tile_y_[8];
+        vint8 tile_x = sint - tile_s, tile_y = tint - tile_t;
+        tile_s.store(tile_s_);
+        tile_t.store(tile_t_);
+        tile_x.store(tile_x_);
+        tile_y.store(tile_y_);
+        for (int k = 0; k < 4; ++k)
+            for (int c = 0; c < 4; ++c)
+                texel[k][c].clear();
+        int todo = fastbits;
+        for (int i = 0; todo; ++i) {
+            if (!(todo & (1 << i)))
+                continue;
+            int tx = tile_x_[i], ty = tile_y_[i];
+            vbool8 ingroup = (tile_x == tx) & (tile_y == ty)
+                             & vbool8::from_bitmask(todo);
+            int group = ingroup.bitmask();
+            todo &= ~group;
+            id.xy(tx, ty);
+            if (!find_tile(id, thread_info, true))
+                error("{}", m_imagecache->geterror());
+            TileRef& tile(thread_info->tile);
+            if (!tile->valid())
+                return false;
+            int pixelsize = tile->pixelsize();
+            int rowbytes  = pixelsize * dims.tile_width;
+            int chanoff   = int(channelsize) * (firstchannel - id.chbegin());
+            const unsigned char* data = tile->bytedata();
+            if (gather) {
+                vint8 offset = (tile_t * dims.tile_width + tile_s) * pixelsize
+                               + chanoff;
+                vint8 corner[4] = { offset, offset + pixelsize,
+                                    offset + rowbytes,
+                                    offset + rowbytes + pixelsize };
+                for (int k = 0; k < 4; ++k)
+                    for (int c = 0; c < actualchannels; ++c)
+                        texel[k][c].gather_mask<1>(ingroup,
+                                                   (const float*)data,
+                                                   corner[k] + 4 * c);
+                continue;
+            }
+            for (int j = i; j < 8; ++j) {
+                if (!(group & (1 << j)))
+                    continue;
+                const unsigned char* p
+                    = data + tile->pixel_offset(tile_s_[j], tile_t_[j])
+                      + chanoff;
+                const unsigned char* corner[4] = { p, p + pixelsize,
+                                                   p + rowbytes,
+                                                   p + rowbytes + pixelsize };
+                for (int k = 0; k < 4; ++k) {
+                    const unsigned char* q = corner[k];
+                    for (int c = 0; c < actualchannels; ++c) {
+                        float v;
+                        if (pixeltype == TypeDesc::UINT8)
+                            v = float(q[c]) * (1.0f / 255.0f);
+                        else if (pixeltype == TypeDesc::UINT16)
+                            v = float(((const uint16_t*)q)[c])
+                                * (1.0f / 65535.0f);
+                        else if (pixeltype == TypeDesc::HALF)
+                            v = float(((const half*)q)[c]);
+                        else
+                            v = ((const float*)q)[c];
+                        texelbuf[k][c][j] = v;
+                    }
+                }
+            }
+        }
+        if (!gather)
+            for (int k = 0; k < 4; ++k)
+                for (int c = 0; c < actualchannels; ++c)
+                    texel[k][c].load(texelbuf[k][c]);
+
+        // Filter all the fast probes together, one channel at a time.
+        vbool8 on = vbool8::from_bitmask(fastbits);
+        fastweight += reduce_add(blend0(weight, on));
+        for (int c = 0; c < actualchannels; ++c) {
+            const vfloat8 &t00(texel[0][c]), &t01(texel[1][c]);
+            const vfloat8 &t10(texel[2][c]), &t11(texel[3][c]);
+            sum[c] += blend0(weight * bilerp(t00, t01, t10, t11, sfrac, tfrac),
+                             on);
+            if (daccumds_) {
+                dsum[c] += blend0(weight * float(dims.width)
+                                      * lerp(t01 - t00, t11 - t10, tfrac),
+                                  on);
+                dtsum[c] += blend0(weight * float(dims.height)
+                                       * lerp(t10 - t00, t11 - t01, sfrac),
+                                   on);
+            }
+        }
+    }
+
+    vfloat4 accum, daccumds, daccumdt;
+    accum.clear();
+    daccumds.clear();
+    daccumdt.clear();
+    for (int c = 0; c < actualchannels; ++c) {
+        accum[c] = reduce_add(sum[c]);
+        if (daccumds_) {
+            daccumds[c] = reduce_add(dsum[c]);
+            daccumdt[c] = reduce_add(dtsum[c]);
+        }
+    }
+    simd::vbool4 channel_mask = channel_masks[actualchannels];
+    if (use_fill) {
+        // The fast probes are fully inside the texture, so extra channels
+        // get all fill for them.
+        accum += blend0not(vfloat4(fastweight * options.fill), channel_mask);
+    }
+    if (nslow) {
+        vfloat4 slow, dslowds, dslowdt;
+        if (!sample_bilinear(nslow, slow_s, slow_t, miplevel, texturefile,
+                             thread_info, options, nchannels_result,
+                             actualchannels, slow_w, &slow,
+                             daccumds_ ? &dslowds : nullptr,
+                             daccumds_ ? &dslowdt : nullptr))
+            return false;
+        if (use_fill) {
+            // sample_bilinear assumed its weights summed to 1 when it
+            // added the fill color; take back the share of the fast ones.
+            slow -= blend0not(vfloat4((1.0f - slowweight) * options.fill),
+                              channel_mask);
+        }
+        accum += slow;
+        if (daccumds_) {
+            daccumds += dslowds;
+            daccumdt += dslowdt;
+        }
+    }
+
+    *accum_ = accum;
+    if (daccumds_) {
+        *daccumds_ = daccumds;
+        *daccumdt_ = daccumdt;
+    }
+    return true;
+}
+
+
+bool
+TextureSystemImpl::sample_bilinear_batch(
+    Tex::RunMask mask, const float* s_, const float* t_, const float* weight_,
+    int miplevel, TextureFile& texturefile, PerThreadInfo* thread_info,
+    TextureOpt& options, int nchannels_result, int actualchannels,
+    float* accum_, float* daccumds_, float* daccumdt_)
+{
+    using BoolWide = simd::VecType<bool, Tex::BatchWidth>::type;
+    const SubimageInfo& si(texturefile.subimageinfo(options.subimage));
+    const LevelInfo& lvl(si.levelinfo(miplevel));
+    const ImageDims& dims(si.leveldims(miplevel));
+    TypeDesc::BASETYPE pixeltype = texturefile.pixeltype(options.subimage);
+    size_t channelsize           = texturefile.channelsize(options.subimage);
+    bool use_fill    = (nchannels_result > actualchannels && options.fill);
+    int firstchannel = options.firstchannel;
+    int tile_chbegin = 0, tile_chend = dims.nchannels;
+    bool need_pole   = (options.envlayout == LayoutLatLong && lvl.onetile);
+    if (dims.nchannels > m_max_tile_channels && !need_pole) {
+        // For files with many channels, narrow the range we cache
+        tile_chbegin = options.firstchannel;
+        tile_chend   = options.firstchannel + actualchannels;
+    }
+    TileID id(texturefile, options.subimage, miplevel, 0, 0, 0, tile_chbegin,
+              tile_chend, options.colortransformid);
+
+    // Texel coordinates of all lanes at once (cf. st_to_texel_simd).
+    Tex::FloatWide s(s_), t(t_);
+    if (texturefile.sample_border() == 0) {
+        s = s * float(dims.width) + (dims.x - 0.5f);
+        t = t * float(dims.height) + (dims.y - 0.5f);
+    } else {
+        s = s * float(dims.width - 1) + float(dims.x);
+        t = t * float(dims.height - 1) + float(dims.y);
+    }
+    Tex::IntWide sint, tint;
+    Tex::FloatWide sfrac = floorfrac(s, &sint);
+    Tex::FloatWide tfrac = floorfrac(t, &tint);
+    Tex::IntWide tile_s  = (sint - dims.x) % dims.tile_width;
+    Tex::IntWide tile_t  = (tint - dims.y) % dims.tile_height;
+
+    // A lane takes the fast path if its whole 2x2 footprint is inside the
+    // data window (so no wrap function can change it and no fill or black
+    // is needed) and inside one tile. The shared-border wrap maps the last
+    // row/column back to the first, so those don't count as inside.
+    int swidth  = dims.width
+                 - (options.swrap == TextureOpt::WrapPeriodicSharedBorder);
+    int theight = dims.height
+                  - (options.twrap == TextureOpt::WrapPeriodicSharedBorder);
+    BoolWide fast = (sint >= dims.x) & (sint + 1 < dims.x + swidth)
+                    & (tint >= dims.y) & (tint + 1 < dims.y + theight)
+                    & (tile_s != dims.tile_width - 1)
+                    & (tile_t != dims.tile_height - 1);
+    Tex::RunMask fastmask = need_pole ? 0
+                                      : (mask & Tex::RunMask(fast.bitmask()));
+    Tex::RunMask slowmask = mask & ~fastmask;
+
+    bool ok = true;
+    if (fastmask) {
+        // Gather the four texels of each fast lane, one tile at a time:
+        // every lane whose footprint falls on the same tile as the first
+        // remaining lane is served by a single find_tile.
+        alignas(Tex::BatchAlign) float texel[4][4][Tex::BatchWidth] = {};
+        alignas(Tex::BatchAlign) int sint_[Tex::BatchWidth];
+        alignas(Tex::BatchAlign) int tint_[Tex::BatchWidth];
+        alignas(Tex::BatchAlign) int tile_s_[Tex::BatchWidth];
+        alignas(Tex::BatchAlign) int tile_t_[Tex::BatchWidth];
+        sint.store(sint_);
+        tint.store(tint_);
+        tile_s.store(tile_s_);
+        tile_t.store(tile_t_);
+        Tex::IntWide tile_x = sint - tile_s, tile_y = tint - tile_t;
+        Tex::RunMask todo = fastmask;
+        for (int i = 0; todo; ++i) {
+            if (!(todo & (Tex::RunMask(1) << i)))
+                continue;
+            int tx = sint_[i] - tile_s_[i], ty = tint_[i] - tile_t_[i];
+            Tex::RunMask group
+                = todo
+                  & Tex::RunMask(((tile_x == tx) & (tile_y == ty)).bitmask());
+            todo &= ~group;
+            id.xy(tx, ty);
+            if (!find_tile(id, thread_info, true))
+                error("{}", m_imagecache->geterror());
+            TileRef& tile(thread_info->tile);
+            if (!tile->valid())
+                return false;
+            int pixelsize   = tile->pixelsize();
+            size_t rowbytes = size_t(pixelsize) * dims.tile_width;
+            const unsigned char* base = tile->bytedata()
+                                        + channelsize
+                                              * (firstchannel - id.chbegin());
+            // Each corner is converted with a single 4-wide load, hoisting
+            // the pixel type test out of the per-lane loop.
+            auto gather = [&](auto tag) {
+                using T = decltype(tag);
+                for (int j = i; j < Tex::BatchWidth; ++j) {
+                    if (!(group & (Tex::RunMask(1) << j)))
+                        continue;
+                    const unsigned char* p
+                        = base + tile->pixel_offset(tile_s_[j], tile_t_[j]);
+                    const unsigned char* corner[4]
+                        = { p, p + pixelsize, p + rowbytes,
+                            p + rowbytes + pixelsize };
+                    for (int k = 0; k < 4; ++k) {
+                        vfloat4 v = pvt::load_texel4<T>(corner[k]);
+                        for (int c = 0; c < actualchannels; ++c)
+                            texel[k][c][j] = v[c];
+                    }
+                }
+            };
+            switch (pixeltype) {
+            case TypeDesc::UINT8: gather(uint8_t()); break;
+            case TypeDesc::UINT16: gather(uint16_t()); break;
+            case TypeDesc::HALF: gather(half()); break;
+            default:
+                OIIO_DASSERT(pixeltype == TypeDesc::FLOAT);
+                gather(float());
+                break;
+            }
+        }
+
+        // Filter all the fast lanes together, one channel at a time.
+        BoolWide on = BoolWide::from_bitmask(int(fastmask));
+        Tex::FloatWide weight(weight_);
+        for (int c = 0; c < actualchannels; ++c) {
+            Tex::FloatWide t00(texel[0][c]), t01(texel[1][c]);
+            Tex::FloatWide t10(texel[2][c]), t11(texel[3][c]);
+            float* a = accum_ + c * Tex::BatchWidth;
+            Tex::FloatWide sum(a);
+            sum += blend0(weight * bilerp(t00, t01, t10, t11, sfrac, tfrac),
+                          on);
+            sum.store(a);
+            if (daccumds_) {
+                float* ds = daccumds_ + c * Tex::BatchWidth;
+                float* dt = daccumdt_ + c * Tex::BatchWidth;
+                Tex::FloatWide dsum(ds), dtsum(dt);
+                dsum += blend0(weight * float(dims.width)
+                                   * lerp(t01 - t00, t11 - t10, tfrac),
+                               on);
+                dtsum += blend0(weight * float(dims.height)
+                                    * lerp(t10 - t00, t11 - t01, sfrac),
+                                on);
+                dsum.store(ds);
+                dtsum.store(dt);
+            }
+        }
+        if (use_fill) {
+            // Fully inside the texture, so extra channels get all fill
+            for (int c = actualchannels; c < nchannels_result; ++c) {
+                float* a = accum_ + c * Tex::BatchWidth;
+                Tex::FloatWide sum(a);
+                sum += blend0(weight * options.fill, on);
+                sum.store(a);
+            }
+        }
+    }
+
+    // Everything else goes through the general single-point sampler.
+    for (int i = 0; slowmask; ++i) {
+        if (!(slowmask & (Tex::RunMask(1) << i)))
+            continue;
+        slowmask &= ~(Tex::RunMask(1) << i);
+        OIIO_SIMD4_ALIGN float ps[4] = { s_[i], 0.0f, 0.0f, 0.0f };
+        OIIO_SIMD4_ALIGN float pt[4] = { t_[i], 0.0f, 0.0f, 0.0f };
+        static OIIO_SIMD4_ALIGN float one[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+        vfloat4 r, drds, drdt;
+        ok &= sample_bilinear(1, ps, pt, miplevel, texturefile, thread_info,
+                              options, nchannels_result, actualchannels, one,
+                              &r, daccumds_ ? &drds : nullptr,
+                              daccumds_ ? &drdt : nullptr);
+        float w = weight_[i];
+        for (int c = 0; c < nchannels_result; ++c) {
+            accum_[c * Tex::BatchWidth + i] += w * r[c];
+            if (daccumds_) {
+                daccumds_[c * Tex::BatchWidth + i] += w * drds[c];
+                daccumdt_[c * Tex::BatchWidth + i] += w * drdt[c];
+            }
+        }
+    }
+    return ok;
+}
+
+
+
 namespace {
 
 // Evaluate Bspline weights for both value and derivatives (if dw is not
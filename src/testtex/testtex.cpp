@@ -26,6 +26,8 @@
 #include <OpenImageIO/timer.h>
 #include <OpenImageIO/ustring.h>
 
+#include "../libtexture/texture_trace.h"
+
 using namespace OIIO;
 
 using OIIO::_1;
@@ -94,6 +96,9 @@ static std::string subimagename;
 static Imath::M33f xform;
 static std::string texoptions;
 static std::string gtiname;
+static std::string replay_file;
+static std::string replay_output;
+static std::string trace_file;
 static std::string maketest_template;
 static int maketest_res   = 2048;
 static int maketest_chans = 4;
@@ -270,12 +275,18 @@ getargs(int argc, const char* argv[])
       .help("Use the specified subimage (by index)");
     ap.arg("--subimagename %s:NAME", &subimagename)
       .help("Use the specified subimage (by name)");
+    ap.arg("--replay %s:TRACEFILE", &replay_file)
+      .help("Replay a lookup trace written via the \"trace_file\" attribute");
+    ap.arg("--replay-output %s:FILENAME", &replay_output)
+      .help("Save the replayed results as the pixels of a --res image");
+    ap.arg("--trace %s:TRACEFILE", &trace_file)
+      .help("Record all lookups to a trace file (for --replay)");
 
     // clang-format on
     ap.parse(argc, argv);
 
     if (filenames.size() < 1 && !num_test_files && !test_construction
-        && !test_getimagespec && !testhash) {
+        && !test_getimagespec && !testhash && replay_file.empty()) {
         std::cerr << "testtex: Must have at least one input file\n";
         ap.usage();
         exit(EXIT_FAILURE);
@@ -1579,6 +1590,164 @@ launch_tex_threads(int numthreads, int iterations)
 
 
 
+// One 2D lookup from a trace written by the TextureSystem "trace_file"
+// attribute.
+using TraceLookup = pvt::TextureTraceLookup;
+
+
+
+// Read a lookup trace into names (indexed by name id, 0 unused) and the
+// list of lookups, in the order they were recorded.
+static bool
+read_trace(const std::string& filename, std::vector<ustring>& names,
+           std::vector<TraceLookup>& lookups)
+{
+    std::vector<char> buf(Filesystem::file_size(filename));
+    if (buf.size() < 8
+        || Filesystem::read_bytes(filename, buf.data(), buf.size())
+               != buf.size()
+        || memcmp(buf.data(), pvt::texture_trace_magic, 8) != 0)
+        return false;
+    names.assign(1, ustring());
+    for (size_t pos = 8; pos < buf.size();) {
+        char tag = buf[pos++];
+        if (tag == 'N' && pos + 8 <= buf.size()) {
+            uint32_t id, len;
+            memcpy(&id, &buf[pos], 4);
+            memcpy(&len, &buf[pos + 4], 4);
+            pos += 8;
+            if (pos + len > buf.size())
+                return false;
+            if (id >= names.size())
+                names.resize(id + 1);
+            names[id] = ustring(&buf[pos], len);
+            pos += len;
+        } else if (tag == 'L' && pos + sizeof(TraceLookup) <= buf.size()) {
+            TraceLookup rec;
+            memcpy(&rec, &buf[pos], sizeof(rec));
+            pos += sizeof(rec);
+            if (rec.file >= names.size() || rec.subimagename >= names.size())
+                return false;
+            lookups.push_back(rec);
+        } else {
+            return false;  // corrupt or truncated
+        }
+    }
+    return true;
+}
+
+
+
+// Replay a recorded lookup trace with nthreads threads. The threads take
+// consecutive chunks of the trace in turn, so the lookups are issued in
+// roughly the order the renderer made them.
+static void
+test_replay()
+{
+    std::vector<ustring> names;
+    std::vector<TraceLookup> lookups;
+    if (!read_trace(replay_file, names, lookups)) {
+        Strutil::print(std::cerr, "testtex: could not read trace \"{}\"\n",
+                       replay_file);
+        exit(EXIT_FAILURE);
+    }
+    std::vector<TextureSystem::TextureHandle*> handles(names.size());
+    for (auto& rec : lookups)
+        if (!handles[rec.file])
+            handles[rec.file] = texsys->get_texture_handle(names[rec.file]);
+
+    int nt = nthreads ? nthreads : Sysutil::hardware_concurrency();
+    Strutil::print("Replaying {} lookups of {} names from {}\n",
+                   lookups.size(), names.size() - 1, replay_file);
+    Strutil::print("texture cache size = {} MB, threads = {}\n", cachesize,
+                   nt);
+
+    // With --replay-output, keep the results of every lookup
+    int nc = std::min(nchannels_override ? nchannels_override : 4, 4);
+    std::vector<float> results(replay_output.size() ? lookups.size() * nc
+                                                    : 0);
+
+    auto replay_thread = [&](std::atomic<size_t>* next) {
+        const size_t chunk = 1024;
+        auto perthread     = texsys->get_perthread_info();
+        float result[4], dresultds[4], dresultdt[4];
+        TextureOpt opt;
+        if (missing[0] >= 0)
+            opt.missingcolor = (float*)&missing;
+        for (;;) {
+            size_t begin = next->fetch_add(chunk);
+            if (begin >= lookups.size())
+                break;
+            size_t end = std::min(begin + chunk, lookups.size());
+            for (size_t i = begin; i < end; ++i) {
+                const TraceLookup& rec(lookups[i]);
+                opt.firstchannel        = rec.firstchannel;
+                opt.subimage            = rec.subimage;
+                opt.subimagename        = names[rec.subimagename];
+                opt.swrap               = (TextureOpt::Wrap)rec.swrap;
+                opt.twrap               = (TextureOpt::Wrap)rec.twrap;
+                opt.mipmode             = (TextureOpt::MipMode)rec.mipmode;
+                opt.interpmode          = (TextureOpt::InterpMode)
+                                              rec.interpmode;
+                opt.conservative_filter = (rec.flags & 1) != 0;
+                opt.anisotropic         = rec.anisotropic;
+                opt.sblur               = rec.sblur;
+                opt.tblur               = rec.tblur;
+                opt.swidth              = rec.swidth;
+                opt.twidth              = rec.twidth;
+                opt.fill                = rec.fill;
+                opt.rnd                 = rec.rnd;
+                opt.colortransformid    = rec.colortransformid;
+                bool derivs             = (rec.flags & 2) != 0;
+                texsys->texture(handles[rec.file], perthread, opt, rec.s,
+                                rec.t, rec.dsdx, rec.dtdx, rec.dsdy, rec.dtdy,
+                                std::min(int(rec.nchannels), 4), result,
+                                derivs ? dresultds : nullptr,
+                                derivs ? dresultdt : nullptr);
+                if (results.size())
+                    for (int c = 0; c < nc; ++c)
+                        results[i * nc + c] = c < rec.nchannels ? result[c]
+                                                                : 0.0f;
+            }
+        }
+    };
+
+    for (int it = 0; it < std::max(iters, 1); ++it) {
+        Timer timer;
+        std::atomic<size_t> next(0);
+        OIIO::thread_group threads;
+        for (int i = 0; i < nt; ++i)
+            threads.create_thread(std::bind(replay_thread, &next));
+        threads.join_all();
+        double t = timer();
+        Strutil::print("  pass {}: {} ({:.3g} Mlookups/s)\n", it,
+                       Strutil::timeintervalformat(t, 3),
+                       t > 0 ? 1.0e-6 * lookups.size() / t : 0.0);
+    }
+
+    if (replay_output.size()) {
+        // Lookup i becomes pixel i, in scanline order, so a trace of a
+        // single-threaded texture test reproduces the test's image.
+        ImageBuf image(ImageSpec(output_xres, output_yres, nc, TypeFloat));
+        ImageBufAlgo::zero(image);
+        size_t n = std::min(lookups.size(),
+                            size_t(image.spec().image_pixels()));
+        for (size_t i = 0; i < n; ++i) {
+            float* r = &results[i * nc];
+            for (int c = 0; c < nc; ++c)
+                r[c] *= scalefactor;
+            image.setpixel(int(i % output_xres), int(i / output_xres),
+                           make_span(r, nc));
+        }
+        image.set_write_format(TypeDesc(dataformatname));
+        if (!image.write(replay_output))
+            Strutil::print(std::cerr, "Error writing {} : {}\n",
+                           replay_output, image.geterror());
+    }
+}
+
+
+
 class GridImageInput final : public ImageInput {
 public:
     GridImageInput()
@@ -1831,6 +2000,8 @@ main(int argc, const char* argv[])
     texsys->attribute("gray_to_rgb", gray_to_rgb);
     texsys->attribute("flip_t", flip_t);
     texsys->attribute("stochastic", stochastic);
+    if (trace_file.size())
+        texsys->attribute("trace_file", trace_file);
     texcolortransform_id
         = std::max(0, texsys->get_colortransform_id(ustring(texcolorspace),
                                                     ustring("scene_linear")));
@@ -1911,7 +2082,9 @@ main(int argc, const char* argv[])
         // Strutil::print("tex {} -> {:p}\n", f, (void*)texture_handles.back());
     }
 
-    if (threadtimes) {
+    if (replay_file.size()) {
+        test_replay();
+    } else if (threadtimes) {
         // If the --iters flag was used, do that number of iterations total
         // (divided among the threads). If not supplied (iters will be 1),
         // then use a large constant *per thread*.
@@ -2044,6 +2217,8 @@ main(int argc, const char* argv[])
                        Strutil::memformat(Sysutil::memory_used(true)));
         Strutil::print("{}\n", texsys->getstats(verbose ? 2 : 1));
     }
+    if (trace_file.size())
+        texsys->attribute("trace_file", "");  // finish the trace
     TextureSystem::destroy(texsys);
 
     if (verbose)
@@ -0,0 +1,22 @@
+#!/usr/bin/env python
+
+# Copyright Contributors to the OpenImageIO project.
+# SPDX-License-Identifier: Apache-2.0
+# https://github.com/AcademySoftwareFoundation/OpenImageIO
+
+
+# Record the lookups of a single-threaded texture test, then replay the
+# trace: the replayed lookups, laid out in the order they were recorded,
+# must reproduce the test's image.
+command += testtex_command ("../common/textures/grid.tx",
+                            extraargs = "--threads 1 -res 128 96 -d float"
+                                        + " --trace lookups.trace -o out.exr",
+                            silent = True)
+command += testtex_command ("--replay lookups.trace",
+                            extraargs = "--threads 1 -res 128 96 -d float"
+                                        + " --replay-output replay.exr",
+                            silent = True)
+command += diff_command ("out.exr", "replay.exr", "-fail 0 -hardfail 0",
+                         silent = True)
+
+outputs = [ ]